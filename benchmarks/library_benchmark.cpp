@@ -0,0 +1,167 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <QIcon>
+#include <QMutexLocker>
+#include <memory>
+
+#include "core/database.h"
+#include "globalsearch/librarysearchprovider.h"
+#include "library/librarybackend.h"
+#include "library/libraryitem.h"
+#include "library/librarymodel.h"
+#include "library/libraryquery.h"
+#include "library/sqlrow.h"
+#include "syntheticlibrary.h"
+
+namespace {
+
+// Runs a query the way LibraryModel::RunQuery does, and returns how many rows
+// it got back.
+int RunModelQuery(LibraryBackend* backend, LibraryQuery* q) {
+  QMutexLocker l(backend->db()->Mutex());
+  if (!backend->ExecQuery(q)) return 0;
+
+  SqlRowList rows;
+  while (q->Next()) {
+    rows << SqlRow(*q);
+  }
+  return rows.count();
+}
+
+}  // namespace
+
+static void BM_LibraryBackendAddOrUpdateSongs(benchmark::State& state) {
+  const SongList songs = MakeSongs(state.range(0));
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::unique_ptr<SyntheticLibrary> library(new SyntheticLibrary);
+    state.ResumeTiming();
+
+    library->backend()->AddOrUpdateSongs(songs);
+
+    state.PauseTiming();
+    library.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * songs.count());
+}
+BENCHMARK(BM_LibraryBackendAddOrUpdateSongs)->Apply(LibrarySizes);
+
+// LibraryModel needs a whole Application for its cover loader and task
+// manager, so the model benchmarks build their queries with
+// LibraryModel::BuildQuery and run them the way RunQuery does, grouped by
+// artist and then album.
+static const LibraryModel::Grouping kGrouping(LibraryModel::GroupBy_Artist,
+                                              LibraryModel::GroupBy_Album);
+
+static void BM_LibraryModelReset(benchmark::State& state) {
+  LibraryBackend* backend = SyntheticLibrary::Get(state.range(0))->backend();
+
+  for (auto _ : state) {
+    LibraryItem root(LibraryItem::Type_Root);
+    LibraryQuery artists;
+    LibraryQuery compilations;
+    LibraryModel::BuildQuery(kGrouping, &root, &artists, &compilations);
+
+    // Whether to show the Various artists node.
+    RunModelQuery(backend, &compilations);
+    benchmark::DoNotOptimize(RunModelQuery(backend, &artists));
+  }
+}
+BENCHMARK(BM_LibraryModelReset)->Apply(LibrarySizes);
+
+static void BM_LibraryModelExpand(benchmark::State& state) {
+  SyntheticLibrary* library = SyntheticLibrary::Get(state.range(0));
+  LibraryBackend* backend = library->backend();
+
+  int i = 0;
+  for (auto _ : state) {
+    const Song& song = library->songs()[i++ % library->songs().count()];
+
+    LibraryItem root(LibraryItem::Type_Root);
+    LibraryItem* artist = new LibraryItem(LibraryItem::Type_Container, &root);
+    artist->container_level = 0;
+    artist->key = song.artist();
+    LibraryItem* album = new LibraryItem(LibraryItem::Type_Container, artist);
+    album->container_level = 1;
+    album->key = song.album();
+
+    // Expand an artist...
+    LibraryQuery albums;
+    LibraryQuery unused;
+    LibraryModel::BuildQuery(kGrouping, artist, &albums, &unused);
+    RunModelQuery(backend, &albums);
+
+    // ...and then one of its albums.
+    LibraryQuery songs;
+    LibraryModel::BuildQuery(kGrouping, album, &songs, &unused);
+    {
+      QMutexLocker l(backend->db()->Mutex());
+      backend->ExecQuery(&songs);
+      while (songs.Next()) {
+        Song child;
+        child.InitFromQuery(SqlRow(songs), true);
+        benchmark::DoNotOptimize(child);
+      }
+    }
+  }
+}
+BENCHMARK(BM_LibraryModelExpand)->Apply(LibrarySizes);
+
+static void BM_LibrarySearchProviderSearch(benchmark::State& state) {
+  LibraryBackend* backend = SyntheticLibrary::Get(state.range(0))->backend();
+  LibrarySearchProvider provider(backend, "Library", "library", QIcon(), true,
+                                 nullptr);
+
+  int id = 0;
+  for (auto _ : state) {
+    // One query that matches a whole artist, and one that matches one song.
+    benchmark::DoNotOptimize(provider.Search(id++, "artist 42"));
+    benchmark::DoNotOptimize(provider.Search(id++, "title 4242"));
+  }
+}
+BENCHMARK(BM_LibrarySearchProviderSearch)->Apply(LibrarySizes);
+
+static void BM_SongInitFromQuery(benchmark::State& state) {
+  LibraryBackend* backend = SyntheticLibrary::Get(state.range(0))->backend();
+
+  SqlRowList rows;
+  {
+    LibraryQuery q;
+    q.SetColumnSpec("%songs_table.ROWID, " + Song::kColumnSpec);
+    q.SetLimit(10000);
+
+    QMutexLocker l(backend->db()->Mutex());
+    backend->ExecQuery(&q);
+    while (q.Next()) {
+      rows << SqlRow(q);
+    }
+  }
+
+  for (auto _ : state) {
+    for (const SqlRow& row : rows) {
+      Song song;
+      song.InitFromQuery(row, true);
+      benchmark::DoNotOptimize(song);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * rows.count());
+}
+BENCHMARK(BM_SongInitFromQuery)->Arg(10000);
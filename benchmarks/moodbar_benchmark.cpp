@@ -0,0 +1,117 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <benchmark/benchmark.h>
+
+#include <QPalette>
+#include <QVector>
+#include <cmath>
+
+#include "moodbar/moodbarbuilder.h"
+#include "moodbar/moodbarrenderer.h"
+
+namespace {
+
+// The same as MoodbarPipeline and the fastspectrum element use.
+const int kBands = 128;
+const int kRate = 44100;
+const int kFramesPerSecond = 10;
+const int kWidth = 1000;
+
+// A four minute song.
+const int kSongFrames = 4 * 60 * kFramesPerSecond;
+
+// The spectrum of every frame of a synthetic song: a chord that changes every
+// couple of seconds, over some noise, getting louder and quieter.  The
+// spectra are made with a plain DFT of the PCM once, so only the moodbar
+// code is timed.
+const QVector<double>& Spectra() {
+  static QVector<double> sSpectra;
+  if (!sSpectra.isEmpty()) return sSpectra;
+
+  const int nfft = 2 * kBands - 2;
+  sSpectra.reserve(kSongFrames * kBands);
+
+  QVector<double> cosines(nfft);
+  QVector<double> sines(nfft);
+  for (int i = 0; i < nfft; ++i) {
+    cosines[i] = std::cos(2 * M_PI * i / nfft);
+    sines[i] = std::sin(2 * M_PI * i / nfft);
+  }
+
+  QVector<double> pcm(nfft);
+  unsigned int noise = 1;
+  for (int frame = 0; frame < kSongFrames; ++frame) {
+    const double root = 110.0 * std::pow(2.0, (frame / 20 % 12) / 12.0);
+    const double envelope = 0.5 + 0.5 * std::sin(frame * 0.01);
+    const int offset = frame * kRate / kFramesPerSecond;
+
+    for (int i = 0; i < nfft; ++i) {
+      const double t = double(offset + i) / kRate;
+      noise = noise * 1103515245 + 12345;
+      pcm[i] = envelope * (std::sin(2 * M_PI * root * t) +
+                           0.5 * std::sin(2 * M_PI * root * 1.5 * t) +
+                           0.25 * std::sin(2 * M_PI * root * 4 * t)) +
+               0.05 * (double((noise >> 16) & 0x7fff) / 0x7fff - 0.5);
+    }
+
+    for (int band = 0; band < kBands; ++band) {
+      double re = 0;
+      double im = 0;
+      for (int i = 0; i < nfft; ++i) {
+        const int angle = band * i % nfft;
+        re += pcm[i] * cosines[angle];
+        im -= pcm[i] * sines[angle];
+      }
+      sSpectra << (re * re + im * im) / (nfft * nfft);
+    }
+  }
+  return sSpectra;
+}
+
+QByteArray BuildMoodbar(const QVector<double>& spectra) {
+  MoodbarBuilder builder;
+  builder.Init(kBands, kRate);
+  for (int frame = 0; frame < kSongFrames; ++frame) {
+    builder.AddFrame(spectra.constData() + frame * kBands, kBands);
+  }
+  return builder.Finish(kWidth);
+}
+
+}  // namespace
+
+static void BM_MoodbarBuild(benchmark::State& state) {
+  const QVector<double>& spectra = Spectra();
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(BuildMoodbar(spectra));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MoodbarBuild);
+
+static void BM_MoodbarColors(benchmark::State& state) {
+  const QByteArray data = BuildMoodbar(Spectra());
+  const QPalette palette;
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        MoodbarRenderer::Colors(data, MoodbarRenderer::Style_Normal, palette));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MoodbarColors);
@@ -0,0 +1,127 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <QSortFilterProxyModel>
+#include <memory>
+
+#include "library/librarybackend.h"
+#include "library/libraryplaylistitem.h"
+#include "playlist/playlist.h"
+#include "playlist/playlistbackend.h"
+#include "smartplaylists/generator_fwd.h"
+#include "syntheticlibrary.h"
+
+namespace {
+
+PlaylistItemList MakeItems(SyntheticLibrary* library) {
+  PlaylistItemList ret;
+  ret.reserve(library->songs().count());
+  for (const Song& song : library->songs()) {
+    ret << PlaylistItemPtr(new LibraryPlaylistItem(song));
+  }
+  return ret;
+}
+
+// A playlist that isn't saved anywhere, full of every song in a library.
+std::unique_ptr<Playlist> MakePlaylist(SyntheticLibrary* library) {
+  std::unique_ptr<Playlist> ret(
+      new Playlist(nullptr, nullptr, library->backend(), 1));
+  ret->InsertItems(MakeItems(library));
+  return ret;
+}
+
+}  // namespace
+
+static void BM_PlaylistInsertItems(benchmark::State& state) {
+  SyntheticLibrary* library = SyntheticLibrary::Get(state.range(0));
+  const PlaylistItemList items = MakeItems(library);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::unique_ptr<Playlist> playlist(
+        new Playlist(nullptr, nullptr, library->backend(), 1));
+    state.ResumeTiming();
+
+    playlist->InsertItems(items);
+
+    state.PauseTiming();
+    playlist.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * items.count());
+}
+BENCHMARK(BM_PlaylistInsertItems)->Apply(LibrarySizes);
+
+static void BM_PlaylistSort(benchmark::State& state) {
+  std::unique_ptr<Playlist> playlist =
+      MakePlaylist(SyntheticLibrary::Get(state.range(0)));
+
+  // Alternate the order so every iteration has something to do.
+  bool ascending = false;
+  for (auto _ : state) {
+    playlist->sort(Playlist::Column_Album,
+                   ascending ? Qt::AscendingOrder : Qt::DescendingOrder);
+    ascending = !ascending;
+  }
+}
+BENCHMARK(BM_PlaylistSort)->Apply(LibrarySizes);
+
+static void BM_PlaylistFilter(benchmark::State& state) {
+  std::unique_ptr<Playlist> playlist =
+      MakePlaylist(SyntheticLibrary::Get(state.range(0)));
+
+  for (auto _ : state) {
+    playlist->proxy()->setFilterFixedString("artist 42");
+    benchmark::DoNotOptimize(playlist->proxy()->rowCount());
+    playlist->proxy()->setFilterFixedString(QString());
+  }
+}
+BENCHMARK(BM_PlaylistFilter)->Apply(LibrarySizes);
+
+static void BM_PlaylistBackendSave(benchmark::State& state) {
+  SyntheticLibrary* library = SyntheticLibrary::Get(state.range(0));
+  const PlaylistItemList items = MakeItems(library);
+
+  PlaylistBackend backend(library->database());
+  const int id = backend.CreatePlaylist("Benchmark", QString());
+
+  for (auto _ : state) {
+    backend.SavePlaylist(id, items, -1, smart_playlists::GeneratorPtr());
+  }
+  state.SetItemsProcessed(state.iterations() * items.count());
+
+  backend.RemovePlaylist(id);
+}
+BENCHMARK(BM_PlaylistBackendSave)->Apply(LibrarySizes);
+
+static void BM_PlaylistBackendRestore(benchmark::State& state) {
+  SyntheticLibrary* library = SyntheticLibrary::Get(state.range(0));
+
+  PlaylistBackend backend(library->database());
+  const int id = backend.CreatePlaylist("Benchmark", QString());
+  backend.SavePlaylist(id, MakeItems(library), -1,
+                       smart_playlists::GeneratorPtr());
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(backend.GetPlaylistItems(id));
+  }
+  state.SetItemsProcessed(state.iterations() * library->songs().count());
+
+  backend.RemovePlaylist(id);
+}
+BENCHMARK(BM_PlaylistBackendRestore)->Apply(LibrarySizes);
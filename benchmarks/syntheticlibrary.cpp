@@ -0,0 +1,90 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "syntheticlibrary.h"
+
+#include <QDir>
+#include <QMap>
+#include <QUrl>
+
+#include "core/database.h"
+#include "core/timeconstants.h"
+#include "library/library.h"
+#include "library/librarybackend.h"
+
+namespace {
+
+const int kTracksPerAlbum = 10;
+const int kAlbumsPerArtist = 5;
+const int kGenres = 40;
+
+}  // namespace
+
+SongList MakeSongs(int count) {
+  SongList ret;
+  ret.reserve(count);
+
+  for (int i = 0; i < count; ++i) {
+    const int album = i / kTracksPerAlbum;
+    const int artist = album / kAlbumsPerArtist;
+
+    Song song;
+    song.Init(QString("Title %1").arg(i), QString("Artist %1").arg(artist),
+              QString("Album %1").arg(album), 200 * kNsecPerSec);
+    song.set_track(i % kTracksPerAlbum + 1);
+    song.set_year(1960 + artist % 60);
+    song.set_genre(QString("Genre %1").arg(artist % kGenres));
+    song.set_bitrate(320);
+    song.set_filetype(Song::Type_Mpeg);
+    song.set_directory_id(1);
+    song.set_url(QUrl::fromLocalFile(
+        QString("/music/%1/%2/%3.mp3").arg(artist).arg(album).arg(i)));
+    song.set_mtime(1);
+    song.set_ctime(1);
+    song.set_filesize(8000000);
+    ret << song;
+  }
+
+  return ret;
+}
+
+SyntheticLibrary::SyntheticLibrary(const SongList& songs)
+    : database_(new MemoryDatabase(nullptr)), backend_(new LibraryBackend) {
+  backend_->Init(database_.get(), Library::kSongsTable, Library::kDirsTable,
+                 Library::kSubdirsTable, Library::kFtsTable);
+  backend_->AddDirectory(QDir::tempPath());
+
+  if (!songs.isEmpty()) {
+    backend_->AddOrUpdateSongs(songs);
+    songs_ = backend_->GetAllSongs();
+  }
+}
+
+SyntheticLibrary::~SyntheticLibrary() {}
+
+SyntheticLibrary* SyntheticLibrary::Get(int count) {
+  static QMap<int, SyntheticLibrary*> sLibraries;
+
+  SyntheticLibrary*& library = sLibraries[count];
+  if (!library) {
+    library = new SyntheticLibrary(MakeSongs(count));
+  }
+  return library;
+}
+
+void LibrarySizes(benchmark::internal::Benchmark* b) {
+  b->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+}
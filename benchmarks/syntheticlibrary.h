@@ -0,0 +1,58 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SYNTHETICLIBRARY_H
+#define SYNTHETICLIBRARY_H
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include "core/song.h"
+
+class Database;
+class LibraryBackend;
+
+// Makes songs that are shaped like a real library: 10 tracks per album, 5
+// albums per artist, and a few dozen genres.
+SongList MakeSongs(int count);
+
+// A library in a MemoryDatabase.
+class SyntheticLibrary {
+ public:
+  explicit SyntheticLibrary(const SongList& songs = SongList());
+  ~SyntheticLibrary();
+
+  // Returns a library of count songs.  Making a big library takes a while, so
+  // each size is only made once and then shared by all the benchmarks.
+  static SyntheticLibrary* Get(int count);
+
+  Database* database() const { return database_.get(); }
+  LibraryBackend* backend() const { return backend_.get(); }
+
+  // The songs as they were read back from the library, with their IDs set.
+  const SongList& songs() const { return songs_; }
+
+ private:
+  std::unique_ptr<Database> database_;
+  std::unique_ptr<LibraryBackend> backend_;
+  SongList songs_;
+};
+
+// Runs a benchmark with libraries of 10k, 100k and 1M songs.
+void LibrarySizes(benchmark::internal::Benchmark* b);
+
+#endif  // SYNTHETICLIBRARY_H
@@ -62,16 +62,28 @@ CREATE TABLE device_%deviceid_songs (
   lyrics TEXT,
 
   originalyear INTEGER,
-  effective_originalyear INTEGER
+  effective_originalyear INTEGER,
+
+  rg_track_gain REAL,
+  rg_track_peak REAL,
+  rg_album_gain REAL,
+  rg_album_peak REAL
 );
 
 CREATE INDEX idx_device_%deviceid_songs_album ON device_%deviceid_songs (album);
 
 CREATE INDEX idx_device_%deviceid_songs_comp_artist ON device_%deviceid_songs (effective_compilation, artist);
 
-CREATE VIRTUAL TABLE device_%deviceid_fts USING fts3(
-  ftstitle, ftsalbum, ftsartist, ftsalbumartist, ftscomposer, ftsperformer, ftsgrouping, ftsgenre, ftscomment, ftsyear
-  tokenize=unicode
+CREATE VIEW device_%deviceid_fts_source AS
+  SELECT ROWID AS fts_rowid, title AS ftstitle, album AS ftsalbum, artist AS ftsartist,
+    albumartist AS ftsalbumartist, composer AS ftscomposer, performer AS ftsperformer,
+    grouping AS ftsgrouping, genre AS ftsgenre, comment AS ftscomment, year AS ftsyear
+  FROM device_%deviceid_songs;
+
+CREATE VIRTUAL TABLE device_%deviceid_fts USING fts5(
+  ftstitle, ftsalbum, ftsartist, ftsalbumartist, ftscomposer, ftsperformer, ftsgrouping, ftsgenre, ftscomment, ftsyear,
+  content='device_%deviceid_fts_source', content_rowid='fts_rowid',
+  tokenize='unicode61 remove_diacritics 2', prefix='1 2 3'
 );
 
 UPDATE devices SET schema_version=0 WHERE ROWID=%deviceid;
@@ -49,14 +49,29 @@ CREATE TABLE jamendo.songs (
   lyrics TEXT,
 
   originalyear INTEGER,
-  effective_originalyear INTEGER
+  effective_originalyear INTEGER,
+
+  rg_track_gain REAL,
+  rg_track_peak REAL,
+  rg_album_gain REAL,
+  rg_album_peak REAL
 );
 
-CREATE VIRTUAL TABLE jamendo.songs_fts USING fts3(
+CREATE VIEW jamendo.songs_fts_source AS
+  SELECT ROWID AS fts_rowid, title AS ftstitle, album AS ftsalbum, artist AS ftsartist,
+    albumartist AS ftsalbumartist, composer AS ftscomposer, performer AS ftsperformer,
+    grouping AS ftsgrouping, genre AS ftsgenre, comment AS ftscomment, year AS ftsyear
+  FROM jamendo.songs;
+
+CREATE VIRTUAL TABLE jamendo.songs_fts USING fts5(
   ftstitle, ftsalbum, ftsartist, ftsalbumartist, ftscomposer, ftsperformer, ftsgrouping, ftsgenre, ftscomment, ftsyear,
-  tokenize=unicode
+  content='songs_fts_source', content_rowid='fts_rowid',
+  tokenize='unicode61 remove_diacritics 2', prefix='1 2 3'
 );
 
+INSERT INTO jamendo.songs_fts (songs_fts, rank)
+  VALUES ('rank', 'bm25(10.0, 4.0, 8.0, 6.0, 2.0, 2.0, 1.0, 1.0, 0.5, 0.5)');
+
 CREATE INDEX jamendo.idx_jamendo_comp_artist ON songs (effective_compilation, artist);
 
 CREATE TABLE jamendo.track_ids (
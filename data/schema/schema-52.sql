@@ -0,0 +1,20 @@
+CREATE TABLE fingerprints (
+  song_id INTEGER PRIMARY KEY,
+  mtime INTEGER NOT NULL,
+  fingerprint TEXT NOT NULL
+);
+
+CREATE TABLE fingerprint_hashes (
+  hash INTEGER NOT NULL,
+  song_id INTEGER NOT NULL
+);
+
+CREATE INDEX idx_fingerprint_hashes_hash ON fingerprint_hashes (hash);
+
+CREATE INDEX idx_fingerprint_hashes_song_id ON fingerprint_hashes (song_id);
+
+CREATE TABLE audio_duplicates (
+  song_id INTEGER PRIMARY KEY
+);
+
+UPDATE schema_version SET version=52;
@@ -0,0 +1,25 @@
+CREATE INDEX idx_songs_artist ON songs (unavailable, artist, album, effective_compilation);
+
+CREATE INDEX idx_songs_albumartist ON songs (unavailable, effective_albumartist, album, effective_compilation);
+
+CREATE INDEX idx_songs_album ON songs (unavailable, album, grouping, effective_compilation);
+
+CREATE INDEX idx_songs_year ON songs (unavailable, year, originalyear, album, grouping, effective_compilation);
+
+CREATE INDEX idx_songs_originalyear ON songs (unavailable, effective_originalyear, album, effective_compilation);
+
+CREATE INDEX idx_songs_genre ON songs (unavailable, genre, artist, album, effective_compilation);
+
+CREATE INDEX idx_songs_composer ON songs (unavailable, composer, album, effective_compilation);
+
+CREATE INDEX idx_songs_performer ON songs (unavailable, performer, album, effective_compilation);
+
+CREATE INDEX idx_songs_grouping ON songs (unavailable, grouping, album, effective_compilation);
+
+CREATE INDEX idx_songs_disc ON songs (unavailable, disc, effective_compilation);
+
+CREATE INDEX idx_songs_bitrate ON songs (unavailable, bitrate, effective_compilation);
+
+CREATE INDEX idx_songs_filetype ON songs (unavailable, filetype, effective_compilation);
+
+UPDATE schema_version SET version=53;
@@ -0,0 +1,22 @@
+DROP TABLE %allsongstables_fts;
+
+CREATE VIEW %allsongstables_fts_source AS
+  SELECT ROWID AS fts_rowid, title AS ftstitle, album AS ftsalbum, artist AS ftsartist,
+    albumartist AS ftsalbumartist, composer AS ftscomposer, performer AS ftsperformer,
+    grouping AS ftsgrouping, genre AS ftsgenre, comment AS ftscomment, year AS ftsyear
+  FROM %allsongstables;
+
+CREATE VIRTUAL TABLE %allsongstables_fts USING fts5(
+  ftstitle, ftsalbum, ftsartist, ftsalbumartist, ftscomposer, ftsperformer, ftsgrouping, ftsgenre, ftscomment, ftsyear,
+  content='%allsongstables_noprefix_fts_source', content_rowid='fts_rowid',
+  tokenize='unicode61 remove_diacritics 2', prefix='1 2 3'
+);
+
+INSERT INTO %allsongstables_fts (%allsongstables_noprefix_fts) VALUES ('rebuild');
+
+INSERT INTO %allsongstables_fts (%allsongstables_noprefix_fts, rank)
+  VALUES ('rank', 'bm25(10.0, 4.0, 8.0, 6.0, 2.0, 2.0, 1.0, 1.0, 0.5, 0.5)');
+
+DROP TABLE playlist_items_fts;
+
+UPDATE schema_version SET version=54;
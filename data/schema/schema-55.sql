@@ -0,0 +1,9 @@
+ALTER TABLE %allsongstables ADD COLUMN rg_track_gain REAL;
+
+ALTER TABLE %allsongstables ADD COLUMN rg_track_peak REAL;
+
+ALTER TABLE %allsongstables ADD COLUMN rg_album_gain REAL;
+
+ALTER TABLE %allsongstables ADD COLUMN rg_album_peak REAL;
+
+UPDATE schema_version SET version=55;
@@ -24,6 +24,10 @@
 #include <QTextCodec>
 #include <QUrl>
 
+#include "core/sharedmemorybuffer.h"
+
+const int TagReaderWorker::kSharedMemoryThreshold = 64 * 1024;
+
 TagReaderWorker::TagReaderWorker(QIODevice* socket, QObject* parent)
     : AbstractMessageHandler<cpb::tagreader::Message>(socket, parent) {}
 
@@ -42,6 +46,14 @@ void TagReaderWorker::MessageArrived(const cpb::tagreader::Message& message) {
     tag_reader_.ReadFile(
         QStringFromStdString(message.read_file_request().filename()),
         reply.mutable_read_file_response()->mutable_metadata());
+  } else if (message.has_read_files_request()) {
+    cpb::tagreader::ReadFilesResponse* response =
+        reply.mutable_read_files_response();
+    for (const std::string& filename :
+         message.read_files_request().filenames()) {
+      tag_reader_.ReadFile(QStringFromStdString(filename),
+                           response->add_metadata());
+    }
   } else if (message.has_save_file_request()) {
     reply.mutable_save_file_response()->set_success(tag_reader_.SaveFile(
         QStringFromStdString(message.save_file_request().filename()),
@@ -62,10 +74,25 @@ void TagReaderWorker::MessageArrived(const cpb::tagreader::Message& message) {
     reply.mutable_is_media_file_response()->set_success(tag_reader_.IsMediaFile(
         QStringFromStdString(message.is_media_file_request().filename())));
   } else if (message.has_load_embedded_art_request()) {
-    QByteArray data = tag_reader_.LoadEmbeddedArt(
-        QStringFromStdString(message.load_embedded_art_request().filename()));
-    reply.mutable_load_embedded_art_response()->set_data(data.constData(),
-                                                         data.size());
+    const cpb::tagreader::LoadEmbeddedArtRequest& req =
+        message.load_embedded_art_request();
+    cpb::tagreader::LoadEmbeddedArtResponse* response =
+        reply.mutable_load_embedded_art_response();
+
+    QByteArray data =
+        tag_reader_.LoadEmbeddedArt(QStringFromStdString(req.filename()));
+
+    QString shared_memory_name;
+    if (req.allow_shared_memory() && data.size() >= kSharedMemoryThreshold) {
+      shared_memory_name = SharedMemoryBuffer::Write(data);
+    }
+
+    if (shared_memory_name.isEmpty()) {
+      response->set_data(data.constData(), data.size());
+    } else {
+      response->set_shared_memory_name(
+          DataCommaSizeFromQString(shared_memory_name));
+    }
   } else if (message.has_read_cloud_file_request()) {
 #ifdef HAVE_GOOGLE_DRIVE
     const cpb::tagreader::ReadCloudFileRequest& req =
@@ -27,6 +27,10 @@ class TagReaderWorker : public AbstractMessageHandler<cpb::tagreader::Message> {
  public:
   TagReaderWorker(QIODevice* socket, QObject* parent = NULL);
 
+  // Embedded art at least this big is sent in a SharedMemoryBuffer, if the
+  // client allows it.
+  static const int kSharedMemoryThreshold;
+
  protected:
   void MessageArrived(const cpb::tagreader::Message& message);
   void DeviceClosed();
@@ -0,0 +1,110 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sharedmemorybuffer.h"
+
+#include <QAtomicInt>
+#include <QCoreApplication>
+
+#include "core/logging.h"
+
+#ifdef Q_OS_UNIX
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+SharedMemoryBuffer::SharedMemoryBuffer(const QString& name)
+    : data_(nullptr), size_(0) {
+#ifdef Q_OS_UNIX
+  const QByteArray encoded_name = name.toLatin1();
+
+  int fd = shm_open(encoded_name.constData(), O_RDONLY, 0);
+  const int open_error = errno;
+
+  // Remove the name even if it couldn't be opened, so the segment doesn't
+  // stay around until the next reboot.
+  shm_unlink(encoded_name.constData());
+
+  if (fd == -1) {
+    qLog(Warning) << "Couldn't open shared memory" << name
+                  << strerror(open_error);
+    return;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+      qLog(Warning) << "Couldn't map shared memory" << name << strerror(errno);
+    } else {
+      data_ = reinterpret_cast<uchar*>(data);
+      size_ = info.st_size;
+    }
+  }
+  close(fd);
+#else
+  Q_UNUSED(name);
+#endif
+}
+
+SharedMemoryBuffer::~SharedMemoryBuffer() {
+#ifdef Q_OS_UNIX
+  if (data_) munmap(data_, size_);
+#endif
+}
+
+QString SharedMemoryBuffer::Write(const QByteArray& data) {
+#ifdef Q_OS_UNIX
+  static QAtomicInt sNextId;
+
+  // Some systems only allow short names, so keep it under 31 characters.
+  const QString name = QString("/clem-%1-%2")
+                           .arg(QCoreApplication::applicationPid())
+                           .arg(sNextId.fetchAndAddRelaxed(1));
+  const QByteArray encoded_name = name.toLatin1();
+
+  int fd = shm_open(encoded_name.constData(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd == -1) {
+    qLog(Warning) << "Couldn't create shared memory" << name << strerror(errno);
+    return QString();
+  }
+
+  bool ok = false;
+  if (ftruncate(fd, data.size()) == 0) {
+    void* mapped = mmap(nullptr, data.size(), PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped != MAP_FAILED) {
+      memcpy(mapped, data.constData(), data.size());
+      munmap(mapped, data.size());
+      ok = true;
+    }
+  }
+  close(fd);
+
+  if (!ok) {
+    qLog(Warning) << "Couldn't write shared memory" << name << strerror(errno);
+    shm_unlink(encoded_name.constData());
+    return QString();
+  }
+  return name;
+#else
+  Q_UNUSED(data);
+  return QString();
+#endif
+}
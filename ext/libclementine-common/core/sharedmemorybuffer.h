@@ -0,0 +1,52 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORE_SHAREDMEMORYBUFFER_H
+#define CORE_SHAREDMEMORYBUFFER_H
+
+#include <QByteArray>
+#include <QString>
+
+// A named block of POSIX shared memory, used to hand large payloads from a
+// worker process to Clementine without copying them through protobuf and the
+// local socket.  The worker writes the payload into a new segment and sends
+// only its name.  Clementine maps it read-only and unlinks it straight away, so
+// the memory is freed as soon as the SharedMemoryBuffer is destroyed.
+//
+// Only supported on Unix - elsewhere Write() always fails and callers should
+// send the payload inline.
+class SharedMemoryBuffer {
+ public:
+  // Maps the segment with the given name and removes the name.
+  explicit SharedMemoryBuffer(const QString& name);
+  ~SharedMemoryBuffer();
+
+  // Copies data into a new segment and returns its name, or an empty string
+  // if it couldn't be created.
+  static QString Write(const QByteArray& data);
+
+  bool is_valid() const { return data_ != nullptr; }
+  const uchar* data() const { return data_; }
+  int size() const { return size_; }
+
+ private:
+  Q_DISABLE_COPY(SharedMemoryBuffer)
+
+  uchar* data_;
+  int size_;
+};
+
+#endif  // CORE_SHAREDMEMORYBUFFER_H
@@ -0,0 +1,201 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tracing.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "core/logging.h"
+
+namespace tracing {
+
+std::atomic<bool> sEnabled(false);
+
+namespace {
+
+const int kMaxEventsPerThread = 1 << 16;
+
+struct Event {
+  const char* category_;
+  const char* name_;
+  qint64 start_usec_;
+  qint64 duration_usec_;
+};
+
+// Incremented by Start().  Buffers recorded in an older generation are
+// thrown away.
+std::atomic<int> sGeneration(0);
+
+// Only the thread that owns a buffer writes to it.  The writer publishes each
+// event by incrementing count_ after the event is written, so the events
+// before count_ can be read from another thread at any time.  The writer
+// empties its buffer itself when it sees that tracing was started again, and
+// then publishes the new generation_.
+struct ThreadBuffer {
+  ThreadBuffer(int id, const QString& thread_name)
+      : id_(id), thread_name_(thread_name), events_(kMaxEventsPerThread),
+        generation_(0), count_(0), dropped_(0) {}
+
+  const int id_;
+  const QString thread_name_;
+  std::vector<Event> events_;
+  std::atomic<int> generation_;
+  std::atomic<int> count_;
+  std::atomic<int> dropped_;
+};
+
+// Buffers are never freed, because a thread might still be writing to its
+// buffer while another one saves the trace.
+QMutex sBuffersMutex;
+QList<ThreadBuffer*> sBuffers;
+
+thread_local ThreadBuffer* sThreadBuffer = nullptr;
+
+ThreadBuffer* CurrentThreadBuffer() {
+  if (!sThreadBuffer) {
+    QString thread_name = QThread::currentThread()->objectName();
+    if (thread_name.isEmpty()) {
+      thread_name = qApp && QThread::currentThread() == qApp->thread()
+                        ? QString("Main thread")
+                        : QString("Thread");
+    }
+
+    QMutexLocker l(&sBuffersMutex);
+    sThreadBuffer = new ThreadBuffer(sBuffers.count() + 1, thread_name);
+    sBuffers << sThreadBuffer;
+  }
+  return sThreadBuffer;
+}
+
+QByteArray Escape(const QString& str) {
+  QByteArray ret = str.toUtf8();
+  ret.replace('\\', "\\\\");
+  ret.replace('"', "\\\"");
+  return ret;
+}
+
+}  // namespace
+
+void Start() {
+  sGeneration.fetch_add(1);
+
+  qLog(Info) << "Tracing started";
+  sEnabled.store(true);
+}
+
+qint64 Now() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void Record(const char* category, const char* name, qint64 start_usec,
+            qint64 duration_usec) {
+  ThreadBuffer* buffer = CurrentThreadBuffer();
+
+  const int generation = sGeneration.load(std::memory_order_relaxed);
+  if (buffer->generation_.load(std::memory_order_relaxed) != generation) {
+    buffer->count_.store(0, std::memory_order_relaxed);
+    buffer->dropped_.store(0, std::memory_order_relaxed);
+    buffer->generation_.store(generation, std::memory_order_release);
+  }
+
+  const int index = buffer->count_.load(std::memory_order_relaxed);
+  if (index >= kMaxEventsPerThread) {
+    buffer->dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  Event& event = buffer->events_[index];
+  event.category_ = category;
+  event.name_ = name;
+  event.start_usec_ = start_usec;
+  event.duration_usec_ = duration_usec;
+  buffer->count_.store(index + 1, std::memory_order_release);
+}
+
+bool StopAndSave(const QString& filename) {
+  sEnabled.store(false);
+
+  QFile file(filename);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    qLog(Error) << "Couldn't write trace to" << filename;
+    return false;
+  }
+
+  const qint64 pid = QCoreApplication::applicationPid();
+  int total = 0;
+  int dropped = 0;
+
+  file.write("{\"traceEvents\":[\n");
+  bool first = true;
+
+  const int generation = sGeneration.load();
+
+  QMutexLocker l(&sBuffersMutex);
+  for (const ThreadBuffer* buffer : sBuffers) {
+    // Threads that haven't recorded anything since Start() still hold the
+    // last trace's events.
+    if (buffer->generation_.load(std::memory_order_acquire) != generation) {
+      continue;
+    }
+
+    const int count = buffer->count_.load(std::memory_order_acquire);
+    if (count == 0) continue;
+
+    if (!first) file.write(",\n");
+    first = false;
+    file.write(QString("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%1,"
+                       "\"tid\":%2,\"args\":{\"name\":\"")
+                   .arg(pid)
+                   .arg(buffer->id_)
+                   .toUtf8() +
+               Escape(buffer->thread_name_) + "\"}}");
+
+    for (int i = 0; i < count; ++i) {
+      const Event& event = buffer->events_[i];
+      file.write(QString(",\n{\"ph\":\"X\",\"cat\":\"%1\",\"name\":\"%2\","
+                         "\"ts\":%3,\"dur\":%4,\"pid\":%5,\"tid\":%6}")
+                     .arg(event.category_, event.name_)
+                     .arg(event.start_usec_)
+                     .arg(event.duration_usec_)
+                     .arg(pid)
+                     .arg(buffer->id_)
+                     .toUtf8());
+    }
+
+    total += count;
+    dropped += buffer->dropped_.load();
+  }
+
+  file.write("\n]}\n");
+
+  qLog(Info) << "Wrote" << total << "trace events to" << filename;
+  if (dropped) {
+    qLog(Warning) << dropped << "trace events didn't fit and were dropped";
+  }
+  return true;
+}
+
+}  // namespace tracing
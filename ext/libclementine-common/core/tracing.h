@@ -0,0 +1,77 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORE_TRACING_H
+#define CORE_TRACING_H
+
+#include <QString>
+#include <atomic>
+
+// Records how long things take across all of Clementine's threads, and writes
+// them out in the Chrome trace event format, which can be opened in
+// chrome://tracing or ui.perfetto.dev.
+//
+// Put TRACE_SPAN("category", "name") at the top of a block to record the time
+// spent in it.  Both arguments have to be string literals.  When tracing isn't
+// running, a span costs one relaxed atomic load.
+//
+// Each thread records into its own fixed-size buffer, so recording never takes
+// a lock.  Events that don't fit in a thread's buffer are dropped.
+namespace tracing {
+
+extern std::atomic<bool> sEnabled;
+
+inline bool IsEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+
+// Throws away anything that was recorded before and starts recording.
+void Start();
+
+// Stops recording and writes the recorded events to a JSON file.  Returns
+// false if the file couldn't be written.
+bool StopAndSave(const QString& filename);
+
+// Microseconds since an arbitrary point in time.
+qint64 Now();
+void Record(const char* category, const char* name, qint64 start_usec,
+            qint64 duration_usec);
+
+class ScopedSpan {
+ public:
+  ScopedSpan(const char* category, const char* name)
+      : category_(category), name_(name), start_usec_(-1) {
+    if (IsEnabled()) start_usec_ = Now();
+  }
+
+  ~ScopedSpan() {
+    if (start_usec_ != -1) {
+      Record(category_, name_, start_usec_, Now() - start_usec_);
+    }
+  }
+
+ private:
+  const char* category_;
+  const char* name_;
+  qint64 start_usec_;
+};
+
+}  // namespace tracing
+
+#define TRACE_SPAN_NAME2(line) trace_span_##line
+#define TRACE_SPAN_NAME(line) TRACE_SPAN_NAME2(line)
+#define TRACE_SPAN(category, name) \
+  tracing::ScopedSpan TRACE_SPAN_NAME(__LINE__)(category, name)
+
+#endif  // CORE_TRACING_H
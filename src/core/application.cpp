@@ -30,8 +30,10 @@
 #include "core/database.h"
 #include "core/lazy.h"
 #include "core/player.h"
+#include "core/startuptrace.h"
 #include "core/tagreaderclient.h"
 #include "core/taskmanager.h"
+#include "core/trackprefetcher.h"
 #include "covers/albumcoverloader.h"
 #include "covers/coverproviders.h"
 #include "covers/currentartloader.h"
@@ -125,6 +127,7 @@ class ApplicationImpl {
         }),
         task_manager_([=]() { return new TaskManager(app); }),
         player_([=]() { return new Player(app, app); }),
+        track_prefetcher_([=]() { return new TrackPrefetcher(app, app); }),
         playlist_manager_([=]() { return new PlaylistManager(app); }),
         current_art_loader_([=]() { return new CurrentArtLoader(app, app); }),
         global_search_([=]() { return new GlobalSearch(app, app); }),
@@ -184,6 +187,7 @@ class ApplicationImpl {
   Lazy<CoverProviders> cover_providers_;
   Lazy<TaskManager> task_manager_;
   Lazy<Player> player_;
+  Lazy<TrackPrefetcher> track_prefetcher_;
   Lazy<PlaylistManager> playlist_manager_;
   Lazy<CurrentArtLoader> current_art_loader_;
   Lazy<GlobalSearch> global_search_;
@@ -202,7 +206,7 @@ class ApplicationImpl {
 };
 
 Application::Application(QObject* parent)
-    : QObject(parent), p_(new ApplicationImpl(this)) {
+    : QObject(parent), p_(new ApplicationImpl(this)), started_(false) {
   setObjectName("Clementine Application");
 
   // Show the splash
@@ -266,6 +270,37 @@ void Application::Starting() {
   if (splash_) {
     splash_.reset();
   }
+
+  StartupTrace::Mark("Event loop started");
+
+  // Give the window a chance to paint before doing anything else.
+  started_ = true;
+  QTimer::singleShot(0, this, SLOT(RunNextDeferred()));
+}
+
+void Application::RunAfterStartup(QObject* receiver, const char* method) {
+  if (started_ && deferred_.isEmpty()) {
+    QMetaObject::invokeMethod(receiver, method, Qt::QueuedConnection);
+    return;
+  }
+
+  deferred_ << qMakePair(QPointer<QObject>(receiver), QByteArray(method));
+}
+
+void Application::RunNextDeferred() {
+  if (deferred_.isEmpty()) {
+    StartupTrace::Mark("Deferred startup work dispatched");
+    return;
+  }
+
+  QPair<QPointer<QObject>, QByteArray> call = deferred_.takeFirst();
+  if (call.first) {
+    QMetaObject::invokeMethod(call.first, call.second.constData(),
+                              Qt::AutoConnection);
+  }
+
+  // Let any events that are waiting be handled before the next one.
+  QTimer::singleShot(0, this, SLOT(RunNextDeferred()));
 }
 
 QString Application::language_without_region() const {
@@ -380,4 +415,8 @@ TaskManager* Application::task_manager() const {
   return p_->task_manager_.get();
 }
 
+TrackPrefetcher* Application::track_prefetcher() const {
+  return p_->track_prefetcher_.get();
+}
+
 void Application::DirtySettings() { p_->settings_timer_.start(); }
@@ -23,6 +23,8 @@
 #define CORE_APPLICATION_H_
 
 #include <QObject>
+#include <QPair>
+#include <QPointer>
 #include <memory>
 
 #include "ui/settingsdialog.h"
@@ -58,6 +60,7 @@ class Scrobbler;
 class Splash;
 class TagReaderClient;
 class TaskManager;
+class TrackPrefetcher;
 
 class Application : public QObject {
   Q_OBJECT
@@ -108,12 +111,19 @@ class Application : public QObject {
   Scrobbler* scrobbler() const;
   TagReaderClient* tag_reader_client() const;
   TaskManager* task_manager() const;
+  TrackPrefetcher* track_prefetcher() const;
 
   void DirtySettings();
 
   void MoveToNewThread(QObject* object);
   void MoveToThread(QObject* object, QThread* thread);
 
+  // Invokes the method on receiver once the main window is showing and the
+  // event loop is idle.  Use this for work that the user doesn't need to see
+  // the window or play the current playlist, so it doesn't hold up startup.
+  // Deferred methods are invoked one at a time, in the order they were added.
+  void RunAfterStartup(QObject* receiver, const char* method);
+
  public slots:
   void Starting();
   void AddError(const QString& message);
@@ -130,12 +140,16 @@ class Application : public QObject {
 
  private slots:
   void SaveSettings_();
+  void RunNextDeferred();
 
  private:
   QString language_name_;
   std::unique_ptr<ApplicationImpl> p_;
   std::unique_ptr<Splash> splash_;
   QList<QThread*> threads_;
+
+  bool started_;
+  QList<QPair<QPointer<QObject>, QByteArray>> deferred_;
 };
 
 #endif  // CORE_APPLICATION_H_
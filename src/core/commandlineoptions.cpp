@@ -70,7 +70,8 @@ const char* CommandlineOptions::kHelpText =
     "      --verbose               %31\n"
     "      --log-levels <levels>   %32\n"
     "      --version               %33\n"
-    "  -x, --delete-current        %34\n";
+    "  -x, --delete-current        %34\n"
+    "      --startup-trace         %35\n";
 
 const char* CommandlineOptions::kVersionText = "Clementine %1";
 
@@ -87,7 +88,8 @@ CommandlineOptions::CommandlineOptions(int argc, char** argv)
       delete_current_track_(false),
       show_osd_(false),
       toggle_pretty_osd_(false),
-      log_levels_(logging::kDefaultLogLevels) {
+      log_levels_(logging::kDefaultLogLevels),
+      startup_trace_(false) {
 #ifdef Q_OS_DARWIN
   // Remove -psn_xxx option that Mac passes when opened from Finder.
   RemoveArg("-psn", 1);
@@ -141,6 +143,7 @@ bool CommandlineOptions::Parse() {
       {"log-levels", required_argument, 0, LogLevels},
       {"version", no_argument, 0, Version},
       {"delete-current", no_argument, 0, 'x'},
+      {"startup-trace", no_argument, 0, StartupTraceOption},
       {0, 0, 0, 0}};
 
   // Parse the arguments
@@ -188,7 +191,8 @@ bool CommandlineOptions::Parse() {
                      tr("Equivalent to --log-levels *:3"),
                      tr("Comma separated list of class:level, level is 0-3"))
                 .arg(tr("Print out version information"),
-                     tr("Delete the currently playing song"));
+                     tr("Delete the currently playing song"),
+                     tr("Log how long each stage of startup takes"));
 
         std::cout << translated_help_text.toLocal8Bit().constData();
         return false;
@@ -253,6 +257,9 @@ bool CommandlineOptions::Parse() {
       case LogLevels:
         log_levels_ = QString(optarg);
         break;
+      case StartupTraceOption:
+        startup_trace_ = true;
+        break;
       case Version: {
         QString version_text =
             QString(kVersionText).arg(CLEMENTINE_VERSION_DISPLAY);
@@ -77,6 +77,7 @@ class CommandlineOptions {
   QList<QUrl> urls() const { return urls_; }
   QString language() const { return language_; }
   QString log_levels() const { return log_levels_; }
+  bool startup_trace() const { return startup_trace_; }
   QString playlist_name() const { return playlist_name_; }
 
   QByteArray Serialize() const;
@@ -96,7 +97,8 @@ class CommandlineOptions {
     Version,
     VolumeIncreaseBy,
     VolumeDecreaseBy,
-    RestartOrPrevious
+    RestartOrPrevious,
+    StartupTraceOption
   };
 
   QString tr(const char* source_text);
@@ -123,6 +125,9 @@ class CommandlineOptions {
   QString playlist_name_;
 
   QList<QUrl> urls_;
+
+  // Only affects this instance, so isn't serialized.
+  bool startup_trace_;
 };
 
 QDataStream& operator<<(QDataStream& s, const CommandlineOptions& a);
@@ -47,8 +47,9 @@
 #include "utilities.h"
 
 const char* Database::kDatabaseFilename = "clementine.db";
-const int Database::kSchemaVersion = 51;
+const int Database::kSchemaVersion = 55;
 const char* Database::kMagicAllSongsTables = "%allsongstables";
+const char* Database::kMagicAllSongsTablesNoPrefix = "%allsongstables_noprefix";
 
 int Database::sNextConnectionId = 1;
 QMutex Database::sNextConnectionIdMutex;
@@ -249,6 +250,14 @@ QSqlDatabase Database::Connect() {
   // Try to find an existing connection for this thread
   QSqlDatabase db = QSqlDatabase::database(connection_id);
   if (db.isOpen()) {
+    // The plans of slow statements can't be worked out while sqlite is running
+    // them, so it's done the next time this thread needs the connection.
+    if (query_profiler_.has_pending()) {
+      QVariant v = db.driver()->handle();
+      if (v.isValid() && qstrcmp(v.typeName(), "sqlite3*") == 0) {
+        query_profiler_.ExplainPending(*static_cast<sqlite3**>(v.data()));
+      }
+    }
     return db;
   }
 
@@ -267,6 +276,14 @@ QSqlDatabase Database::Connect() {
   // Find Sqlite3 functions in the Qt plugin.
   if (!sFTSTokenizer) StaticInit();
 
+  {
+    QVariant v = db.driver()->handle();
+    if (v.isValid() && qstrcmp(v.typeName(), "sqlite3*") == 0) {
+      sqlite3* handle = *static_cast<sqlite3**>(v.data());
+      if (handle) query_profiler_.Install(handle);
+    }
+  }
+
   {
 #ifdef SQLITE_DBCONFIG_ENABLE_FTS3_TOKENIZER
     // In case sqlite>=3.12 is compiled without -DSQLITE_ENABLE_FTS3_TOKENIZER
@@ -544,14 +561,20 @@ void Database::ExecSongTablesCommands(QSqlDatabase& db,
     if (command.contains(kMagicAllSongsTables)) {
       for (const QString& table : song_tables) {
         // Another horrible hack: device songs tables don't have matching _fts
-        // tables, so if this command tries to touch one, ignore it.
-        if (table.startsWith("device_") &&
+        // tables, and playlist_items never used its own, so if this command
+        // tries to touch one, ignore it.
+        if ((table.startsWith("device_") || table == "playlist_items") &&
             command.contains(QString(kMagicAllSongsTables) + "_fts")) {
           continue;
         }
 
         qLog(Info) << "Updating" << table << "for" << kMagicAllSongsTables;
         QString new_command(command);
+        // Some things (like the content option of an FTS5 table) are always
+        // looked up in the same database as the table being created, so they
+        // need the name without the "jamendo." prefix.
+        new_command.replace(kMagicAllSongsTablesNoPrefix,
+                            table.section('.', -1, -1));
         new_command.replace(kMagicAllSongsTables, table);
         QSqlQuery query(db.exec(new_command));
         if (CheckErrors(query))
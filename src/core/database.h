@@ -33,6 +33,7 @@
 #include <QSqlError>
 #include <QStringList>
 
+#include "core/queryprofiler.h"
 #include "gtest/gtest_prod.h"
 
 extern "C" {
@@ -64,10 +65,12 @@ class Database : public QObject {
   static const int kSchemaVersion;
   static const char* kDatabaseFilename;
   static const char* kMagicAllSongsTables;
+  static const char* kMagicAllSongsTablesNoPrefix;
 
   QSqlDatabase Connect();
   bool CheckErrors(const QSqlQuery& query);
   QMutex* Mutex() { return &mutex_; }
+  QueryProfiler* query_profiler() { return &query_profiler_; }
 
   void RecreateAttachedDb(const QString& database_name);
   void ExecSchemaCommands(QSqlDatabase& db, const QString& schema,
@@ -111,6 +114,7 @@ class Database : public QObject {
   QMap<QString, AttachedDatabase> attached_databases_;
 
   QString directory_;
+  QueryProfiler query_profiler_;
   QMutex connect_mutex_;
   QMutex mutex_;
 
@@ -0,0 +1,220 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "filecopier.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QtGlobal>
+#include <memory>
+
+#include "core/logging.h"
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <linux/fs.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const qint64 FileCopier::kBufferSize = 4 * 1024 * 1024;        // 4MB
+const qint64 FileCopier::kKernelChunkSize = 64 * 1024 * 1024;  // 64MB
+
+bool FileCopier::Copy(const QString& source, const QString& destination,
+                      bool verify, ProgressFunction progress) {
+  QFile source_file(source);
+  if (!source_file.open(QIODevice::ReadOnly)) {
+    qLog(Warning) << "Failed to open" << source << "for reading:"
+                  << source_file.errorString();
+    return false;
+  }
+
+  if (QFile::exists(destination)) {
+    qLog(Warning) << "Not overwriting existing file" << destination;
+    return false;
+  }
+
+  QFile destination_file(destination);
+  if (!destination_file.open(QIODevice::WriteOnly)) {
+    qLog(Warning) << "Failed to open" << destination << "for writing:"
+                  << destination_file.errorString();
+    return false;
+  }
+
+  bool ok = CopyContents(&source_file, &destination_file, progress);
+  destination_file.close();
+  source_file.close();
+
+  if (ok) {
+    destination_file.setPermissions(source_file.permissions());
+  }
+
+  if (ok && verify) {
+    const QByteArray source_checksum = Checksum(source);
+    ok = !source_checksum.isEmpty() && source_checksum == Checksum(destination);
+    if (!ok) {
+      qLog(Warning) << "Verification failed after copying" << source << "to"
+                    << destination;
+    }
+  }
+
+  if (!ok) {
+    QFile::remove(destination);
+    return false;
+  }
+
+  if (progress) progress(1.0);
+  return true;
+}
+
+bool FileCopier::Move(const QString& source, const QString& destination,
+                      bool verify, ProgressFunction progress) {
+  // A rename is atomic and never touches the data, so there's nothing to
+  // verify.
+  if (QFile::rename(source, destination)) {
+    if (progress) progress(1.0);
+    return true;
+  }
+
+  qLog(Debug) << "Couldn't rename" << source << "to" << destination
+              << "- copying instead";
+
+  if (!Copy(source, destination, verify, progress)) return false;
+
+  if (!QFile::remove(source)) {
+    qLog(Warning) << "Copied" << source << "but failed to remove the original";
+  }
+  return true;
+}
+
+bool FileCopier::CopyContents(QFile* source, QFile* destination,
+                              const ProgressFunction& progress) {
+  const qint64 size = source->size();
+
+#ifdef Q_OS_LINUX
+  const int source_fd = source->handle();
+  const int destination_fd = destination->handle();
+
+  if (Reflink(source_fd, destination_fd)) {
+    return true;
+  }
+
+  bool unsupported = false;
+  if (KernelCopy(source_fd, destination_fd, size, progress, &unsupported)) {
+    return true;
+  }
+  if (!unsupported) return false;
+
+  // copy_file_range might have failed before writing anything, but make sure
+  // both files are back at the start before streaming.
+  if (!destination->resize(0) || !source->seek(0) || !destination->seek(0)) {
+    return false;
+  }
+#endif
+
+  return StreamCopy(source, destination, size, progress);
+}
+
+bool FileCopier::Reflink(int source_fd, int destination_fd) {
+#if defined(Q_OS_LINUX) && defined(FICLONE)
+  return ioctl(destination_fd, FICLONE, source_fd) == 0;
+#else
+  Q_UNUSED(source_fd);
+  Q_UNUSED(destination_fd);
+  return false;
+#endif
+}
+
+bool FileCopier::KernelCopy(int source_fd, int destination_fd, qint64 size,
+                            const ProgressFunction& progress,
+                            bool* unsupported) {
+#if defined(Q_OS_LINUX) && defined(SYS_copy_file_range)
+  qint64 copied = 0;
+  while (copied < size) {
+    const qint64 chunk = qMin(kKernelChunkSize, size - copied);
+    const long ret =
+        syscall(SYS_copy_file_range, source_fd, nullptr, destination_fd,
+                nullptr, static_cast<size_t>(chunk), 0u);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+
+      // These mean the kernel or filesystem can't do it for this pair of
+      // files - the caller should fall back to a userspace copy.
+      if (copied == 0 && (errno == ENOSYS || errno == EXDEV ||
+                          errno == EINVAL || errno == EOPNOTSUPP)) {
+        *unsupported = true;
+      } else {
+        qLog(Warning) << "copy_file_range failed:" << strerror(errno);
+      }
+      return false;
+    }
+    if (ret == 0) {
+      // The file got shorter while we were copying it.
+      break;
+    }
+
+    copied += ret;
+    if (progress && size > 0) progress(float(copied) / size);
+  }
+  return true;
+#else
+  Q_UNUSED(source_fd);
+  Q_UNUSED(destination_fd);
+  Q_UNUSED(size);
+  Q_UNUSED(progress);
+  *unsupported = true;
+  return false;
+#endif
+}
+
+bool FileCopier::StreamCopy(QFile* source, QFile* destination, qint64 size,
+                            const ProgressFunction& progress) {
+  std::unique_ptr<char[]> buffer(new char[kBufferSize]);
+
+  qint64 copied = 0;
+  forever {
+    const qint64 bytes_read = source->read(buffer.get(), kBufferSize);
+    if (bytes_read < 0) {
+      qLog(Warning) << "Error reading" << source->fileName() << ":"
+                    << source->errorString();
+      return false;
+    }
+    if (bytes_read == 0) break;
+
+    if (destination->write(buffer.get(), bytes_read) != bytes_read) {
+      qLog(Warning) << "Error writing" << destination->fileName() << ":"
+                    << destination->errorString();
+      return false;
+    }
+
+    copied += bytes_read;
+    if (progress && size > 0) progress(float(copied) / size);
+  }
+
+  return destination->flush();
+}
+
+QByteArray FileCopier::Checksum(const QString& filename) {
+  QFile file(filename);
+  if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  if (!hash.addData(&file)) return QByteArray();
+  return hash.result();
+}
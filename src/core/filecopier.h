@@ -0,0 +1,67 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORE_FILECOPIER_H_
+#define CORE_FILECOPIER_H_
+
+#include <QByteArray>
+#include <QString>
+#include <functional>
+
+class QFile;
+
+// Copies or moves a single local file as fast as the filesystem allows.
+// In order of preference it will:
+//  * rename the file (moves only, when source and destination are on the
+//    same filesystem),
+//  * clone the file's extents with FICLONE on filesystems that support
+//    reflinks (btrfs, XFS, ...),
+//  * let the kernel copy the data with copy_file_range,
+//  * stream the data through a large userspace buffer.
+// All functions are reentrant, so several files can be copied concurrently
+// from different threads.
+class FileCopier {
+ public:
+  typedef std::function<void(float progress)> ProgressFunction;
+
+  static const qint64 kBufferSize;
+  static const qint64 kKernelChunkSize;
+
+  // Copies source to destination.  Fails if destination already exists.  If
+  // verify is true the contents of both files are compared with a checksum
+  // afterwards and the copy is removed if they don't match.
+  static bool Copy(const QString& source, const QString& destination,
+                   bool verify = false,
+                   ProgressFunction progress = ProgressFunction());
+
+  // Like Copy(), but removes source afterwards.  Falls back to copying when
+  // a rename isn't possible (eg. across filesystems).
+  static bool Move(const QString& source, const QString& destination,
+                   bool verify = false,
+                   ProgressFunction progress = ProgressFunction());
+
+ private:
+  static bool CopyContents(QFile* source, QFile* destination,
+                           const ProgressFunction& progress);
+  static bool Reflink(int source_fd, int destination_fd);
+  static bool KernelCopy(int source_fd, int destination_fd, qint64 size,
+                         const ProgressFunction& progress, bool* unsupported);
+  static bool StreamCopy(QFile* source, QFile* destination, qint64 size,
+                         const ProgressFunction& progress);
+  static QByteArray Checksum(const QString& filename);
+};
+
+#endif  // CORE_FILECOPIER_H_
@@ -26,6 +26,7 @@
 #include <QFile>
 #include <QUrl>
 
+#include "core/filecopier.h"
 #include "core/logging.h"
 #include "core/utilities.h"
 
@@ -51,9 +52,11 @@ bool FilesystemMusicStorage::CopyToStorage(const CopyJob& job) {
 
   // Copy or move
   if (job.remove_original_)
-    return QFile::rename(src.absoluteFilePath(), dest.absoluteFilePath());
+    return FileCopier::Move(src.absoluteFilePath(), dest.absoluteFilePath(),
+                            job.verify_, job.progress_);
   else
-    return QFile::copy(src.absoluteFilePath(), dest.absoluteFilePath());
+    return FileCopier::Copy(src.absoluteFilePath(), dest.absoluteFilePath(),
+                            job.verify_, job.progress_);
 }
 
 bool FilesystemMusicStorage::DeleteFromStorage(const DeleteJob& job) {
@@ -27,10 +27,11 @@ class FilesystemMusicStorage : public virtual MusicStorage {
   explicit FilesystemMusicStorage(const QString& root);
   ~FilesystemMusicStorage() {}
 
-  QString LocalPath() const { return root_; }
+  QString LocalPath() const override { return root_; }
 
-  bool CopyToStorage(const CopyJob& job);
-  bool DeleteFromStorage(const DeleteJob& job);
+  bool CopyToStorage(const CopyJob& job) override;
+  bool SupportsParallelCopy() const override { return true; }
+  bool DeleteFromStorage(const DeleteJob& job) override;
 
  private:
   QString root_;
@@ -54,6 +54,7 @@ class MusicStorage {
     bool overwrite_;
     bool mark_as_listened_;
     bool remove_original_;
+    bool verify_;
     ProgressFunction progress_;
   };
 
@@ -75,6 +76,9 @@ class MusicStorage {
     return true;
   }
   virtual bool CopyToStorage(const CopyJob& job) = 0;
+  // Storages that return true here must allow CopyToStorage to be called from
+  // several threads at once.
+  virtual bool SupportsParallelCopy() const { return false; }
   virtual void FinishCopy(bool success) {}
 
   virtual void StartDelete() {}
@@ -28,6 +28,7 @@
 #include <QUrl>
 #include <functional>
 
+#include "core/closure.h"
 #include "core/logging.h"
 #include "core/tagreaderclient.h"
 #include "core/utilities.h"
@@ -38,6 +39,7 @@ using std::placeholders::_1;
 
 const int Organise::kBatchSize = 10;
 const int Organise::kTranscodeProgressInterval = 500;
+const int Organise::kDefaultCopyWorkers = 4;
 
 Organise::Organise(TaskManager* task_manager,
                    std::shared_ptr<MusicStorage> destination,
@@ -54,11 +56,14 @@ Organise::Organise(TaskManager* task_manager,
       mark_as_listened_(mark_as_listened),
       eject_after_(eject_after),
       task_count_(songs_info.count()),
+      copy_workers_(kDefaultCopyWorkers),
+      verify_copies_(false),
       transcode_suffix_(1),
       tasks_complete_(0),
+      copy_queue_(WorkScheduler::Priority_Normal),
+      next_copy_id_(0),
       started_(false),
-      task_id_(0),
-      current_copy_progress_(0) {
+      task_id_(0) {
   original_thread_ = thread();
 
   for (const NewSongInfo& song_info : songs_info) {
@@ -103,6 +108,13 @@ void Organise::ProcessSomeFiles() {
       return;
     }
 
+    if (!tasks_copying_.isEmpty()) {
+      // ParallelCopyFinished will start us off again when the last one is
+      // done.
+      qLog(Debug) << "Waiting for copy jobs";
+      return;
+    }
+
     UpdateProgress();
 
     destination_->FinishCopy(files_with_errors_.isEmpty());
@@ -122,12 +134,18 @@ void Organise::ProcessSomeFiles() {
     return;
   }
 
+  if (parallel_copy()) {
+    copy_queue_.set_max_concurrency(copy_workers_);
+  }
+
   // We process files in batches so we can be cancelled part-way through.
   for (int i = 0; i < kBatchSize; ++i) {
-    SetSongProgress(0);
-
     if (tasks_pending_.isEmpty()) break;
 
+    // Don't queue up more copies than there are workers to run them -
+    // ParallelCopyFinished will call us again when one is done.
+    if (parallel_copy() && tasks_copying_.count() >= copy_workers_) return;
+
     Task task = tasks_pending_.takeFirst();
     qLog(Info) << "Processing" << task.song_info_.song_.url().toLocalFile();
 
@@ -184,6 +202,8 @@ void Organise::ProcessSomeFiles() {
       }
     }
 
+    const int copy_id = next_copy_id_++;
+
     MusicStorage::CopyJob job;
     job.source_ = task.transcoded_filename_.isEmpty()
                       ? task.song_info_.song_.url().toLocalFile()
@@ -193,35 +213,80 @@ void Organise::ProcessSomeFiles() {
     job.overwrite_ = overwrite_;
     job.mark_as_listened_ = mark_as_listened_;
     job.remove_original_ = !copy_;
-    job.progress_ = std::bind(&Organise::SetSongProgress, this, _1,
+    job.verify_ = verify_copies_;
+    job.progress_ = std::bind(&Organise::SetSongProgress, this, copy_id, _1,
                               !task.transcoded_filename_.isEmpty());
 
-    if (!destination_->CopyToStorage(job)) {
-      files_with_errors_ << task.song_info_.song_.basefilename();
-    } else {
-      if (job.remove_original_) {
-        // Notify other aspects of system that song has been invalidated
-        QString root = destination_->LocalPath();
-        QFileInfo new_file =
-            QFileInfo(root + "/" + task.song_info_.new_filename_);
-        emit SongPathChanged(song, new_file);
-      }
-      if (job.mark_as_listened_) {
-        emit FileCopied(job.metadata_.id());
-      }
+    SetSongProgress(copy_id, 0, !task.transcoded_filename_.isEmpty());
+
+    if (parallel_copy()) {
+      CopyTask copy_task;
+      copy_task.task_ = task;
+      copy_task.job_ = job;
+      tasks_copying_[copy_id] = copy_task;
+
+      QFuture<bool> future = copy_queue_.Run<bool, MusicStorage::CopyJob>(
+          std::bind(&MusicStorage::CopyToStorage, destination_.get(), _1),
+          job);
+      NewClosure(future, this, SLOT(ParallelCopyFinished(QFuture<bool>, int)),
+                 future, copy_id);
+      copy_progress_timer_.start(kTranscodeProgressInterval, this);
+      continue;
+    }
+
+    const bool success = destination_->CopyToStorage(job);
+    {
+      QMutexLocker l(&copy_progress_mutex_);
+      copy_progress_.remove(copy_id);
     }
+    CopyFinished(task, job, success);
+  }
 
-    // Clean up the temporary transcoded file
-    if (!task.transcoded_filename_.isEmpty())
-      QFile::remove(task.transcoded_filename_);
+  QTimer::singleShot(0, this, SLOT(ProcessSomeFiles()));
+}
 
-    tasks_complete_++;
+void Organise::ParallelCopyFinished(QFuture<bool> future, int copy_id) {
+  const CopyTask copy_task = tasks_copying_.take(copy_id);
+  {
+    QMutexLocker l(&copy_progress_mutex_);
+    copy_progress_.remove(copy_id);
   }
-  SetSongProgress(0);
+  if (tasks_copying_.isEmpty()) copy_progress_timer_.stop();
+
+  CopyFinished(copy_task.task_, copy_task.job_, future.result());
+  UpdateProgress();
 
   QTimer::singleShot(0, this, SLOT(ProcessSomeFiles()));
 }
 
+void Organise::CopyFinished(const Task& task, const MusicStorage::CopyJob& job,
+                            bool success) {
+  if (!success) {
+    files_with_errors_ << task.song_info_.song_.basefilename();
+  } else {
+    if (job.remove_original_) {
+      // Notify other aspects of system that song has been invalidated
+      QString root = destination_->LocalPath();
+      QFileInfo new_file =
+          QFileInfo(root + "/" + task.song_info_.new_filename_);
+      emit SongPathChanged(job.metadata_, new_file);
+    }
+    if (job.mark_as_listened_) {
+      emit FileCopied(job.metadata_.id());
+    }
+  }
+
+  // Clean up the temporary transcoded file
+  if (!task.transcoded_filename_.isEmpty())
+    QFile::remove(task.transcoded_filename_);
+
+  tasks_complete_++;
+}
+
+bool Organise::parallel_copy() const {
+  return copy_workers_ > 1 && destination_->SupportsParallelCopy();
+}
+
 Song::FileType Organise::CheckTranscode(Song::FileType original_type) const {
   if (original_type == Song::Type_Stream) return Song::Type_Unknown;
 
@@ -251,11 +316,18 @@ Song::FileType Organise::CheckTranscode(Song::FileType original_type) const {
   return Song::Type_Unknown;
 }
 
-void Organise::SetSongProgress(float progress, bool transcoded) {
+void Organise::SetSongProgress(int copy_id, float progress, bool transcoded) {
   const int max = transcoded ? 50 : 100;
-  current_copy_progress_ = (transcoded ? 50 : 0) +
-                           qBound(0, static_cast<int>(progress * max), max - 1);
-  UpdateProgress();
+  {
+    QMutexLocker l(&copy_progress_mutex_);
+    copy_progress_[copy_id] =
+        (transcoded ? 50 : 0) +
+        qBound(0, static_cast<int>(progress * max), max - 1);
+  }
+
+  // Parallel copies report progress from their own threads - those are picked
+  // up by copy_progress_timer_ instead.
+  if (QThread::currentThread() == thread()) UpdateProgress();
 }
 
 void Organise::UpdateProgress() {
@@ -282,8 +354,13 @@ void Organise::UpdateProgress() {
     progress += qBound(0, static_cast<int>(task.transcode_progress_ * 50), 50);
   }
 
-  // Add the progress of the track that's currently copying
-  progress += current_copy_progress_;
+  // Add the progress of the tracks that are currently copying
+  {
+    QMutexLocker l(&copy_progress_mutex_);
+    for (int copy_progress : copy_progress_) {
+      progress += copy_progress;
+    }
+  }
 
   task_manager_->SetTaskProgress(task_id_, progress, total);
 }
@@ -308,7 +385,8 @@ void Organise::FileTranscoded(const QUrl& input, const QString& output,
 void Organise::timerEvent(QTimerEvent* e) {
   QObject::timerEvent(e);
 
-  if (e->timerId() == transcode_progress_timer_.timerId()) {
+  if (e->timerId() == transcode_progress_timer_.timerId() ||
+      e->timerId() == copy_progress_timer_.timerId()) {
     UpdateProgress();
   }
 }
@@ -24,14 +24,17 @@
 
 #include <QBasicTimer>
 #include <QFileInfo>
+#include <QFuture>
+#include <QMutex>
 #include <QObject>
 #include <QTemporaryFile>
 #include <memory>
 
+#include "core/workscheduler.h"
+#include "musicstorage.h"
 #include "organiseformat.h"
 #include "transcoder/transcoder.h"
 
-class MusicStorage;
 class TaskManager;
 
 class Organise : public QObject {
@@ -54,6 +57,13 @@ class Organise : public QObject {
 
   static const int kBatchSize;
   static const int kTranscodeProgressInterval;
+  static const int kDefaultCopyWorkers;
+
+  // How many files may be copied at the same time.  Only has an effect if
+  // the destination supports parallel copies.
+  void set_copy_workers(int workers) { copy_workers_ = qMax(1, workers); }
+  // Compare checksums of the source and destination after each copy.
+  void set_verify_copies(bool verify) { verify_copies_ = verify; }
 
   void Start();
 
@@ -68,11 +78,13 @@ class Organise : public QObject {
  private slots:
   void ProcessSomeFiles();
   void FileTranscoded(const QUrl& input, const QString& output, bool success);
+  void ParallelCopyFinished(QFuture<bool> future, int copy_id);
 
  private:
-  void SetSongProgress(float progress, bool transcoded = false);
+  void SetSongProgress(int copy_id, float progress, bool transcoded = false);
   void UpdateProgress();
   Song::FileType CheckTranscode(Song::FileType original_type) const;
+  bool parallel_copy() const;
 
  private:
   struct Task {
@@ -87,6 +99,14 @@ class Organise : public QObject {
     Song::FileType new_filetype_;
   };
 
+  struct CopyTask {
+    Task task_;
+    MusicStorage::CopyJob job_;
+  };
+
+  void CopyFinished(const Task& task, const MusicStorage::CopyJob& job,
+                    bool success);
+
   QThread* thread_;
   QThread* original_thread_;
   TaskManager* task_manager_;
@@ -100,8 +120,11 @@ class Organise : public QObject {
   const bool mark_as_listened_;
   const bool eject_after_;
   int task_count_;
+  int copy_workers_;
+  bool verify_copies_;
 
   QBasicTimer transcode_progress_timer_;
+  QBasicTimer copy_progress_timer_;
   QTemporaryFile transcode_temp_name_;
   int transcode_suffix_;
 
@@ -109,10 +132,19 @@ class Organise : public QObject {
   QMap<QString, Task> tasks_transcoding_;
   int tasks_complete_;
 
+  // Copies that are running on copy_queue_, keyed by copy ID.
+  WorkQueue copy_queue_;
+  QMap<int, CopyTask> tasks_copying_;
+  int next_copy_id_;
+
   bool started_;
 
   int task_id_;
-  int current_copy_progress_;
+
+  // Progress of each copy in flight, out of 100.  Written from the copy
+  // threads.
+  QMutex copy_progress_mutex_;
+  QMap<int, int> copy_progress_;
 
   QStringList files_with_errors_;
 };
@@ -52,6 +52,23 @@ using std::shared_ptr;
 
 const char* Player::kSettingsGroup = "Player";
 
+namespace {
+
+MediaPlaybackRequest RequestForItem(PlaylistItemPtr item) {
+  MediaPlaybackRequest req(item->Url());
+
+  const Song& song = item->Metadata();
+  if (song.has_replaygain()) {
+    req.rg_track_gain_ = song.replaygain_track_gain();
+    req.rg_track_peak_ = song.replaygain_track_peak();
+    req.rg_album_gain_ = song.replaygain_album_gain();
+    req.rg_album_peak_ = song.replaygain_album_peak();
+  }
+  return req;
+}
+
+}  // namespace
+
 Player::Player(Application* app, QObject* parent)
     : PlayerInterface(parent),
       app_(app),
@@ -484,10 +501,11 @@ void Player::PlayAt(int index, Engine::TrackChangeFlags change,
     HandleLoadResult(url_handlers_[url.scheme()]->StartLoading(url));
   } else {
     loading_async_ = QUrl();
-    MediaPlaybackRequest req(current_item_->Url());
+    MediaPlaybackRequest req = RequestForItem(current_item_);
     engine_->Play(req, change, current_item_->Metadata().has_cue(),
                   current_item_->Metadata().beginning_nanosec(),
                   current_item_->Metadata().end_nanosec());
+    PrerollUpcoming();
 
 #ifdef HAVE_LIBLASTFM
     if (lastfm_->IsScrobblingEnabled())
@@ -496,6 +514,28 @@ void Player::PlayAt(int index, Engine::TrackChangeFlags change,
   }
 }
 
+void Player::PrerollUpcoming() {
+  Playlist* playlist = app_->playlist_manager()->active();
+
+  // Next and Previous both ignore "Repeat track".  next_row takes the queue
+  // into account.
+  QList<MediaPlaybackRequest> reqs;
+  for (int row : {playlist->next_row(true), playlist->previous_row(true)}) {
+    if (!playlist->has_item_at(row)) continue;
+
+    PlaylistItemPtr item = playlist->item_at(row);
+    // Tracks from URL handlers and cue sheets need more than their URL to be
+    // played.
+    if (url_handlers_.contains(item->Url().scheme()) ||
+        item->Metadata().has_cue()) {
+      continue;
+    }
+    reqs << RequestForItem(item);
+  }
+
+  engine_->Preroll(reqs);
+}
+
 void Player::CurrentMetadataChanged(const Song& metadata) {
   // those things might have changed (especially when a previously invalid
   // song was reloaded) so we push the latest version into Engine
@@ -650,7 +690,7 @@ void Player::TrackAboutToEnd() {
   // gap between songs.
   if (!has_next_row || !next_item) return;
 
-  MediaPlaybackRequest req(next_item->Url());
+  MediaPlaybackRequest req = RequestForItem(next_item);
 
   // Get the actual track URL rather than the stream URL.
   UrlHandler* handler = url_handlers_.value(req.RequestUrl().scheme(), nullptr);
@@ -204,6 +204,9 @@ class Player : public PlayerInterface {
 
   void HandleInvalidItem(const QUrl& url);
 
+  // Tells the engine which tracks the user is likely to skip to next.
+  void PrerollUpcoming();
+
  private:
   Application* app_;
   Scrobbler* lastfm_;
@@ -0,0 +1,254 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "queryprofiler.h"
+
+#include <sqlite3.h>
+
+#include <QHash>
+#include <QMutexLocker>
+#include <QStringList>
+#include <algorithm>
+
+#include "core/logging.h"
+
+// sqlite3_trace_v2 tells us how many rows each statement returned, the older
+// sqlite3_profile only how long it took.
+#if SQLITE_VERSION_NUMBER >= 3014000
+#define HAVE_SQLITE_TRACE_V2
+#endif
+
+const int QueryProfiler::kMaxSamples = 1000;
+const int QueryProfiler::kMaxStatements = 500;
+const int QueryProfiler::kDefaultSlowQueryMsec = 100;
+
+namespace {
+
+#ifdef HAVE_SQLITE_TRACE_V2
+// Rows returned so far by each statement that's running on this thread.
+// Connections are never shared between threads, so this needs no lock.  The
+// counts belong to one profiler, and are thrown away when it's disabled,
+// since statements can be reset or finalized without ever finishing.
+thread_local QHash<sqlite3_stmt*, qint64> sRowCounts;
+thread_local const QueryProfiler* sRowCountsProfiler = nullptr;
+thread_local int sRowCountsGeneration = 0;
+#endif
+
+// Set while we're explaining a slow statement, so the EXPLAIN itself isn't
+// profiled.
+thread_local bool sExplaining = false;
+
+}  // namespace
+
+QueryProfiler::QueryProfiler()
+    : enabled_(false),
+      slow_query_msec_(kDefaultSlowQueryMsec),
+      generation_(0),
+      pending_count_(0) {}
+
+void QueryProfiler::Install(sqlite3* handle) {
+#ifdef HAVE_SQLITE_TRACE_V2
+  sqlite3_trace_v2(handle,
+                   SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE | SQLITE_TRACE_ROW,
+                   &QueryProfiler::TraceCallback, this);
+#else
+  sqlite3_profile(handle, &QueryProfiler::ProfileCallback, this);
+#endif
+}
+
+void QueryProfiler::SetEnabled(bool enabled) {
+  // Each thread empties its own row counts when it sees the new generation.
+  if (!enabled) generation_.ref();
+  enabled_.store(enabled);
+  qLog(Info) << "Query profiling" << (enabled ? "enabled" : "disabled");
+}
+
+void QueryProfiler::SetSlowQueryMsec(int msec) { slow_query_msec_.store(msec); }
+
+int QueryProfiler::TraceCallback(unsigned type, void* context, void* p,
+                                 void* x) {
+#ifdef HAVE_SQLITE_TRACE_V2
+  QueryProfiler* me = reinterpret_cast<QueryProfiler*>(context);
+  if (!me->is_enabled() || sExplaining) return 0;
+
+  const int generation = me->generation_.load();
+  if (sRowCountsProfiler != me || sRowCountsGeneration != generation) {
+    sRowCounts.clear();
+    sRowCountsProfiler = me;
+    sRowCountsGeneration = generation;
+  }
+
+  sqlite3_stmt* stmt = reinterpret_cast<sqlite3_stmt*>(p);
+  if (type == SQLITE_TRACE_STMT) {
+    // A statement is starting, unless this is a trigger inside it, so any
+    // count left behind by an earlier statement at this address is stale.
+    const char* sql = reinterpret_cast<const char*>(x);
+    if (!sql || qstrncmp(sql, "--", 2) != 0) sRowCounts.remove(stmt);
+  } else if (type == SQLITE_TRACE_ROW) {
+    sRowCounts[stmt]++;
+  } else if (type == SQLITE_TRACE_PROFILE) {
+    const qint64 nsec = *reinterpret_cast<sqlite3_int64*>(x);
+    me->StatementFinished(sqlite3_db_handle(stmt), sqlite3_sql(stmt), nsec,
+                          sRowCounts.take(stmt));
+  }
+#else
+  Q_UNUSED(type);
+  Q_UNUSED(context);
+  Q_UNUSED(p);
+  Q_UNUSED(x);
+#endif
+  return 0;
+}
+
+void QueryProfiler::ProfileCallback(void* context, const char* sql,
+                                    quint64 nsec) {
+  QueryProfiler* me = reinterpret_cast<QueryProfiler*>(context);
+  if (!me->is_enabled() || sExplaining) return;
+
+  // The old interface doesn't give us the connection, so slow statements are
+  // logged without their plan.
+  me->StatementFinished(nullptr, sql, nsec, 0);
+}
+
+void QueryProfiler::StatementFinished(sqlite3* handle, const char* sql,
+                                      qint64 nsec, qint64 rows) {
+  if (!sql) return;
+  const QString sql_str = QString::fromUtf8(sql).simplified();
+  const bool slow = nsec >= qint64(slow_query_msec()) * 1000000;
+
+  {
+    QMutexLocker l(&mutex_);
+    auto it = entries_.find(sql_str);
+    if (it == entries_.end()) {
+      if (entries_.count() >= kMaxStatements) DropCheapestEntry();
+      it = entries_.insert(sql_str, Entry());
+    }
+
+    Entry& entry = it.value();
+    entry.count_++;
+    entry.total_nsec_ += nsec;
+    entry.rows_ += rows;
+
+    if (entry.samples_.count() < kMaxSamples) {
+      entry.samples_ << nsec;
+    } else {
+      entry.samples_[entry.next_sample_] = nsec;
+      entry.next_sample_ = (entry.next_sample_ + 1) % kMaxSamples;
+    }
+
+    // The plan of a statement doesn't change, so it's only asked for the
+    // first time it's slow.  An empty plan means it's on its way.
+    if (slow && handle && entry.plan_.isNull()) {
+      entry.plan_ = "";
+      pending_plans_[handle] << PendingPlan{sql_str, QByteArray(sql)};
+      pending_count_.ref();
+    }
+  }
+
+  if (!slow) return;
+
+  qLog(Warning) << "Slow query" << sql_str << "took" << nsec / 1000000
+                << "ms and returned" << rows << "rows";
+}
+
+void QueryProfiler::DropCheapestEntry() {
+  auto cheapest = entries_.begin();
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    if (it->total_nsec_ < cheapest->total_nsec_) cheapest = it;
+  }
+  if (cheapest != entries_.end()) entries_.erase(cheapest);
+}
+
+void QueryProfiler::ExplainPending(sqlite3* handle) {
+  if (!has_pending()) return;
+
+  QList<PendingPlan> pending;
+  {
+    QMutexLocker l(&mutex_);
+    pending = pending_plans_.take(handle);
+    pending_count_.fetchAndAddOrdered(-pending.count());
+  }
+
+  for (const PendingPlan& statement : pending) {
+    const QString plan = ExplainQueryPlan(handle, statement.sql_.constData());
+    qLog(Warning) << "Query plan for" << statement.key_ << ":\n"
+                  << plan.toUtf8().constData();
+
+    QMutexLocker l(&mutex_);
+    auto it = entries_.find(statement.key_);
+    if (it != entries_.end()) it->plan_ = plan;
+  }
+}
+
+QString QueryProfiler::ExplainQueryPlan(sqlite3* handle, const char* sql) {
+  sExplaining = true;
+
+  QStringList lines;
+  sqlite3_stmt* stmt = nullptr;
+  const QByteArray explain = QByteArray("EXPLAIN QUERY PLAN ") + sql;
+  if (sqlite3_prepare_v2(handle, explain.constData(), -1, &stmt, nullptr) ==
+      SQLITE_OK) {
+    // The last column is the description of each step, in every version of
+    // sqlite.
+    const int detail_column = sqlite3_column_count(stmt) - 1;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      lines << QString::fromUtf8(reinterpret_cast<const char*>(
+          sqlite3_column_text(stmt, detail_column)));
+    }
+  }
+  sqlite3_finalize(stmt);
+
+  sExplaining = false;
+  return lines.join("\n");
+}
+
+QList<QueryProfiler::Stats> QueryProfiler::Results() const {
+  QList<Stats> ret;
+
+  QMutexLocker l(&mutex_);
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    const Entry& entry = it.value();
+
+    Stats stats;
+    stats.sql_ = it.key();
+    stats.count_ = entry.count_;
+    stats.total_nsec_ = entry.total_nsec_;
+    stats.rows_ = entry.rows_;
+    stats.plan_ = entry.plan_;
+
+    if (!entry.samples_.isEmpty()) {
+      QVector<qint64> samples = entry.samples_;
+      const int index = (samples.count() - 1) * 99 / 100;
+      std::nth_element(samples.begin(), samples.begin() + index,
+                       samples.end());
+      stats.p99_nsec_ = samples[index];
+    }
+
+    ret << stats;
+  }
+
+  std::sort(ret.begin(), ret.end(), [](const Stats& a, const Stats& b) {
+    return a.total_nsec_ > b.total_nsec_;
+  });
+  return ret;
+}
+
+void QueryProfiler::Reset() {
+  QMutexLocker l(&mutex_);
+  entries_.clear();
+  pending_plans_.clear();
+  pending_count_.store(0);
+}
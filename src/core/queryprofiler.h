@@ -0,0 +1,121 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORE_QUERYPROFILER_H_
+#define CORE_QUERYPROFILER_H_
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+// Times every statement run on the sqlite connections it's installed on, and
+// adds them up by their SQL, so you can see which queries are slow or run too
+// often.  Statements that take longer than the slow query threshold are logged,
+// and so is their query plan once ExplainPending has worked it out.
+//
+// Profiling is off until SetEnabled(true) is called.  While it's off the only
+// cost is a callback per statement that returns straight away.
+class QueryProfiler {
+ public:
+  QueryProfiler();
+
+  // How many of the latest timings of each statement are kept to work out the
+  // 99th percentile.
+  static const int kMaxSamples;
+  // How many different statements are kept.  When there are more, the one that
+  // has taken the least time in total is dropped.
+  static const int kMaxStatements;
+  static const int kDefaultSlowQueryMsec;
+
+  struct Stats {
+    Stats() : count_(0), total_nsec_(0), p99_nsec_(0), rows_(0) {}
+
+    QString sql_;
+    int count_;
+    qint64 total_nsec_;
+    qint64 p99_nsec_;
+    qint64 rows_;
+
+    // Only set for statements that were slower than the threshold.
+    QString plan_;
+  };
+
+  // Starts watching a connection.  The profiler must outlive it.
+  void Install(sqlite3* handle);
+
+  // Works out the plans of the slow statements that have finished on a
+  // connection.  Running another statement from inside sqlite's callbacks
+  // isn't safe, so this is called by the connection's thread instead, when
+  // sqlite has returned.
+  void ExplainPending(sqlite3* handle);
+  bool has_pending() const { return pending_count_.load() > 0; }
+
+  bool is_enabled() const { return enabled_.load(); }
+  void SetEnabled(bool enabled);
+
+  int slow_query_msec() const { return slow_query_msec_.load(); }
+  void SetSlowQueryMsec(int msec);
+
+  // Returns the statements run since the last Reset, the ones that took the
+  // longest in total first.
+  QList<Stats> Results() const;
+  void Reset();
+
+ private:
+  struct Entry {
+    Entry() : count_(0), total_nsec_(0), rows_(0), next_sample_(0) {}
+
+    int count_;
+    qint64 total_nsec_;
+    qint64 rows_;
+    QVector<qint64> samples_;
+    int next_sample_;
+    QString plan_;
+  };
+
+  struct PendingPlan {
+    QString key_;
+    QByteArray sql_;
+  };
+
+  static int TraceCallback(unsigned type, void* context, void* p, void* x);
+  static void ProfileCallback(void* context, const char* sql, quint64 nsec);
+  static QString ExplainQueryPlan(sqlite3* handle, const char* sql);
+
+  void StatementFinished(sqlite3* handle, const char* sql, qint64 nsec,
+                         qint64 rows);
+  // Makes room for another statement.  Must be called with mutex_ held.
+  void DropCheapestEntry();
+
+  QAtomicInt enabled_;
+  QAtomicInt slow_query_msec_;
+  // Incremented when profiling is disabled.
+  QAtomicInt generation_;
+
+  mutable QMutex mutex_;
+  QHash<QString, Entry> entries_;
+  QHash<sqlite3*, QList<PendingPlan>> pending_plans_;
+  QAtomicInt pending_count_;
+};
+
+#endif  // CORE_QUERYPROFILER_H_
@@ -115,7 +115,11 @@ const QStringList Song::kColumns = QStringList() << "title"
                                                  << "grouping"
                                                  << "lyrics"
                                                  << "originalyear"
-                                                 << "effective_originalyear";
+                                                 << "effective_originalyear"
+                                                 << "rg_track_gain"
+                                                 << "rg_track_peak"
+                                                 << "rg_album_gain"
+                                                 << "rg_album_peak";
 
 const QStringList Song::kIntColumns = QStringList() << "track"
                                                     << "disc"
@@ -139,6 +143,7 @@ const QString Song::kBindSpec =
     Utilities::Prepend(":", Song::kColumns).join(", ");
 const QString Song::kUpdateSpec =
     Utilities::Updateify(Song::kColumns).join(", ");
+const int Song::kFilenameColumn = 16;
 
 const QStringList Song::kFtsColumns = QStringList() << "ftstitle"
                                                     << "ftsalbum"
@@ -152,10 +157,6 @@ const QStringList Song::kFtsColumns = QStringList() << "ftstitle"
                                                     << "ftsyear";
 
 const QString Song::kFtsColumnSpec = Song::kFtsColumns.join(", ");
-const QString Song::kFtsBindSpec =
-    Utilities::Prepend(":", Song::kFtsColumns).join(", ");
-const QString Song::kFtsUpdateSpec =
-    Utilities::Updateify(Song::kFtsColumns).join(", ");
 
 const QString Song::kManuallyUnsetCover = "(unset)";
 const QString Song::kEmbeddedCover = "(embedded)";
@@ -199,6 +200,13 @@ struct Song::Private : public QSharedData {
   int lastplayed_;
   int score_;
 
+  // Loudness measured by ReplayGainScanner, in dB relative to the ReplayGain
+  // reference level.  The peaks are linear, and -1 if there's no gain.
+  float rg_track_gain_;
+  float rg_track_peak_;
+  float rg_album_gain_;
+  float rg_album_peak_;
+
   // The beginning of the song in seconds. In case of single-part media
   // streams, this will equal to 0. In case of multi-part streams on the
   // other hand, this will mark the beginning of a section represented by
@@ -263,6 +271,10 @@ Song::Private::Private()
       skipcount_(0),
       lastplayed_(-1),
       score_(0),
+      rg_track_gain_(0),
+      rg_track_peak_(-1),
+      rg_album_gain_(0),
+      rg_album_peak_(-1),
       beginning_(0),
       end_(-1),
       bitrate_(-1),
@@ -317,6 +329,11 @@ int Song::effective_originalyear() const {
   return d->originalyear_ < 0 ? d->year_ : d->originalyear_;
 }
 const QString& Song::genre() const { return d->genre_; }
+float Song::replaygain_track_gain() const { return d->rg_track_gain_; }
+float Song::replaygain_track_peak() const { return d->rg_track_peak_; }
+float Song::replaygain_album_gain() const { return d->rg_album_gain_; }
+float Song::replaygain_album_peak() const { return d->rg_album_peak_; }
+bool Song::has_replaygain() const { return d->rg_track_peak_ >= 0; }
 const QString& Song::comment() const { return d->comment_; }
 bool Song::is_compilation() const {
   return (d->compilation_ || d->sampler_ || d->forced_compilation_on_) &&
@@ -375,6 +392,14 @@ void Song::set_bpm(float v) { d->bpm_ = v; }
 void Song::set_year(int v) { d->year_ = v; }
 void Song::set_originalyear(int v) { d->originalyear_ = v; }
 void Song::set_genre(const QString& v) { d->genre_ = v; }
+void Song::set_replaygain_track(float gain, float peak) {
+  d->rg_track_gain_ = gain;
+  d->rg_track_peak_ = peak;
+}
+void Song::set_replaygain_album(float gain, float peak) {
+  d->rg_album_gain_ = gain;
+  d->rg_album_peak_ = peak;
+}
 void Song::set_comment(const QString& v) { d->comment_ = v; }
 void Song::set_compilation(bool v) { d->compilation_ = v; }
 void Song::set_sampler(bool v) { d->sampler_ = v; }
@@ -641,7 +666,7 @@ void Song::InitFromQuery(const SqlRow& q, bool reliable_metadata, int col) {
   d->samplerate_ = toint(col + 14);
 
   d->directory_id_ = toint(col + 15);
-  set_url(QUrl::fromEncoded(tostr(col + 16).toUtf8()));
+  set_url(QUrl::fromEncoded(tostr(col + kFilenameColumn).toUtf8()));
   d->basefilename_ = QFileInfo(d->url_.toLocalFile()).fileName();
   d->mtime_ = toint(col + 17);
   d->ctime_ = toint(col + 18);
@@ -681,6 +706,13 @@ void Song::InitFromQuery(const SqlRow& q, bool reliable_metadata, int col) {
   d->grouping_ = tostr(col + 39);
   d->lyrics_ = tostr(col + 40);
 
+  // effective_originalyear = 42
+
+  d->rg_track_gain_ = q.value(col + 43).toFloat();
+  d->rg_track_peak_ = tofloat(col + 44);
+  d->rg_album_gain_ = q.value(col + 45).toFloat();
+  d->rg_album_peak_ = tofloat(col + 46);
+
   InitArtManual();
 
 #undef tostr
@@ -939,6 +971,7 @@ void Song::BindToQuery(QSqlQuery* query) const {
 #define strval(x) (x.isNull() ? "" : x)
 #define intval(x) (x <= 0 ? -1 : x)
 #define notnullintval(x) (x == -1 ? QVariant() : x)
+#define gainval(x, peak) (peak < 0 ? QVariant() : x)
 
   // Remember to bind these in the same order as kBindSpec
 
@@ -1007,24 +1040,21 @@ void Song::BindToQuery(QSqlQuery* query) const {
   query->bindValue(":effective_originalyear",
                    intval(this->effective_originalyear()));
 
+  query->bindValue(":rg_track_gain", gainval(d->rg_track_gain_,
+                                             d->rg_track_peak_));
+  query->bindValue(":rg_track_peak", gainval(d->rg_track_peak_,
+                                             d->rg_track_peak_));
+  query->bindValue(":rg_album_gain", gainval(d->rg_album_gain_,
+                                             d->rg_album_peak_));
+  query->bindValue(":rg_album_peak", gainval(d->rg_album_peak_,
+                                             d->rg_album_peak_));
+
 #undef intval
 #undef notnullintval
+#undef gainval
 #undef strval
 }
 
-void Song::BindToFtsQuery(QSqlQuery* query) const {
-  query->bindValue(":ftstitle", d->title_);
-  query->bindValue(":ftsalbum", d->album_);
-  query->bindValue(":ftsartist", d->artist_);
-  query->bindValue(":ftsalbumartist", d->albumartist_);
-  query->bindValue(":ftscomposer", d->composer_);
-  query->bindValue(":ftsperformer", d->performer_);
-  query->bindValue(":ftsgrouping", d->grouping_);
-  query->bindValue(":ftsgenre", d->genre_);
-  query->bindValue(":ftscomment", d->comment_);
-  query->bindValue(":ftsyear", d->year_);
-}
-
 #ifdef HAVE_LIBLASTFM
 void Song::ToLastFM(lastfm::Track* track, bool prefer_album_artist) const {
   lastfm::MutableTrack mtrack(*track);
@@ -1200,4 +1230,12 @@ void Song::MergeUserSetData(const Song& other) {
   if (rating() == -1.0f) {
     set_rating(other.rating());
   }
+  // The audio might have changed if the file has, in which case it has to be
+  // analysed again.
+  if (mtime() == other.mtime()) {
+    set_replaygain_track(other.replaygain_track_gain(),
+                         other.replaygain_track_peak());
+    set_replaygain_album(other.replaygain_album_gain(),
+                         other.replaygain_album_peak());
+  }
 }
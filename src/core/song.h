@@ -73,14 +73,15 @@ class Song {
   static const QString kBindSpec;
   static const QString kUpdateSpec;
 
+  // Where the filename is in a row of ROWID followed by kColumnSpec.
+  static const int kFilenameColumn;
+
   static const QStringList kIntColumns;
   static const QStringList kFloatColumns;
   static const QStringList kDateColumns;
 
   static const QStringList kFtsColumns;
   static const QString kFtsColumnSpec;
-  static const QString kFtsBindSpec;
-  static const QString kFtsUpdateSpec;
 
   static const QString kManuallyUnsetCover;
   static const QString kEmbeddedCover;
@@ -154,7 +155,6 @@ class Song {
 
   // Save
   void BindToQuery(QSqlQuery* query) const;
-  void BindToFtsQuery(QSqlQuery* query) const;
 #ifdef HAVE_LIBLASTFM
   void ToLastFM(lastfm::Track* track, bool prefer_album_artist) const;
 #endif
@@ -196,6 +196,15 @@ class Song {
   int score() const;
   int album_id() const;
 
+  // Measured by ReplayGainScanner rather than read from the file's tags.  The
+  // gains are in dB and the peaks are linear.  A peak is -1 if there's no
+  // gain to go with it.
+  float replaygain_track_gain() const;
+  float replaygain_track_peak() const;
+  float replaygain_album_gain() const;
+  float replaygain_album_peak() const;
+  bool has_replaygain() const;
+
   const QString& cue_path() const;
   bool has_cue() const;
 
@@ -291,6 +300,8 @@ class Song {
   void set_skipcount(int v);
   void set_lastplayed(int v);
   void set_score(int v);
+  void set_replaygain_track(float gain, float peak);
+  void set_replaygain_album(float gain, float peak);
   void set_cue_path(const QString& v);
   void set_unavailable(bool v);
   void set_etag(const QString& etag);
@@ -0,0 +1,49 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "startuptrace.h"
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include "core/logging.h"
+
+namespace {
+
+QMutex sMutex;
+QElapsedTimer sTimer;
+qint64 sLastMsec = 0;
+bool sEnabled = false;
+
+}  // namespace
+
+void StartupTrace::Start() { sTimer.start(); }
+
+void StartupTrace::SetEnabled(bool enabled) {
+  QMutexLocker l(&sMutex);
+  sEnabled = enabled;
+}
+
+void StartupTrace::Mark(const char* stage) {
+  QMutexLocker l(&sMutex);
+  if (!sEnabled) return;
+
+  const qint64 msec = sTimer.elapsed();
+  qLog(Info) << QString("%1 ms (+%2 ms)").arg(msec, 6).arg(msec - sLastMsec, 5)
+             << stage;
+  sLastMsec = msec;
+}
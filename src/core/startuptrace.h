@@ -0,0 +1,34 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORE_STARTUPTRACE_H_
+#define CORE_STARTUPTRACE_H_
+
+// Records when each stage of startup is reached, so regressions in startup
+// time can be measured.  Turned on with --startup-trace, which logs each stage
+// with the time since Clementine started and since the previous stage.
+class StartupTrace {
+ public:
+  // Starts the clock.  Call this as early as possible in main().
+  static void Start();
+  static void SetEnabled(bool enabled);
+
+  // Records that a stage of startup has finished.  Thread-safe, and does
+  // nothing unless --startup-trace was given.
+  static void Mark(const char* stage);
+};
+
+#endif  // CORE_STARTUPTRACE_H_
@@ -0,0 +1,64 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tagreaderbatcher.h"
+
+const int TagReaderBatcher::kMaxBatchSize = 32;
+const int TagReaderBatcher::kMaxLatencyMsec = 100;
+
+TagReaderBatcher::TagReaderBatcher(TagReaderClient* client)
+    : client_(client) {}
+
+TagReaderBatcher::~TagReaderBatcher() {
+  // The worker pool still has pointers to the replies, so they can't be
+  // deleted until they've finished.
+  for (const Batch& batch : sent_) {
+    batch.reply_->WaitForFinished();
+    batch.reply_->deleteLater();
+  }
+}
+
+void TagReaderBatcher::Add(const QString& filename) {
+  if (pending_.isEmpty()) oldest_pending_.start();
+  pending_ << filename;
+
+  if (pending_.count() >= kMaxBatchSize ||
+      oldest_pending_.elapsed() >= kMaxLatencyMsec) {
+    Send();
+  }
+}
+
+SongList TagReaderBatcher::Finish() {
+  Send();
+
+  SongList ret;
+  for (const Batch& batch : sent_) {
+    client_->WaitForReadFiles(batch.reply_, batch.filenames_, &ret);
+  }
+  sent_.clear();
+  return ret;
+}
+
+void TagReaderBatcher::Send() {
+  if (pending_.isEmpty()) return;
+
+  Batch batch;
+  batch.filenames_ = pending_;
+  batch.reply_ = client_->ReadFiles(pending_);
+  sent_ << batch;
+
+  pending_.clear();
+}
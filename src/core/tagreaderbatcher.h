@@ -0,0 +1,65 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORE_TAGREADERBATCHER_H_
+#define CORE_TAGREADERBATCHER_H_
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QStringList>
+
+#include "core/song.h"
+#include "core/tagreaderclient.h"
+
+// Coalesces the files a scanner wants to read into ReadFiles requests, so the
+// tag reader gets one message for a whole batch of files instead of one per
+// file.  A batch is sent as soon as it's full, or when a file is added after
+// the oldest file in it has waited kMaxLatencyMsec, so the workers can get on
+// with it while the caller is still looking for more files.
+// This is blocking and not thread-safe: use one per scanning thread, and not
+// on the TagReaderClient's thread.
+class TagReaderBatcher {
+ public:
+  explicit TagReaderBatcher(
+      TagReaderClient* client = TagReaderClient::Instance());
+  ~TagReaderBatcher();
+
+  static const int kMaxBatchSize;
+  static const int kMaxLatencyMsec;
+
+  void Add(const QString& filename);
+
+  // Sends the files that are still waiting and returns one song for each file
+  // that was added, in the same order.  Files that couldn't be read, or that
+  // aren't media files, give invalid songs.
+  SongList Finish();
+
+ private:
+  struct Batch {
+    QStringList filenames_;
+    TagReaderReply* reply_;
+  };
+
+  void Send();
+
+  TagReaderClient* client_;
+
+  QStringList pending_;
+  QElapsedTimer oldest_pending_;
+  QList<Batch> sent_;
+};
+
+#endif  // CORE_TAGREADERBATCHER_H_
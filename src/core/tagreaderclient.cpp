@@ -29,6 +29,8 @@
 #include <QThread>
 #include <QUrl>
 
+#include "core/sharedmemorybuffer.h"
+#include "core/tracing.h"
 #include "player.h"
 #include "songpathparser.h"
 
@@ -75,6 +77,17 @@ TagReaderReply* TagReaderClient::ReadFile(const QString& filename) {
   return worker_pool_->SendMessageWithReply(&message);
 }
 
+TagReaderReply* TagReaderClient::ReadFiles(const QStringList& filenames) {
+  cpb::tagreader::Message message;
+  cpb::tagreader::ReadFilesRequest* req = message.mutable_read_files_request();
+
+  for (const QString& filename : filenames) {
+    req->add_filenames(DataCommaSizeFromQString(filename));
+  }
+
+  return worker_pool_->SendMessageWithReply(&message);
+}
+
 TagReaderReply* TagReaderClient::SaveFile(const QString& filename,
                                           const Song& metadata) {
   cpb::tagreader::Message message;
@@ -132,12 +145,14 @@ TagReaderReply* TagReaderClient::IsMediaFile(const QString& filename) {
   return worker_pool_->SendMessageWithReply(&message);
 }
 
-TagReaderReply* TagReaderClient::LoadEmbeddedArt(const QString& filename) {
+TagReaderReply* TagReaderClient::LoadEmbeddedArt(const QString& filename,
+                                                 bool allow_shared_memory) {
   cpb::tagreader::Message message;
   cpb::tagreader::LoadEmbeddedArtRequest* req =
       message.mutable_load_embedded_art_request();
 
   req->set_filename(DataCommaSizeFromQString(filename));
+  req->set_allow_shared_memory(allow_shared_memory);
 
   return worker_pool_->SendMessageWithReply(&message);
 }
@@ -161,6 +176,7 @@ TagReaderReply* TagReaderClient::ReadCloudFile(
 
 void TagReaderClient::ReadFileBlocking(const QString& filename, Song* song) {
   Q_ASSERT(QThread::currentThread() != thread());
+  TRACE_SPAN("tagreader", "TagReaderClient::ReadFileBlocking");
 
   TagReaderReply* reply = ReadFile(filename);
   if (reply->WaitForFinished()) {
@@ -170,9 +186,44 @@ void TagReaderClient::ReadFileBlocking(const QString& filename, Song* song) {
   reply->deleteLater();
 }
 
+void TagReaderClient::ReadFilesBlocking(const QStringList& filenames,
+                                        SongList* songs) {
+  WaitForReadFiles(ReadFiles(filenames), filenames, songs);
+}
+
+void TagReaderClient::WaitForReadFiles(TagReaderReply* reply,
+                                       const QStringList& filenames,
+                                       SongList* songs) {
+  Q_ASSERT(QThread::currentThread() != thread());
+  TRACE_SPAN("tagreader", "TagReaderClient::WaitForReadFiles");
+
+  const bool success = reply->WaitForFinished();
+  const cpb::tagreader::ReadFilesResponse& response =
+      reply->message().read_files_response();
+
+  if (success && response.metadata_size() == filenames.count()) {
+    for (int i = 0; i < filenames.count(); ++i) {
+      Song song;
+      song.InitFromProtobuf(response.metadata(i));
+      path_parser_->GuessMissingFields(&song, filenames[i]);
+      *songs << song;
+    }
+  } else {
+    qLog(Warning) << "Reading" << filenames.count()
+                  << "files in one batch failed, reading them one by one";
+    for (const QString& filename : filenames) {
+      Song song;
+      ReadFileBlocking(filename, &song);
+      *songs << song;
+    }
+  }
+  reply->deleteLater();
+}
+
 bool TagReaderClient::SaveFileBlocking(const QString& filename,
                                        const Song& metadata) {
   Q_ASSERT(QThread::currentThread() != thread());
+  TRACE_SPAN("tagreader", "TagReaderClient::SaveFileBlocking");
 
   bool ret = false;
 
@@ -187,6 +238,7 @@ bool TagReaderClient::SaveFileBlocking(const QString& filename,
 
 bool TagReaderClient::UpdateSongStatisticsBlocking(const Song& metadata) {
   Q_ASSERT(QThread::currentThread() != thread());
+  TRACE_SPAN("tagreader", "TagReaderClient::UpdateSongStatisticsBlocking");
 
   bool ret = false;
 
@@ -201,6 +253,7 @@ bool TagReaderClient::UpdateSongStatisticsBlocking(const Song& metadata) {
 
 bool TagReaderClient::UpdateSongRatingBlocking(const Song& metadata) {
   Q_ASSERT(QThread::currentThread() != thread());
+  TRACE_SPAN("tagreader", "TagReaderClient::UpdateSongRatingBlocking");
 
   bool ret = false;
 
@@ -215,6 +268,7 @@ bool TagReaderClient::UpdateSongRatingBlocking(const Song& metadata) {
 
 bool TagReaderClient::IsMediaFileBlocking(const QString& filename) {
   Q_ASSERT(QThread::currentThread() != thread());
+  TRACE_SPAN("tagreader", "TagReaderClient::IsMediaFileBlocking");
 
   bool ret = false;
 
@@ -229,14 +283,27 @@ bool TagReaderClient::IsMediaFileBlocking(const QString& filename) {
 
 QImage TagReaderClient::LoadEmbeddedArtBlocking(const QString& filename) {
   Q_ASSERT(QThread::currentThread() != thread());
+  TRACE_SPAN("tagreader", "TagReaderClient::LoadEmbeddedArtBlocking");
 
   QImage ret;
 
-  TagReaderReply* reply = LoadEmbeddedArt(filename);
+  TagReaderReply* reply = LoadEmbeddedArt(filename, true);
   if (reply->WaitForFinished()) {
-    const std::string& data_str =
-        reply->message().load_embedded_art_response().data();
-    ret.loadFromData(QByteArray(data_str.data(), data_str.size()));
+    const cpb::tagreader::LoadEmbeddedArtResponse& response =
+        reply->message().load_embedded_art_response();
+
+    if (response.has_shared_memory_name()) {
+      // Decode the image straight out of the worker's buffer.
+      SharedMemoryBuffer buffer(
+          QStringFromStdString(response.shared_memory_name()));
+      if (buffer.is_valid()) {
+        ret.loadFromData(buffer.data(), buffer.size());
+      }
+    } else {
+      const std::string& data_str = response.data();
+      ret.loadFromData(reinterpret_cast<const uchar*>(data_str.data()),
+                       data_str.size());
+    }
   }
   reply->deleteLater();
 
@@ -50,11 +50,15 @@ class TagReaderClient : public QObject {
   void ReloadSettings();
 
   ReplyType* ReadFile(const QString& filename);
+  ReplyType* ReadFiles(const QStringList& filenames);
   ReplyType* SaveFile(const QString& filename, const Song& metadata);
   ReplyType* UpdateSongStatistics(const Song& metadata);
   ReplyType* UpdateSongRating(const Song& metadata);
   ReplyType* IsMediaFile(const QString& filename);
-  ReplyType* LoadEmbeddedArt(const QString& filename);
+  // If allow_shared_memory is set, large images are returned in a
+  // SharedMemoryBuffer instead of in the reply, and the caller must open it.
+  ReplyType* LoadEmbeddedArt(const QString& filename,
+                             bool allow_shared_memory = false);
   ReplyType* ReadCloudFile(const QUrl& download_url, const QString& title,
                            int size, const QString& mime_type,
                            const QString& authorisation_header);
@@ -63,12 +67,20 @@ class TagReaderClient : public QObject {
   // response.  These block the calling thread with a semaphore, and must NOT
   // be called from the TagReaderClient's thread.
   void ReadFileBlocking(const QString& filename, Song* song);
+  void ReadFilesBlocking(const QStringList& filenames, SongList* songs);
   bool SaveFileBlocking(const QString& filename, const Song& metadata);
   bool UpdateSongStatisticsBlocking(const Song& metadata);
   bool UpdateSongRatingBlocking(const Song& metadata);
   bool IsMediaFileBlocking(const QString& filename);
   QImage LoadEmbeddedArtBlocking(const QString& filename);
 
+  // Waits for a reply from ReadFiles and appends one song to songs for each of
+  // the filenames that were asked for.  If the batch failed, the files are
+  // read again one at a time so one bad file doesn't lose the rest.  Deletes
+  // the reply.
+  void WaitForReadFiles(ReplyType* reply, const QStringList& filenames,
+                        SongList* songs);
+
   // TODO(David Sansome): Make this not a singleton
   static TagReaderClient* Instance() { return sInstance; }
 
@@ -20,7 +20,10 @@
 
 #include "taskmanager.h"
 
-TaskManager::TaskManager(QObject* parent) : QObject(parent), next_task_id_(1) {}
+TaskManager::TaskManager(QObject* parent) : QObject(parent), next_task_id_(1) {
+  connect(WorkScheduler::Instance(), SIGNAL(ActivityChanged()),
+          SIGNAL(TasksChanged()), Qt::QueuedConnection);
+}
 
 int TaskManager::StartTask(const QString& name) {
   Task t;
@@ -28,6 +31,8 @@ int TaskManager::StartTask(const QString& name) {
   t.progress = 0;
   t.progress_max = 0;
   t.blocks_library_scans = false;
+  t.pausable = false;
+  t.paused = false;
 
   {
     QMutexLocker l(&mutex_);
@@ -63,6 +68,35 @@ void TaskManager::SetTaskBlocksLibraryScans(int id) {
   emit PauseLibraryWatchers();
 }
 
+void TaskManager::SetTaskPausable(int id) {
+  {
+    QMutexLocker l(&mutex_);
+    if (!tasks_.contains(id)) return;
+
+    tasks_[id].pausable = true;
+  }
+
+  emit TasksChanged();
+}
+
+void TaskManager::SetTaskPaused(int id, bool paused) {
+  {
+    QMutexLocker l(&mutex_);
+    if (!tasks_.contains(id)) return;
+
+    Task& t = tasks_[id];
+    if (!t.pausable || t.paused == paused) return;
+    t.paused = paused;
+  }
+
+  emit TasksChanged();
+}
+
+bool TaskManager::IsTaskPaused(int id) {
+  QMutexLocker l(&mutex_);
+  return tasks_.contains(id) && tasks_[id].paused;
+}
+
 void TaskManager::SetTaskProgress(int id, int progress, int max) {
   {
     QMutexLocker l(&mutex_);
@@ -120,3 +154,7 @@ int TaskManager::GetTaskProgress(int id) {
     return tasks_[id].progress;
   }
 }
+
+WorkScheduler::Stats TaskManager::GetWorkStats() {
+  return WorkScheduler::Instance()->GetStats();
+}
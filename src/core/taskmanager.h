@@ -25,6 +25,8 @@
 #include <QMutex>
 #include <QObject>
 
+#include "core/workscheduler.h"
+
 class TaskManager : public QObject {
   Q_OBJECT
 
@@ -37,6 +39,8 @@ class TaskManager : public QObject {
     int progress;
     int progress_max;
     bool blocks_library_scans;
+    bool pausable;
+    bool paused;
   };
 
   class ScopedTask {
@@ -58,11 +62,21 @@ class TaskManager : public QObject {
 
   int StartTask(const QString& name);
   void SetTaskBlocksLibraryScans(int id);
+  // Lets the user pause the task.  Whatever is doing the work should check
+  // IsTaskPaused every so often, and wait while it's true.
+  void SetTaskPausable(int id);
+  void SetTaskPaused(int id, bool paused);
+  bool IsTaskPaused(int id);
   void SetTaskProgress(int id, int progress, int max = 0);
   void IncreaseTaskProgress(int id, int progress, int max = 0);
   void SetTaskFinished(int id);
   int GetTaskProgress(int id);
 
+  // What the background jobs on the shared WorkScheduler are doing.
+  // TasksChanged is emitted when a priority class starts or stops having
+  // jobs.
+  WorkScheduler::Stats GetWorkStats();
+
  signals:
   void TasksChanged();
 
@@ -0,0 +1,260 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "trackprefetcher.h"
+
+#include <QFile>
+#include <QSettings>
+#include <functional>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
+#include "core/application.h"
+#include "core/closure.h"
+#include "core/logging.h"
+#include "playlist/playlist.h"
+#include "playlist/playlistmanager.h"
+#include "playlist/playlistsequence.h"
+#include "playlist/queue.h"
+
+const char* TrackPrefetcher::kSettingsGroup = "Prefetch";
+const int TrackPrefetcher::kDefaultLookahead = 3;
+const int TrackPrefetcher::kDefaultBudgetMb = 256;
+
+TrackPrefetcher::TrackPrefetcher(Application* app, QObject* parent)
+    : QObject(parent),
+      app_(app),
+      enabled_(true),
+      lookahead_(kDefaultLookahead),
+      budget_(qint64(kDefaultBudgetMb) * 1024 * 1024),
+      work_queue_(WorkScheduler::Priority_Idle, 1),
+      cache_size_(0) {
+  update_timer_.setSingleShot(true);
+  update_timer_.setInterval(500);
+  connect(&update_timer_, SIGNAL(timeout()), SLOT(Update()));
+
+  connect(app_, SIGNAL(SettingsChanged()), SLOT(ReloadSettings()));
+  ReloadSettings();
+}
+
+TrackPrefetcher::~TrackPrefetcher() {
+  abort_ = 1;
+  work_queue_.WaitForDone();
+}
+
+void TrackPrefetcher::Init() {
+  PlaylistManager* manager = app_->playlist_manager();
+
+  connect(manager, SIGNAL(ActiveChanged(Playlist*)),
+          SLOT(ActiveChanged(Playlist*)));
+  connect(manager, SIGNAL(CurrentSongChanged(Song)),
+          SLOT(CurrentSongChanged(Song)));
+  connect(manager, SIGNAL(PlaylistChanged(Playlist*)), &update_timer_,
+          SLOT(start()));
+  connect(manager->sequence(),
+          SIGNAL(RepeatModeChanged(PlaylistSequence::RepeatMode)),
+          &update_timer_, SLOT(start()));
+  connect(manager->sequence(),
+          SIGNAL(ShuffleModeChanged(PlaylistSequence::ShuffleMode)),
+          &update_timer_, SLOT(start()));
+
+  ActiveChanged(manager->active());
+}
+
+void TrackPrefetcher::ReloadSettings() {
+  QSettings s;
+  s.beginGroup(kSettingsGroup);
+  enabled_ = s.value("enabled", true).toBool();
+  lookahead_ = s.value("lookahead", kDefaultLookahead).toInt();
+  budget_ = s.value("budget_mb", kDefaultBudgetMb).toLongLong() * 1024 * 1024;
+  s.endGroup();
+
+  skipped_.clear();
+  update_timer_.start();
+}
+
+void TrackPrefetcher::ActiveChanged(Playlist* playlist) {
+  if (playlist) {
+    // Queued tracks are played first.
+    Queue* queue = playlist->queue();
+    connect(queue, SIGNAL(rowsInserted(QModelIndex, int, int)),
+            &update_timer_, SLOT(start()), Qt::UniqueConnection);
+    connect(queue, SIGNAL(rowsRemoved(QModelIndex, int, int)),
+            &update_timer_, SLOT(start()), Qt::UniqueConnection);
+    connect(queue, SIGNAL(layoutChanged()), &update_timer_, SLOT(start()),
+            Qt::UniqueConnection);
+  }
+
+  update_timer_.start();
+}
+
+void TrackPrefetcher::CurrentSongChanged(const Song& song) {
+  // This is also emitted when the current song's metadata changes.
+  if (song.url().isLocalFile() && song.url().toLocalFile() != current_) {
+    current_ = song.url().toLocalFile();
+
+    if (IndexOf(current_) != -1) {
+      stats_.hits_++;
+    } else {
+      stats_.misses_++;
+    }
+    qLog(Debug) << "Read ahead" << stats_.hits_ << "of"
+                << stats_.hits_ + stats_.misses_ << "local tracks,"
+                << stats_.bytes_read_ << "bytes read";
+  }
+
+  update_timer_.start();
+}
+
+QStringList TrackPrefetcher::UpcomingFiles() const {
+  QStringList ret;
+
+  Playlist* playlist = app_->playlist_manager()->active();
+  if (!playlist) return ret;
+
+  for (int row : playlist->upcoming_rows(lookahead_)) {
+    PlaylistItemPtr item = playlist->item_at(row);
+    if (!item) continue;
+
+    const QUrl url = item->Url();
+    if (url.isLocalFile()) {
+      ret << url.toLocalFile();
+    }
+  }
+
+  return ret;
+}
+
+int TrackPrefetcher::IndexOf(const QString& filename) const {
+  for (int i = 0; i < cache_.count(); ++i) {
+    if (cache_[i].filename_ == filename) return i;
+  }
+  return -1;
+}
+
+void TrackPrefetcher::Update() {
+  wanted_ = enabled_ ? UpcomingFiles() : QStringList();
+  skipped_.intersect(QSet<QString>::fromList(wanted_));
+
+  if (!enabled_) {
+    // Nothing is wanted any more, so this drops everything.
+    MakeRoom(budget_);
+    return;
+  }
+
+  // Only one file is read at a time - FileRead will call us again.
+  if (!reading_.isEmpty()) return;
+
+  for (const QString& filename : wanted_) {
+    if (skipped_.contains(filename)) continue;
+
+    const int index = IndexOf(filename);
+    if (index != -1) {
+      // It's still wanted, so it shouldn't be dropped before the others.
+      cache_.move(index, cache_.count() - 1);
+      continue;
+    }
+
+    // Space taken up by upcoming files and the current one can't be reused
+    // for this one.
+    qint64 available = budget_;
+    for (const CachedFile& file : cache_) {
+      if (wanted_.contains(file.filename_) || file.filename_ == current_) {
+        available -= file.size_;
+      }
+    }
+
+    reading_ = filename;
+    QFuture<qint64> future = work_queue_.Run<qint64>(
+        std::bind(&TrackPrefetcher::ReadFile, filename, available, &abort_));
+    NewClosure(future, this, SLOT(FileRead(QFuture<qint64>, QString)), future,
+               filename);
+    return;
+  }
+}
+
+void TrackPrefetcher::FileRead(QFuture<qint64> future,
+                               const QString& filename) {
+  reading_.clear();
+
+  const qint64 size = future.result();
+  if (size < 0) {
+    skipped_ << filename;
+  } else {
+    MakeRoom(size);
+
+    CachedFile file;
+    file.filename_ = filename;
+    file.size_ = size;
+    cache_ << file;
+    cache_size_ += size;
+    stats_.bytes_read_ += size;
+  }
+
+  Update();
+}
+
+void TrackPrefetcher::MakeRoom(qint64 size) {
+  for (int i = 0; i < cache_.count() && cache_size_ + size > budget_;) {
+    // The current file is still being read by GStreamer.
+    if (wanted_.contains(cache_[i].filename_) ||
+        cache_[i].filename_ == current_) {
+      ++i;
+      continue;
+    }
+
+    const CachedFile file = cache_.takeAt(i);
+    cache_size_ -= file.size_;
+    work_queue_.Run<void>(
+        std::bind(&TrackPrefetcher::DropFile, file.filename_));
+  }
+}
+
+qint64 TrackPrefetcher::ReadFile(const QString& filename, qint64 max_size,
+                                 QAtomicInt* abort) {
+  QFile file(filename);
+  if (!file.open(QIODevice::ReadOnly) || file.size() > max_size) {
+    return -1;
+  }
+
+#ifdef Q_OS_LINUX
+  posix_fadvise(file.handle(), 0, 0, POSIX_FADV_WILLNEED);
+#endif
+
+  // The hint isn't enough on network filesystems, so read the whole thing.
+  QByteArray buffer(1024 * 1024, Qt::Uninitialized);
+  qint64 total = 0;
+  while (!abort->load()) {
+    const qint64 bytes = file.read(buffer.data(), buffer.size());
+    if (bytes <= 0) break;
+    total += bytes;
+  }
+
+  return abort->load() ? -1 : total;
+}
+
+void TrackPrefetcher::DropFile(const QString& filename) {
+#ifdef Q_OS_LINUX
+  QFile file(filename);
+  if (file.open(QIODevice::ReadOnly)) {
+    posix_fadvise(file.handle(), 0, 0, POSIX_FADV_DONTNEED);
+  }
+#else
+  Q_UNUSED(filename);
+#endif
+}
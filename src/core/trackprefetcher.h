@@ -0,0 +1,125 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORE_TRACKPREFETCHER_H_
+#define CORE_TRACKPREFETCHER_H_
+
+#include <QAtomicInt>
+#include <QFuture>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+#include "core/song.h"
+#include "core/workscheduler.h"
+
+class Application;
+class Playlist;
+
+// Reads the files of the next few tracks in the active playlist before they're
+// played, so they're already in the operating system's page cache when
+// GStreamer opens them.  This helps with libraries on network shares or disks
+// that spin down, where the preload at the end of a track is sometimes too
+// late.
+//
+// Files are read one at a time at idle IO priority.  The total size of the
+// files that are kept warm is limited by a budget - when it's full the files
+// that were read longest ago and are no longer upcoming or playing are dropped
+// from the cache again.
+class TrackPrefetcher : public QObject {
+  Q_OBJECT
+
+ public:
+  TrackPrefetcher(Application* app, QObject* parent = nullptr);
+  ~TrackPrefetcher();
+
+  static const char* kSettingsGroup;
+  static const int kDefaultLookahead;
+  static const int kDefaultBudgetMb;
+
+  struct Stats {
+    Stats() : hits_(0), misses_(0), bytes_read_(0) {}
+
+    // How many local tracks started playing after being read ahead, and how
+    // many weren't.
+    int hits_;
+    int misses_;
+    qint64 bytes_read_;
+  };
+
+  // Connects to the playlist manager.  Must be called after the playlists
+  // have been initialized.
+  void Init();
+
+  const Stats& stats() const { return stats_; }
+
+ public slots:
+  void ReloadSettings();
+
+ private slots:
+  void ActiveChanged(Playlist* playlist);
+  void CurrentSongChanged(const Song& song);
+  void Update();
+  void FileRead(QFuture<qint64> future, const QString& filename);
+
+ private:
+  struct CachedFile {
+    QString filename_;
+    qint64 size_;
+  };
+
+  // Reads the whole file if it's no bigger than max_size, and returns its
+  // size or -1.  Runs in the thread pool.
+  static qint64 ReadFile(const QString& filename, qint64 max_size,
+                         QAtomicInt* abort);
+  // Tells the operating system it can drop the file from its cache.
+  static void DropFile(const QString& filename);
+
+  QStringList UpcomingFiles() const;
+  int IndexOf(const QString& filename) const;
+  void MakeRoom(qint64 size);
+
+  Application* app_;
+
+  bool enabled_;
+  int lookahead_;
+  qint64 budget_;
+
+  // Changes to the playlist often come in bursts, so they're handled a moment
+  // later.
+  QTimer update_timer_;
+
+  // Files are read one at a time, with whatever disk time is left over.
+  WorkQueue work_queue_;
+  QAtomicInt abort_;
+
+  // Upcoming files, in the order they'll be played.
+  QStringList wanted_;
+  QString reading_;
+  // Upcoming files that couldn't be read, or didn't fit in the budget.
+  QSet<QString> skipped_;
+  QString current_;
+
+  // Files that have been read, least recently used first.
+  QList<CachedFile> cache_;
+  qint64 cache_size_;
+
+  Stats stats_;
+};
+
+#endif  // CORE_TRACKPREFETCHER_H_
@@ -0,0 +1,355 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "workscheduler.h"
+
+#include <QThread>
+
+#include "core/logging.h"
+#include "core/utilities.h"
+
+const int WorkScheduler::kHelpPollMsec = 10;
+
+Q_GLOBAL_STATIC(WorkScheduler, sWorkScheduler)
+
+class WorkScheduler::Worker : public QThread {
+ public:
+  Worker(WorkScheduler* scheduler, int index)
+      : scheduler_(scheduler), index_(index) {}
+
+  WorkScheduler* scheduler_;
+  int index_;
+
+  // Jobs started by jobs running on this worker.  Protected by the
+  // scheduler's mutex.
+  QList<QRunnable*> queues_[kPriorityCount];
+
+  // The classes of the jobs this worker is running - there's more than one
+  // while a job is waiting in HelpUntil.  Only used by the worker itself.
+  QList<Priority> running_;
+
+ protected:
+  void run() override { scheduler_->WorkerLoop(this); }
+};
+
+WorkScheduler::WorkScheduler(int thread_count, QObject* parent)
+    : QObject(parent), stopping_(false) {
+  setObjectName("Work scheduler");
+
+  if (thread_count <= 0) {
+    thread_count = qMax(2, QThread::idealThreadCount());
+  }
+
+  limits_[Priority_Interactive] = thread_count;
+  limits_[Priority_Normal] = qMax(1, thread_count - 1);
+  limits_[Priority_Idle] = qMax(1, thread_count / 2);
+
+  for (int i = 0; i < kPriorityCount; ++i) {
+    running_[i] = 0;
+    queued_[i] = 0;
+  }
+
+  for (int i = 0; i < thread_count; ++i) {
+    Worker* worker = new Worker(this, i);
+    worker->setObjectName(QString("Worker %1").arg(i));
+    workers_ << worker;
+  }
+  for (Worker* worker : workers_) {
+    worker->start();
+  }
+
+  qLog(Debug) << "Started" << thread_count << "workers";
+}
+
+WorkScheduler::~WorkScheduler() {
+  // The workers finish everything that's been queued before they stop.
+  {
+    QMutexLocker l(&mutex_);
+    stopping_ = true;
+  }
+  wake_.wakeAll();
+
+  for (Worker* worker : workers_) {
+    worker->wait();
+    delete worker;
+  }
+}
+
+WorkScheduler* WorkScheduler::Instance() { return sWorkScheduler(); }
+
+int WorkScheduler::limit(Priority priority) const {
+  QMutexLocker l(&mutex_);
+  return limits_[priority];
+}
+
+void WorkScheduler::set_limit(Priority priority, int limit) {
+  {
+    QMutexLocker l(&mutex_);
+    limits_[priority] = qBound(1, limit, workers_.count());
+  }
+  wake_.wakeAll();
+}
+
+WorkScheduler::Stats WorkScheduler::GetStats() const {
+  QMutexLocker l(&mutex_);
+
+  Stats ret;
+  for (int i = 0; i < kPriorityCount; ++i) {
+    ret.running_[i] = running_[i];
+    ret.queued_[i] = queued_[i];
+  }
+  return ret;
+}
+
+WorkScheduler::Worker* WorkScheduler::CurrentWorker() const {
+  Worker* worker = dynamic_cast<Worker*>(QThread::currentThread());
+  if (worker && worker->scheduler_ == this) {
+    return worker;
+  }
+  return nullptr;
+}
+
+void WorkScheduler::Submit(Priority priority, QRunnable* runnable) {
+  Worker* worker = CurrentWorker();
+  bool first_job = false;
+
+  {
+    QMutexLocker l(&mutex_);
+    first_job = running_[priority] == 0 && queued_[priority] == 0;
+
+    if (worker) {
+      worker->queues_[priority] << runnable;
+    } else {
+      shared_queues_[priority] << runnable;
+    }
+    queued_[priority]++;
+  }
+
+  // Not every worker can take a job of any class, so wake them all and let
+  // them sort it out.
+  wake_.wakeAll();
+
+  if (first_job) emit ActivityChanged();
+}
+
+bool WorkScheduler::CanStart(Priority priority) const {
+  int running = 0;
+  for (int i = priority; i < kPriorityCount; ++i) {
+    running += running_[i];
+  }
+  return running < limits_[priority];
+}
+
+int WorkScheduler::QueuedCount() const {
+  int ret = 0;
+  for (int i = 0; i < kPriorityCount; ++i) {
+    ret += queued_[i];
+  }
+  return ret;
+}
+
+QRunnable* WorkScheduler::TakeJob(Worker* worker, Priority lowest,
+                                   Priority* priority) {
+  for (int i = 0; i <= lowest; ++i) {
+    const Priority p = Priority(i);
+    if (queued_[p] == 0 || !CanStart(p)) continue;
+
+    QRunnable* ret = nullptr;
+    if (!worker->queues_[p].isEmpty()) {
+      ret = worker->queues_[p].takeLast();
+    } else if (!shared_queues_[p].isEmpty()) {
+      ret = shared_queues_[p].takeFirst();
+    } else {
+      // Steal from the other workers, starting with the next one along so
+      // they don't all pick on the first.
+      for (int j = 1; j < workers_.count() && !ret; ++j) {
+        Worker* victim = workers_[(worker->index_ + j) % workers_.count()];
+        if (!victim->queues_[p].isEmpty()) {
+          ret = victim->queues_[p].takeFirst();
+        }
+      }
+    }
+
+    if (ret) {
+      queued_[p]--;
+      running_[p]++;
+      *priority = p;
+      return ret;
+    }
+  }
+  return nullptr;
+}
+
+void WorkScheduler::RunJob(Worker* worker, QRunnable* runnable,
+                           Priority priority) {
+  // Idle jobs get what disk time is left over, but the thread's CPU priority
+  // is left alone: it can't be raised again afterwards, and the class limits
+  // already keep idle jobs off some of the cores.
+  worker->running_ << priority;
+  Utilities::SetThreadIOPriority(priority == Priority_Idle
+                                     ? Utilities::IOPRIO_CLASS_IDLE
+                                     : Utilities::IOPRIO_CLASS_NONE);
+
+  const bool auto_delete = runnable->autoDelete();
+  runnable->run();
+  if (auto_delete) delete runnable;
+
+  worker->running_.removeLast();
+  if (!worker->running_.isEmpty()) {
+    Utilities::SetThreadIOPriority(worker->running_.last() == Priority_Idle
+                                       ? Utilities::IOPRIO_CLASS_IDLE
+                                       : Utilities::IOPRIO_CLASS_NONE);
+  }
+
+  bool last_job = false;
+  {
+    QMutexLocker l(&mutex_);
+    running_[priority]--;
+    last_job = running_[priority] == 0 && queued_[priority] == 0;
+  }
+
+  // Wake workers that were held back by a limit, and any jobs waiting in
+  // HelpUntil.
+  wake_.wakeAll();
+
+  if (last_job) emit ActivityChanged();
+}
+
+void WorkScheduler::WorkerLoop(Worker* worker) {
+  QMutexLocker l(&mutex_);
+  forever {
+    Priority priority;
+    QRunnable* runnable = TakeJob(worker, Priority_Idle, &priority);
+    if (runnable) {
+      l.unlock();
+      RunJob(worker, runnable, priority);
+      l.relock();
+      continue;
+    }
+
+    if (stopping_ && QueuedCount() == 0) break;
+    wake_.wait(&mutex_);
+  }
+}
+
+void WorkScheduler::HelpUntil(const std::function<bool()>& done) {
+  Worker* worker = CurrentWorker();
+  Q_ASSERT(worker);
+  Q_ASSERT(!worker->running_.isEmpty());
+
+  const Priority waiting = worker->running_.last();
+  {
+    QMutexLocker l(&mutex_);
+    running_[waiting]--;
+  }
+  wake_.wakeAll();
+
+  // done is called without mutex_ held, since it might take locks of its
+  // own.  If it becomes true just after it's been checked the wait times out
+  // soon anyway.
+  while (!done()) {
+    QMutexLocker l(&mutex_);
+    Priority priority;
+    QRunnable* runnable = TakeJob(worker, waiting, &priority);
+    if (runnable) {
+      l.unlock();
+      RunJob(worker, runnable, priority);
+    } else {
+      wake_.wait(&mutex_, kHelpPollMsec);
+    }
+  }
+
+  QMutexLocker l(&mutex_);
+  running_[waiting]++;
+}
+
+class WorkQueue::Job : public QRunnable {
+ public:
+  Job(WorkQueue* queue, QRunnable* runnable)
+      : queue_(queue), runnable_(runnable) {}
+
+  void run() override {
+    const bool auto_delete = runnable_->autoDelete();
+    runnable_->run();
+    if (auto_delete) delete runnable_;
+
+    // The queue might be destroyed as soon as this returns.
+    queue_->JobFinished();
+  }
+
+ private:
+  WorkQueue* queue_;
+  QRunnable* runnable_;
+};
+
+WorkQueue::WorkQueue(WorkScheduler::Priority priority, int max_concurrency,
+                     WorkScheduler* scheduler)
+    : scheduler_(scheduler),
+      priority_(priority),
+      max_concurrency_(max_concurrency),
+      active_(0) {}
+
+WorkQueue::~WorkQueue() { WaitForDone(); }
+
+void WorkQueue::set_max_concurrency(int max_concurrency) {
+  QMutexLocker l(&mutex_);
+  max_concurrency_ = max_concurrency;
+  SubmitPending();
+}
+
+int WorkQueue::active_count() const {
+  QMutexLocker l(&mutex_);
+  return active_;
+}
+
+void WorkQueue::Submit(QRunnable* runnable) {
+  QMutexLocker l(&mutex_);
+  pending_ << runnable;
+  SubmitPending();
+}
+
+void WorkQueue::SubmitPending() {
+  while (!pending_.isEmpty() &&
+         (max_concurrency_ <= 0 || active_ < max_concurrency_)) {
+    active_++;
+    scheduler_->Submit(priority_, new Job(this, pending_.takeFirst()));
+  }
+}
+
+void WorkQueue::JobFinished() {
+  QMutexLocker l(&mutex_);
+  active_--;
+  SubmitPending();
+
+  if (IsDone()) done_.wakeAll();
+}
+
+bool WorkQueue::IsDone() const { return active_ == 0 && pending_.isEmpty(); }
+
+void WorkQueue::WaitForDone() {
+  if (scheduler_->IsWorkerThread()) {
+    scheduler_->HelpUntil([this]() {
+      QMutexLocker l(&mutex_);
+      return IsDone();
+    });
+    return;
+  }
+
+  QMutexLocker l(&mutex_);
+  while (!IsDone()) {
+    done_.wait(&mutex_);
+  }
+}
@@ -0,0 +1,246 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORE_WORKSCHEDULER_H_
+#define CORE_WORKSCHEDULER_H_
+
+#include <functional>
+
+#include <QFuture>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QRunnable>
+#include <QWaitCondition>
+
+#include "core/concurrentrun.h"
+
+// Runs background jobs on a fixed set of worker threads that's shared by the
+// whole application, in place of private thread pools and the global one.
+//
+// Every job has a priority class.  Workers take interactive jobs before
+// normal ones, and normal ones before idle ones, and each class has a limit
+// on the number of workers it can use.  The limits count the class and all
+// the classes below it, so by default normal and idle jobs together always
+// leave a worker free for interactive ones, and idle jobs never get more than
+// half of the workers.
+//
+// A job that's started by another job goes on its worker's own queue, and
+// workers take the newest job from their own queue first, so it's likely to
+// run on the same thread while its data is still in the cache.  Jobs from
+// other threads go on a shared queue.  A worker that runs out of work takes
+// the oldest job from another worker's queue.  The jobs run here are coarse -
+// reading a file, running a query - so all the queues share one lock.
+//
+// A job that waits for other jobs should do it with WaitForFinished(), which
+// runs queued jobs while it waits rather than keeping a worker busy.
+class WorkScheduler : public QObject {
+  Q_OBJECT
+
+ public:
+  enum Priority {
+    // Work the user is waiting for, like changing the playback state.
+    Priority_Interactive = 0,
+    // Work the user asked for that can take a while, like loading a
+    // directory or transcoding.
+    Priority_Normal = 1,
+    // Work nobody is waiting for, like analysing the whole library.
+    Priority_Idle = 2,
+  };
+  static const int kPriorityCount = 3;
+
+  struct Stats {
+    int running_[kPriorityCount];
+    int queued_[kPriorityCount];
+  };
+
+  // A thread_count of 0 starts one worker for each core, and at least two.
+  explicit WorkScheduler(int thread_count = 0, QObject* parent = nullptr);
+  ~WorkScheduler();
+
+  // The scheduler that everything in the application shares.
+  static WorkScheduler* Instance();
+
+  int thread_count() const { return workers_.count(); }
+
+  // The number of workers that jobs in this class or any lower one can use
+  // at once.  It's at least 1, and at most thread_count().
+  int limit(Priority priority) const;
+  void set_limit(Priority priority, int limit);
+
+  // Everything here is thread safe
+  Stats GetStats() const;
+
+  // Runs the function on a worker.  These mirror ConcurrentRun::Run.
+  template <typename ReturnType>
+  QFuture<ReturnType> Run(Priority priority,
+                          std::function<ReturnType()> function) {
+    return Start(priority, new ThreadFunctor<ReturnType>(function));
+  }
+
+  template <typename ReturnType, typename... Args>
+  QFuture<ReturnType> Run(Priority priority,
+                          std::function<ReturnType(Args...)> function,
+                          const Args&... args) {
+    return Start(priority,
+                 new ThreadFunctor<ReturnType, Args...>(function, args...));
+  }
+
+  template <typename ReturnType, typename... Args>
+  QFuture<ReturnType> Run(Priority priority, ReturnType (*function)(Args...),
+                          const Args&... args) {
+    return Run(priority, std::function<ReturnType(Args...)>(function),
+               args...);
+  }
+
+  // Queues the runnable, and deletes it after it's run if autoDelete() is
+  // set.
+  void Submit(Priority priority, QRunnable* runnable);
+
+  // Waits for the future to finish.  On one of this scheduler's workers,
+  // queued jobs are run in the meantime.
+  template <typename T>
+  void WaitForFinished(QFuture<T> future) {
+    if (IsWorkerThread()) {
+      HelpUntil([&future]() { return future.isFinished(); });
+    } else {
+      future.waitForFinished();
+    }
+  }
+
+  bool IsWorkerThread() const { return CurrentWorker() != nullptr; }
+
+  // Runs queued jobs on the current worker until done returns true.  Only jobs
+  // in the waiting job's class or a higher one are run, so an interactive job
+  // never ends up running a long idle one before it returns.  The job that's
+  // waiting doesn't count towards its class's limit until then.
+  void HelpUntil(const std::function<bool()>& done);
+
+ signals:
+  // Emitted when a class gets its first job, or finishes its last one.
+  void ActivityChanged();
+
+ private:
+  class Worker;
+
+  template <typename ReturnType>
+  QFuture<ReturnType> Start(Priority priority,
+                            ThreadFunctorBase<ReturnType>* functor) {
+    functor->reportStarted();
+    QFuture<ReturnType> future = functor->future();
+    Submit(priority, functor);
+    return future;
+  }
+
+  Worker* CurrentWorker() const;
+  void WorkerLoop(Worker* worker);
+
+  // These must be called with mutex_ held.
+  bool CanStart(Priority priority) const;
+  // Takes a job in the lowest class or a higher one.
+  QRunnable* TakeJob(Worker* worker, Priority lowest, Priority* priority);
+  int QueuedCount() const;
+
+  // Runs a job taken by TakeJob, without mutex_ held.
+  void RunJob(Worker* worker, QRunnable* runnable, Priority priority);
+
+ private:
+  static const int kHelpPollMsec;
+
+  mutable QMutex mutex_;
+  QWaitCondition wake_;
+  QList<Worker*> workers_;
+
+  QList<QRunnable*> shared_queues_[kPriorityCount];
+  int limits_[kPriorityCount];
+  int running_[kPriorityCount];
+  int queued_[kPriorityCount];
+  bool stopping_;
+
+  Q_DISABLE_COPY(WorkScheduler)
+};
+
+// Jobs of one priority class, with an optional limit on how many of them run
+// at once.  With a limit of 1 they run one at a time, in the order they were
+// added.  Use it in place of a private QThreadPool - like one, it waits for
+// its jobs to finish when it's destroyed.
+class WorkQueue {
+ public:
+  // A max_concurrency of 0 leaves it to the class's limit.
+  explicit WorkQueue(WorkScheduler::Priority priority, int max_concurrency = 0,
+                     WorkScheduler* scheduler = WorkScheduler::Instance());
+  ~WorkQueue();
+
+  WorkScheduler* scheduler() const { return scheduler_; }
+  int max_concurrency() const { return max_concurrency_; }
+  void set_max_concurrency(int max_concurrency);
+
+  // The number of jobs that have been handed to the scheduler and haven't
+  // finished yet.
+  int active_count() const;
+
+  template <typename ReturnType>
+  QFuture<ReturnType> Run(std::function<ReturnType()> function) {
+    return Start(new ThreadFunctor<ReturnType>(function));
+  }
+
+  template <typename ReturnType, typename... Args>
+  QFuture<ReturnType> Run(std::function<ReturnType(Args...)> function,
+                          const Args&... args) {
+    return Start(new ThreadFunctor<ReturnType, Args...>(function, args...));
+  }
+
+  template <typename ReturnType, typename... Args>
+  QFuture<ReturnType> Run(ReturnType (*function)(Args...),
+                          const Args&... args) {
+    return Run(std::function<ReturnType(Args...)>(function), args...);
+  }
+
+  void Submit(QRunnable* runnable);
+
+  // Waits for every job that's been added so far to finish.
+  void WaitForDone();
+
+ private:
+  class Job;
+
+  template <typename ReturnType>
+  QFuture<ReturnType> Start(ThreadFunctorBase<ReturnType>* functor) {
+    functor->reportStarted();
+    QFuture<ReturnType> future = functor->future();
+    Submit(functor);
+    return future;
+  }
+
+  // Must be called with mutex_ held.
+  void SubmitPending();
+  void JobFinished();
+  bool IsDone() const;
+
+ private:
+  WorkScheduler* scheduler_;
+  WorkScheduler::Priority priority_;
+  int max_concurrency_;
+
+  mutable QMutex mutex_;
+  QWaitCondition done_;
+  QList<QRunnable*> pending_;
+  int active_;
+
+  Q_DISABLE_COPY(WorkQueue)
+};
+
+#endif  // CORE_WORKSCHEDULER_H_
@@ -20,7 +20,6 @@
 #include "albumcoverexporter.h"
 
 #include <QFile>
-#include <QThreadPool>
 
 #include "core/song.h"
 #include "coverexportrunnable.h"
@@ -29,12 +28,10 @@ const int AlbumCoverExporter::kMaxConcurrentRequests = 3;
 
 AlbumCoverExporter::AlbumCoverExporter(QObject* parent)
     : QObject(parent),
-      thread_pool_(new QThreadPool(this)),
+      work_queue_(WorkScheduler::Priority_Normal, kMaxConcurrentRequests),
       exported_(0),
       skipped_(0),
-      all_(0) {
-  thread_pool_->setMaxThreadCount(kMaxConcurrentRequests);
-}
+      all_(0) {}
 
 void AlbumCoverExporter::SetDialogResult(
     const AlbumCoverExport::DialogResult& dialog_result) {
@@ -56,13 +53,13 @@ void AlbumCoverExporter::StartExporting() {
 
 void AlbumCoverExporter::AddJobsToPool() {
   while (!requests_.isEmpty() &&
-         thread_pool_->activeThreadCount() < thread_pool_->maxThreadCount()) {
+         work_queue_.active_count() < work_queue_.max_concurrency()) {
     CoverExportRunnable* runnable = requests_.dequeue();
 
     connect(runnable, SIGNAL(CoverExported()), SLOT(CoverExported()));
     connect(runnable, SIGNAL(CoverSkipped()), SLOT(CoverSkipped()));
 
-    thread_pool_->start(runnable);
+    work_queue_.Submit(runnable);
   }
 }
 
@@ -24,11 +24,10 @@
 #include <QTimer>
 
 #include "core/song.h"
+#include "core/workscheduler.h"
 #include "coverexportrunnable.h"
 #include "ui/albumcoverexport.h"
 
-class QThreadPool;
-
 class AlbumCoverExporter : public QObject {
   Q_OBJECT
 
@@ -57,7 +56,7 @@ class AlbumCoverExporter : public QObject {
   AlbumCoverExport::DialogResult dialog_result_;
 
   QQueue<CoverExportRunnable*> requests_;
-  QThreadPool* thread_pool_;
+  WorkQueue work_queue_;
 
   int exported_;
   int skipped_;
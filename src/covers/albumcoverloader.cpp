@@ -32,6 +32,7 @@
 #include "core/logging.h"
 #include "core/network.h"
 #include "core/tagreaderclient.h"
+#include "core/tracing.h"
 #include "core/utilities.h"
 #include "internet/core/internetmodel.h"
 
@@ -108,6 +109,7 @@ void AlbumCoverLoader::ProcessTasks() {
 }
 
 void AlbumCoverLoader::ProcessTask(Task* task) {
+  TRACE_SPAN("covers", "AlbumCoverLoader::ProcessTask");
   TryLoadResult result = TryLoadImage(*task);
   if (result.started_async) {
     // The image is being loaded from a remote URL, we'll carry on later
@@ -21,11 +21,12 @@
 #include <gst/gst.h>
 #include <gst/tag/tag.h>
 
-#include <QtConcurrentRun>
+#include <functional>
 
 #include "cddadevice.h"
 #include "core/logging.h"
 #include "core/timeconstants.h"
+#include "core/workscheduler.h"
 
 CddaSongLoader::CddaSongLoader(const QUrl& url, QObject* parent)
     : QObject(parent), url_(url), cdda_(nullptr), may_load_(true), disc_() {
@@ -70,8 +71,9 @@ void CddaSongLoader::LoadSongs() {
   if (!IsActive()) {
     QMutexLocker lock(&disc_mutex_);
     disc_ = Disc();
-    loading_future_ =
-        QtConcurrent::run(this, &CddaSongLoader::LoadSongsFromCdda);
+    loading_future_ = WorkScheduler::Instance()->Run<void>(
+        WorkScheduler::Priority_Normal,
+        std::bind(&CddaSongLoader::LoadSongsFromCdda, this));
   }
 }
 
@@ -17,6 +17,8 @@
 
 #include "connecteddevice.h"
 
+#include <QDateTime>
+#include <QFileInfo>
 #include <QtDebug>
 
 #include "core/application.h"
@@ -65,30 +67,49 @@ ConnectedDevice::~ConnectedDevice() {}
 
 void ConnectedDevice::InitBackendDirectory(const QString& mount_point,
                                            bool first_time, bool rewrite_path) {
-  if (first_time || backend_->GetAllDirectories().isEmpty()) {
+  if (rewrite_path) {
+    // The device might not be mounted at the same path each time, so store
+    // everything relative to the mount point and resolve paths against
+    // wherever it is now when they're read.
+    backend_->SetRootPath(mount_point);
+  }
+
+  const DirectoryList dirs = backend_->GetAllDirectories();
+  if (first_time || dirs.isEmpty()) {
     backend_->AddDirectory(mount_point);
   } else {
-    if (rewrite_path) {
-      // This is a bit of a hack.  The device might not be mounted at the same
-      // path each time, so if it's different we have to munge all the paths in
-      // the database to fix it.  This can be done entirely in sqlite so it's
-      // relatively fast...
-
-      // Get the directory it was mounted at last time.  Devices only have one
-      // directory (the root).
-      Directory dir = backend_->GetAllDirectories()[0];
-      if (dir.path != mount_point) {
-        // The directory is different, commence the munging.
-        qLog(Info) << "Changing path from" << dir.path << "to" << mount_point;
-        backend_->ChangeDirPath(dir.id, dir.path, mount_point);
-      }
-    }
+    // Devices only have one directory (the root).  If nothing at the top
+    // level of the device has changed since last time there's no need to
+    // look through the rest of it.
+    SetScanOnConnect(!rewrite_path || TopLevelDirectoriesChanged(dirs[0]));
 
     // Load the directory properly now
     backend_->LoadDirectoriesAsync();
   }
 }
 
+bool ConnectedDevice::TopLevelDirectoriesChanged(const Directory& dir) {
+  const SubdirectoryList subdirs = backend_->SubdirsInDirectory(dir.id);
+  if (subdirs.isEmpty()) return true;
+
+  for (const Subdirectory& subdir : subdirs) {
+    // Only look at the root and the directories directly inside it.
+    if (subdir.path != dir.path &&
+        QFileInfo(subdir.path).path() != dir.path) {
+      continue;
+    }
+
+    const QFileInfo info(subdir.path);
+    if (!info.exists() || info.lastModified().toTime_t() != subdir.mtime) {
+      qLog(Debug) << subdir.path << "changed since the device was last seen";
+      return true;
+    }
+  }
+
+  qLog(Info) << "Device contents unchanged, skipping scan of" << dir.path;
+  return false;
+}
+
 void ConnectedDevice::ConnectAsync() { emit ConnectFinished(unique_id_, true); }
 
 void ConnectedDevice::Eject() {
@@ -25,6 +25,7 @@
 
 #include "core/musicstorage.h"
 #include "core/song.h"
+#include "library/directory.h"
 
 class Application;
 class Database;
@@ -70,6 +71,11 @@ class ConnectedDevice : public QObject,
   void InitBackendDirectory(const QString& mount_point, bool first_time,
                             bool rewrite_path = true);
 
+  // Called before the device's library directory is loaded on a reconnect.
+  // scan is false if the device doesn't look like it has changed since it was
+  // last connected.
+  virtual void SetScanOnConnect(bool scan) {}
+
  protected:
   Application* app_;
 
@@ -85,6 +91,9 @@ class ConnectedDevice : public QObject,
 
   int song_count_;
 
+ private:
+  bool TopLevelDirectoriesChanged(const Directory& dir);
+
  private slots:
   void BackendTotalSongCountUpdated(int count);
 };
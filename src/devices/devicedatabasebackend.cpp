@@ -113,6 +113,7 @@ void DeviceDatabaseBackend::RemoveDevice(int id) {
   // Remove the songs tables for the device
   db.exec(QString("DROP TABLE device_%1_songs").arg(id));
   db.exec(QString("DROP TABLE device_%1_fts").arg(id));
+  db.exec(QString("DROP VIEW IF EXISTS device_%1_fts_source").arg(id));
   db.exec(QString("DROP TABLE device_%1_directories").arg(id));
   db.exec(QString("DROP TABLE device_%1_subdirectories").arg(id));
 
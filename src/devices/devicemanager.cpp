@@ -29,7 +29,6 @@
 
 #include "config.h"
 #include "core/application.h"
-#include "core/concurrentrun.h"
 #include "core/database.h"
 #include "core/logging.h"
 #include "core/musicstorage.h"
@@ -72,8 +71,8 @@ DeviceManager::DeviceManager(Application* app, QObject* parent)
     : SimpleTreeModel<DeviceInfo>(new DeviceInfo(this), parent),
       app_(app),
       not_connected_overlay_(
-          IconLoader::Load("edit-delete", IconLoader::Base)) {
-  thread_pool_.setMaxThreadCount(1);
+          IconLoader::Load("edit-delete", IconLoader::Base)),
+      work_queue_(WorkScheduler::Priority_Normal, 1) {
   connect(app_->task_manager(), SIGNAL(TasksChanged()), SLOT(TasksChanged()));
 
   // Create the backend in the database thread
@@ -85,8 +84,7 @@ DeviceManager::DeviceManager(Application* app, QObject* parent)
           SLOT(AddDeviceFromDb(DeviceInfo*)));
   // This reads from the database and contends on the database mutex, which can
   // be very slow on startup.
-  ConcurrentRun::Run<void>(&thread_pool_,
-                           bind(&DeviceManager::LoadAllDevices, this));
+  work_queue_.Run<void>(bind(&DeviceManager::LoadAllDevices, this));
 
   // This proxy model only shows connected devices
   connected_devices_model_ = new DeviceStateFilterModel(this);
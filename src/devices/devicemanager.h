@@ -20,10 +20,10 @@
 
 #include <QAbstractItemModel>
 #include <QIcon>
-#include <QThreadPool>
 #include <memory>
 
 #include "core/simpletreemodel.h"
+#include "core/workscheduler.h"
 #include "devicedatabasebackend.h"
 #include "deviceinfo.h"
 #include "library/librarymodel.h"
@@ -145,7 +145,7 @@ class DeviceManager : public SimpleTreeModel<DeviceInfo> {
   // Map of task ID to device index
   QMap<int, QPersistentModelIndex> active_tasks_;
 
-  QThreadPool thread_pool_;
+  WorkQueue work_queue_;
 };
 
 template <typename T>
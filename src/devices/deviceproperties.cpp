@@ -18,12 +18,12 @@
 #include "deviceproperties.h"
 
 #include <QScrollBar>
-#include <QtConcurrentRun>
 #include <functional>
 #include <memory>
 
 #include "connecteddevice.h"
 #include "core/utilities.h"
+#include "core/workscheduler.h"
 #include "devicelister.h"
 #include "devicemanager.h"
 #include "transcoder/transcoder.h"
@@ -221,8 +221,10 @@ void DeviceProperties::UpdateFormats() {
     // blocks, so do it in the background.
     supported_formats_.clear();
 
-    QFuture<bool> future = QtConcurrent::run(std::bind(
-        &ConnectedDevice::GetSupportedFiletypes, device, &supported_formats_));
+    QFuture<bool> future = WorkScheduler::Instance()->Run<bool>(
+        WorkScheduler::Priority_Normal,
+        std::bind(&ConnectedDevice::GetSupportedFiletypes, device,
+                  &supported_formats_));
     NewClosure(future, this, SLOT(UpdateFormatsFinished(QFuture<bool>)),
                future);
 
@@ -75,6 +75,12 @@ bool FilesystemDevice::Init() {
   return true;
 }
 
+void FilesystemDevice::SetScanOnConnect(bool scan) {
+  // Queued, so it reaches the watcher's thread before the directory does.  A
+  // device that looks changed is left to the user's startup scan setting.
+  if (!scan) watcher_->DisableStartupScanAsync();
+}
+
 FilesystemDevice::~FilesystemDevice() {
   watcher_->Stop();
   watcher_->deleteLater();
@@ -39,6 +39,9 @@ class FilesystemDevice : public ConnectedDevice,
 
   static QStringList url_schemes() { return QStringList() << "file"; }
 
+ protected:
+  void SetScanOnConnect(bool scan) override;
+
  private:
   LibraryWatcher* watcher_;
   QThread* watcher_thread_;
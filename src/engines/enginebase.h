@@ -47,6 +47,9 @@ class Base : public QObject {
 
   virtual void StartPreloading(const MediaPlaybackRequest&, bool, qint64,
                                qint64) {}
+  // Tells the engine which requests are likely to be loaded next, most likely
+  // first, so it can get them ready to start straight away.
+  virtual void Preroll(const QList<MediaPlaybackRequest>&) {}
   virtual bool Play(quint64 offset_nanosec) = 0;
   virtual void Stop(bool stop_after = false) = 0;
   virtual void Pause() = 0;
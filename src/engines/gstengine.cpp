@@ -33,8 +33,8 @@
 #include <QSettings>
 #include <QTimeLine>
 #include <QTimer>
-#include <QtConcurrentRun>
 #include <cmath>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <vector>
@@ -45,7 +45,9 @@
 #include "core/logging.h"
 #include "core/taskmanager.h"
 #include "core/timeconstants.h"
+#include "core/tracing.h"
 #include "core/utilities.h"
+#include "core/workscheduler.h"
 #include "devicefinder.h"
 #include "gstenginedebug.h"
 #include "gstenginepipeline.h"
@@ -101,10 +103,17 @@ const char* GstEngine::kEnterprisePipeline =
     "audiotestsrc wave=5 ! "
     "audiocheblimit mode=0 cutoff=120";
 
-GstEngine::GstEngine(Application* app)
+GstEngine::GstEngine(Application* app) : GstEngine(app->task_manager()) {
+  connect(app, SIGNAL(NewDebugConsole(Console*)), this,
+          SLOT(NewDebugConsole(Console*)));
+}
+
+GstEngine::GstEngine(TaskManager* task_manager)
     : Engine::Base(),
-      task_manager_(app->task_manager()),
+      task_manager_(task_manager),
       buffering_task_id_(-1),
+      first_audio_pending_(false),
+      first_audio_prerolled_(false),
       latest_buffer_(nullptr),
       equalizer_enabled_(false),
       stereo_balance_(0.0f),
@@ -126,8 +135,6 @@ GstEngine::GstEngine(Application* app)
   seek_timer_->setSingleShot(true);
   seek_timer_->setInterval(kSeekDelayNanosec / kNsecPerMsec);
   connect(seek_timer_, SIGNAL(timeout()), SLOT(SeekNow()));
-  connect(app, SIGNAL(NewDebugConsole(Console*)), this,
-          SLOT(NewDebugConsole(Console*)));
 
   ReloadSettings();
 
@@ -160,7 +167,9 @@ bool GstEngine::Init() {
     qputenv("GST_DEBUG_DUMP_DOT_DIR", path);
   }
 
-  initialising_ = QtConcurrent::run(this, &GstEngine::InitialiseGstreamer);
+  initialising_ = WorkScheduler::Instance()->Run<void>(
+      WorkScheduler::Priority_Interactive,
+      std::bind(&GstEngine::InitialiseGstreamer, this));
   return true;
 }
 
@@ -306,6 +315,25 @@ void GstEngine::AddBufferToScope(GstBuffer* buf, int pipeline_id) {
     return;
   }
 
+  if (first_audio_pending_) {
+    // The analyzer's branch is synchronised to the clock, so this is about
+    // when the buffer is heard.
+    first_audio_pending_ = false;
+
+    FirstAudioTiming timing;
+    timing.url = current_pipeline_->url();
+    timing.msec = first_audio_timer_.elapsed();
+    timing.prerolled = first_audio_prerolled_;
+    qLog(Debug) << "First audio after" << timing.msec << "ms"
+                << (timing.prerolled ? "(pre-rolled)" : "");
+
+    first_audio_timings_ << timing;
+    while (first_audio_timings_.count() > kMaxFirstAudioTimings) {
+      first_audio_timings_.removeFirst();
+    }
+    emit FirstAudioTimed();
+  }
+
   if (latest_buffer_ != nullptr) {
     gst_buffer_unref(latest_buffer_);
   }
@@ -403,6 +431,7 @@ void GstEngine::StartPreloading(const MediaPlaybackRequest& req,
 bool GstEngine::Load(const MediaPlaybackRequest& req,
                      Engine::TrackChangeFlags change, bool force_stop_at_end,
                      quint64 beginning_nanosec, qint64 end_nanosec) {
+  TRACE_SPAN("engine", "GstEngine::Load");
   EnsureInitialised();
 
   Engine::Base::Load(req, change, force_stop_at_end, beginning_nanosec,
@@ -425,10 +454,45 @@ bool GstEngine::Load(const MediaPlaybackRequest& req,
     return true;
   }
 
+  // Track changes happen inside the current pipeline wherever they can, so
+  // the output doesn't have to be opened again.  A track that starts part of
+  // the way through is seeked to once it's playing.
+  if (current_pipeline_ && !is_fading_out_to_pause_ &&
+      req.url_.scheme() != "hypnotoad" && req.url_.scheme() != "enterprise" &&
+      !current_pipeline_->is_buffering()) {
+    const qint64 end = force_stop_at_end ? end_nanosec : 0;
+
+    // Crossfades mix the rest of the old track in, which is only done for
+    // tracks that are playing from the start.
+    if (crossfade && beginning_nanosec == 0 &&
+        current_pipeline_->state() == GST_STATE_PLAYING &&
+        current_pipeline_->CrossfadeTo(req, end, fadeout_duration_nanosec_)) {
+      return true;
+    }
+
+    const bool prerolled = current_pipeline_->is_prerolled(req.url_);
+    if (current_pipeline_->SwitchTo(req, end)) {
+      // The switch put the volume back, so don't fade in again on Unpause.
+      if (has_faded_out_) {
+        disconnect(current_pipeline_.get(), SIGNAL(FaderFinished()), 0, 0);
+        has_faded_out_ = false;
+      }
+
+      first_audio_timer_.start();
+      first_audio_pending_ = true;
+      first_audio_prerolled_ = prerolled;
+      return true;
+    }
+  }
+
   shared_ptr<GstEnginePipeline> pipeline =
       CreatePipeline(req, force_stop_at_end ? end_nanosec : 0);
   if (!pipeline) return false;
 
+  first_audio_timer_.start();
+  first_audio_pending_ = true;
+  first_audio_prerolled_ = false;
+
   if (crossfade) StartFadeout();
 
   BufferingFinished();
@@ -867,6 +931,27 @@ shared_ptr<GstEnginePipeline> GstEngine::CreatePipeline(
   return ret;
 }
 
+void GstEngine::Preroll(const QList<MediaPlaybackRequest>& reqs) {
+  EnsureInitialised();
+
+  if (!current_pipeline_) return;
+
+  QList<MediaPlaybackRequest> prerolled;
+  for (const MediaPlaybackRequest& req : reqs) {
+    if (prerolled.count() >= kMaxPrerolledTracks) break;
+
+    // Streams might be live, or cost something to open, so only files are
+    // pre-rolled.
+    if (!req.url_.isLocalFile()) continue;
+
+    prerolled << req;
+  }
+
+  // Only the tracks' decoders are made, in the current pipeline, so they can
+  // be switched to without opening the output again.
+  current_pipeline_->Preroll(prerolled);
+}
+
 void GstEngine::AddBufferConsumer(BufferConsumer* consumer) {
   buffer_consumers_ << consumer;
   if (current_pipeline_) current_pipeline_->AddBufferConsumer(consumer);
@@ -24,6 +24,7 @@
 
 #include <gst/gst.h>
 
+#include <QElapsedTimer>
 #include <QFuture>
 #include <QHash>
 #include <QList>
@@ -61,6 +62,8 @@ class GstEngine : public Engine::Base, public BufferConsumer {
 
  public:
   GstEngine(Application* app);
+  // Without an Application there's no debug console.
+  explicit GstEngine(TaskManager* task_manager);
   ~GstEngine();
 
   struct OutputDetails {
@@ -72,6 +75,12 @@ class GstEngine : public Engine::Base, public BufferConsumer {
   };
   typedef QList<OutputDetails> OutputDetailsList;
 
+  struct FirstAudioTiming {
+    QUrl url;
+    int msec;
+    bool prerolled;
+  };
+
   static const int kAutoSampleRate = -1;
   static const char* kOutFormatDetect;
   static const char* kOutFormatS16LE;
@@ -95,6 +104,12 @@ class GstEngine : public Engine::Base, public BufferConsumer {
 
   OutputDetailsList GetOutputsList() const;
 
+  // How long the latest tracks took from being loaded to their first audio
+  // being played, oldest first.
+  QList<FirstAudioTiming> first_audio_timings() const {
+    return first_audio_timings_;
+  }
+
   GstElement* CreateElement(const QString& factoryName, GstElement* bin = 0);
 
   // BufferConsumer
@@ -103,6 +118,7 @@ class GstEngine : public Engine::Base, public BufferConsumer {
  public slots:
   void StartPreloading(const MediaPlaybackRequest& req, bool force_stop_at_end,
                        qint64 beginning_nanosec, qint64 end_nanosec);
+  void Preroll(const QList<MediaPlaybackRequest>& reqs);
   bool Load(const MediaPlaybackRequest&, Engine::TrackChangeFlags change,
             bool force_stop_at_end, quint64 beginning_nanosec,
             qint64 end_nanosec);
@@ -132,6 +148,9 @@ class GstEngine : public Engine::Base, public BufferConsumer {
 
   void NewDebugConsole(Console* console);
 
+ signals:
+  void FirstAudioTimed();
+
  protected:
   void SetVolumeSW(uint percent);
   void timerEvent(QTimerEvent*);
@@ -190,6 +209,8 @@ class GstEngine : public Engine::Base, public BufferConsumer {
   static const qint64 kTimerIntervalNanosec = 1000 * kNsecPerMsec;  // 1s
   static const qint64 kPreloadGapNanosec = 2000 * kNsecPerMsec;     // 2s
   static const qint64 kSeekDelayNanosec = 100 * kNsecPerMsec;       // 100msec
+  static const int kMaxPrerolledTracks = 2;
+  static const int kMaxFirstAudioTimings = 50;
 
   static const char* kHypnotoadPipeline;
   static const char* kEnterprisePipeline;
@@ -207,6 +228,11 @@ class GstEngine : public Engine::Base, public BufferConsumer {
   std::shared_ptr<GstEnginePipeline> fadeout_pause_pipeline_;
   QUrl preloaded_url_;
 
+  QElapsedTimer first_audio_timer_;
+  bool first_audio_pending_;
+  bool first_audio_prerolled_;
+  QList<FirstAudioTiming> first_audio_timings_;
+
   QList<BufferConsumer*> buffer_consumers_;
 
   GstBuffer* latest_buffer_;
@@ -25,6 +25,9 @@ GstEngineDebug::GstEngineDebug(GstEngine* engine, QWidget* parent)
     : QWidget(parent), engine_(engine) {
   ui_.setupUi(this);
   connect(ui_.dump_graph_button, SIGNAL(clicked()), SLOT(DumpGraph()));
+  connect(engine_, SIGNAL(FirstAudioTimed()), SLOT(UpdateFirstAudioTimings()));
+
+  UpdateFirstAudioTimings();
 }
 
 void GstEngineDebug::DumpGraph() {
@@ -33,3 +36,30 @@ void GstEngineDebug::DumpGraph() {
     pipeline->DumpGraph();
   }
 }
+
+void GstEngineDebug::UpdateFirstAudioTimings() {
+  ui_.first_audio_list->clear();
+
+  int count[2] = {0, 0};
+  qint64 total[2] = {0, 0};
+  for (const GstEngine::FirstAudioTiming& timing :
+       engine_->first_audio_timings()) {
+    // Newest first.
+    QTreeWidgetItem* item = new QTreeWidgetItem;
+    item->setText(0, timing.url.fileName());
+    item->setToolTip(0, timing.url.toString());
+    item->setData(1, Qt::DisplayRole, timing.msec);
+    item->setText(2, timing.prerolled ? tr("Yes") : tr("No"));
+    ui_.first_audio_list->insertTopLevelItem(0, item);
+
+    count[timing.prerolled]++;
+    total[timing.prerolled] += timing.msec;
+  }
+
+  ui_.first_audio_summary->setText(
+      tr("Average: %1 ms pre-rolled (%2 tracks), %3 ms otherwise (%4 tracks)")
+          .arg(count[1] ? total[1] / count[1] : 0)
+          .arg(count[1])
+          .arg(count[0] ? total[0] / count[0] : 0)
+          .arg(count[0]));
+}
@@ -31,6 +31,7 @@ class GstEngineDebug : public QWidget {
 
  private slots:
   void DumpGraph();
+  void UpdateFirstAudioTimings();
 
  private:
   Ui::GstEngineDebug ui_;
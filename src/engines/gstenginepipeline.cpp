@@ -28,7 +28,6 @@
 
 #include "bufferconsumer.h"
 #include "config.h"
-#include "core/concurrentrun.h"
 #include "core/logging.h"
 #include "core/mac_startup.h"
 #include "core/signalchecker.h"
@@ -40,8 +39,6 @@
 #endif
 #include "internet/core/internetmodel.h"
 
-const int GstEnginePipeline::kGstStateTimeoutNanosecs = 10000000;
-const int GstEnginePipeline::kFaderFudgeMsec = 2000;
 
 const int GstEnginePipeline::kEqBandCount = 10;
 const int GstEnginePipeline::kEqBandFrequencies[] = {
@@ -79,9 +76,10 @@ GstEnginePipeline::GstEnginePipeline(GstEngine* engine)
       pipeline_is_initialised_(false),
       pipeline_is_connected_(false),
       pending_seek_nanosec_(-1),
-      last_known_position_ns_(0),
+      state_(GST_STATE_NULL),
+      position_nanosec_(0),
+      duration_nanosec_(0),
       volume_percent_(100),
-      volume_modifier_(1.0),
       uridecodebin_(nullptr),
       audiobin_(nullptr),
       queue_(nullptr),
@@ -97,7 +95,22 @@ GstEnginePipeline::GstEnginePipeline(GstEngine* engine)
       capsfilter_(nullptr),
       tee_(nullptr),
       tee_probe_pad_(nullptr),
-      tee_audio_pad_(nullptr) {
+      tee_audio_pad_(nullptr),
+      set_state_queue_(WorkScheduler::Priority_Interactive),
+      mixer_(nullptr),
+      mixer_trunk_pad_(nullptr),
+      mixer_running_time_(0),
+      tail_decodebin_(nullptr),
+      tail_bin_(nullptr),
+      tail_pad_(nullptr),
+      tail_audiobin_pad_(nullptr),
+      tail_mixer_pad_(nullptr),
+      tail_probe_id_(0),
+      tail_linked_(0),
+      crossfade_pending_(false),
+      crossfade_decodebin_(nullptr),
+      crossfade_end_nanosec_(0),
+      crossfade_duration_nanosec_(0) {
   if (!sElementDeleter) {
     sElementDeleter = new GstElementDeleter;
   }
@@ -148,7 +161,10 @@ bool GstEnginePipeline::ReplaceDecodeBin(GstElement* new_bin) {
   segment_start_ = 0;
   segment_start_received_ = false;
   pipeline_is_connected_ = false;
-  gst_bin_add(GST_BIN(pipeline_), uridecodebin_);
+  // Prerolled tracks are already in the pipeline.
+  if (GST_ELEMENT_PARENT(uridecodebin_) != pipeline_) {
+    gst_bin_add(GST_BIN(pipeline_), uridecodebin_);
+  }
 
   return true;
 }
@@ -178,6 +194,51 @@ GstElement* GstEnginePipeline::CreateDecodeBinFromUrl(const QUrl& url) {
   return new_bin;
 }
 
+namespace {
+
+const char* kReplayGainTagsKey = "clementine-replaygain-tags";
+const char* kDecodeBinKey = "clementine-decodebin";
+
+// Kept by each decodebin pad that might need the library's gains.
+struct ReplayGainProbeData {
+  GstTagList* tags;
+  // Until the stream has some ReplayGain tags of its own.
+  bool needed;
+};
+
+void FreeReplayGainProbeData(gpointer data) {
+  ReplayGainProbeData* probe_data =
+      reinterpret_cast<ReplayGainProbeData*>(data);
+  gst_tag_list_unref(probe_data->tags);
+  delete probe_data;
+}
+
+}  // namespace
+
+void GstEnginePipeline::SetReplayGainTags(GstElement* bin,
+                                          const MediaPlaybackRequest& req) {
+  if (req.rg_track_peak_ < 0) return;
+
+  GstTagList* tags = gst_tag_list_new(
+      GST_TAG_TRACK_GAIN, gdouble(req.rg_track_gain_), GST_TAG_TRACK_PEAK,
+      gdouble(req.rg_track_peak_), nullptr);
+  if (req.rg_album_peak_ >= 0) {
+    gst_tag_list_add(tags, GST_TAG_MERGE_REPLACE, GST_TAG_ALBUM_GAIN,
+                     gdouble(req.rg_album_gain_), GST_TAG_ALBUM_PEAK,
+                     gdouble(req.rg_album_peak_), nullptr);
+  }
+
+  g_object_set_data_full(
+      G_OBJECT(bin), kReplayGainTagsKey, tags,
+      reinterpret_cast<GDestroyNotify>(gst_mini_object_unref));
+}
+
+GstElement* GstEnginePipeline::FindDecodeBin(GstElement* bin) {
+  GstElement* decodebin = reinterpret_cast<GstElement*>(
+      g_object_get_data(G_OBJECT(bin), kDecodeBinKey));
+  return decodebin ? decodebin : bin;
+}
+
 GstElement* GstEnginePipeline::CreateDecodeBinFromString(const char* pipeline) {
   GError* error = nullptr;
   GstElement* bin = gst_parse_bin_from_description(pipeline, TRUE, &error);
@@ -213,10 +274,16 @@ bool GstEnginePipeline::InitAudioBin() {
   // samples for the scope, the other is kept as float32 and sent to the
   // speaker.
   //   tee1 ! probe_queue ! probe_converter ! <caps16> ! probe_sink
-  //   tee2 ! audio_queue ! equalizer_preamp ! equalizer ! volume ! audioscale
-  //        ! convert ! audiosink
+  //   tee2 ! audio_queue ! fader ! mixer ! equalizer_preamp ! equalizer
+  //        ! volume ! audioscale ! convert ! audiosink
+  // The fader is another volume element whose volume is driven by a control
+  // source, so fades don't interfere with the user's volume.  The mixer only
+  // has one input until we crossfade to another track, when the rest of the
+  // old track goes into it through a tail bin (see CreateTailBin()).
 
   gst_segment_init(&last_decodebin_segment_, GST_FORMAT_TIME);
+  gst_segment_init(&probe_segment_, GST_FORMAT_TIME);
+  gst_segment_init(&mixer_segment_, GST_FORMAT_TIME);
 
   // Audio bin
   audiobin_ = gst_bin_new("audiobin");
@@ -257,7 +324,7 @@ bool GstEnginePipeline::InitAudioBin() {
 
   // Create all the other elements
   GstElement *probe_queue, *probe_converter, *probe_sink, *audio_queue,
-      *convert;
+      *fader, *convert;
 
   queue_ = engine_->CreateElement("queue2", audiobin_);
   audioconvert_ = engine_->CreateElement("audioconvert", audiobin_);
@@ -268,6 +335,8 @@ bool GstEnginePipeline::InitAudioBin() {
   probe_sink = engine_->CreateElement("fakesink", audiobin_);
 
   audio_queue = engine_->CreateElement("queue", audiobin_);
+  fader = engine_->CreateElement("volume", audiobin_);
+  mixer_ = engine_->CreateElement("audiomixer", audiobin_);
   equalizer_preamp_ = engine_->CreateElement("volume", audiobin_);
   equalizer_ = engine_->CreateElement("equalizer-nbands", audiobin_);
   stereo_panorama_ = engine_->CreateElement("audiopanorama", audiobin_);
@@ -277,9 +346,9 @@ bool GstEnginePipeline::InitAudioBin() {
   capsfilter_ = engine_->CreateElement("capsfilter", audiobin_);
 
   if (!queue_ || !audioconvert_ || !tee_ || !probe_queue || !probe_converter ||
-      !probe_sink || !audio_queue || !equalizer_preamp_ || !equalizer_ ||
-      !stereo_panorama_ || !volume_ || !audioscale_ || !convert ||
-      !capsfilter_) {
+      !probe_sink || !audio_queue || !fader || !mixer_ || !equalizer_preamp_ ||
+      !equalizer_ || !stereo_panorama_ || !volume_ || !audioscale_ ||
+      !convert || !capsfilter_) {
     qLog(Error) << "Failed to create elements";
     return false;
   }
@@ -324,8 +393,11 @@ bool GstEnginePipeline::InitAudioBin() {
                     &EventHandoffCallback, this, NULL);
   gst_object_unref(pad);
 
-  // Configure the fakesink properly
-  g_object_set(G_OBJECT(probe_sink), "sync", TRUE, nullptr);
+  // Configure the fakesink properly.  It doesn't take part in prerolling, so
+  // flushing the trunk when switching tracks doesn't make the whole pipeline
+  // preroll again.  The audio sink is behind the mixer, which doesn't pass
+  // those flushes on.
+  g_object_set(G_OBJECT(probe_sink), "sync", TRUE, "async", FALSE, nullptr);
 
   // Setting the equalizer bands:
   //
@@ -424,7 +496,16 @@ bool GstEnginePipeline::InitAudioBin() {
   // Link the analyzer output of the tee
   gst_element_link(probe_queue, probe_converter);
 
-  gst_element_link_many(audio_queue, equalizer_preamp_, equalizer_,
+  gst_element_link(audio_queue, fader);
+  fader_.reset(new GstFader(fader));
+  connect(fader_.get(), SIGNAL(Finished()), SIGNAL(FaderFinished()));
+
+  pad = gst_element_get_static_pad(fader, "src");
+  mixer_trunk_pad_ = gst_element_get_request_pad(mixer_, "sink_%u");
+  gst_pad_link(pad, mixer_trunk_pad_);
+  gst_object_unref(pad);
+
+  gst_element_link_many(mixer_, equalizer_preamp_, equalizer_,
                         stereo_panorama_, volume_, audioscale_, convert,
                         nullptr);
 
@@ -448,6 +529,25 @@ bool GstEnginePipeline::InitAudioBin() {
   pad = gst_element_get_static_pad(probe_converter, "src");
   gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, HandoffCallback, this,
                     nullptr);
+  // The mixer swallows the stream-start events of each track, so the sinks
+  // only see the first one and the bus never tells us about the others.  This
+  // branch isn't mixed, and sees them just before the track's first buffer.
+  gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, StreamStartProbe,
+                    this, nullptr);
+  gst_object_unref(pad);
+  pad = gst_element_get_static_pad(mixer_, "src");
+  gst_pad_add_probe(
+      pad,
+      static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER |
+                                   GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+      MixerProbe, this, nullptr);
+  gst_object_unref(pad);
+  pad = gst_element_get_static_pad(probe_sink, "sink");
+  gst_pad_add_probe(
+      pad,
+      static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER |
+                                   GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+      PositionProbe, this, nullptr);
   gst_object_unref(pad);
   GstBus* bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline_));
   gst_bus_set_sync_handler(bus, BusCallbackSync, this, nullptr);
@@ -507,6 +607,7 @@ bool GstEnginePipeline::InitFromReq(const MediaPlaybackRequest& req,
 
   // Decode bin
   if (!ReplaceDecodeBin(url)) return false;
+  SetReplayGainTags(uridecodebin_, req);
 
   if (!InitAudioBin()) return false;
 
@@ -517,6 +618,11 @@ bool GstEnginePipeline::InitFromReq(const MediaPlaybackRequest& req,
 }
 
 GstEnginePipeline::~GstEnginePipeline() {
+  if (crossfade_pending_) {
+    if (!tail_linked_.load()) gst_pad_remove_probe(tail_pad_, tail_probe_id_);
+    gst_object_unref(crossfade_decodebin_);
+  }
+
   if (pipeline_) {
     GstBus* bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline_));
     gst_bus_remove_watch(bus);
@@ -538,6 +644,24 @@ GstEnginePipeline::~GstEnginePipeline() {
         gst_object_unref(tee_audio_pad_);
       }
     }
+
+    if (mixer_) {
+      if (mixer_trunk_pad_) {
+        gst_element_release_request_pad(mixer_, mixer_trunk_pad_);
+        gst_object_unref(mixer_trunk_pad_);
+      }
+      if (tail_mixer_pad_) {
+        gst_element_release_request_pad(mixer_, tail_mixer_pad_);
+        gst_object_unref(tail_mixer_pad_);
+      }
+    }
+  }
+
+  if (tail_pad_) gst_object_unref(tail_pad_);
+
+  // The prerolled tracks' bins went with the pipeline.
+  for (const PrerolledTrack& track : prerolled_) {
+    gst_object_unref(track.queue_src);
   }
 }
 
@@ -561,6 +685,11 @@ gboolean GstEnginePipeline::BusCallback(GstBus*, GstMessage* msg,
       instance->StateChangedMessageReceived(msg);
       break;
 
+    case GST_MESSAGE_DURATION_CHANGED:
+    case GST_MESSAGE_ASYNC_DONE:
+      instance->UpdateDuration();
+      break;
+
     default:
       break;
   }
@@ -604,15 +733,6 @@ GstBusSyncReply GstEnginePipeline::BusCallbackSync(GstBus*, GstMessage* msg,
       instance->StreamStatusMessageReceived(msg);
       break;
 
-    case GST_MESSAGE_STREAM_START:
-      if (instance->emit_track_ended_on_stream_start_) {
-        qLog(Debug) << "New segment started, EOS will signal on next buffer "
-                       "discontinuity";
-        instance->emit_track_ended_on_stream_start_ = false;
-        instance->emit_track_ended_on_time_discontinuity_ = true;
-      }
-      break;
-
     default:
       break;
   }
@@ -671,6 +791,18 @@ void GstEnginePipeline::ErrorMessageReceived(GstMessage* msg) {
   g_error_free(error);
   g_free(debugs);
 
+  if (IsFromPrerolled(msg)) {
+    qLog(Warning) << id() << "Error in a prerolled track:" << message;
+    return;
+  }
+
+  if (IsFromTail(msg)) {
+    // The track is being faded out anyway.
+    qLog(Warning) << id() << "Error in the track being faded out:" << message;
+    QMetaObject::invokeMethod(this, "RemoveTail", Qt::QueuedConnection);
+    return;
+  }
+
   if (!redirect_url_.isEmpty() &&
       debugstr.contains(
           "A redirect message was posted on the bus and should have been "
@@ -729,13 +861,35 @@ void GstEnginePipeline::TagMessageReceived(GstMessage* msg) {
 
   gst_tag_list_free(taglist);
 
-  if (ignore_tags_) return;
+  if (ignore_tags_ || IsFromTail(msg) || IsFromPrerolled(msg)) return;
 
   if (!bundle.title.isEmpty() || !bundle.artist.isEmpty() ||
       !bundle.comment.isEmpty() || !bundle.album.isEmpty())
     emit MetadataFound(id(), bundle);
 }
 
+bool GstEnginePipeline::IsFromTail(GstMessage* msg) const {
+  for (GstElement* tail : {tail_decodebin_, tail_bin_}) {
+    if (tail &&
+        gst_object_has_as_ancestor(GST_MESSAGE_SRC(msg), GST_OBJECT(tail))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool GstEnginePipeline::IsFromPrerolled(GstMessage* msg) {
+  QMutexLocker l(&prerolled_mutex_);
+  for (PrerolledTrack& track : prerolled_) {
+    if (gst_object_has_as_ancestor(GST_MESSAGE_SRC(msg),
+                                   GST_OBJECT(track.bin))) {
+      if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) track.failed = true;
+      return true;
+    }
+  }
+  return false;
+}
+
 QString GstEnginePipeline::ParseTag(GstTagList* list, const char* tag) const {
   gchar* data = nullptr;
   bool success = gst_tag_list_get_string(list, tag, &data);
@@ -756,6 +910,7 @@ void GstEnginePipeline::StateChangedMessageReceived(GstMessage* msg) {
 
   GstState old_state, new_state, pending;
   gst_message_parse_state_changed(msg, &old_state, &new_state, &pending);
+  state_ = new_state;
 
   if (!pipeline_is_initialised_ &&
       (new_state == GST_STATE_PAUSED || new_state == GST_STATE_PLAYING)) {
@@ -772,6 +927,16 @@ void GstEnginePipeline::StateChangedMessageReceived(GstMessage* msg) {
   }
 }
 
+void GstEnginePipeline::UpdateDuration() {
+  // This is only called on the main thread, where asking the decodebin can't
+  // hold up the streaming threads.
+  gint64 value = 0;
+  if (uridecodebin_ && gst_element_query_duration(FindDecodeBin(uridecodebin_),
+                                                  GST_FORMAT_TIME, &value)) {
+    duration_nanosec_ = value;
+  }
+}
+
 void GstEnginePipeline::BufferingMessageReceived(GstMessage* msg) {
   // Only handle buffering messages from the queue2 element in audiobin - not
   // the one that's created automatically by uridecodebin.
@@ -820,18 +985,20 @@ QString GstEnginePipeline::GetAudioFormat(GstCaps* caps) {
   return "";
 }
 
-void GstEnginePipeline::NewPadCallback(GstElement*, GstPad* pad,
+void GstEnginePipeline::NewPadCallback(GstElement* bin, GstPad* pad,
                                        gpointer self) {
   GstEnginePipeline* instance = reinterpret_cast<GstEnginePipeline*>(self);
-  GstPad* const audiopad =
-      gst_element_get_static_pad(instance->audiobin_, "sink");
 
   qLog(Debug) << "Decoder bin pad added:" << GST_PAD_NAME(pad);
+  instance->LinkDecodedPad(bin, pad);
+}
+
+void GstEnginePipeline::LinkDecodedPad(GstElement* bin, GstPad* pad) {
+  GstPad* const audiopad = gst_element_get_static_pad(audiobin_, "sink");
 
   // Make sure the audio bin isn't already linked to something.
   if (GST_PAD_IS_LINKED(audiopad)) {
-    qLog(Warning) << instance->id()
-                  << "audiopad is already linked, unlinking old pad";
+    qLog(Warning) << id() << "audiopad is already linked, unlinking old pad";
     gst_pad_unlink(audiopad, GST_PAD_PEER(audiopad));
   }
 
@@ -842,9 +1009,9 @@ void GstEnginePipeline::NewPadCallback(GstElement*, GstPad* pad,
     qLog(Debug) << "Initial decoder caps:" << caps_str;
     g_free(caps_str);
 
-    if (instance->format_ != GstEngine::kOutFormatDetect) {
+    if (format_ != GstEngine::kOutFormatDetect) {
       // Caps were set when the pipeline was constructed.
-    } else if (instance->pipeline_is_initialised_) {
+    } else if (pipeline_is_initialised_) {
       qLog(Debug)
           << "Ignoring native format since pipeline is already running.";
     } else {
@@ -853,9 +1020,9 @@ void GstEnginePipeline::NewPadCallback(GstElement*, GstPad* pad,
       // The output branch only handles F32LE and S16LE. If the source is S16LE,
       // then use that throughout the pipeline. Otherwise, use F32LE.
       if (fmt == GstEngine::kOutFormatS16LE) {
-        instance->SetOutputFormat(GstEngine::kOutFormatS16LE);
+        SetOutputFormat(GstEngine::kOutFormatS16LE);
       } else {
-        instance->SetOutputFormat(GstEngine::kOutFormatF32LE);
+        SetOutputFormat(GstEngine::kOutFormatF32LE);
       }
     }
     gst_caps_unref(caps);
@@ -872,8 +1039,8 @@ void GstEnginePipeline::NewPadCallback(GstElement*, GstPad* pad,
   // decodebin.
   // "Running time" is the time since the last flushing seek.
   GstClockTime running_time = gst_segment_to_running_time(
-      &instance->last_decodebin_segment_, GST_FORMAT_TIME,
-      instance->last_decodebin_segment_.position);
+      &last_decodebin_segment_, GST_FORMAT_TIME,
+      last_decodebin_segment_.position);
   gst_pad_set_offset(pad, running_time);
 
   // Add a probe to the pad so we can update last_decodebin_segment_.
@@ -882,13 +1049,25 @@ void GstEnginePipeline::NewPadCallback(GstElement*, GstPad* pad,
       static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER |
                                    GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM |
                                    GST_PAD_PROBE_TYPE_EVENT_FLUSH),
-      DecodebinProbe, instance, nullptr);
+      DecodebinProbe, this, nullptr);
+
+  GstTagList* replaygain_tags = reinterpret_cast<GstTagList*>(
+      g_object_get_data(G_OBJECT(bin), kReplayGainTagsKey));
+  if (replaygain_tags && rg_enabled_) {
+    ReplayGainProbeData* data = new ReplayGainProbeData;
+    data->tags = gst_tag_list_ref(replaygain_tags);
+    data->needed = true;
+    gst_pad_add_probe(
+        pad,
+        static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER |
+                                     GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+        ReplayGainProbe, data, FreeReplayGainProbeData);
+  }
 
-  instance->pipeline_is_connected_ = true;
-  if (instance->pending_seek_nanosec_ != -1 &&
-      instance->pipeline_is_initialised_) {
-    QMetaObject::invokeMethod(instance, "Seek", Qt::QueuedConnection,
-                              Q_ARG(qint64, instance->pending_seek_nanosec_));
+  pipeline_is_connected_ = true;
+  if (pending_seek_nanosec_ != -1 && pipeline_is_initialised_) {
+    QMetaObject::invokeMethod(this, "Seek", Qt::QueuedConnection,
+                              Q_ARG(qint64, pending_seek_nanosec_));
   }
 }
 
@@ -898,6 +1077,11 @@ GstPadProbeReturn GstEnginePipeline::DecodebinProbe(GstPad* pad,
   GstEnginePipeline* instance = reinterpret_cast<GstEnginePipeline*>(data);
   const GstPadProbeType info_type = GST_PAD_PROBE_INFO_TYPE(info);
 
+  // The track being faded out doesn't affect where the next one starts.
+  if (instance->tail_linked_.load() && pad == instance->tail_pad_) {
+    return GST_PAD_PROBE_OK;
+  }
+
   if (info_type & GST_PAD_PROBE_TYPE_BUFFER) {
     // The decodebin produced a buffer.  Record its end time, so we can offset
     // the buffers produced by the next decodebin when transitioning to the next
@@ -933,6 +1117,38 @@ GstPadProbeReturn GstEnginePipeline::DecodebinProbe(GstPad* pad,
   return GST_PAD_PROBE_OK;
 }
 
+GstPadProbeReturn GstEnginePipeline::ReplayGainProbe(GstPad* pad,
+                                                     GstPadProbeInfo* info,
+                                                     gpointer data) {
+  ReplayGainProbeData* probe_data =
+      reinterpret_cast<ReplayGainProbeData*>(data);
+  const GstPadProbeType info_type = GST_PAD_PROBE_INFO_TYPE(info);
+
+  if (info_type & GST_PAD_PROBE_TYPE_BUFFER) {
+    if (probe_data->needed) {
+      // The file's tags have all been sent by the time its audio is, so it
+      // doesn't have any gains.  Send ours to rgvolume before the audio.
+      probe_data->needed = false;
+      gst_pad_push_event(
+          pad, gst_event_new_tag(gst_tag_list_copy(probe_data->tags)));
+    }
+  } else if (info_type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+    GstEvent* event = GST_PAD_PROBE_INFO_EVENT(info);
+    if (GST_EVENT_TYPE(event) == GST_EVENT_TAG) {
+      GstTagList* tags = nullptr;
+      gst_event_parse_tag(event, &tags);
+
+      gdouble gain = 0;
+      if (gst_tag_list_get_double(tags, GST_TAG_TRACK_GAIN, &gain) ||
+          gst_tag_list_get_double(tags, GST_TAG_ALBUM_GAIN, &gain)) {
+        probe_data->needed = false;
+      }
+    }
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
 GstPadProbeReturn GstEnginePipeline::HandoffCallback(GstPad*,
                                                      GstPadProbeInfo* info,
                                                      gpointer self) {
@@ -999,6 +1215,84 @@ GstPadProbeReturn GstEnginePipeline::HandoffCallback(GstPad*,
   return GST_PAD_PROBE_OK;
 }
 
+GstPadProbeReturn GstEnginePipeline::PositionProbe(GstPad*,
+                                                   GstPadProbeInfo* info,
+                                                   gpointer self) {
+  GstEnginePipeline* instance = reinterpret_cast<GstEnginePipeline*>(self);
+  const GstPadProbeType info_type = GST_PAD_PROBE_INFO_TYPE(info);
+
+  if (info_type & GST_PAD_PROBE_TYPE_BUFFER) {
+    // The sink waits for the clock after this, so it's as close as we get to
+    // the buffer being heard.
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    const GstClockTime position =
+        gst_segment_to_stream_time(&instance->probe_segment_, GST_FORMAT_TIME,
+                                   GST_BUFFER_TIMESTAMP(buffer));
+    if (GST_CLOCK_TIME_IS_VALID(position)) {
+      instance->position_nanosec_ = position;
+    }
+  } else if (info_type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+    GstEvent* event = GST_PAD_PROBE_INFO_EVENT(info);
+    if (GST_EVENT_TYPE(event) == GST_EVENT_SEGMENT) {
+      gst_event_copy_segment(event, &instance->probe_segment_);
+    }
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn GstEnginePipeline::StreamStartProbe(GstPad*,
+                                                      GstPadProbeInfo* info,
+                                                      gpointer self) {
+  GstEnginePipeline* instance = reinterpret_cast<GstEnginePipeline*>(self);
+  GstEvent* event = GST_PAD_PROBE_INFO_EVENT(info);
+  if (GST_EVENT_TYPE(event) != GST_EVENT_STREAM_START) return GST_PAD_PROBE_OK;
+
+  if (instance->emit_track_ended_on_stream_start_) {
+    qLog(Debug) << "New stream started, EOS will signal on next buffer "
+                   "discontinuity";
+    instance->emit_track_ended_on_stream_start_ = false;
+    instance->emit_track_ended_on_time_discontinuity_ = true;
+  }
+
+  // Whichever way we got to a new track, it's about to be played, and the
+  // length we've got is the last one's.
+  QMetaObject::invokeMethod(instance, "UpdateDuration", Qt::QueuedConnection);
+
+  return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn GstEnginePipeline::MixerProbe(GstPad*, GstPadProbeInfo* info,
+                                                gpointer self) {
+  GstEnginePipeline* instance = reinterpret_cast<GstEnginePipeline*>(self);
+  const GstPadProbeType info_type = GST_PAD_PROBE_INFO_TYPE(info);
+
+  if (info_type & GST_PAD_PROBE_TYPE_BUFFER) {
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    GstClockTime end = GST_BUFFER_TIMESTAMP(buffer);
+    if (!GST_CLOCK_TIME_IS_VALID(end)) return GST_PAD_PROBE_OK;
+    if (GST_BUFFER_DURATION_IS_VALID(buffer)) {
+      end += GST_BUFFER_DURATION(buffer);
+    }
+
+    const GstClockTime running_time = gst_segment_to_running_time(
+        &instance->mixer_segment_, GST_FORMAT_TIME, end);
+    if (GST_CLOCK_TIME_IS_VALID(running_time)) {
+      instance->mixer_running_time_ = running_time;
+    }
+  } else if (info_type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+    GstEvent* event = GST_PAD_PROBE_INFO_EVENT(info);
+    if (GST_EVENT_TYPE(event) == GST_EVENT_SEGMENT) {
+      gst_event_copy_segment(event, &instance->mixer_segment_);
+    } else if (GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_STOP) {
+      // Seeking starts the running time again.
+      instance->mixer_running_time_ = 0;
+    }
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
 GstPadProbeReturn GstEnginePipeline::EventHandoffCallback(GstPad*,
                                                           GstPadProbeInfo* info,
                                                           gpointer self) {
@@ -1031,6 +1325,12 @@ void GstEnginePipeline::SourceDrainedCallback(GstURIDecodeBin* bin,
                                               gpointer self) {
   GstEnginePipeline* instance = reinterpret_cast<GstEnginePipeline*>(self);
 
+  if (!instance->uridecodebin_ ||
+      GST_ELEMENT(bin) != FindDecodeBin(instance->uridecodebin_)) {
+    // This is the track being faded out, or one that's being prerolled.
+    return;
+  }
+
   if (instance->has_next_valid_url() &&
       // I'm not sure why, but calling this when previous track is a local song
       // and the next track is a Spotify song is buggy: the Spotify song will
@@ -1105,6 +1405,13 @@ void GstEnginePipeline::TransitionToNext() {
     qLog(Error) << "ReplaceDecodeBin failed with " << next_.url_;
     return;
   }
+  SetReplayGainTags(uridecodebin_, next_);
+
+  // This function gets called when the source has been drained, even if the
+  // song hasn't finished playing yet.  We'll get a new stream when it really
+  // does finish, so emit TrackEnded then.  This is set before the new bin
+  // starts, so its stream can't get there first.
+  emit_track_ended_on_stream_start_ = true;
   gst_element_set_state(uridecodebin_, GST_STATE_PLAYING);
   MaybeLinkDecodeToAudio();
 
@@ -1114,11 +1421,6 @@ void GstEnginePipeline::TransitionToNext() {
   next_beginning_offset_nanosec_ = 0;
   next_end_offset_nanosec_ = 0;
 
-  // This function gets called when the source has been drained, even if the
-  // song hasn't finished playing yet.  We'll get a new stream when it really
-  // does finish, so emit TrackEnded then.
-  emit_track_ended_on_stream_start_ = true;
-
   // This has to happen *after* the gst_element_set_state on the new bin to
   // fix an occasional race condition deadlock.
   sElementDeleter->DeleteElementLater(old_decode_bin);
@@ -1126,33 +1428,424 @@ void GstEnginePipeline::TransitionToNext() {
   ignore_tags_ = false;
 }
 
-qint64 GstEnginePipeline::position() const {
-  if (pipeline_is_initialised_)
-    gst_element_query_position(pipeline_, GST_FORMAT_TIME,
-                               &last_known_position_ns_);
+GstElement* GstEnginePipeline::CreateTailBin() {
+  // The tail bin does to the old track what the audiobin does before the
+  // mixer, apart from buffering:
+  //   queue ! audioconvert ! ( rgvolume ! rglimiter ! audioconvert2 )
+  //         ! audioresample ! fader
+  GstElement* bin = gst_bin_new("tailbin");
+
+  GstElement* queue = engine_->CreateElement("queue", bin);
+  GstElement* convert = engine_->CreateElement("audioconvert", bin);
+  GstElement* resample = engine_->CreateElement("audioresample", bin);
+  GstElement* fader = engine_->CreateElement("volume", bin);
+  if (!queue || !convert || !resample || !fader) {
+    qLog(Error) << "Failed to create tail elements";
+    gst_object_unref(bin);
+    return nullptr;
+  }
+
+  gst_element_link(queue, convert);
+  GstElement* last = convert;
+
+  if (rg_enabled_) {
+    GstElement* rgvolume = engine_->CreateElement("rgvolume", bin);
+    GstElement* rglimiter = engine_->CreateElement("rglimiter", bin);
+    GstElement* convert2 = engine_->CreateElement("audioconvert", bin);
+    if (!rgvolume || !rglimiter || !convert2) {
+      qLog(Error) << "Failed to create tail rg elements";
+      gst_object_unref(bin);
+      return nullptr;
+    }
+
+    g_object_set(G_OBJECT(rgvolume), "album-mode", rg_mode_, nullptr);
+    g_object_set(G_OBJECT(rgvolume), "pre-amp", double(rg_preamp_), nullptr);
+    g_object_set(G_OBJECT(rglimiter), "enabled", int(rg_compression_),
+                 nullptr);
+
+    gst_element_link_many(convert, rgvolume, rglimiter, convert2, nullptr);
+    last = convert2;
+  }
+
+  gst_element_link_many(last, resample, fader, nullptr);
+
+  GstPad* pad = gst_element_get_static_pad(queue, "sink");
+  gst_element_add_pad(bin, gst_ghost_pad_new("sink", pad));
+  gst_object_unref(pad);
+
+  pad = gst_element_get_static_pad(fader, "src");
+  gst_element_add_pad(bin, gst_ghost_pad_new("src", pad));
+  gst_object_unref(pad);
+
+  tail_fader_.reset(new GstFader(fader));
+  return bin;
+}
+
+bool GstEnginePipeline::CrossfadeTo(const MediaPlaybackRequest& req,
+                                    qint64 end_nanosec,
+                                    qint64 duration_nanosec) {
+  if (crossfade_pending_ || !pipeline_is_connected_ || !uridecodebin_) {
+    return false;
+  }
+
+  // Only one track is faded out at a time.
+  RemoveTail();
+
+  GstPad* audiopad = gst_element_get_static_pad(audiobin_, "sink");
+  GstPad* pad = gst_pad_get_peer(audiopad);
+  gst_object_unref(audiopad);
+  if (!pad) return false;
+
+  GstElement* new_bin = CreateDecodeBinFromUrl(req.url_);
+  if (!new_bin) {
+    gst_object_unref(pad);
+    return false;
+  }
+  SetReplayGainTags(new_bin, req);
+
+  tail_bin_ = CreateTailBin();
+  if (!tail_bin_) {
+    gst_object_unref(new_bin);
+    gst_object_unref(pad);
+    return false;
+  }
+
+  // The tail bin is outside the audiobin, so it gets a pad of its own on the
+  // audiobin's edge.
+  tail_mixer_pad_ = gst_element_get_request_pad(mixer_, "sink_%u");
+  tail_audiobin_pad_ = gst_ghost_pad_new("tail", tail_mixer_pad_);
+  gst_pad_set_active(tail_audiobin_pad_, TRUE);
+  gst_element_add_pad(audiobin_, tail_audiobin_pad_);
+
+  gst_bin_add(GST_BIN(pipeline_), tail_bin_);
+  GstPad* tail_src = gst_element_get_static_pad(tail_bin_, "src");
+  gst_pad_link(tail_src, tail_audiobin_pad_);
+  gst_object_unref(tail_src);
+  gst_element_sync_state_with_parent(tail_bin_);
+
+  connect(tail_fader_.get(), SIGNAL(Finished()), SLOT(RemoveTail()),
+          Qt::QueuedConnection);
+  tail_fader_->Start(duration_nanosec, QTimeLine::Backward);
+
+  crossfade_pending_ = true;
+  crossfade_decodebin_ = new_bin;
+  crossfade_req_ = req;
+  crossfade_end_nanosec_ = end_nanosec;
+  crossfade_duration_nanosec_ = duration_nanosec;
+
+  // Move the old track over to the tail as soon as it's between two buffers.
+  // Its pad keeps the offset it was given, so the mixer still lines it up with
+  // the audio that's already in the audiobin's queues.
+  tail_pad_ = pad;
+  tail_linked_ = 0;
+  tail_probe_id_ = gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_IDLE,
+                                     TailLinkProbe, this, nullptr);
+
+  return true;
+}
+
+GstPadProbeReturn GstEnginePipeline::TailLinkProbe(GstPad* pad,
+                                                   GstPadProbeInfo*,
+                                                   gpointer self) {
+  GstEnginePipeline* instance = reinterpret_cast<GstEnginePipeline*>(self);
+
+  GstPad* peer = gst_pad_get_peer(pad);
+  if (peer) {
+    gst_pad_unlink(pad, peer);
+    gst_object_unref(peer);
+  }
+
+  GstPad* sinkpad = gst_element_get_static_pad(instance->tail_bin_, "sink");
+  if (gst_pad_link(pad, sinkpad) != GST_PAD_LINK_OK) {
+    qLog(Error) << "Failed to link the old track to the tail bin.";
+  }
+  gst_object_unref(sinkpad);
+
+  instance->tail_linked_ = 1;
+  QMetaObject::invokeMethod(instance, "CrossfadeLinked", Qt::QueuedConnection);
+
+  return GST_PAD_PROBE_REMOVE;
+}
+
+void GstEnginePipeline::CrossfadeLinked() {
+  crossfade_pending_ = false;
+
+  // ReplaceDecodeBin would take the old decodebin out of the pipeline, but it
+  // stays there until the tail is removed.
+  tail_decodebin_ = uridecodebin_;
+  uridecodebin_ = nullptr;
+
+  ignore_tags_ = true;
+
+  ReplaceDecodeBin(crossfade_decodebin_);
+  crossfade_decodebin_ = nullptr;
+  gst_element_sync_state_with_parent(uridecodebin_);
+  MaybeLinkDecodeToAudio();
+
+  current_ = crossfade_req_;
+  end_offset_nanosec_ = crossfade_end_nanosec_;
+  next_ = MediaPlaybackRequest();
+  next_beginning_offset_nanosec_ = 0;
+  next_end_offset_nanosec_ = 0;
+  emit_track_ended_on_stream_start_ = false;
+  emit_track_ended_on_time_discontinuity_ = false;
+
+  // The new track starts after whatever is left of the old one in the
+  // audiobin's queues, so that's when it starts fading in.
+  fader_->Start(crossfade_duration_nanosec_, QTimeLine::Forward,
+                QTimeLine::LinearCurve, true, true);
+
+  ignore_tags_ = false;
+}
+
+namespace {
 
-  return last_known_position_ns_;
+GstPadProbeReturn DropProbe(GstPad*, GstPadProbeInfo*, gpointer) {
+  return GST_PAD_PROBE_DROP;
 }
 
-qint64 GstEnginePipeline::length() const {
-  gint64 value = 0;
-  gst_element_query_duration(pipeline_, GST_FORMAT_TIME, &value);
+GstPadProbeReturn BlockProbe(GstPad*, GstPadProbeInfo*, gpointer) {
+  return GST_PAD_PROBE_OK;
+}
+
+}  // namespace
 
-  return value;
+void GstEnginePipeline::RemoveTail() {
+  if (!tail_linked_.load() || crossfade_pending_) return;
+
+  // Stop the tail's streaming threads before anything is unlinked, so they
+  // don't post errors about it.  Anything the tail's queue pushes from now on
+  // is dropped, and releasing the mixer's pad wakes it up if it's waiting for
+  // the mixer.
+  GstPad* tail_src = gst_element_get_static_pad(tail_bin_, "src");
+  gst_pad_add_probe(tail_src, GST_PAD_PROBE_TYPE_DATA_DOWNSTREAM, DropProbe,
+                    nullptr, nullptr);
+  gst_object_unref(tail_src);
+
+  gst_element_release_request_pad(mixer_, tail_mixer_pad_);
+  gst_object_unref(tail_mixer_pad_);
+  tail_mixer_pad_ = nullptr;
+
+  gst_element_set_state(tail_bin_, GST_STATE_NULL);
+  gst_element_set_state(tail_decodebin_, GST_STATE_NULL);
+
+  // The fader's probe might still have been running until the streaming
+  // threads stopped.
+  tail_fader_.reset();
+
+  gst_element_remove_pad(audiobin_, tail_audiobin_pad_);
+  tail_audiobin_pad_ = nullptr;
+
+  GstElement* tail_decodebin = tail_decodebin_;
+  GstElement* tail_bin = tail_bin_;
+  tail_decodebin_ = nullptr;
+  tail_bin_ = nullptr;
+  gst_bin_remove(GST_BIN(pipeline_), tail_decodebin);
+  gst_bin_remove(GST_BIN(pipeline_), tail_bin);
+
+  gst_object_unref(tail_pad_);
+  tail_pad_ = nullptr;
+  tail_linked_ = 0;
 }
 
-GstState GstEnginePipeline::state() const {
-  GstState s, sp;
-  if (gst_element_get_state(pipeline_, &s, &sp, kGstStateTimeoutNanosecs) ==
-      GST_STATE_CHANGE_FAILURE)
-    return GST_STATE_NULL;
+bool GstEnginePipeline::SwitchTo(const MediaPlaybackRequest& req,
+                                 qint64 end_nanosec) {
+  const GstState current_state = state();
+  if (crossfade_pending_ || !uridecodebin_ ||
+      (current_state != GST_STATE_PAUSED &&
+       current_state != GST_STATE_PLAYING)) {
+    return false;
+  }
+
+  // The CD device is only taken out of the URL by InitFromReq.
+  if (req.url_.scheme() == "cdda") return false;
+
+  // Use the track's decodebin if it's already been prerolled.
+  PrerolledTrack prerolled;
+  bool is_prerolled = TakePrerolled(req.url_, &prerolled);
+  if (is_prerolled && prerolled.failed) {
+    StopPrerolling(prerolled);
+    is_prerolled = false;
+  }
 
-  return s;
+  GstElement* new_bin =
+      is_prerolled ? prerolled.bin : CreateDecodeBinFromUrl(req.url_);
+  if (!new_bin) return false;
+  SetReplayGainTags(new_bin, req);
+
+  // There's no point fading out the track before either.
+  RemoveTail();
+
+  // Don't let the old track's streaming threads move on to the next track or
+  // stop the pipeline while it's being taken out.
+  next_ = MediaPlaybackRequest();
+  end_offset_nanosec_ = 0;
+
+  // Throw away what's left of the old track before the mixer.  This also wakes
+  // the old decodebin's streaming threads if they're waiting for room in the
+  // queue, so it can be stopped.  The mixer doesn't pass the flush on, so the
+  // sink carries on without prerolling again.
+  GstPad* audiopad = gst_element_get_static_pad(audiobin_, "sink");
+  gst_pad_send_event(audiopad, gst_event_new_flush_start());
+
+  gst_element_set_state(uridecodebin_, GST_STATE_NULL);
+  GstPad* peer = gst_pad_get_peer(audiopad);
+  if (peer) {
+    gst_pad_unlink(peer, audiopad);
+    gst_object_unref(peer);
+  }
+
+  gst_pad_send_event(audiopad, gst_event_new_flush_stop(FALSE));
+  gst_object_unref(audiopad);
+
+  // The new track follows on from what the mixer has already sent to the
+  // sink, rather than from the audio that was thrown away.
+  gst_segment_init(&last_decodebin_segment_, GST_FORMAT_TIME);
+  last_decodebin_segment_.position = mixer_running_time_.load();
+
+  ReplaceDecodeBin(new_bin);
+
+  current_ = req;
+  end_offset_nanosec_ = end_nanosec;
+  next_beginning_offset_nanosec_ = 0;
+  next_end_offset_nanosec_ = 0;
+  emit_track_ended_on_stream_start_ = false;
+  emit_track_ended_on_time_discontinuity_ = false;
+  pending_seek_nanosec_ = -1;
+  position_nanosec_ = 0;
+  duration_nanosec_ = 0;
+
+  // Whatever the old track was faded to, the new one starts at full volume.
+  fader_->Start(0, QTimeLine::Forward, QTimeLine::LinearCurve, false, true);
+
+  if (is_prerolled) {
+    // Its audio is waiting at the end of its bin.
+    GstPad* pad = gst_element_get_static_pad(uridecodebin_, "src");
+    LinkDecodedPad(uridecodebin_, pad);
+    gst_object_unref(pad);
+
+    gst_pad_remove_probe(prerolled.queue_src, prerolled.block_probe_id);
+    gst_object_unref(prerolled.queue_src);
+  } else {
+    gst_element_sync_state_with_parent(uridecodebin_);
+    MaybeLinkDecodeToAudio();
+  }
+
+  return true;
+}
+
+void GstEnginePipeline::Preroll(const QList<MediaPlaybackRequest>& reqs) {
+  QList<QUrl> urls;
+  for (const MediaPlaybackRequest& req : reqs) urls << req.url_;
+
+  // Keep the ones we've already got.
+  QList<PrerolledTrack> unwanted;
+  QList<QUrl> prerolled_urls;
+  {
+    QMutexLocker l(&prerolled_mutex_);
+    for (int i = prerolled_.count() - 1; i >= 0; --i) {
+      if (prerolled_[i].failed || !urls.contains(prerolled_[i].url)) {
+        unwanted << prerolled_.takeAt(i);
+      } else {
+        prerolled_urls << prerolled_[i].url;
+      }
+    }
+  }
+
+  // The bins' threads might be waiting for the mutex, so they're only stopped
+  // once it's been released.
+  for (const PrerolledTrack& track : unwanted) StopPrerolling(track);
+
+  for (const MediaPlaybackRequest& req : reqs) {
+    if (prerolled_urls.contains(req.url_)) continue;
+    StartPrerolling(req);
+    prerolled_urls << req.url_;
+  }
+}
+
+bool GstEnginePipeline::is_prerolled(const QUrl& url) const {
+  QMutexLocker l(&prerolled_mutex_);
+  for (const PrerolledTrack& track : prerolled_) {
+    if (track.url == url && !track.failed) return true;
+  }
+  return false;
+}
+
+void GstEnginePipeline::StartPrerolling(const MediaPlaybackRequest& req) {
+  GstElement* bin = gst_bin_new(nullptr);
+  GstElement* decodebin = engine_->CreateElement("uridecodebin", bin);
+  GstElement* convert = engine_->CreateElement("audioconvert", bin);
+  GstElement* queue = engine_->CreateElement("queue", bin);
+  if (!decodebin || !convert || !queue) {
+    qLog(Error) << "Failed to create preroll elements";
+    gst_object_unref(bin);
+    return;
+  }
+
+  QByteArray uri = GstUriFromUrl(req.url_);
+  g_object_set(G_OBJECT(decodebin), "uri", uri.constData(), nullptr);
+  CHECKED_GCONNECT(G_OBJECT(decodebin), "drained", &SourceDrainedCallback,
+                   this);
+  CHECKED_GCONNECT(G_OBJECT(decodebin), "pad-added", &PrerolledPadCallback,
+                   convert);
+  g_object_set_data(G_OBJECT(bin), kDecodeBinKey, decodebin);
+  SetReplayGainTags(bin, req);
+
+  gst_element_link(convert, queue);
+
+  PrerolledTrack track;
+  track.url = req.url_;
+  track.bin = bin;
+  track.queue_src = gst_element_get_static_pad(queue, "src");
+  track.block_probe_id =
+      gst_pad_add_probe(track.queue_src, GST_PAD_PROBE_TYPE_BLOCK_DOWNSTREAM,
+                        BlockProbe, nullptr, nullptr);
+  track.failed = false;
+  gst_element_add_pad(bin, gst_ghost_pad_new("src", track.queue_src));
+
+  // It has to be in the list before it posts any messages.
+  {
+    QMutexLocker l(&prerolled_mutex_);
+    prerolled_ << track;
+  }
+
+  gst_bin_add(GST_BIN(pipeline_), bin);
+  gst_element_sync_state_with_parent(bin);
+}
+
+void GstEnginePipeline::StopPrerolling(const PrerolledTrack& track) {
+  // Stopping it also wakes up the queue's thread if it's blocked.
+  gst_element_set_state(track.bin, GST_STATE_NULL);
+  gst_bin_remove(GST_BIN(pipeline_), track.bin);
+  gst_object_unref(track.queue_src);
+}
+
+bool GstEnginePipeline::TakePrerolled(const QUrl& url, PrerolledTrack* track) {
+  QMutexLocker l(&prerolled_mutex_);
+  for (int i = 0; i < prerolled_.count(); ++i) {
+    if (prerolled_[i].url == url) {
+      *track = prerolled_.takeAt(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+void GstEnginePipeline::PrerolledPadCallback(GstElement*, GstPad* pad,
+                                             gpointer convert) {
+  GstPad* sinkpad = gst_element_get_static_pad(
+      reinterpret_cast<GstElement*>(convert), "sink");
+  if (GST_PAD_IS_LINKED(sinkpad) ||
+      gst_pad_link(pad, sinkpad) != GST_PAD_LINK_OK) {
+    qLog(Warning) << "Couldn't link a prerolled decoder pad"
+                  << GST_PAD_NAME(pad);
+  }
+  gst_object_unref(sinkpad);
 }
 
 QFuture<GstStateChangeReturn> GstEnginePipeline::SetState(GstState state) {
-  return ConcurrentRun::Run<GstStateChangeReturn, GstElement*, GstState>(
-      &set_state_threadpool_, &gst_element_set_state, pipeline_, state);
+  return set_state_queue_.Run<GstStateChangeReturn, GstElement*, GstState>(
+      &gst_element_set_state, pipeline_, state);
 }
 
 bool GstEnginePipeline::Seek(qint64 nanosec) {
@@ -1161,13 +1854,17 @@ bool GstEnginePipeline::Seek(qint64 nanosec) {
     return true;
   }
 
-  if (!pipeline_is_connected_ || !pipeline_is_initialised_) {
+  if (!pipeline_is_connected_ || !pipeline_is_initialised_ ||
+      crossfade_pending_) {
     pending_seek_nanosec_ = nanosec;
     return true;
   }
 
+  // There's no point seeking in the track we're fading out.
+  RemoveTail();
+
   pending_seek_nanosec_ = -1;
-  last_known_position_ns_ = nanosec;
+  position_nanosec_ = nanosec;
   return gst_element_seek_simple(pipeline_, GST_FORMAT_TIME,
                                  GST_SEEK_FLAG_FLUSH, nanosec);
 }
@@ -1226,13 +1923,8 @@ void GstEnginePipeline::SetVolume(int percent) {
   UpdateVolume();
 }
 
-void GstEnginePipeline::SetVolumeModifier(qreal mod) {
-  volume_modifier_ = mod;
-  UpdateVolume();
-}
-
 void GstEnginePipeline::UpdateVolume() {
-  float vol = double(volume_percent_) * 0.01 * volume_modifier_;
+  float vol = double(volume_percent_) * 0.01;
   g_object_set(G_OBJECT(volume_), "volume", vol, nullptr);
 }
 
@@ -1248,63 +1940,9 @@ void GstEnginePipeline::StartFader(qint64 duration_nanosec,
                                    QTimeLine::Direction direction,
                                    QTimeLine::CurveShape shape,
                                    bool use_fudge_timer) {
-  const int duration_msec = duration_nanosec / kNsecPerMsec;
-
-  // If there's already another fader running then start from the same time
-  // that one was already at.
-  int start_time = direction == QTimeLine::Forward ? 0 : duration_msec;
-  if (fader_ && fader_->state() == QTimeLine::Running) {
-    if (duration_msec == fader_->duration()) {
-      start_time = fader_->currentTime();
-    } else {
-      // Calculate the position in the new fader with the same value from
-      // the old fader, so no volume jumps appear
-      qreal time = qreal(duration_msec) *
-                   (qreal(fader_->currentTime()) / qreal(fader_->duration()));
-      start_time = qRound(time);
-    }
-  }
-
-  fader_.reset(new QTimeLine(duration_msec, this));
-  connect(fader_.get(), SIGNAL(valueChanged(qreal)),
-          SLOT(SetVolumeModifier(qreal)));
-  connect(fader_.get(), SIGNAL(finished()), SLOT(FaderTimelineFinished()));
-  fader_->setDirection(direction);
-  fader_->setCurveShape(shape);
-  fader_->setCurrentTime(start_time);
-  fader_->resume();
-
-  fader_fudge_timer_.stop();
-  use_fudge_timer_ = use_fudge_timer;
-
-  SetVolumeModifier(fader_->currentValue());
-}
-
-void GstEnginePipeline::FaderTimelineFinished() {
-  fader_.reset();
-
-  // Wait a little while longer before emitting the finished signal (and
-  // probably destroying the pipeline) to account for delays in the audio
-  // server/driver.
-  if (use_fudge_timer_) {
-    fader_fudge_timer_.start(kFaderFudgeMsec, this);
-  } else {
-    // Even here we cannot emit the signal directly, as it result in a
-    // stutter when resuming playback. So use a quest small time, so you
-    // won't notice the difference when resuming playback
-    // (You get here when the pause fading is active)
-    fader_fudge_timer_.start(250, this);
-  }
-}
-
-void GstEnginePipeline::timerEvent(QTimerEvent* e) {
-  if (e->timerId() == fader_fudge_timer_.timerId()) {
-    fader_fudge_timer_.stop();
-    emit FaderFinished();
-    return;
+  if (fader_) {
+    fader_->Start(duration_nanosec, direction, shape, use_fudge_timer);
   }
-
-  QObject::timerEvent(e);
 }
 
 void GstEnginePipeline::AddBufferConsumer(BufferConsumer* consumer) {
@@ -18,15 +18,16 @@
 #ifndef GSTENGINEPIPELINE_H
 #define GSTENGINEPIPELINE_H
 
-#include <QBasicTimer>
+#include <QAtomicInt>
 #include <QFuture>
 #include <QMutex>
-#include <QThreadPool>
 #include <QTimeLine>
 #include <QUrl>
 #include <memory>
 
+#include "core/workscheduler.h"
 #include "engine_fwd.h"
+#include "gstfader.h"
 #include "gstpipelinebase.h"
 #include "playbackrequest.h"
 
@@ -69,6 +70,8 @@ class GstEnginePipeline : public GstPipelineBase {
   void SetEqualizerParams(int preamp, const QList<int>& band_gains);
   void SetVolume(int percent);
   void SetStereoBalance(float value);
+  // Fades the volume in or out.  FaderFinished is emitted once the whole fade
+  // has been played.
   void StartFader(qint64 duration_nanosec,
                   QTimeLine::Direction direction = QTimeLine::Forward,
                   QTimeLine::CurveShape shape = QTimeLine::LinearCurve,
@@ -80,18 +83,42 @@ class GstEnginePipeline : public GstPipelineBase {
                   qint64 end_nanosec);
   bool has_next_valid_url() const { return next_.url_.isValid(); }
 
+  // Crossfades to another track without leaving this pipeline, so the output
+  // device stays open.  The rest of the current track is moved to its own
+  // branch, which fades out and is mixed with the new track until it's
+  // removed.  Returns false if the pipeline isn't in a state to do that, and a
+  // new pipeline should be used instead.
+  bool CrossfadeTo(const MediaPlaybackRequest& req, qint64 end_nanosec,
+                   qint64 duration_nanosec);
+
+  // Switches straight to another track without leaving this pipeline.  The
+  // audio of the old track that hasn't been played yet is thrown away, and the
+  // new track carries on from where the output has got to.  Returns false if
+  // the pipeline isn't in a state to do that, and a new pipeline should be
+  // used instead.
+  bool SwitchTo(const MediaPlaybackRequest& req, qint64 end_nanosec);
+
+  // Starts decoding these tracks in the background, so SwitchTo can start
+  // them straight away.  Only their decodebins are made, and they're held
+  // before the audiobin until they're switched to, so no more of the output
+  // is opened.  Tracks that were being prerolled and aren't in the list are
+  // dropped.
+  void Preroll(const QList<MediaPlaybackRequest>& reqs);
+  bool is_prerolled(const QUrl& url) const;
+
   // Get information about the music playback
   QUrl url() const { return current_.url_; }
   bool is_valid() const { return valid_; }
+  // The position, length and state are kept up to date by the streaming
+  // threads and bus messages, so these never wait for the pipeline.
   // Please note that this method (unlike GstEngine's.position()) is
   // multiple-section media unaware.
-  qint64 position() const;
+  qint64 position() const { return position_nanosec_.load(); }
   // Please note that this method (unlike GstEngine's.length()) is
   // multiple-section media unaware.
-  qint64 length() const;
-  // Returns this pipeline's state. May return GST_STATE_NULL if the state check
-  // timed out. The timeout value is a reasonable default.
-  GstState state() const;
+  qint64 length() const { return duration_nanosec_.load(); }
+  // Returns the state the pipeline was in after its last state change.
+  GstState state() const { return GstState(state_.load()); }
   qint64 segment_start() const { return segment_start_; }
 
   // Don't allow the user to change the playback state (playing/paused) while
@@ -102,9 +129,6 @@ class GstEnginePipeline : public GstPipelineBase {
 
   QString source_device() const { return source_device_; }
 
- public slots:
-  void SetVolumeModifier(qreal mod);
-
  signals:
   void EndOfStreamReached(int pipeline_id, bool has_next_track);
   void MetadataFound(int pipeline_id, const Engine::SimpleMetaBundle& bundle);
@@ -118,23 +142,28 @@ class GstEnginePipeline : public GstPipelineBase {
   void BufferingProgress(int percent);
   void BufferingFinished();
 
- protected:
-  void timerEvent(QTimerEvent*);
-
  private:
   // Static callbacks.  The GstEnginePipeline instance is passed in the last
   // argument.
   static GstBusSyncReply BusCallbackSync(GstBus*, GstMessage*, gpointer);
   static gboolean BusCallback(GstBus*, GstMessage*, gpointer);
   static void NewPadCallback(GstElement*, GstPad*, gpointer);
+  static void PrerolledPadCallback(GstElement*, GstPad*, gpointer);
   static GstPadProbeReturn HandoffCallback(GstPad*, GstPadProbeInfo*, gpointer);
   static GstPadProbeReturn EventHandoffCallback(GstPad*, GstPadProbeInfo*,
                                                 gpointer);
   static GstPadProbeReturn DecodebinProbe(GstPad*, GstPadProbeInfo*, gpointer);
+  static GstPadProbeReturn ReplayGainProbe(GstPad*, GstPadProbeInfo*,
+                                           gpointer);
   static void SourceDrainedCallback(GstURIDecodeBin*, gpointer);
   static void SourceSetupCallback(GstURIDecodeBin*, GParamSpec* pspec,
                                   gpointer);
   static void TaskEnterCallback(GstTask*, GThread*, gpointer);
+  static GstPadProbeReturn PositionProbe(GstPad*, GstPadProbeInfo*, gpointer);
+  static GstPadProbeReturn StreamStartProbe(GstPad*, GstPadProbeInfo*,
+                                            gpointer);
+  static GstPadProbeReturn MixerProbe(GstPad*, GstPadProbeInfo*, gpointer);
+  static GstPadProbeReturn TailLinkProbe(GstPad*, GstPadProbeInfo*, gpointer);
 
   static QByteArray GstUriFromUrl(const QUrl& url);
 
@@ -146,10 +175,25 @@ class GstEnginePipeline : public GstPipelineBase {
   void StreamStatusMessageReceived(GstMessage*);
 
   QString ParseTag(GstTagList* list, const char* tag) const;
+  bool IsFromTail(GstMessage* msg) const;
+  // Errors from a prerolled track are only reported if it's played, when it
+  // goes wrong again.
+  bool IsFromPrerolled(GstMessage* msg);
 
   bool InitAudioBin();
   GstElement* CreateDecodeBinFromString(const char* pipeline);
   GstElement* CreateDecodeBinFromUrl(const QUrl& url);
+  // Remembers the loudness the library measured for this request's file, so
+  // it can be used if the file doesn't have ReplayGain tags.
+  static void SetReplayGainTags(GstElement* bin,
+                                const MediaPlaybackRequest& req);
+  GstElement* CreateTailBin();
+  // Links a decodebin's pad to the audiobin, so its track carries on from the
+  // last one.
+  void LinkDecodedPad(GstElement* bin, GstPad* pad);
+  // Returns the uridecodebin in bin, which is either one or a prerolled
+  // track's bin.
+  static GstElement* FindDecodeBin(GstElement* bin);
 
   void UpdateVolume();
   void UpdateEqualizer();
@@ -160,6 +204,21 @@ class GstEnginePipeline : public GstPipelineBase {
 
   void TransitionToNext();
 
+  // A track that's being decoded before it's played:
+  //   uridecodebin ! audioconvert ! queue
+  // The queue's src pad is blocked until the bin is linked to the audiobin.
+  struct PrerolledTrack {
+    QUrl url;
+    GstElement* bin;
+    GstPad* queue_src;
+    gulong block_probe_id;
+    bool failed;
+  };
+
+  void StartPrerolling(const MediaPlaybackRequest& req);
+  void StopPrerolling(const PrerolledTrack& track);
+  bool TakePrerolled(const QUrl& url, PrerolledTrack* track);
+
   // If the decodebin is special (ie. not really a uridecodebin) then it'll have
   // a src pad immediately and we can link it after everything's created.
   void MaybeLinkDecodeToAudio();
@@ -168,11 +227,11 @@ class GstEnginePipeline : public GstPipelineBase {
   static QString GetAudioFormat(GstCaps* caps);
 
  private slots:
-  void FaderTimelineFinished();
+  void CrossfadeLinked();
+  void RemoveTail();
+  void UpdateDuration();
 
  private:
-  static const int kGstStateTimeoutNanosecs;
-  static const int kFaderFudgeMsec;
   static const int kEqBandCount;
   static const int kEqBandFrequencies[];
 
@@ -256,19 +315,17 @@ class GstEnginePipeline : public GstPipelineBase {
   bool pipeline_is_connected_;
   qint64 pending_seek_nanosec_;
 
-  // We can only use gst_element_query_position() when the pipeline is in
-  // PAUSED nor PLAYING state. Whenever we get a new position (e.g. after a
-  // correct call to gst_element_query_position() or after a seek), we store
-  // it here so that we can use it when using gst_element_query_position() is
-  // not possible.
-  mutable gint64 last_known_position_ns_;
+  // The position is the stream time of the buffer the analyzer's sink is
+  // about to play, which is synchronised to the clock like the audio sink.
+  // The duration is asked for whenever it might have changed, on the main
+  // thread.
+  QAtomicInt state_;
+  QAtomicInteger<qint64> position_nanosec_;
+  QAtomicInteger<qint64> duration_nanosec_;
+  // Only used by the analyzer's streaming thread.
+  GstSegment probe_segment_;
 
   int volume_percent_;
-  qreal volume_modifier_;
-
-  std::unique_ptr<QTimeLine> fader_;
-  QBasicTimer fader_fudge_timer_;
-  bool use_fudge_timer_;
 
   // Bins
   // uridecodebin ! audiobin
@@ -294,9 +351,45 @@ class GstEnginePipeline : public GstPipelineBase {
   GstPad* tee_probe_pad_;
   GstPad* tee_audio_pad_;
 
-  QThreadPool set_state_threadpool_;
+  // State changes can block for a while, but playback is waiting on them.
+  WorkQueue set_state_queue_;
 
   GstSegment last_decodebin_segment_;
+
+  // The decodebin's audio goes through the fader and into one of the mixer's
+  // pads.  While crossfading, the old track's decodebin is linked to the tail
+  // bin instead, which has a fader of its own and is mixed in through another
+  // pad.
+  std::unique_ptr<GstFader> fader_;
+  GstElement* mixer_;
+  GstPad* mixer_trunk_pad_;
+  // The running time the mixer has sent audio up to, which is where a track
+  // that's switched to starts.  The segment is only used by the mixer's
+  // streaming thread.
+  GstSegment mixer_segment_;
+  QAtomicInteger<qint64> mixer_running_time_;
+
+  GstElement* tail_decodebin_;
+  GstElement* tail_bin_;
+  GstPad* tail_pad_;
+  GstPad* tail_audiobin_pad_;
+  GstPad* tail_mixer_pad_;
+  gulong tail_probe_id_;
+  QAtomicInt tail_linked_;
+  std::unique_ptr<GstFader> tail_fader_;
+
+  // Set between CrossfadeTo and the tail being linked, which happens on the
+  // streaming thread.
+  bool crossfade_pending_;
+  GstElement* crossfade_decodebin_;
+  MediaPlaybackRequest crossfade_req_;
+  qint64 crossfade_end_nanosec_;
+  qint64 crossfade_duration_nanosec_;
+
+  // The bins are in the pipeline.  The list is also looked at by the bus's
+  // sync handler.
+  mutable QMutex prerolled_mutex_;
+  QList<PrerolledTrack> prerolled_;
 };
 
 #endif  // GSTENGINEPIPELINE_H
@@ -0,0 +1,327 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "gstfader.h"
+
+#include <gst/base/gstbasetransform.h>
+#include <gst/controller/gstdirectcontrolbinding.h>
+#include <gst/controller/gstinterpolationcontrolsource.h>
+
+#include <QTimerEvent>
+#include <limits>
+
+#include "core/timeconstants.h"
+
+const int GstFader::kFudgeMsec = 2000;
+const int GstFader::kStepMsec = 20;
+
+GstFader::GstFader(GstElement* volume, QObject* parent)
+    : QObject(parent),
+      volume_(volume),
+      control_(gst_interpolation_control_source_new()),
+      pad_(gst_element_get_static_pad(volume, "sink")),
+      probe_id_(0),
+      running_(false),
+      duration_msec_(0),
+      direction_(QTimeLine::Forward),
+      shape_(QTimeLine::LinearCurve),
+      start_time_(0),
+      use_fudge_timer_(true),
+      generation_(0),
+      wait_for_segment_(false),
+      anchor_(-1),
+      end_(-1),
+      active_(0),
+      stream_time_(-1) {
+  // The volume follows the control source from the buffers' stream time.
+  // Until a fade has been scheduled the control source has no values, and the
+  // volume stays where it is.
+  g_object_set(G_OBJECT(control_), "mode", GST_INTERPOLATION_MODE_LINEAR,
+               nullptr);
+  gst_object_add_control_binding(
+      GST_OBJECT(volume_), gst_direct_control_binding_new_absolute(
+                               GST_OBJECT(volume_), "volume", control_));
+
+  probe_id_ = gst_pad_add_probe(
+      pad_,
+      static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER |
+                                   GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+      Probe, this, nullptr);
+}
+
+GstFader::~GstFader() {
+  gst_pad_remove_probe(pad_, probe_id_);
+  gst_object_unref(pad_);
+  gst_object_unref(control_);
+}
+
+void GstFader::Start(qint64 duration_nanosec, QTimeLine::Direction direction,
+                     QTimeLine::CurveShape shape, bool use_fudge_timer,
+                     bool wait_for_segment) {
+  const int duration_msec = duration_nanosec / kNsecPerMsec;
+
+  // If there's already another fader running then start from the same time
+  // that one was already at.
+  int start_time = direction == QTimeLine::Forward ? 0 : duration_msec;
+  if (running_) {
+    const int current_time = CurrentTime();
+    if (duration_msec == duration_msec_) {
+      start_time = current_time;
+    } else {
+      // Calculate the position in the new fader with the same value from
+      // the old fader, so no volume jumps appear
+      qreal time =
+          qreal(duration_msec) * (qreal(current_time) / qreal(duration_msec_));
+      start_time = qRound(time);
+    }
+  }
+
+  duration_msec_ = duration_msec;
+  direction_ = direction;
+  shape_ = shape;
+
+  fudge_timer_.stop();
+  use_fudge_timer_ = use_fudge_timer;
+
+  Schedule(start_time, wait_for_segment);
+}
+
+int GstFader::CurrentTime() {
+  qint64 elapsed_nanosec = 0;
+  {
+    QMutexLocker l(&mutex_);
+    if (anchor_ != -1) {
+      elapsed_nanosec =
+          qMax(qint64(0), qint64(stream_time_.load()) - anchor_);
+    }
+  }
+
+  const int elapsed =
+      qMin(qint64(duration_msec_), elapsed_nanosec / kNsecPerMsec);
+  if (direction_ == QTimeLine::Forward) {
+    return qMin(duration_msec_, start_time_ + elapsed);
+  }
+  return qMax(0, start_time_ - elapsed);
+}
+
+void GstFader::Schedule(int start_time, bool wait_for_segment) {
+  // A QTimeLine that's never started is still the easiest way to get the
+  // values of its curves.
+  QTimeLine curve(qMax(1, duration_msec_));
+  curve.setCurveShape(shape_);
+
+  const int end_time = direction_ == QTimeLine::Forward ? duration_msec_ : 0;
+  const int length = qAbs(end_time - start_time);
+  // The control source interpolates linearly between the points, so a linear
+  // fade only needs its ends.
+  const int step = shape_ == QTimeLine::LinearCurve ? length : kStepMsec;
+
+  QList<QPair<qint64, double>> points;
+  for (int elapsed = 0;; elapsed = qMin(length, elapsed + step)) {
+    const int time = direction_ == QTimeLine::Forward ? start_time + elapsed
+                                                      : start_time - elapsed;
+    double value = curve.valueForTime(time);
+    if (duration_msec_ == 0) {
+      value = direction_ == QTimeLine::Forward ? 1.0 : 0.0;
+    }
+    points << qMakePair(qint64(elapsed) * kNsecPerMsec, value);
+    if (elapsed == length) break;
+  }
+
+  {
+    QMutexLocker l(&mutex_);
+    generation_++;
+    points_ = points;
+    wait_for_segment_ = wait_for_segment;
+    anchor_ = -1;
+    end_ = -1;
+    active_ = 1;
+  }
+
+  start_time_ = start_time;
+  running_ = true;
+
+  // The streaming thread tells us when the fade has been played, but if the
+  // pipeline stops getting data we still want to finish eventually.
+  timeout_timer_.start(length + kFudgeMsec, this);
+}
+
+GstPadProbeReturn GstFader::Probe(GstPad*, GstPadProbeInfo* info,
+                                  gpointer self) {
+  GstFader* instance = reinterpret_cast<GstFader*>(self);
+  const GstPadProbeType info_type = GST_PAD_PROBE_INFO_TYPE(info);
+
+  if (info_type & GST_PAD_PROBE_TYPE_BUFFER) {
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+
+    // This is the same time the volume element gives its control source.
+    const GstClockTime start = gst_segment_to_stream_time(
+        &GST_BASE_TRANSFORM(instance->volume_)->segment, GST_FORMAT_TIME,
+        GST_BUFFER_TIMESTAMP(buffer));
+    if (!GST_CLOCK_TIME_IS_VALID(start)) return GST_PAD_PROBE_OK;
+
+    GstClockTime end = start;
+    if (GST_BUFFER_DURATION_IS_VALID(buffer)) {
+      end += GST_BUFFER_DURATION(buffer);
+    }
+
+    instance->PositionReached(start, end);
+  } else if (info_type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+    GstEvent* event = GST_PAD_PROBE_INFO_EVENT(info);
+
+    if (GST_EVENT_TYPE(event) == GST_EVENT_EOS) {
+      // Nothing else is going to be played, so the fade is as finished as
+      // it's going to get.
+      instance->PositionReached(std::numeric_limits<qint64>::max(),
+                                std::numeric_limits<qint64>::max());
+    } else if (GST_EVENT_TYPE(event) == GST_EVENT_SEGMENT &&
+               instance->active_.load()) {
+      instance->SegmentReceived();
+    }
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+void GstFader::SegmentReceived() {
+  QMutexLocker l(&mutex_);
+
+  if (wait_for_segment_) {
+    // This is the track the fade was waiting for.
+    wait_for_segment_ = false;
+    return;
+  }
+
+  if (anchor_ == -1) return;
+
+  // After a seek or a gapless transition the stream time jumps, so the rest
+  // of the fade has to be moved to wherever the next buffer is.
+  const qint64 elapsed = stream_time_.load() - anchor_;
+
+  double current = 0.0;
+  gst_control_source_get_value(control_, stream_time_.load(), &current);
+
+  QList<QPair<qint64, double>> points;
+  points << qMakePair(qint64(0), current);
+  for (const auto& point : points_) {
+    if (point.first > elapsed) {
+      points << qMakePair(point.first - elapsed, point.second);
+    }
+  }
+
+  points_ = points;
+  anchor_ = -1;
+  end_ = -1;
+}
+
+void GstFader::PositionReached(qint64 start, qint64 end) {
+  // Called on the streaming thread for every buffer, so most of the time this
+  // shouldn't need the lock.
+  stream_time_ = end;
+  if (!active_.load()) return;
+
+  const bool eos = start == std::numeric_limits<qint64>::max();
+
+  QMutexLocker l(&mutex_);
+  if (!active_.load()) return;
+  if (anchor_ == -1 && !eos) {
+    if (wait_for_segment_) return;
+
+    GstTimedValueControlSource* source =
+        GST_TIMED_VALUE_CONTROL_SOURCE(control_);
+    gst_timed_value_control_source_unset_all(source);
+
+    // Anything before the fade (if we seek backwards) stays at its first
+    // value.
+    gst_timed_value_control_source_set(source, 0, points_.first().second);
+    for (const auto& point : points_) {
+      gst_timed_value_control_source_set(source, start + point.first,
+                                         point.second);
+    }
+
+    anchor_ = start;
+    end_ = start + points_.last().first;
+  }
+
+  if (eos || end >= end_) {
+    active_ = 0;
+    HoldFinalValue();
+    QMetaObject::invokeMethod(this, "CurveFinished", Qt::QueuedConnection,
+                              Q_ARG(int, generation_));
+  }
+}
+
+void GstFader::HoldFinalValue() {
+  // Once a fade has been played its points aren't moved on new segments any
+  // more, so they're replaced by the value it ended on.  Otherwise seeking
+  // back, or the stream time starting again from 0 on the next track, would
+  // play the curve again.
+  GstTimedValueControlSource* source = GST_TIMED_VALUE_CONTROL_SOURCE(control_);
+  gst_timed_value_control_source_unset_all(source);
+  gst_timed_value_control_source_set(source, 0, points_.last().second);
+}
+
+void GstFader::CurveFinished(int generation) {
+  {
+    // Ignore fades that were replaced by another one before they finished.
+    QMutexLocker l(&mutex_);
+    if (generation != generation_) return;
+    if (active_.load()) {
+      // The timeout went off before the streaming thread got to the end.
+      active_ = 0;
+      HoldFinalValue();
+    }
+  }
+
+  if (!running_) return;
+  running_ = false;
+  timeout_timer_.stop();
+
+  // Wait a little while longer before emitting the finished signal (and
+  // probably destroying the pipeline) to account for delays in the audio
+  // server/driver.
+  if (use_fudge_timer_) {
+    fudge_timer_.start(kFudgeMsec, this);
+  } else {
+    // Even here we cannot emit the signal directly, as it result in a
+    // stutter when resuming playback. So use a quest small time, so you
+    // won't notice the difference when resuming playback
+    // (You get here when the pause fading is active)
+    fudge_timer_.start(250, this);
+  }
+}
+
+void GstFader::timerEvent(QTimerEvent* e) {
+  if (e->timerId() == fudge_timer_.timerId()) {
+    fudge_timer_.stop();
+    emit Finished();
+    return;
+  }
+
+  if (e->timerId() == timeout_timer_.timerId()) {
+    timeout_timer_.stop();
+    int generation = 0;
+    {
+      QMutexLocker l(&mutex_);
+      generation = generation_;
+    }
+    CurveFinished(generation);
+    return;
+  }
+
+  QObject::timerEvent(e);
+}
@@ -0,0 +1,108 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GSTFADER_H
+#define GSTFADER_H
+
+#include <gst/gst.h>
+
+#include <QAtomicInt>
+#include <QBasicTimer>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QPair>
+#include <QTimeLine>
+
+// Fades the audio going through a volume element in or out.  The fade is
+// scheduled on the element's controller, starting from the next buffer that
+// reaches it, so it's applied by the streaming thread and doesn't depend on
+// the main thread being idle.
+class GstFader : public QObject {
+  Q_OBJECT
+
+ public:
+  // The volume element must already be in a bin.  Until a fade is started it
+  // leaves the volume at 1.0.
+  explicit GstFader(GstElement* volume, QObject* parent = nullptr);
+  ~GstFader();
+
+  static const int kFudgeMsec;
+  static const int kStepMsec;
+
+  GstElement* element() const { return volume_; }
+  bool is_running() const { return running_; }
+
+  // Starts a fade.  If another fade is already running the new one starts from
+  // the same volume.  If wait_for_segment is true the fade starts with the
+  // first buffer of the next segment instead, for a track that's about to
+  // start playing.
+  void Start(qint64 duration_nanosec,
+             QTimeLine::Direction direction = QTimeLine::Forward,
+             QTimeLine::CurveShape shape = QTimeLine::LinearCurve,
+             bool use_fudge_timer = true, bool wait_for_segment = false);
+
+ signals:
+  // Emitted a little while after the whole fade has been played.
+  void Finished();
+
+ protected:
+  void timerEvent(QTimerEvent*);
+
+ private slots:
+  void CurveFinished(int generation);
+
+ private:
+  static GstPadProbeReturn Probe(GstPad*, GstPadProbeInfo*, gpointer);
+
+  int CurrentTime();
+  void Schedule(int start_time, bool wait_for_segment);
+  void PositionReached(qint64 start, qint64 end);
+  void SegmentReceived();
+  // Must be called with mutex_ held.
+  void HoldFinalValue();
+
+  GstElement* volume_;
+  GstControlSource* control_;
+  GstPad* pad_;
+  gulong probe_id_;
+
+  // The fade that's in progress, as the QTimeLine that used to run it would
+  // have described it.  Only used on the main thread.
+  bool running_;
+  int duration_msec_;
+  QTimeLine::Direction direction_;
+  QTimeLine::CurveShape shape_;
+  int start_time_;
+  QBasicTimer fudge_timer_;
+  QBasicTimer timeout_timer_;
+  bool use_fudge_timer_;
+
+  // Shared with the streaming thread.  The points of a fade are relative to
+  // the first buffer that reaches the element after it was scheduled, which
+  // sets anchor_ and end_ (in stream time).
+  QMutex mutex_;
+  int generation_;
+  QList<QPair<qint64, double>> points_;
+  bool wait_for_segment_;
+  qint64 anchor_;
+  qint64 end_;
+  QAtomicInt active_;
+  QAtomicInteger<qint64> stream_time_;
+};
+
+#endif  // GSTFADER_H
@@ -24,10 +24,25 @@
 class MediaPlaybackRequest {
  public:
   // For local songs and raw streams, the request and media URLs are the same.
-  MediaPlaybackRequest(const QUrl& url) : request_url_(url), url_(url) {}
+  MediaPlaybackRequest(const QUrl& url)
+      : request_url_(url),
+        url_(url),
+        rg_track_gain_(0),
+        rg_track_peak_(-1),
+        rg_album_gain_(0),
+        rg_album_peak_(-1) {}
   MediaPlaybackRequest(const QUrl& request_url, const QUrl& media_url)
-      : request_url_(request_url), url_(media_url) {}
-  MediaPlaybackRequest() {}
+      : request_url_(request_url),
+        url_(media_url),
+        rg_track_gain_(0),
+        rg_track_peak_(-1),
+        rg_album_gain_(0),
+        rg_album_peak_(-1) {}
+  MediaPlaybackRequest()
+      : rg_track_gain_(0),
+        rg_track_peak_(-1),
+        rg_album_gain_(0),
+        rg_album_peak_(-1) {}
 
   const QUrl& RequestUrl() const { return request_url_; }
   const QUrl& MediaUrl() const { return url_; }
@@ -38,6 +53,13 @@ class MediaPlaybackRequest {
 
   typedef QMap<QByteArray, QByteArray> HeaderList;
   HeaderList headers_;
+
+  // Loudness measured by the library, used if the file doesn't have ReplayGain
+  // tags of its own.  A peak is -1 if there's no gain to go with it.
+  float rg_track_gain_;
+  float rg_track_peak_;
+  float rg_album_gain_;
+  float rg_album_peak_;
 };
 
 #endif  // ENGINES_PLAYBACKREQUEST_H_
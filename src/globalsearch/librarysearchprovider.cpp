@@ -54,6 +54,7 @@ SearchProvider::ResultList LibrarySearchProvider::Search(int id,
 
   LibraryQuery q(options);
   q.SetColumnSpec("%songs_table.ROWID, " + Song::kColumnSpec);
+  q.SetOrderByRank(true);
 
   if (!backend_->ExecQuery(&q)) {
     return ResultList();
@@ -19,9 +19,10 @@
 
 #include <QPainter>
 #include <QUrl>
-#include <QtConcurrentRun>
+#include <functional>
 
 #include "core/closure.h"
+#include "core/workscheduler.h"
 #include "internet/core/internetsongmimedata.h"
 #include "playlist/songmimedata.h"
 
@@ -79,8 +80,9 @@ BlockingSearchProvider::BlockingSearchProvider(Application* app,
     : SearchProvider(app, parent) {}
 
 void BlockingSearchProvider::SearchAsync(int id, const QString& query) {
-  QFuture<ResultList> future =
-      QtConcurrent::run(this, &BlockingSearchProvider::Search, id, query);
+  QFuture<ResultList> future = WorkScheduler::Instance()->Run<ResultList>(
+      WorkScheduler::Priority_Interactive,
+      std::bind(&BlockingSearchProvider::Search, this, id, query));
   NewClosure(future, this,
              SLOT(BlockingSearchFinished(QFuture<ResultList>, int)), future,
              id);
@@ -25,9 +25,12 @@
 #include <QVariant>
 
 #include "core/database.h"
+#include "core/logging.h"
 #include "core/scopedtransaction.h"
 
 const char* IcecastBackend::kTableName = "icecast_stations";
+const char* IcecastBackend::kStagingTableName = "temp.icecast_staging";
+const int IcecastBackend::kMinStationsPerGenre = 3;
 
 IcecastBackend::IcecastBackend(QObject* parent) : QObject(parent) {}
 
@@ -145,41 +148,121 @@ bool IcecastBackend::IsEmpty() {
   return !q.next();
 }
 
-void IcecastBackend::ClearAndAddStations(const StationList& stations) {
+void IcecastBackend::BeginUpdate() {
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db = db_->Connect();
+
+  // Names are unique in the directory - other URLs for the same station are
+  // dropped.
+  QSqlQuery q(db);
+  q.exec(QString("CREATE TABLE IF NOT EXISTS %1 ("
+                 "  name TEXT PRIMARY KEY, url TEXT, mime_type TEXT,"
+                 "  bitrate INTEGER, channels INTEGER, samplerate INTEGER,"
+                 "  genre TEXT)")
+             .arg(kStagingTableName));
+  if (db_->CheckErrors(q)) return;
+
+  q.exec(QString("DELETE FROM %1").arg(kStagingTableName));
+  db_->CheckErrors(q);
+}
+
+void IcecastBackend::StageStations(const StationList& stations) {
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db = db_->Connect();
+  ScopedTransaction t(&db);
+
+  QSqlQuery q(db);
+  q.prepare(QString("INSERT OR IGNORE INTO %1 (name, url, mime_type, bitrate,"
+                    "                          channels, samplerate, genre)"
+                    " VALUES (:name, :url, :mime_type, :bitrate,"
+                    "         :channels, :samplerate, :genre)")
+                .arg(kStagingTableName));
+
+  for (const Station& station : stations) {
+    q.bindValue(":name", station.name);
+    q.bindValue(":url", station.url);
+    q.bindValue(":mime_type", station.mime_type);
+    q.bindValue(":bitrate", station.bitrate);
+    q.bindValue(":channels", station.channels);
+    q.bindValue(":samplerate", station.samplerate);
+    q.bindValue(":genre", station.genre);
+    q.exec();
+    if (db_->CheckErrors(q)) return;
+  }
+
+  t.Commit();
+}
+
+void IcecastBackend::FinishUpdate() {
+  int changes = 0;
   {
     QMutexLocker l(db_->Mutex());
     QSqlDatabase db = db_->Connect();
-    ScopedTransaction t(&db);
-
-    // Remove all existing items
     QSqlQuery q(db);
-    q.prepare(QString("DELETE FROM %1").arg(kTableName));
+
+    // This needs every station to count them, so it's done once they've all
+    // been staged.
+    q.prepare(QString("UPDATE %1 SET genre = 'Other' WHERE genre IN ("
+                      "  SELECT genre FROM %1 GROUP BY genre"
+                      "  HAVING COUNT(*) < :min_count)")
+                  .arg(kStagingTableName));
+    q.bindValue(":min_count", kMinStationsPerGenre);
     q.exec();
     if (db_->CheckErrors(q)) return;
 
-    q.prepare(QString("INSERT INTO %1 (name, url, mime_type, bitrate,"
-                      "                channels, samplerate, genre)"
-                      " VALUES (:name, :url, :mime_type, :bitrate,"
-                      "         :channels, :samplerate, :genre)")
-                  .arg(kTableName));
-
-    // Add these ones
-    for (const Station& station : stations) {
-      q.bindValue(":name", station.name);
-      q.bindValue(":url", station.url);
-      q.bindValue(":mime_type", station.mime_type);
-      q.bindValue(":bitrate", station.bitrate);
-      q.bindValue(":channels", station.channels);
-      q.bindValue(":samplerate", station.samplerate);
-      q.bindValue(":genre", station.genre);
-      q.exec();
-      if (db_->CheckErrors(q)) return;
+    ScopedTransaction t(&db);
+
+    q.exec(QString("DELETE FROM %1 WHERE name NOT IN (SELECT name FROM %2)")
+               .arg(kTableName, kStagingTableName));
+    if (db_->CheckErrors(q)) return;
+    changes += q.numRowsAffected();
+
+    const QStringList columns = QStringList() << "url"
+                                              << "mime_type"
+                                              << "bitrate"
+                                              << "channels"
+                                              << "samplerate"
+                                              << "genre";
+    QStringList updates;
+    QStringList differences;
+    for (const QString& column : columns) {
+      updates << QString("%1 = (SELECT %1 FROM %2 AS s WHERE s.name = %3.name)")
+                     .arg(column, kStagingTableName, kTableName);
+      differences << QString("s.%1 IS NOT o.%1").arg(column);
     }
 
+    q.exec(QString("UPDATE %1 SET %2 WHERE ROWID IN ("
+                   "  SELECT o.ROWID FROM %1 AS o"
+                   "  JOIN %3 AS s ON s.name = o.name"
+                   "  WHERE %4)")
+               .arg(kTableName, updates.join(", "), kStagingTableName,
+                    differences.join(" OR ")));
+    if (db_->CheckErrors(q)) return;
+    changes += q.numRowsAffected();
+
+    q.exec(QString("INSERT INTO %1 (name, %2)"
+                   " SELECT name, %2 FROM %3"
+                   " WHERE name NOT IN (SELECT name FROM %1)")
+               .arg(kTableName, columns.join(", "), kStagingTableName));
+    if (db_->CheckErrors(q)) return;
+    changes += q.numRowsAffected();
+
     t.Commit();
+
+    q.exec(QString("DELETE FROM %1").arg(kStagingTableName));
+    db_->CheckErrors(q);
   }
 
-  emit DatabaseReset();
+  qLog(Debug) << "Icecast directory updated," << changes << "stations changed";
+  if (changes) emit DatabaseReset();
+}
+
+void IcecastBackend::CancelUpdate() {
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db = db_->Connect();
+  QSqlQuery q(db);
+  q.exec(QString("DELETE FROM %1").arg(kStagingTableName));
+  db_->CheckErrors(q);
 }
 
 Song IcecastBackend::Station::ToSong() const {
@@ -35,6 +35,10 @@ class IcecastBackend : public QObject {
   void Init(Database* db);
 
   static const char* kTableName;
+  static const char* kStagingTableName;
+
+  // Genres with fewer stations than this are merged into "Other".
+  static const int kMinStationsPerGenre;
 
   struct Station {
     Station() : bitrate(0), channels(0), samplerate(0) {}
@@ -56,7 +60,16 @@ class IcecastBackend : public QObject {
   StationList GetStations(const QString& filter = QString(),
                           const QString& genre = QString());
 
-  void ClearAndAddStations(const StationList& stations);
+  // Replaces the stations with a new directory.  The new stations are written
+  // to a staging table in batches as they're read, and then only the rows
+  // that are different are changed, so the database isn't locked for long.
+  // CancelUpdate throws the staged stations away instead.  These all have to
+  // be called from the same thread, because the staging table only exists on
+  // that thread's connection.
+  void BeginUpdate();
+  void StageStations(const StationList& stations);
+  void FinishUpdate();
+  void CancelUpdate();
 
   bool IsEmpty();
 
@@ -26,15 +26,16 @@
 #include <QMultiHash>
 #include <QNetworkReply>
 #include <QRegExp>
-#include <QtConcurrentRun>
-#include <algorithm>
+#include <functional>
 
 #include "core/application.h"
 #include "core/closure.h"
 #include "core/database.h"
+#include "core/logging.h"
 #include "core/mergedproxymodel.h"
 #include "core/network.h"
 #include "core/taskmanager.h"
+#include "core/workscheduler.h"
 #include "globalsearch/globalsearch.h"
 #include "globalsearch/icecastsearchprovider.h"
 #include "internet/core/internetmodel.h"
@@ -44,14 +45,13 @@
 #include "playlist/songplaylistitem.h"
 #include "ui/iconloader.h"
 
-using std::sort;
-using std::unique;
-
 const char* IcecastService::kServiceName = "Icecast";
 const char* IcecastService::kDirectoryUrl =
     "http://data.clementine-player.org/icecast-directory";
 const char* IcecastService::kHomepage = "http://dir.xiph.org/";
 
+const int IcecastService::kBatchSize = 1000;
+
 IcecastService::IcecastService(Application* app, InternetModel* parent)
     : InternetService(kServiceName, app, parent, parent),
       network_(new NetworkAccessManager(this)),
@@ -130,12 +130,10 @@ void IcecastService::DownloadDirectoryFinished(QNetworkReply* reply,
     return;
   }
 
-  QFuture<IcecastBackend::StationList> future =
-      QtConcurrent::run(this, &IcecastService::ParseDirectory, reply);
-  NewClosure(
-      future, this,
-      SLOT(ParseDirectoryFinished(QFuture<IcecastBackend::StationList>, int)),
-      future, task_id);
+  QFuture<void> future = WorkScheduler::Instance()->Run<void>(
+      WorkScheduler::Priority_Normal,
+      std::bind(&IcecastService::ParseDirectory, this, reply));
+  NewClosure(future, this, SLOT(ParseDirectoryFinished(int)), task_id);
 }
 
 namespace {
@@ -152,25 +150,6 @@ struct GenreSorter {
   const QMultiHash<QString, T>& genres_;
 };
 
-template <typename T>
-struct StationSorter {
-  bool operator()(const T& a, const T& b) const {
-    return a.name.compare(b.name, Qt::CaseInsensitive) < 0;
-  }
-};
-
-template <typename T>
-struct StationSorter<T*> {
-  bool operator()(const T* a, const T* b) const {
-    return a->name.compare(b->name, Qt::CaseInsensitive) < 0;
-  }
-};
-
-template <typename T>
-struct StationEquality {
-  bool operator()(T a, T b) const { return a.name == b.name; }
-};
-
 QStringList FilterGenres(const QStringList& genres) {
   QStringList ret;
   for (const QString& genre : genres) {
@@ -194,57 +173,39 @@ QStringList FilterGenres(const QStringList& genres) {
 }
 }  // namespace
 
-void IcecastService::ParseDirectoryFinished(
-    QFuture<IcecastBackend::StationList> future, int task_id) {
-  IcecastBackend::StationList all_stations = future.result();
-  sort(all_stations.begin(), all_stations.end(),
-       StationSorter<IcecastBackend::Station>());
-  // Remove duplicates by name. These tend to be multiple URLs for the same
-  // station.
-  IcecastBackend::StationList::iterator it =
-      unique(all_stations.begin(), all_stations.end(),
-             StationEquality<IcecastBackend::Station>());
-  all_stations.erase(it, all_stations.end());
-
-  // Cluster stations by genre.
-  QMultiHash<QString, IcecastBackend::Station*> genres;
-
-  // Add stations.
-  for (int i = 0; i < all_stations.count(); ++i) {
-    IcecastBackend::Station& s = all_stations[i];
-    genres.insert(s.genre, &s);
-  }
-
-  QSet<QString> genre_set = genres.keys().toSet();
-
-  // Merge genres with only 1 or 2 stations into "Other".
-  for (const QString& genre : genre_set) {
-    if (genres.count(genre) < 3) {
-      const QList<IcecastBackend::Station*>& small_genre = genres.values(genre);
-      for (IcecastBackend::Station* s : small_genre) {
-        s->genre = "Other";
-      }
-    }
-  }
-
-  backend_->ClearAndAddStations(all_stations);
-
+void IcecastService::ParseDirectoryFinished(int task_id) {
   app_->task_manager()->SetTaskFinished(task_id);
 }
 
-IcecastBackend::StationList IcecastService::ParseDirectory(
-    QIODevice* device) const {
+void IcecastService::ParseDirectory(QIODevice* device) const {
   QXmlStreamReader reader(device);
   IcecastBackend::StationList stations;
+
+  backend_->BeginUpdate();
   while (!reader.atEnd()) {
     reader.readNext();
     if (reader.tokenType() == QXmlStreamReader::StartElement &&
         reader.name() == "entry") {
       stations << ReadStation(&reader);
+
+      if (stations.count() >= kBatchSize) {
+        backend_->StageStations(stations);
+        stations.clear();
+      }
     }
   }
+  backend_->StageStations(stations);
   device->deleteLater();
-  return stations;
+
+  // Don't remove all the stations that were after a broken bit of XML.
+  if (reader.hasError()) {
+    qLog(Warning) << "Failed to parse the Icecast directory"
+                  << reader.errorString();
+    backend_->CancelUpdate();
+    return;
+  }
+
+  backend_->FinishUpdate();
 }
 
 IcecastBackend::Station IcecastService::ReadStation(
@@ -46,6 +46,8 @@ class IcecastService : public InternetService {
   static const char* kDirectoryUrl;
   static const char* kHomepage;
 
+  static const int kBatchSize;
+
   enum ItemType {
     Type_Stream = 3000,
     Type_Genre,
@@ -62,13 +64,12 @@ class IcecastService : public InternetService {
   void LoadDirectory();
   void Homepage();
   void DownloadDirectoryFinished(QNetworkReply* reply, int task_id);
-  void ParseDirectoryFinished(QFuture<IcecastBackend::StationList> future,
-                              int task_id);
+  void ParseDirectoryFinished(int task_id);
 
  private:
   void RequestDirectory(const QUrl& url, int task_id);
   void EnsureMenuCreated();
-  IcecastBackend::StationList ParseDirectory(QIODevice* device) const;
+  void ParseDirectory(QIODevice* device) const;
   IcecastBackend::Station ReadStation(QXmlStreamReader* reader) const;
 
   QStandardItem* root_;
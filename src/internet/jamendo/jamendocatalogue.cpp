@@ -0,0 +1,281 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "jamendocatalogue.h"
+
+#include <QMutexLocker>
+#include <QSqlQuery>
+#include <QStringList>
+
+#include "core/database.h"
+#include "core/logging.h"
+#include "core/scopedtransaction.h"
+#include "jamendoservice.h"
+
+const char* JamendoCatalogue::kStagingTable = "temp.jamendo_staging";
+
+namespace {
+
+const char* kFtsSourceView = "jamendo.songs_fts_source";
+const char* kRemovedTable = "temp.jamendo_removed";
+const char* kChangedTable = "temp.jamendo_changed";
+const char* kAddedTable = "temp.jamendo_added";
+
+// The columns that are filled in from the catalogue.  A song is only updated
+// if one of these has changed.
+const QStringList kCatalogueColumns = QStringList() << "title"
+                                                    << "album"
+                                                    << "artist"
+                                                    << "genre"
+                                                    << "comment"
+                                                    << "length"
+                                                    << "filename"
+                                                    << "art_automatic";
+
+}  // namespace
+
+JamendoCatalogue::JamendoCatalogue(Database* db) : db_(db) {}
+
+void JamendoCatalogue::Begin() {
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  // The staging table has the same columns as the songs table, and the track
+  // ID that identifies each song in the catalogue.
+  QSqlQuery q(db);
+  q.exec(QString("CREATE TABLE IF NOT EXISTS %1 AS"
+                 " SELECT 0 AS %2, * FROM %3 WHERE 0")
+             .arg(kStagingTable, JamendoService::kTrackIdsColumn,
+                  JamendoService::kSongsTable));
+  if (db_->CheckErrors(q)) return;
+
+  q.exec(QString("CREATE INDEX IF NOT EXISTS %1_%2 ON jamendo_staging (%2)")
+             .arg(kStagingTable, JamendoService::kTrackIdsColumn));
+  if (db_->CheckErrors(q)) return;
+
+  q.exec(QString("DELETE FROM %1").arg(kStagingTable));
+  db_->CheckErrors(q);
+}
+
+void JamendoCatalogue::Stage(const SongList& songs,
+                             const QList<int>& track_ids) {
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  ScopedTransaction t(&db);
+
+  QSqlQuery insert(db);
+  insert.prepare(QString("INSERT INTO %1 (%2, " + Song::kColumnSpec +
+                         ") VALUES (:track_id, " + Song::kBindSpec + ")")
+                     .arg(kStagingTable, JamendoService::kTrackIdsColumn));
+
+  // Only the songs that had an ID got one added to track_ids.
+  QList<int>::const_iterator track_id = track_ids.begin();
+  for (const Song& song : songs) {
+    if (!song.is_valid() || track_id == track_ids.end()) continue;
+
+    song.BindToQuery(&insert);
+    insert.bindValue(":track_id", *track_id++);
+    if (!insert.exec()) {
+      qLog(Warning) << "Query failed" << insert.lastQuery();
+    }
+  }
+
+  t.Commit();
+}
+
+void JamendoCatalogue::Apply() {
+  Database* database = db_;
+
+  const QString songs_table = JamendoService::kSongsTable;
+  const QString fts_table = JamendoService::kFtsTable;
+  const QString track_ids_table = JamendoService::kTrackIdsTable;
+  const QString track_id_column = JamendoService::kTrackIdsColumn;
+  const QString fts_columns = Song::kFtsColumnSpec;
+  const QString song_columns = Song::kColumnSpec;
+  int added = 0;
+  int removed = 0;
+  int changed = 0;
+
+  {
+    QMutexLocker l(database->Mutex());
+    QSqlDatabase db(database->Connect());
+    QSqlQuery q(db);
+
+    for (const char* table : {kRemovedTable, kChangedTable, kAddedTable}) {
+      q.exec(QString("DROP TABLE IF EXISTS %1").arg(table));
+      if (database->CheckErrors(q)) return;
+    }
+
+    ScopedTransaction t(&db);
+
+    // Songs that aren't in the catalogue any more, or that never had a track
+    // ID.  They're taken out of the FTS index while the songs table still has
+    // their values.
+    q.exec(QString("CREATE TABLE %1 AS"
+                   " SELECT ROWID AS songs_row_id FROM %2"
+                   " WHERE ROWID NOT IN ("
+                   "  SELECT songs_row_id FROM %3"
+                   "  WHERE %4 IN (SELECT %4 FROM %5))")
+               .arg(kRemovedTable, songs_table, track_ids_table,
+                    track_id_column, kStagingTable));
+    if (database->CheckErrors(q)) return;
+
+    const QString removed_ids =
+        QString("SELECT songs_row_id FROM %1").arg(kRemovedTable);
+    q.exec(QString("DELETE FROM %1 WHERE ROWID IN (%2)")
+               .arg(fts_table, removed_ids));
+    if (database->CheckErrors(q)) return;
+    q.exec(QString("DELETE FROM %1 WHERE ROWID IN (%2)")
+               .arg(songs_table, removed_ids));
+    if (database->CheckErrors(q)) return;
+    removed = q.numRowsAffected();
+    q.exec(QString("DELETE FROM %1 WHERE songs_row_id NOT IN"
+                   " (SELECT ROWID FROM %2)")
+               .arg(track_ids_table, songs_table));
+    if (database->CheckErrors(q)) return;
+
+    // Songs that are still there, but have different details.
+    QStringList differences;
+    QStringList updates;
+    for (const QString& column : kCatalogueColumns) {
+      differences << QString("s.%1 IS NOT o.%1").arg(column);
+      updates << QString(
+                     "%1 = (SELECT s.%1 FROM %2 AS s, %3 AS c"
+                     " WHERE c.songs_row_id = songs.ROWID"
+                     " AND s.ROWID = c.staging_row_id)")
+                     .arg(column, kStagingTable, kChangedTable);
+    }
+
+    q.exec(QString("CREATE TABLE %1 ("
+                   " songs_row_id INTEGER PRIMARY KEY, staging_row_id INTEGER)")
+               .arg(kChangedTable));
+    if (database->CheckErrors(q)) return;
+    q.exec(QString("INSERT OR IGNORE INTO %1"
+                   " SELECT t.songs_row_id, s.ROWID FROM %2 AS s"
+                   " JOIN %3 AS t ON t.%4 = s.%4"
+                   " JOIN %5 AS o ON o.ROWID = t.songs_row_id"
+                   " WHERE %6")
+               .arg(kChangedTable, kStagingTable, track_ids_table,
+                    track_id_column, songs_table, differences.join(" OR ")));
+    if (database->CheckErrors(q)) return;
+
+    const QString changed_ids =
+        QString("SELECT songs_row_id FROM %1").arg(kChangedTable);
+    q.exec(QString("DELETE FROM %1 WHERE ROWID IN (%2)")
+               .arg(fts_table, changed_ids));
+    if (database->CheckErrors(q)) return;
+    q.exec(QString("UPDATE %1 SET %2 WHERE ROWID IN (%3)")
+               .arg(songs_table, updates.join(", "), changed_ids));
+    if (database->CheckErrors(q)) return;
+    changed = q.numRowsAffected();
+    q.exec(QString("INSERT INTO %1 (ROWID, %2)"
+                   " SELECT fts_rowid, %2 FROM %3 WHERE fts_rowid IN (%4)")
+               .arg(fts_table, fts_columns, kFtsSourceView, changed_ids));
+    if (database->CheckErrors(q)) return;
+
+    // Songs that are new in the catalogue.
+    q.exec(QString("CREATE TABLE %1 AS SELECT ROWID AS staging_row_id FROM %2"
+                   " WHERE %3 NOT IN (SELECT %3 FROM %4)")
+               .arg(kAddedTable, kStagingTable, track_id_column,
+                    track_ids_table));
+    if (database->CheckErrors(q)) return;
+
+    t.Commit();
+  }
+
+  // New songs are added in batches, so other queries can get at the database
+  // in between.  Each one is given the ROWID after the last one in the songs
+  // table plus its ROWID in the staging table, so it can be found again to
+  // add to the other tables.
+  qint64 base = 0;
+  qint64 last_staging_row_id = 0;
+  {
+    QMutexLocker l(database->Mutex());
+    QSqlDatabase db(database->Connect());
+    QSqlQuery q(db);
+    q.exec(QString("SELECT MAX(IFNULL((SELECT MAX(ROWID) FROM %1), 0),"
+                   "           IFNULL((SELECT MAX(songs_row_id) FROM %2), 0)),"
+                   "       IFNULL((SELECT MAX(staging_row_id) FROM %3), 0)")
+               .arg(songs_table, track_ids_table, kAddedTable));
+    if (database->CheckErrors(q) || !q.next()) return;
+    base = q.value(0).toLongLong();
+    last_staging_row_id = q.value(1).toLongLong();
+  }
+
+  for (qint64 first = 1; first <= last_staging_row_id;
+       first += JamendoService::kBatchSize) {
+    const qint64 last = first + JamendoService::kBatchSize - 1;
+
+    QMutexLocker l(database->Mutex());
+    QSqlDatabase db(database->Connect());
+    ScopedTransaction t(&db);
+
+    const QString staged = QString(
+                               " FROM %1 WHERE ROWID IN ("
+                               "  SELECT staging_row_id FROM %2"
+                               "  WHERE staging_row_id BETWEEN :first AND "
+                               ":last)")
+                               .arg(kStagingTable, kAddedTable);
+
+    QSqlQuery insert_songs(db);
+    insert_songs.prepare(QString("INSERT INTO %1 (ROWID, %2)"
+                                 " SELECT :base + ROWID, %2")
+                             .arg(songs_table, song_columns) +
+                         staged);
+    QSqlQuery insert_track_ids(db);
+    insert_track_ids.prepare(QString("INSERT INTO %1 (songs_row_id, %2)"
+                                     " SELECT :base + ROWID, %2")
+                                 .arg(track_ids_table, track_id_column) +
+                             staged);
+    QSqlQuery insert_fts(db);
+    insert_fts.prepare(QString("INSERT INTO %1 (ROWID, %2)"
+                               " SELECT fts_rowid, %2 FROM %3"
+                               " WHERE fts_rowid BETWEEN :base + :first"
+                               " AND :base + :last")
+                           .arg(fts_table, fts_columns, kFtsSourceView));
+
+    for (QSqlQuery* q : {&insert_songs, &insert_track_ids, &insert_fts}) {
+      q->bindValue(":base", base);
+      q->bindValue(":first", first);
+      q->bindValue(":last", last);
+      q->exec();
+      if (database->CheckErrors(*q)) return;
+    }
+    added += insert_songs.numRowsAffected();
+
+    t.Commit();
+  }
+
+  {
+    QMutexLocker l(database->Mutex());
+    QSqlDatabase db(database->Connect());
+    QSqlQuery q(db);
+    q.exec(QString("DELETE FROM %1").arg(kStagingTable));
+    database->CheckErrors(q);
+  }
+
+  qLog(Debug) << "Jamendo catalogue updated:" << added << "added," << removed
+              << "removed," << changed << "changed";
+}
+
+void JamendoCatalogue::Cancel() {
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+  QSqlQuery q(db);
+  q.exec(QString("DELETE FROM %1").arg(kStagingTable));
+  db_->CheckErrors(q);
+}
@@ -0,0 +1,55 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INTERNET_JAMENDO_JAMENDOCATALOGUE_H_
+#define INTERNET_JAMENDO_JAMENDOCATALOGUE_H_
+
+#include <QList>
+
+#include "core/song.h"
+
+class Database;
+
+// Replaces the Jamendo songs with a new catalogue.  The catalogue is read into
+// a staging table, and then only the songs that were added, removed or changed
+// are written to the real tables, so the database isn't locked for long.
+//
+// All the methods have to be called from the same thread, because the staging
+// table only exists on that thread's database connection.
+class JamendoCatalogue {
+ public:
+  explicit JamendoCatalogue(Database* db);
+
+  static const char* kStagingTable;
+
+  // Creates the staging table, or empties it if it's already there.
+  void Begin();
+
+  // Adds songs to the staging table.  Each valid song takes the next ID from
+  // track_ids.
+  void Stage(const SongList& songs, const QList<int>& track_ids);
+
+  // Makes the songs tables match the staging table, and empties it.
+  void Apply();
+
+  // Throws away the staged songs and leaves the songs tables alone.
+  void Cancel();
+
+ private:
+  Database* db_;
+};
+
+#endif  // INTERNET_JAMENDO_JAMENDOCATALOGUE_H_
@@ -29,7 +29,7 @@
 #include <QNetworkReply>
 #include <QSortFilterProxyModel>
 #include <QXmlStreamReader>
-#include <QtConcurrentRun>
+#include <functional>
 
 #include "core/application.h"
 #include "core/database.h"
@@ -39,9 +39,11 @@
 #include "core/scopedtransaction.h"
 #include "core/taskmanager.h"
 #include "core/timeconstants.h"
+#include "core/workscheduler.h"
 #include "globalsearch/globalsearch.h"
 #include "globalsearch/librarysearchprovider.h"
 #include "internet/core/internetmodel.h"
+#include "jamendocatalogue.h"
 #include "jamendodynamicplaylist.h"
 #include "jamendoplaylistitem.h"
 #include "library/librarybackend.h"
@@ -224,23 +226,17 @@ void JamendoService::DownloadDirectoryFinished() {
   load_database_task_id_ =
       app_->task_manager()->StartTask(tr("Parsing Jamendo catalogue"));
 
-  QFuture<void> future =
-      QtConcurrent::run(this, &JamendoService::ParseDirectory, gzip);
+  QFuture<void> future = WorkScheduler::Instance()->Run<void>(
+      WorkScheduler::Priority_Normal,
+      std::bind(&JamendoService::ParseDirectory, this, gzip));
   NewClosure(future, this, SLOT(ParseDirectoryFinished()));
 }
 
 void JamendoService::ParseDirectory(QIODevice* device) const {
   int total_count = 0;
 
-  // Bit of a hack: don't update the model while we're parsing the xml
-  disconnect(library_backend_.get(), SIGNAL(SongsDiscovered(SongList)),
-             library_model_, SLOT(SongsDiscovered(SongList)));
-  disconnect(library_backend_.get(), SIGNAL(TotalSongCountUpdated(int)), this,
-             SLOT(UpdateTotalSongCount(int)));
-
-  // Delete the database and recreate it.  This is faster than dropping tables
-  // or removing rows.
-  library_backend_->db()->RecreateAttachedDb("jamendo");
+  JamendoCatalogue catalogue(library_backend_->db());
+  catalogue.Begin();
 
   TrackIdList track_ids;
   SongList songs;
@@ -253,9 +249,8 @@ void JamendoService::ParseDirectory(QIODevice* device) const {
     }
 
     if (songs.count() >= kBatchSize) {
-      // Add the songs to the database in batches
-      library_backend_->AddOrUpdateSongs(songs);
-      InsertTrackIds(track_ids);
+      // Stage the songs in batches
+      catalogue.Stage(songs, track_ids);
 
       total_count += songs.count();
       songs.clear();
@@ -267,35 +262,18 @@ void JamendoService::ParseDirectory(QIODevice* device) const {
     }
   }
 
-  library_backend_->AddOrUpdateSongs(songs);
-  InsertTrackIds(track_ids);
-
-  connect(library_backend_.get(), SIGNAL(SongsDiscovered(SongList)),
-          library_model_, SLOT(SongsDiscovered(SongList)));
-  connect(library_backend_.get(), SIGNAL(TotalSongCountUpdated(int)),
-          SLOT(UpdateTotalSongCount(int)));
-
-  library_backend_->UpdateTotalSongCount();
-}
+  catalogue.Stage(songs, track_ids);
 
-void JamendoService::InsertTrackIds(const TrackIdList& ids) const {
-  QMutexLocker l(library_backend_->db()->Mutex());
-  QSqlDatabase db(library_backend_->db()->Connect());
-
-  ScopedTransaction t(&db);
-
-  QSqlQuery insert(db);
-  insert.prepare(QString("INSERT INTO %1 (%2) VALUES (:id)")
-                     .arg(kTrackIdsTable, kTrackIdsColumn));
-
-  for (int id : ids) {
-    insert.bindValue(":id", id);
-    if (!insert.exec()) {
-      qLog(Warning) << "Query failed" << insert.lastQuery();
-    }
+  // Don't remove all the songs that were after a broken bit of XML.
+  if (reader.hasError()) {
+    qLog(Warning) << "Failed to parse the Jamendo catalogue"
+                  << reader.errorString();
+    catalogue.Cancel();
+    return;
   }
 
-  t.Commit();
+  catalogue.Apply();
+  library_backend_->UpdateTotalSongCount();
 }
 
 SongList JamendoService::ReadArtist(QXmlStreamReader* reader,
@@ -84,7 +84,6 @@ class JamendoService : public InternetService {
   Song ReadTrack(const QString& artist, const QString& album,
                  const QString& album_cover, int album_id,
                  QXmlStreamReader* reader, TrackIdList* track_ids) const;
-  void InsertTrackIds(const TrackIdList& ids) const;
 
   void EnsureMenuCreated();
 
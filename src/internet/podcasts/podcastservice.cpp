@@ -23,12 +23,13 @@
 #include <QMap>
 #include <QMenu>
 #include <QSortFilterProxyModel>
-#include <QtConcurrentRun>
+#include <functional>
 
 #include "addpodcastdialog.h"
 #include "core/application.h"
 #include "core/logging.h"
 #include "core/mergedproxymodel.h"
+#include "core/workscheduler.h"
 #include "devices/devicemanager.h"
 #include "devices/devicestatefiltermodel.h"
 #include "devices/deviceview.h"
@@ -751,8 +752,10 @@ void PodcastService::ShowConfig() {
 void PodcastService::CurrentSongChanged(const Song& metadata) {
   // This does two db queries, and we are called on every song change, so run
   // this off the main thread.
-  QtConcurrent::run(this, &PodcastService::UpdatePodcastListenedStateAsync,
-                    metadata);
+  WorkScheduler::Instance()->Run<void>(
+      WorkScheduler::Priority_Normal,
+      std::bind(&PodcastService::UpdatePodcastListenedStateAsync, this,
+                metadata));
 }
 
 void PodcastService::UpdatePodcastListenedStateAsync(const Song& metadata) {
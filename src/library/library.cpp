@@ -26,6 +26,8 @@
 #include "librarybackend.h"
 #include "librarydirectorymodel.h"
 #include "librarymodel.h"
+#include "musicbrainz/fingerprintstore.h"
+#include "replaygainscanner.h"
 #include "smartplaylists/generator.h"
 #include "smartplaylists/querygenerator.h"
 #include "smartplaylists/search.h"
@@ -40,6 +42,9 @@ Library::Library(Application* app, QObject* parent)
       app_(app),
       backend_(nullptr),
       model_(nullptr),
+      dir_model_(nullptr),
+      fingerprint_store_(nullptr),
+      replaygain_scanner_(nullptr),
       watcher_(nullptr),
       watcher_thread_(nullptr),
       save_statistics_in_files_(false),
@@ -58,6 +63,12 @@ Library::Library(Application* app, QObject* parent)
 
   model_ = new LibraryModel(backend_, app_, this);
   dir_model_ = new LibraryDirectoryModel(backend_, this);
+  fingerprint_store_ =
+      new FingerprintStore(app->database(), app->task_manager(), this);
+  connect(fingerprint_store_, SIGNAL(DuplicatesUpdated()), model_,
+          SLOT(ResetAsync()));
+  replaygain_scanner_ =
+      new ReplayGainScanner(app->database(), app->task_manager(), this);
   model_->set_show_smart_playlists(true);
   model_->set_default_smart_playlists(
       LibraryModel::DefaultGenerators()
@@ -171,8 +182,9 @@ void Library::Init() {
           SLOT(CurrentSongChanged(Song)));
   connect(app_->player(), SIGNAL(Stopped()), SLOT(Stopped()));
 
-  // This will start the watcher checking for updates
-  backend_->LoadDirectoriesAsync();
+  // This will start the watcher checking for updates.  Scanning competes
+  // with restoring the playlists for the disk, so wait until we've started.
+  app_->RunAfterStartup(backend_.get(), "LoadDirectories");
 }
 
 void Library::IncrementalScan() { watcher_->IncrementalScanAsync(); }
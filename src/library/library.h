@@ -27,10 +27,12 @@
 
 class Application;
 class Database;
+class FingerprintStore;
 class LibraryBackend;
 class LibraryModel;
 class LibraryDirectoryModel;
 class LibraryWatcher;
+class ReplayGainScanner;
 class TaskManager;
 class Thread;
 
@@ -51,6 +53,8 @@ class Library : public QObject {
   LibraryBackend* backend() const { return backend_.get(); }
   LibraryModel* model() const { return model_; }
   LibraryDirectoryModel* directory_model() const { return dir_model_; }
+  FingerprintStore* fingerprint_store() const { return fingerprint_store_; }
+  ReplayGainScanner* replaygain_scanner() const { return replaygain_scanner_; }
 
   QString full_rescan_reason(int schema_version) const {
     return full_rescan_revisions_.value(schema_version, QString());
@@ -82,6 +86,8 @@ class Library : public QObject {
   std::shared_ptr<LibraryBackend> backend_;
   LibraryModel* model_;
   LibraryDirectoryModel* dir_model_;
+  FingerprintStore* fingerprint_store_;
+  ReplayGainScanner* replaygain_scanner_;
 
   LibraryWatcher* watcher_;
   Thread* watcher_thread_;
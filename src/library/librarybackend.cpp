@@ -27,12 +27,15 @@
 
 #include "core/application.h"
 #include "core/database.h"
+#include "core/logging.h"
 #include "core/scopedtransaction.h"
 #include "core/tagreaderclient.h"
+#include "core/tracing.h"
 #include "core/utilities.h"
 #include "libraryquery.h"
 #include "smartplaylists/search.h"
 #include "sqlrow.h"
+#include "tagcompletionindex.h"
 
 const char* LibraryBackend::kSettingsGroup = "LibraryBackend";
 
@@ -45,7 +48,8 @@ const char* LibraryBackend::kNewScoreSql =
 LibraryBackend::LibraryBackend(QObject* parent)
     : LibraryBackendInterface(parent),
       save_statistics_in_file_(false),
-      save_ratings_in_file_(false) {}
+      save_ratings_in_file_(false),
+      tag_completion_index_(new TagCompletionIndex(this)) {}
 
 void LibraryBackend::Init(Database* db, const QString& songs_table,
                           const QString& fts_table) {
@@ -63,6 +67,154 @@ void LibraryBackend::Init(Database* db, const QString& songs_table,
   subdirs_table_ = subdirs_table;
 }
 
+void LibraryBackend::SetRootPath(const QString& root) {
+  QString canonical_root = QFileInfo(root).canonicalFilePath();
+  if (canonical_root.isEmpty()) canonical_root = root;
+
+  {
+    QMutexLocker l(&root_path_mutex_);
+    root_path_ = canonical_root;
+  }
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+  MakePathsRelative(db);
+}
+
+QString LibraryBackend::root_path() const {
+  QMutexLocker l(&root_path_mutex_);
+  return root_path_;
+}
+
+QString LibraryBackend::AbsolutePath(const QString& path) const {
+  const QString root = root_path();
+  if (root.isEmpty() || !QDir::isRelativePath(path)) return path;
+  if (path.isEmpty()) return root;
+  return root + "/" + path;
+}
+
+QString LibraryBackend::RelativePath(const QString& path) const {
+  const QString root = root_path();
+  if (root.isEmpty()) return path;
+  if (path == root) return QString("");
+  if (path.startsWith(root + "/")) return path.mid(root.length() + 1);
+  return path;
+}
+
+QUrl LibraryBackend::AbsoluteUrl(const QUrl& url) const {
+  const QString root = root_path();
+  if (root.isEmpty() || !url.isRelative()) return url;
+  return QUrl::fromLocalFile(root + "/").resolved(url);
+}
+
+QByteArray LibraryBackend::DatabaseUrl(const QUrl& url) const {
+  if (!url.isLocalFile()) return url.toEncoded();
+
+  const QString relative_path = RelativePath(url.toLocalFile());
+  if (!QDir::isRelativePath(relative_path)) return url.toEncoded();
+
+  // The ./ stops a ':' in the first directory's name being read back as the
+  // end of a scheme.
+  QUrl relative_url;
+  relative_url.setPath("./" + relative_path);
+  return relative_url.toEncoded();
+}
+
+Song LibraryBackend::SongFromRow(const SqlRow& row) const {
+  Song song;
+  song.InitFromQuery(row, true);
+
+  if (!root_path().isEmpty()) {
+    // Read the filename column again - set_url might have already resolved a
+    // relative URL against the wrong directory in portable mode.
+    const QUrl url =
+        QUrl::fromEncoded(row.value(Song::kFilenameColumn).toByteArray());
+    if (url.isRelative()) {
+      song.set_url(AbsoluteUrl(url));
+      song.set_basefilename(QFileInfo(song.url().toLocalFile()).fileName());
+    }
+  }
+  return song;
+}
+
+void LibraryBackend::MakePathsRelative(QSqlDatabase& db) {
+  // Devices only have one directory, and it's the mount point.  If it was
+  // stored as an absolute path by an older version then everything under it
+  // has to be rewritten relative to it, once.
+  QSqlQuery q(db);
+  q.prepare(QString("SELECT ROWID, path FROM %1").arg(dirs_table_));
+  q.exec();
+  if (db_->CheckErrors(q)) return;
+
+  QMap<int, QString> absolute_dirs;
+  while (q.next()) {
+    const QString path = q.value(1).toString();
+    if (!path.isEmpty() && !QDir::isRelativePath(path)) {
+      absolute_dirs[q.value(0).toInt()] = path;
+    }
+  }
+  if (absolute_dirs.isEmpty()) return;
+
+  ScopedTransaction t(&db);
+
+  for (auto it = absolute_dirs.constBegin(); it != absolute_dirs.constEnd();
+       ++it) {
+    const int id = it.key();
+    const QString old_path = it.value();
+    const QString old_prefix = old_path + "/";
+    const QByteArray old_url_prefix =
+        QUrl::fromLocalFile(old_path).toEncoded() + "/";
+
+    qLog(Info) << "Making paths in" << old_path << "relative";
+
+    // Do the dirs table
+    q = QSqlQuery(db);
+    q.prepare(
+        QString("UPDATE %1 SET path = '' WHERE ROWID = :id").arg(dirs_table_));
+    q.bindValue(":id", id);
+    q.exec();
+    if (db_->CheckErrors(q)) return;
+
+    // Do the subdirs table
+    q = QSqlQuery(db);
+    q.prepare(QString("UPDATE %1 SET path = ''"
+                      " WHERE directory = :id AND path = :path")
+                  .arg(subdirs_table_));
+    q.bindValue(":id", id);
+    q.bindValue(":path", old_path);
+    q.exec();
+    if (db_->CheckErrors(q)) return;
+
+    q = QSqlQuery(db);
+    q.prepare(QString("UPDATE %1 SET path = substr(path, %2)"
+                      " WHERE directory = :id"
+                      "   AND substr(path, 1, %3) = :prefix")
+                  .arg(subdirs_table_)
+                  .arg(old_prefix.length() + 1)
+                  .arg(old_prefix.length()));
+    q.bindValue(":id", id);
+    q.bindValue(":prefix", old_prefix);
+    q.exec();
+    if (db_->CheckErrors(q)) return;
+
+    // Do the songs table
+    q = QSqlQuery(db);
+    q.prepare(
+        QString("UPDATE %1 SET filename = './' || substr(filename, %2)"
+                " WHERE directory = :id"
+                "   AND substr(filename, 1, %3) = :prefix")
+            .arg(songs_table_)
+            .arg(old_url_prefix.length() + 1)
+            .arg(old_url_prefix.length()));
+    q.bindValue(":id", id);
+    q.bindValue(":prefix", old_url_prefix);
+    q.exec();
+    if (db_->CheckErrors(q)) return;
+  }
+
+  t.Commit();
+}
+
 void LibraryBackend::LoadDirectoriesAsync() {
   metaObject()->invokeMethod(this, "LoadDirectories", Qt::QueuedConnection);
 }
@@ -169,7 +321,7 @@ DirectoryList LibraryBackend::GetAllDirectories() {
   while (q.next()) {
     Directory dir;
     dir.id = q.value(0).toInt();
-    dir.path = q.value(1).toString();
+    dir.path = AbsolutePath(q.value(1).toString());
 
     ret << dir;
   }
@@ -195,7 +347,7 @@ SubdirectoryList LibraryBackend::SubdirsInDirectory(int id, QSqlDatabase& db) {
   while (q.next()) {
     Subdirectory subdir;
     subdir.directory_id = id;
-    subdir.path = q.value(0).toString();
+    subdir.path = AbsolutePath(q.value(0).toString());
     subdir.mtime = q.value(1).toUInt();
     subdirs << subdir;
   }
@@ -221,8 +373,11 @@ void LibraryBackend::AddDirectory(const QString& path) {
   QString canonical_path = QFileInfo(path).canonicalFilePath();
   QString db_path = canonical_path;
 
-  if (Application::kIsPortable && Utilities::UrlOnSameDriveAsClementine(
-                                      QUrl::fromLocalFile(canonical_path))) {
+  if (!root_path().isEmpty()) {
+    db_path = RelativePath(canonical_path);
+  } else if (Application::kIsPortable &&
+             Utilities::UrlOnSameDriveAsClementine(
+                 QUrl::fromLocalFile(canonical_path))) {
     db_path = Utilities::GetRelativePathToClementineBin(db_path);
     qLog(Debug) << "db_path" << db_path;
   }
@@ -288,8 +443,7 @@ SongList LibraryBackend::FindSongsInDirectory(int id) {
 
   SongList ret;
   while (q.next()) {
-    Song song;
-    song.InitFromQuery(q, true);
+    Song song = SongFromRow(q);
     ret << song;
   }
   return ret;
@@ -327,28 +481,30 @@ void LibraryBackend::AddOrUpdateSubdirs(const SubdirectoryList& subdirs) {
 
   ScopedTransaction transaction(&db);
   for (const Subdirectory& subdir : subdirs) {
+    const QString db_path = RelativePath(subdir.path);
+
     if (subdir.mtime == 0) {
       // Delete the subdirectory
       delete_query.bindValue(":id", subdir.directory_id);
-      delete_query.bindValue(":path", subdir.path);
+      delete_query.bindValue(":path", db_path);
       delete_query.exec();
       db_->CheckErrors(delete_query);
     } else {
       // See if this subdirectory already exists in the database
       find_query.bindValue(":id", subdir.directory_id);
-      find_query.bindValue(":path", subdir.path);
+      find_query.bindValue(":path", db_path);
       find_query.exec();
       if (db_->CheckErrors(find_query)) continue;
 
       if (find_query.next()) {
         update_query.bindValue(":mtime", subdir.mtime);
         update_query.bindValue(":id", subdir.directory_id);
-        update_query.bindValue(":path", subdir.path);
+        update_query.bindValue(":path", db_path);
         update_query.exec();
         db_->CheckErrors(update_query);
       } else {
         add_query.bindValue(":id", subdir.directory_id);
-        add_query.bindValue(":path", subdir.path);
+        add_query.bindValue(":path", db_path);
         add_query.bindValue(":mtime", subdir.mtime);
         add_query.exec();
         db_->CheckErrors(add_query);
@@ -359,6 +515,7 @@ void LibraryBackend::AddOrUpdateSubdirs(const SubdirectoryList& subdirs) {
 }
 
 void LibraryBackend::AddOrUpdateSongs(const SongList& songs) {
+  TRACE_SPAN("library", "LibraryBackend::AddOrUpdateSongs");
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
@@ -375,22 +532,22 @@ void LibraryBackend::AddOrUpdateSongs(const SongList& songs) {
   update_song.prepare(
       QString("UPDATE %1 SET " + Song::kUpdateSpec + " WHERE ROWID = :id")
           .arg(songs_table_));
+  // Index exactly what the FTS table's content view will read back when the
+  // row is removed again, rather than binding the song's values a second time.
   QSqlQuery add_song_fts(db);
-  add_song_fts.prepare(QString("INSERT INTO %1 (ROWID, " +
-                               Song::kFtsColumnSpec +
-                               ")"
-                               " VALUES (:id, " +
-                               Song::kFtsBindSpec + ")")
-                           .arg(fts_table_));
-  QSqlQuery update_song_fts(db);
-  update_song_fts.prepare(
-      QString("UPDATE %1 SET " + Song::kFtsUpdateSpec + " WHERE ROWID = :id")
-          .arg(fts_table_));
+  add_song_fts.prepare(QString("INSERT INTO %1 (ROWID, %2)"
+                               " SELECT fts_rowid, %2 FROM %1_source"
+                               " WHERE fts_rowid = :id")
+                           .arg(fts_table_, Song::kFtsColumnSpec));
+  QSqlQuery remove_song_fts(db);
+  remove_song_fts.prepare(
+      QString("DELETE FROM %1 WHERE ROWID = :id").arg(fts_table_));
 
   ScopedTransaction transaction(&db);
 
   SongList added_songs;
   SongList deleted_songs;
+  const bool relative_paths = !root_path().isEmpty();
 
   for (const Song& song : songs) {
     // Do a sanity check first - make sure the song's directory still exists
@@ -409,6 +566,9 @@ void LibraryBackend::AddOrUpdateSongs(const SongList& songs) {
 
       // Insert the row and create a new ID
       song.BindToQuery(&add_song);
+      if (relative_paths) {
+        add_song.bindValue(":filename", DatabaseUrl(song.url()));
+      }
       add_song.exec();
       if (db_->CheckErrors(add_song)) continue;
 
@@ -417,7 +577,6 @@ void LibraryBackend::AddOrUpdateSongs(const SongList& songs) {
 
       // Add to the FTS index
       add_song_fts.bindValue(":id", id);
-      song.BindToFtsQuery(&add_song_fts);
       add_song_fts.exec();
       if (db_->CheckErrors(add_song_fts)) continue;
 
@@ -429,16 +588,25 @@ void LibraryBackend::AddOrUpdateSongs(const SongList& songs) {
       Song old_song(GetSongById(song.id()));
       if (!old_song.is_valid()) continue;
 
+      // Take the song out of the FTS index while the songs table still has
+      // its old values - an external content FTS5 table reads them from there
+      // to know which terms to remove.
+      remove_song_fts.bindValue(":id", song.id());
+      remove_song_fts.exec();
+      if (db_->CheckErrors(remove_song_fts)) continue;
+
       // Update
       song.BindToQuery(&update_song);
+      if (relative_paths) {
+        update_song.bindValue(":filename", DatabaseUrl(song.url()));
+      }
       update_song.bindValue(":id", song.id());
       update_song.exec();
       if (db_->CheckErrors(update_song)) continue;
 
-      song.BindToFtsQuery(&update_song_fts);
-      update_song_fts.bindValue(":id", song.id());
-      update_song_fts.exec();
-      if (db_->CheckErrors(update_song_fts)) continue;
+      add_song_fts.bindValue(":id", song.id());
+      add_song_fts.exec();
+      if (db_->CheckErrors(add_song_fts)) continue;
 
       deleted_songs << old_song;
       added_songs << song;
@@ -455,6 +623,7 @@ void LibraryBackend::AddOrUpdateSongs(const SongList& songs) {
 }
 
 void LibraryBackend::UpdateMTimesOnly(const SongList& songs) {
+  TRACE_SPAN("library", "LibraryBackend::UpdateMTimesOnly");
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
@@ -473,6 +642,7 @@ void LibraryBackend::UpdateMTimesOnly(const SongList& songs) {
 }
 
 void LibraryBackend::DeleteSongs(const SongList& songs) {
+  TRACE_SPAN("library", "LibraryBackend::DeleteSongs");
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
@@ -484,13 +654,14 @@ void LibraryBackend::DeleteSongs(const SongList& songs) {
 
   ScopedTransaction transaction(&db);
   for (const Song& song : songs) {
-    remove.bindValue(":id", song.id());
-    remove.exec();
-    db_->CheckErrors(remove);
-
+    // The FTS index needs the song's row to still be there to remove it.
     remove_fts.bindValue(":id", song.id());
     remove_fts.exec();
     db_->CheckErrors(remove_fts);
+
+    remove.bindValue(":id", song.id());
+    remove.exec();
+    db_->CheckErrors(remove);
   }
   transaction.Commit();
 
@@ -537,6 +708,24 @@ QStringList LibraryBackend::GetAll(const QString& column,
   return ret;
 }
 
+QHash<QString, int> LibraryBackend::CountAll(const QString& column) {
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  QSqlQuery q(db);
+  q.exec(QString("SELECT %1, COUNT(*) FROM %2"
+                 " WHERE +effective_compilation = 0 AND unavailable = 0"
+                 " GROUP BY %1")
+             .arg(column, songs_table_));
+  if (db_->CheckErrors(q)) return QHash<QString, int>();
+
+  QHash<QString, int> ret;
+  while (q.next()) {
+    ret[q.value(0).toString()] = q.value(1).toInt();
+  }
+  return ret;
+}
+
 QStringList LibraryBackend::GetAllArtists(const QueryOptions& opt) {
   return GetAll("artist", opt);
 }
@@ -612,8 +801,7 @@ SongList LibraryBackend::ExecLibraryQuery(LibraryQuery* query) {
 
   SongList ret;
   while (query->Next()) {
-    Song song;
-    song.InitFromQuery(*query, true);
+    Song song = SongFromRow(*query);
     ret << song;
   }
   return ret;
@@ -669,7 +857,7 @@ SongList LibraryBackend::GetSongsByForeignId(const QStringList& ids,
     const int index = ids.indexOf(foreign_id);
     if (index == -1) continue;
 
-    ret[index].InitFromQuery(q, true);
+    ret[index] = SongFromRow(q);
   }
   return ret.toList();
 }
@@ -694,8 +882,7 @@ SongList LibraryBackend::GetSongsById(const QStringList& ids,
 
   SongList ret;
   while (q.next()) {
-    Song song;
-    song.InitFromQuery(q, true);
+    Song song = SongFromRow(q);
     ret << song;
   }
   return ret;
@@ -704,12 +891,12 @@ SongList LibraryBackend::GetSongsById(const QStringList& ids,
 Song LibraryBackend::GetSongByUrl(const QUrl& url, qint64 beginning) {
   LibraryQuery query;
   query.SetColumnSpec("%songs_table.ROWID, " + Song::kColumnSpec);
-  query.AddWhere("filename", url.toEncoded());
+  query.AddWhere("filename", DatabaseUrl(url));
   query.AddWhere("beginning", beginning);
 
   Song song;
   if (ExecQuery(&query) && query.Next()) {
-    song.InitFromQuery(query, true);
+    song = SongFromRow(query);
   }
   return song;
 }
@@ -717,13 +904,12 @@ Song LibraryBackend::GetSongByUrl(const QUrl& url, qint64 beginning) {
 SongList LibraryBackend::GetSongsByUrl(const QUrl& url) {
   LibraryQuery query;
   query.SetColumnSpec("%songs_table.ROWID, " + Song::kColumnSpec);
-  query.AddWhere("filename", url.toEncoded());
+  query.AddWhere("filename", DatabaseUrl(url));
 
   SongList songlist;
   if (ExecQuery(&query)) {
     while (query.Next()) {
-      Song song;
-      song.InitFromQuery(query, true);
+      Song song = SongFromRow(query);
 
       songlist << song;
     }
@@ -748,8 +934,7 @@ SongList LibraryBackend::GetCompilationSongs(const QString& album,
 
   SongList ret;
   while (query.Next()) {
-    Song song;
-    song.InitFromQuery(query, true);
+    Song song = SongFromRow(query);
     ret << song;
   }
   return ret;
@@ -851,8 +1036,7 @@ void LibraryBackend::UpdateCompilations(const QSqlDatabase& db,
   find_song.bindValue(":filename", url.toEncoded());
   find_song.exec();
   while (find_song.next()) {
-    Song song;
-    song.InitFromQuery(find_song, true);
+    Song song = SongFromRow(find_song);
     deleted_songs << song;
     song.set_sampler(sampler);
     added_songs << song;
@@ -904,7 +1088,8 @@ LibraryBackend::AlbumList LibraryBackend::GetAlbums(const QString& artist,
     info.album_name = query.Value(0).toString();
     info.art_automatic = query.Value(5).toString();
     info.art_manual = query.Value(6).toString();
-    info.first_url = QUrl::fromEncoded(query.Value(7).toByteArray());
+    info.first_url =
+        AbsoluteUrl(QUrl::fromEncoded(query.Value(7).toByteArray()));
 
     if ((info.artist == last_artist ||
          info.album_artist == last_album_artist) &&
@@ -944,7 +1129,8 @@ LibraryBackend::Album LibraryBackend::GetAlbumArt(const QString& artist,
   if (query.Next()) {
     ret.art_automatic = query.Value(0).toString();
     ret.art_manual = query.Value(1).toString();
-    ret.first_url = QUrl::fromEncoded(query.Value(2).toByteArray());
+    ret.first_url =
+        AbsoluteUrl(QUrl::fromEncoded(query.Value(2).toByteArray()));
   }
 
   return ret;
@@ -982,8 +1168,7 @@ void LibraryBackend::UpdateManualAlbumArt(const QString& artist,
 
   SongList deleted_songs;
   while (query.Next()) {
-    Song song;
-    song.InitFromQuery(query, true);
+    Song song = SongFromRow(query);
     deleted_songs << song;
   }
 
@@ -1015,8 +1200,7 @@ void LibraryBackend::UpdateManualAlbumArt(const QString& artist,
 
   SongList added_songs;
   while (query.Next()) {
-    Song song;
-    song.InitFromQuery(query, true);
+    Song song = SongFromRow(query);
     added_songs << song;
   }
 
@@ -1042,8 +1226,7 @@ void LibraryBackend::ForceCompilation(const QString& album,
     if (!ExecQuery(&query)) return;
 
     while (query.Next()) {
-      Song song;
-      song.InitFromQuery(query, true);
+      Song song = SongFromRow(query);
       deleted_songs << song;
     }
 
@@ -1072,8 +1255,7 @@ void LibraryBackend::ForceCompilation(const QString& album,
     if (!ExecQuery(&query)) return;
 
     while (query.Next()) {
-      Song song;
-      song.InitFromQuery(query, true);
+      Song song = SongFromRow(query);
       added_songs << song;
     }
   }
@@ -1085,10 +1267,12 @@ void LibraryBackend::ForceCompilation(const QString& album,
 }
 
 bool LibraryBackend::ExecQuery(LibraryQuery* q) {
+  TRACE_SPAN("library", "LibraryBackend::ExecQuery");
   return !db_->CheckErrors(q->Exec(db_->Connect(), songs_table_, fts_table_));
 }
 
 SongList LibraryBackend::FindSongs(const smart_playlists::Search& search) {
+  TRACE_SPAN("library", "LibraryBackend::FindSongs");
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
@@ -1104,8 +1288,7 @@ SongList LibraryBackend::FindSongs(const smart_playlists::Search& search) {
 
   // Read the results
   while (query.next()) {
-    Song song;
-    song.InitFromQuery(query, true);
+    Song song = SongFromRow(query);
     ret << song;
   }
   return ret;
@@ -1216,11 +1399,14 @@ void LibraryBackend::DeleteAll() {
     QSqlDatabase db(db_->Connect());
     ScopedTransaction t(&db);
 
-    QSqlQuery q("DELETE FROM " + songs_table_, db);
-    q.exec();
+    // Deleting the FTS rows one by one would make FTS5 read every song back
+    // from the content view.
+    QSqlQuery q(db);
+    q.exec(QString("INSERT INTO %1 (%2) VALUES ('delete-all')")
+               .arg(fts_table_, fts_table_.section('.', -1)));
     if (db_->CheckErrors(q)) return;
 
-    q = QSqlQuery("DELETE FROM " + fts_table_, db);
+    q = QSqlQuery("DELETE FROM " + songs_table_, db);
     q.exec();
     if (db_->CheckErrors(q)) return;
 
@@ -19,6 +19,8 @@
 #define LIBRARYBACKEND_H
 
 #include <QFileInfo>
+#include <QHash>
+#include <QMutex>
 #include <QObject>
 #include <QSet>
 #include <QUrl>
@@ -28,6 +30,8 @@
 #include "libraryquery.h"
 
 class Database;
+class SqlRow;
+class TagCompletionIndex;
 
 namespace smart_playlists {
 class Search;
@@ -137,10 +141,26 @@ class LibraryBackend : public LibraryBackendInterface {
 
   Database* db() const { return db_; }
 
+  // The distinct values of tag columns, for completing them in tag editors.
+  TagCompletionIndex* tag_completion_index() const {
+    return tag_completion_index_;
+  }
+
   QString songs_table() const { return songs_table_; }
   QString dirs_table() const { return dirs_table_; }
   QString subdirs_table() const { return subdirs_table_; }
 
+  // Makes the backend store paths relative to root, and resolve them against
+  // it again when they're read.  Devices use this so their library survives
+  // being mounted somewhere else.  Any absolute paths already stored under a
+  // directory are converted.
+  void SetRootPath(const QString& root);
+  QString root_path() const;
+
+  // Creates a song from a row of songs_table, resolving its path against the
+  // root path if there is one.
+  Song SongFromRow(const SqlRow& row) const;
+
   // Get a list of directories in the library.  Emits DirectoriesDiscovered.
   void LoadDirectoriesAsync();
 
@@ -154,6 +174,8 @@ class LibraryBackend : public LibraryBackendInterface {
 
   QStringList GetAll(const QString& column,
                      const QueryOptions& opt = QueryOptions());
+  // Returns how many songs have each of the values GetAll would return.
+  QHash<QString, int> CountAll(const QString& column);
   QStringList GetAllArtists(const QueryOptions& opt = QueryOptions());
   QStringList GetAllArtistsWithAlbums(const QueryOptions& opt = QueryOptions());
   SongList GetSongsByAlbum(const QString& album,
@@ -257,6 +279,12 @@ class LibraryBackend : public LibraryBackendInterface {
                       const QueryOptions& opt = QueryOptions());
   SubdirectoryList SubdirsInDirectory(int id, QSqlDatabase& db);
 
+  QString AbsolutePath(const QString& path) const;
+  QString RelativePath(const QString& path) const;
+  QUrl AbsoluteUrl(const QUrl& url) const;
+  QByteArray DatabaseUrl(const QUrl& url) const;
+  void MakePathsRelative(QSqlDatabase& db);
+
   Song GetSongById(int id, QSqlDatabase& db);
   SongList GetSongsById(const QStringList& ids, QSqlDatabase& db);
 
@@ -268,6 +296,11 @@ class LibraryBackend : public LibraryBackendInterface {
   QString fts_table_;
   bool save_statistics_in_file_;
   bool save_ratings_in_file_;
+
+  mutable QMutex root_path_mutex_;
+  QString root_path_;
+
+  TagCompletionIndex* tag_completion_index_;
 };
 
 #endif  // LIBRARYBACKEND_H
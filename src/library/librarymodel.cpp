@@ -26,7 +26,6 @@
 #include <QSettings>
 #include <QStringList>
 #include <QUrl>
-#include <QtConcurrentRun>
 #include <algorithm>
 #include <functional>
 
@@ -85,7 +84,7 @@ LibraryModel::LibraryModel(std::shared_ptr<LibraryBackend> backend,
       playlists_dir_icon_(IconLoader::Load("folder-sound", IconLoader::Base)),
       playlist_icon_(IconLoader::Load("x-clementine-albums", IconLoader::Base)),
       icon_cache_(new QNetworkDiskCache(this)),
-      thread_pool_(this),
+      work_queue_(WorkScheduler::Priority_Interactive),
       init_task_id_(-1),
       use_pretty_covers_(false),
       show_dividers_(true) {
@@ -127,7 +126,7 @@ LibraryModel::LibraryModel(std::shared_ptr<LibraryBackend> backend,
 }
 
 LibraryModel::~LibraryModel() {
-  thread_pool_.waitForDone();
+  work_queue_.WaitForDone();
   delete root_;
 }
 
@@ -683,45 +682,57 @@ QVariant LibraryModel::data(const LibraryItem* item, int role) const {
   return QVariant();
 }
 
-bool LibraryModel::HasCompilations(const LibraryQuery& query) {
-  LibraryQuery q = query;
-  q.AddCompilationRequirement(true);
-  q.SetLimit(1);
-
+bool LibraryModel::HasCompilations(LibraryQuery* query) {
   QMutexLocker l(backend_->db()->Mutex());
-  if (!backend_->ExecQuery(&q)) return false;
+  if (!backend_->ExecQuery(query)) return false;
 
-  return q.Next();
+  return query->Next();
 }
 
-LibraryModel::QueryResult LibraryModel::RunQuery(LibraryItem* parent) {
-  QueryResult result;
-
+LibraryModel::GroupBy LibraryModel::BuildQuery(const Grouping& group_by,
+                                               LibraryItem* parent,
+                                               LibraryQuery* q,
+                                               LibraryQuery* va_query) {
   // Information about what we want the children to be
-  int child_level = parent == root_ ? 0 : parent->container_level + 1;
-  GroupBy child_type = child_level >= 3 ? GroupBy_None : group_by_[child_level];
+  int child_level =
+      parent->type == LibraryItem::Type_Root ? 0 : parent->container_level + 1;
+  GroupBy child_type = child_level >= 3 ? GroupBy_None : group_by[child_level];
 
   // Initialise the query.  child_type says what type of thing we want (artists,
   // songs, etc.)
-  LibraryQuery q(query_options_);
-  InitQuery(child_type, &q);
+  InitQuery(child_type, q);
 
   // Walk up through the item's parents adding filters as necessary
   LibraryItem* p = parent;
   while (p && p->type == LibraryItem::Type_Container) {
-    FilterQuery(group_by_[p->container_level], p, &q);
+    FilterQuery(group_by[p->container_level], p, q);
     p = p->parent;
   }
 
   // Artists GroupBy is special - we don't want compilation albums appearing
   if (IsArtistGroupBy(child_type)) {
-    // Add the special Various artists node
-    if (show_various_artists_ && HasCompilations(q)) {
-      result.create_va = true;
-    }
+    *va_query = *q;
+    va_query->AddCompilationRequirement(true);
+    va_query->SetLimit(1);
 
     // Don't show compilations again outside the Various artists node
-    q.AddCompilationRequirement(false);
+    q->AddCompilationRequirement(false);
+  }
+
+  return child_type;
+}
+
+LibraryModel::QueryResult LibraryModel::RunQuery(LibraryItem* parent) {
+  QueryResult result;
+
+  LibraryQuery q(query_options_);
+  LibraryQuery va_query(query_options_);
+  const GroupBy child_type = BuildQuery(group_by_, parent, &q, &va_query);
+
+  // Add the special Various artists node
+  if (IsArtistGroupBy(child_type) && show_various_artists_ &&
+      HasCompilations(&va_query)) {
+    result.create_va = true;
   }
 
   // Execute the query
@@ -769,7 +780,8 @@ void LibraryModel::LazyPopulate(LibraryItem* parent, bool signal) {
 
 void LibraryModel::ResetAsync() {
   QFuture<LibraryModel::QueryResult> future =
-      QtConcurrent::run(&thread_pool_, this, &LibraryModel::RunQuery, root_);
+      work_queue_.Run<LibraryModel::QueryResult>(
+          std::bind(&LibraryModel::RunQuery, this, root_));
   NewClosure(future, this,
              SLOT(ResetAsyncQueryFinished(QFuture<LibraryModel::QueryResult>)),
              future);
@@ -1042,7 +1054,7 @@ LibraryItem* LibraryModel::ItemFromQuery(GroupBy type, bool signal,
       break;
 
     case GroupBy_None:
-      item->metadata.InitFromQuery(row, true);
+      item->metadata = backend_->SongFromRow(row);
       item->key = item->metadata.title();
       item->display_text = item->metadata.TitleWithCompilationArtist();
       item->sort_text = SortTextForSong(item->metadata);
@@ -21,11 +21,11 @@
 #include <QAbstractItemModel>
 #include <QIcon>
 #include <QNetworkDiskCache>
-#include <QThreadPool>
 #include <memory>
 
 #include "core/simpletreemodel.h"
 #include "core/song.h"
+#include "core/workscheduler.h"
 #include "covers/albumcoverloaderoptions.h"
 #include "engines/engine_fwd.h"
 #include "libraryitem.h"
@@ -166,6 +166,12 @@ class LibraryModel : public SimpleTreeModel<LibraryItem> {
   // Save the current grouping
   void SaveGrouping(QString name);
 
+  // Builds the query that gets the children of parent, and returns their type.
+  // If they're artists, va_query is set to a query that finds whether there
+  // should be a Various artists node.
+  static GroupBy BuildQuery(const Grouping& group_by, LibraryItem* parent,
+                            LibraryQuery* q, LibraryQuery* va_query);
+
   // Utility functions for manipulating text
   static QString TextOrUnknown(const QString& text);
   static QString PrettyYearAlbum(int year, const QString& album);
@@ -212,7 +218,7 @@ class LibraryModel : public SimpleTreeModel<LibraryItem> {
   QueryResult RunQuery(LibraryItem* parent);
   void PostQuery(LibraryItem* parent, const QueryResult& result, bool signal);
 
-  bool HasCompilations(const LibraryQuery& query);
+  bool HasCompilations(LibraryQuery* query);
 
   void BeginReset();
 
@@ -222,7 +228,7 @@ class LibraryModel : public SimpleTreeModel<LibraryItem> {
   // for each parent item, restricting the songs returned to a particular
   // album or artist for example.
   static void InitQuery(GroupBy type, LibraryQuery* q);
-  void FilterQuery(GroupBy type, LibraryItem* item, LibraryQuery* q);
+  static void FilterQuery(GroupBy type, LibraryItem* item, LibraryQuery* q);
 
   // Items can be created either from a query that's been run to populate a
   // node, or by a spontaneous SongsDiscovered emission from the backend.
@@ -291,7 +297,7 @@ class LibraryModel : public SimpleTreeModel<LibraryItem> {
 
   QNetworkDiskCache* icon_cache_;
 
-  QThreadPool thread_pool_;
+  WorkQueue work_queue_;
 
   int init_task_id_;
 
@@ -54,14 +54,45 @@ const QMap<QString, Song::FileType> kFiletypeId = QMap<QString, Song::FileType>(
 
 const QString kAllowedChars = "smhd";
 
+namespace {
+
+// Turns some text from the filter box into prefix terms for an FTS MATCH,
+// optionally restricted to one column.  Anything that isn't a letter or a
+// number is a separator for the tokenizer anyway, and taking it out here means
+// the query is never mistaken for FTS syntax.  The terms are lowercased so
+// words like "and" or "not" aren't treated as operators.
+QString FtsTerms(const QString& text, const QString& column = QString()) {
+  QString ret;
+  QString term;
+  for (int i = 0; i <= text.length(); ++i) {
+    if (i < text.length() && text[i].isLetterOrNumber()) {
+      term.append(text[i]);
+      continue;
+    }
+
+    if (!term.isEmpty()) {
+      if (!column.isEmpty()) ret += column + ":";
+      ret += term.toLower() + "* ";
+      term.clear();
+    }
+  }
+  return ret;
+}
+
+}  // namespace
+
 LibraryQuery::LibraryQuery(const QueryOptions& options)
-    : include_unavailable_(false), join_with_fts_(false), limit_(-1) {
+    : include_unavailable_(false),
+      join_with_fts_(false),
+      order_by_rank_(false),
+      limit_(-1) {
   if (!options.filter().isEmpty()) {
     // We need to munge the filter text a little bit to get it to work as
-    // expected with sqlite's FTS3:
+    // expected with sqlite's FTS:
     //  1) Append * to all tokens.
     //  2) Prefix "fts" to column names.
     //  3) Remove colons which don't correspond to column names.
+    //  4) Split tokens on punctuation, like the tokenizer does.
     //
     // We also allow to search on non-FTS columns, but FTS columns
     // are higher priority. Non-FTS query parts go to where_clauses
@@ -70,12 +101,9 @@ LibraryQuery::LibraryQuery(const QueryOptions& options)
     QStringList tokens(
         options.filter().split(QRegExp("\\s+"), QString::SkipEmptyParts));
     QString query;
+    // Whether any of the filter was meant to be searched for as text.
+    bool text_filter = false;
     for (QString token : tokens) {
-      token.remove('(');
-      token.remove(')');
-      token.remove('"');
-      token.replace('-', ' ');
-
       if (token.contains(':')) {
         QString columntoken = token.section(':', 0, 0);
         QString subtoken = token.section(':', 1, -1);
@@ -85,7 +113,8 @@ LibraryQuery::LibraryQuery(const QueryOptions& options)
         if (Song::kFtsColumns.contains(
                 "fts" + columntoken,
                 Qt::CaseInsensitive)) {  // Is it a FTS column?
-          query += "fts" + columntoken + ":" + subtoken + "* ";
+          query += FtsTerms(subtoken, "fts" + columntoken.toLower());
+          text_filter = true;
         } else if (Song::kColumns.contains(columntoken, Qt::CaseInsensitive)) {
           // We need to extract the operator and the value from the subtoken
           QRegExp operatorRe("^(" + kNumericCompOperators.join("|") + ")(.*)");
@@ -127,12 +156,12 @@ LibraryQuery::LibraryQuery(const QueryOptions& options)
             AddWhere(columntoken, val, op);
           }
         } else {  // We did't recognize this as a column
-          token.replace(":", " ");
-          token = token.trimmed();
-          query += token + "* ";
+          query += FtsTerms(token);
+          text_filter = true;
         }
       } else {
-        query += token + "* ";
+        query += FtsTerms(token);
+        text_filter = true;
       }
     }
 
@@ -140,6 +169,9 @@ LibraryQuery::LibraryQuery(const QueryOptions& options)
       where_clauses_ << "fts.%fts_table_noprefix MATCH ?";
       bound_values_ << query;
       join_with_fts_ = true;
+    } else if (text_filter) {
+      // Text with no letters or numbers in it can't match anything.
+      where_clauses_ << "0";
     }
   }
 
@@ -166,6 +198,11 @@ LibraryQuery::LibraryQuery(const QueryOptions& options)
   if (options.query_mode() == QueryOptions::QueryMode_Untagged) {
     where_clauses_ << "(artist = '' OR album = '' OR title ='')";
   }
+
+  if (options.query_mode() == QueryOptions::QueryMode_AudioDuplicates) {
+    where_clauses_
+        << "%songs_table.ROWID IN (SELECT song_id FROM audio_duplicates)";
+  }
 }
 
 int LibraryQuery::GetSecondsFromToken(QString& val) const {
@@ -253,12 +290,19 @@ QSqlQuery LibraryQuery::Exec(QSqlDatabase db, const QString& songs_table,
 
   QStringList where_clauses(where_clauses_);
   if (!include_unavailable_) {
-    where_clauses << "unavailable = 0";
+    // Every index for the library's groupings starts with unavailable.  When
+    // there's a filter the unary + stops sqlite walking all the available
+    // songs through one of them, instead of starting from the FTS matches.
+    where_clauses << (join_with_fts_ ? "+unavailable = 0" : "unavailable = 0");
   }
 
   if (!where_clauses.isEmpty()) sql += " WHERE " + where_clauses.join(" AND ");
 
-  if (!order_by_.isEmpty()) sql += " ORDER BY " + order_by_;
+  if (order_by_rank_ && join_with_fts_) {
+    sql += " ORDER BY fts.rank";
+  } else if (!order_by_.isEmpty()) {
+    sql += " ORDER BY " + order_by_;
+  }
 
   if (limit_ != -1) sql += " LIMIT " + QString::number(limit_);
 
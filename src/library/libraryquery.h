@@ -36,9 +36,16 @@ struct QueryOptions {
   //   in the songs table
   // - use the untagged songs view; by untagged we mean those for which
   //   at least one of the (artist, album, title) tags is empty
+  // - use the songs that sound the same as another song, according to their
+  //   fingerprints (see FingerprintStore)
   // Please note that additional filtering based on fts table (the filter
-  // attribute) won't work in Duplicates and Untagged modes.
-  enum QueryMode { QueryMode_All, QueryMode_Duplicates, QueryMode_Untagged };
+  // attribute) won't work in Duplicates, Untagged and AudioDuplicates modes.
+  enum QueryMode {
+    QueryMode_All,
+    QueryMode_Duplicates,
+    QueryMode_Untagged,
+    QueryMode_AudioDuplicates
+  };
 
   QueryOptions();
 
@@ -73,6 +80,10 @@ class LibraryQuery {
   void SetColumnSpec(const QString& spec) { column_spec_ = spec; }
   // Sets an ORDER BY clause on the query.
   void SetOrderBy(const QString& order_by) { order_by_ = order_by; }
+  // Orders the results by how well they match the filter text instead, best
+  // first.  Only works on FTS5 tables, and does nothing if there's no filter
+  // text.
+  void SetOrderByRank(bool order_by_rank) { order_by_rank_ = order_by_rank; }
 
   // Adds a fragment of WHERE clause. When executed, this Query will connect all
   // the fragments with AND operator.
@@ -101,6 +112,7 @@ class LibraryQuery {
 
   bool include_unavailable_;
   bool join_with_fts_;
+  bool order_by_rank_;
   QString column_spec_;
   QString order_by_;
   QStringList where_clauses_;
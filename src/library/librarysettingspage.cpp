@@ -21,10 +21,11 @@
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QSettings>
-#include <QtConcurrentRun>
+#include <functional>
 
 #include "core/application.h"
 #include "core/utilities.h"
+#include "core/workscheduler.h"
 #include "librarybackend.h"
 #include "librarydirectorymodel.h"
 #include "librarymodel.h"
@@ -165,6 +166,8 @@ void LibrarySettingsPage::WriteAllSongsStatisticsToFiles() {
   if (confirmation_dialog.exec() != QMessageBox::Yes) {
     return;
   }
-  QtConcurrent::run(dialog()->app()->library(),
-                    &Library::WriteAllSongsStatisticsToFiles);
+  WorkScheduler::Instance()->Run<void>(
+      WorkScheduler::Priority_Idle,
+      std::bind(&Library::WriteAllSongsStatisticsToFiles,
+                dialog()->app()->library()));
 }
@@ -32,8 +32,9 @@
 
 #include "core/filesystemwatcherinterface.h"
 #include "core/logging.h"
-#include "core/tagreaderclient.h"
+#include "core/tagreaderbatcher.h"
 #include "core/taskmanager.h"
+#include "core/tracing.h"
 #include "core/utilities.h"
 #include "librarybackend.h"
 #include "playlistparsers/cueparser.h"
@@ -264,6 +265,7 @@ void LibraryWatcher::ScanSubdirectory(const QString& path,
                                       const Subdirectory& subdir,
                                       ScanTransaction* t,
                                       bool force_noincremental) {
+  TRACE_SPAN("library", "LibraryWatcher::ScanSubdirectory");
   QFileInfo path_info(path);
   QDir path_dir(path);
 
@@ -348,6 +350,11 @@ void LibraryWatcher::ScanSubdirectory(const QString& path,
 
   QSet<QString> cues_processed;
 
+  // Files whose tags need reading are sent to the tag reader in batches while
+  // we carry on looking at the rest of the directory.
+  TagReaderBatcher tag_reader_batcher;
+  QList<PendingRead> pending_reads;
+
   // Now compare the list from the database with the list of files on disk
   for (const QString& file : files_on_disk) {
     if (t->aborted()) return;
@@ -402,8 +409,13 @@ void LibraryWatcher::ScanSubdirectory(const QString& path,
           UpdateCueAssociatedSongs(file, path, matching_cue, image, t);
           // if no cue or it's about to lose it...
         } else {
-          UpdateNonCueAssociatedSong(file, matching_song, image, cue_deleted,
-                                     t);
+          PendingRead read;
+          read.file = file;
+          read.matching_song = matching_song;
+          read.image = image;
+          read.cue_deleted = cue_deleted;
+          pending_reads << read;
+          tag_reader_batcher.Add(file);
         }
       }
 
@@ -412,23 +424,51 @@ void LibraryWatcher::ScanSubdirectory(const QString& path,
 
     } else {
       // The song is on disk but not in the DB
-      SongList song_list =
-          ScanNewFile(file, path, matching_cue, &cues_processed);
-
-      if (song_list.isEmpty()) {
-        continue;
+      PendingRead read;
+      read.file = file;
+      read.new_file = true;
+
+      // if it's a cue - create virtual tracks
+      if (GetMtimeForCue(matching_cue)) {
+        read.matching_cue = matching_cue;
+        read.cue_songs = CueSectionsForFile(file, path, matching_cue);
+        if (read.cue_songs.isEmpty()) continue;
       }
 
-      qLog(Debug) << file << "created";
-      // choose an image for the song(s)
-      QString image = ImageForSong(file, &album_art, t);
+      pending_reads << read;
+      tag_reader_batcher.Add(file);
+    }
+  }
 
-      for (Song song : song_list) {
-        song.set_directory_id(t->dir_id());
-        if (song.art_automatic().isEmpty()) song.set_art_automatic(image);
+  if (t->aborted()) return;
 
-        t->new_songs << song;
-      }
+  // Now wait for the tags of the new and changed files
+  SongList songs_on_disk = tag_reader_batcher.Finish();
+  for (int i = 0; i < pending_reads.count(); ++i) {
+    const PendingRead& read = pending_reads[i];
+
+    if (!read.new_file) {
+      UpdateNonCueAssociatedSong(read.file, read.matching_song,
+                                 songs_on_disk[i], read.image,
+                                 read.cue_deleted, t);
+      continue;
+    }
+
+    SongList song_list = ScanNewFile(read, songs_on_disk[i], &cues_processed);
+
+    if (song_list.isEmpty()) {
+      continue;
+    }
+
+    qLog(Debug) << read.file << "created";
+    // choose an image for the song(s)
+    QString image = ImageForSong(read.file, &album_art, t);
+
+    for (Song song : song_list) {
+      song.set_directory_id(t->dir_id());
+      if (song.art_automatic().isEmpty()) song.set_art_automatic(image);
+
+      t->new_songs << song;
     }
   }
 
@@ -510,6 +550,7 @@ void LibraryWatcher::UpdateCueAssociatedSongs(const QString& file,
 
 void LibraryWatcher::UpdateNonCueAssociatedSong(const QString& file,
                                                 const Song& matching_song,
+                                                const Song& song_on_disk,
                                                 const QString& image,
                                                 bool cue_deleted,
                                                 ScanTransaction* t) {
@@ -525,54 +566,53 @@ void LibraryWatcher::UpdateNonCueAssociatedSong(const QString& file,
     }
   }
 
-  Song song_on_disk;
-  song_on_disk.set_directory_id(t->dir_id());
-  TagReaderClient::Instance()->ReadFileBlocking(file, &song_on_disk);
-
   if (song_on_disk.is_valid()) {
-    PreserveUserSetData(file, image, matching_song, &song_on_disk, t);
+    Song song(song_on_disk);
+    song.set_directory_id(t->dir_id());
+    PreserveUserSetData(file, image, matching_song, &song, t);
   }
 }
 
-SongList LibraryWatcher::ScanNewFile(const QString& file, const QString& path,
-                                     const QString& matching_cue,
-                                     QSet<QString>* cues_processed) {
+SongList LibraryWatcher::CueSectionsForFile(const QString& file,
+                                            const QString& path,
+                                            const QString& matching_cue) {
   SongList song_list;
 
-  uint matching_cue_mtime = GetMtimeForCue(matching_cue);
-  // if it's a cue - create virtual tracks
-  if (matching_cue_mtime) {
-    // don't process the same cue many times
-    if (cues_processed->contains(matching_cue)) return song_list;
-
-    QFile cue(matching_cue);
-    cue.open(QIODevice::ReadOnly);
-
-    // Ignore FILEs pointing to other media files. Also, watch out for incorrect
-    // media files. Playlist parser for CUEs considers every entry in sheet
-    // valid and we don't want invalid media getting into library!
-    QString file_nfd = file.normalized(QString::NormalizationForm_D);
-    for (const Song& cue_song : cue_parser_->Load(&cue, matching_cue, path)) {
-      if (cue_song.url().toLocalFile().normalized(
-              QString::NormalizationForm_D) == file_nfd) {
-        if (TagReaderClient::Instance()->IsMediaFileBlocking(file)) {
-          song_list << cue_song;
-        }
-      }
-    }
+  QFile cue(matching_cue);
+  cue.open(QIODevice::ReadOnly);
 
-    if (!song_list.isEmpty()) {
-      *cues_processed << matching_cue;
+  // Ignore FILEs pointing to other media files.
+  QString file_nfd = file.normalized(QString::NormalizationForm_D);
+  for (const Song& cue_song : cue_parser_->Load(&cue, matching_cue, path)) {
+    if (cue_song.url().toLocalFile().normalized(QString::NormalizationForm_D) ==
+        file_nfd) {
+      song_list << cue_song;
     }
+  }
 
-    // it's a normal media file
-  } else {
-    Song song;
-    TagReaderClient::Instance()->ReadFileBlocking(file, &song);
+  return song_list;
+}
 
-    if (song.is_valid()) {
-      song_list << song;
+SongList LibraryWatcher::ScanNewFile(const PendingRead& read,
+                                     const Song& song_on_disk,
+                                     QSet<QString>* cues_processed) {
+  SongList song_list;
+
+  if (!read.matching_cue.isEmpty()) {
+    // don't process the same cue many times
+    if (cues_processed->contains(read.matching_cue)) return song_list;
+
+    // Watch out for incorrect media files. Playlist parser for CUEs considers
+    // every entry in sheet valid and we don't want invalid media getting into
+    // library!
+    if (song_on_disk.is_valid()) {
+      song_list = read.cue_songs;
+      *cues_processed << read.matching_cue;
     }
+
+    // it's a normal media file
+  } else if (song_on_disk.is_valid()) {
+    song_list << song_on_disk;
   }
 
   return song_list;
@@ -866,6 +906,12 @@ void LibraryWatcher::SetRescanPaused(bool pause) {
   if (!rescan_paused_ && !rescan_queue_.isEmpty()) RescanPathsNow();
 }
 
+void LibraryWatcher::DisableStartupScanAsync() {
+  QMetaObject::invokeMethod(this, "DisableStartupScan", Qt::QueuedConnection);
+}
+
+void LibraryWatcher::DisableStartupScan() { scan_on_startup_ = false; }
+
 void LibraryWatcher::IncrementalScanAsync() {
   QMetaObject::invokeMethod(this, "IncrementalScanNow", Qt::QueuedConnection);
 }
@@ -50,10 +50,11 @@ class LibraryWatcher : public QObject {
   void set_device_name(const QString& device_name) {
     device_name_ = device_name;
   }
-
   void IncrementalScanAsync();
   void FullScanAsync();
   void SetRescanPausedAsync(bool pause);
+  // Skips the scan of directories added after this, whatever the settings say.
+  void DisableStartupScanAsync();
   void ReloadSettingsAsync();
   // This thread-safe method will cause a scan of this directory to cancel to
   // unblock the watcher thread. It will then invoke the DoRemoveDirectory on
@@ -79,6 +80,7 @@ class LibraryWatcher : public QObject {
   void ReloadSettings();
   void AddDirectory(const Directory& dir, const SubdirectoryList& subdirs);
   void SetRescanPaused(bool pause);
+  void DisableStartupScan();
 
  private:
   class WatchedDir : public Directory {
@@ -178,6 +180,25 @@ class LibraryWatcher : public QObject {
   uint GetMtimeForCue(const QString& cue_path);
   void PerformScan(bool incremental, bool ignore_mtimes);
 
+  // A file whose tags are being read, along with the rest of the files in its
+  // directory, by a TagReaderBatcher.
+  struct PendingRead {
+    PendingRead() : new_file(false), cue_deleted(false) {}
+
+    QString file;
+    bool new_file;
+
+    // For files that are already in the library.
+    Song matching_song;
+    QString image;
+    bool cue_deleted;
+
+    // For new files that have a cue sheet: the sections of the cue that are in
+    // this file.
+    QString matching_cue;
+    SongList cue_songs;
+  };
+
   // Updates the sections of a cue associated and altered (according to mtime)
   // media file during a scan.
   void UpdateCueAssociatedSongs(const QString& file, const QString& path,
@@ -187,6 +208,7 @@ class LibraryWatcher : public QObject {
   // during a scan.
   void UpdateNonCueAssociatedSong(const QString& file,
                                   const Song& matching_song,
+                                  const Song& song_on_disk,
                                   const QString& image, bool cue_deleted,
                                   ScanTransaction* t);
   // Updates a new song with some metadata taken from it's equivalent old
@@ -194,12 +216,14 @@ class LibraryWatcher : public QObject {
   void PreserveUserSetData(const QString& file, const QString& image,
                            const Song& matching_song, Song* out,
                            ScanTransaction* t);
+  // Returns the sections of a cue sheet that are in the given media file.
+  SongList CueSectionsForFile(const QString& file, const QString& path,
+                              const QString& matching_cue);
   // Scans a single media file that's present on the disk but not yet in the
-  // library.
+  // library, once its tags have been read.
   // It may result in a multiple files added to the library when the media file
   // has many sections (like a CUE related media file).
-  SongList ScanNewFile(const QString& file, const QString& path,
-                       const QString& matching_cue,
+  SongList ScanNewFile(const PendingRead& read, const Song& song_on_disk,
                        QSet<QString>* cues_processed);
 
  private:
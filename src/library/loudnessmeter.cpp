@@ -0,0 +1,162 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "loudnessmeter.h"
+
+#include <cmath>
+
+#include <QtGlobal>
+
+const double LoudnessMeter::kReferenceLoudness = -18.0;
+
+namespace {
+
+// Blocks quieter than this never count.
+const double kAbsoluteGate = -70.0;
+// Blocks this much quieter than the mean of the louder blocks don't count.
+const double kRelativeGate = -10.0;
+
+double BlockLoudness(double mean_square) {
+  return -0.691 + 10.0 * std::log10(mean_square);
+}
+
+double BlockMeanSquare(double lufs) {
+  return std::pow(10.0, (lufs + 0.691) / 10.0);
+}
+
+}  // namespace
+
+LoudnessMeter::LoudnessMeter(int sample_rate, int channels)
+    : channels_(channels),
+      weight_(channels == 1 ? 2.0 : 1.0),
+      shelf_(HighShelf(sample_rate)),
+      high_pass_(HighPass(sample_rate)),
+      state_(channels * 4, 0.0),
+      step_frames_(qMax(1, qRound(sample_rate / 10.0))),
+      step_position_(0),
+      step_sum_(0.0),
+      steps_seen_(0),
+      peak_(0.0f) {
+  for (double& step : steps_) step = 0.0;
+}
+
+// The filter coefficients for any sample rate, worked out from the ones given
+// for 48kHz in BS.1770.
+LoudnessMeter::Biquad LoudnessMeter::HighShelf(int sample_rate) {
+  const double f0 = 1681.974450955533;
+  const double gain_db = 3.999843853973347;
+  const double q = 0.7071752369554196;
+
+  const double k = std::tan(M_PI * f0 / sample_rate);
+  const double vh = std::pow(10.0, gain_db / 20.0);
+  const double vb = std::pow(vh, 0.4996667741545416);
+  const double a0 = 1.0 + k / q + k * k;
+
+  Biquad ret;
+  ret.b0 = (vh + vb * k / q + k * k) / a0;
+  ret.b1 = 2.0 * (k * k - vh) / a0;
+  ret.b2 = (vh - vb * k / q + k * k) / a0;
+  ret.a1 = 2.0 * (k * k - 1.0) / a0;
+  ret.a2 = (1.0 - k / q + k * k) / a0;
+  return ret;
+}
+
+LoudnessMeter::Biquad LoudnessMeter::HighPass(int sample_rate) {
+  const double f0 = 38.13547087602444;
+  const double q = 0.5003270373238773;
+
+  const double k = std::tan(M_PI * f0 / sample_rate);
+  const double a0 = 1.0 + k / q + k * k;
+
+  Biquad ret;
+  ret.b0 = 1.0;
+  ret.b1 = -2.0;
+  ret.b2 = 1.0;
+  ret.a1 = 2.0 * (k * k - 1.0) / a0;
+  ret.a2 = (1.0 - k / q + k * k) / a0;
+  return ret;
+}
+
+double LoudnessMeter::Filter(const Biquad& f, double x, double* z) {
+  const double y = f.b0 * x + z[0];
+  z[0] = f.b1 * x - f.a1 * y + z[1];
+  z[1] = f.b2 * x - f.a2 * y;
+  return y;
+}
+
+void LoudnessMeter::Process(const float* samples, int frames) {
+  double* state = state_.data();
+
+  for (int i = 0; i < frames; ++i) {
+    double sum = 0.0;
+    for (int c = 0; c < channels_; ++c) {
+      const float sample = *samples++;
+      peak_ = qMax(peak_, std::fabs(sample));
+
+      double y = Filter(shelf_, sample, state + c * 4);
+      y = Filter(high_pass_, y, state + c * 4 + 2);
+      sum += y * y;
+    }
+    step_sum_ += sum * weight_;
+
+    if (++step_position_ < step_frames_) continue;
+
+    steps_[steps_seen_ % 4] = step_sum_;
+    step_sum_ = 0.0;
+    step_position_ = 0;
+
+    if (++steps_seen_ >= 4) {
+      blocks_ << (steps_[0] + steps_[1] + steps_[2] + steps_[3]) /
+                     (4 * step_frames_);
+    }
+  }
+}
+
+bool LoudnessMeter::IntegratedLoudness(double* lufs) const {
+  return IntegratedLoudness(blocks_, lufs);
+}
+
+bool LoudnessMeter::IntegratedLoudness(const QVector<double>& blocks,
+                                       double* lufs) {
+  const double absolute_gate = BlockMeanSquare(kAbsoluteGate);
+
+  double sum = 0.0;
+  int count = 0;
+  for (double block : blocks) {
+    if (block > absolute_gate) {
+      sum += block;
+      count++;
+    }
+  }
+  if (count == 0) return false;
+
+  const double relative_gate =
+      BlockMeanSquare(BlockLoudness(sum / count) + kRelativeGate);
+
+  sum = 0.0;
+  count = 0;
+  for (double block : blocks) {
+    if (block > absolute_gate && block > relative_gate) {
+      sum += block;
+      count++;
+    }
+  }
+  if (count == 0) return false;
+
+  *lufs = BlockLoudness(sum / count);
+  return true;
+}
@@ -0,0 +1,84 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef LIBRARY_LOUDNESSMETER_H_
+#define LIBRARY_LOUDNESSMETER_H_
+
+#include <QVector>
+
+// Measures the integrated loudness of some audio as described by EBU R128
+// (ITU-R BS.1770), and its sample peak.
+//
+// The audio is K-weighted, and its mean square is taken over 400ms blocks that
+// overlap by 300ms.  The loudness is the mean of the blocks that are louder
+// than -70 LUFS and not more than 10 LU quieter than the rest.  The blocks are
+// kept, so the loudness of a whole album can be found by gating the blocks of
+// all its tracks together.
+class LoudnessMeter {
+ public:
+  // Mono audio is counted twice, as if it was played on both speakers.  Every
+  // other channel is weighted the same, so anything with more than two should
+  // be downmixed first.
+  LoudnessMeter(int sample_rate, int channels);
+
+  // The ReplayGain 2.0 reference level.
+  static const double kReferenceLoudness;
+
+  // Takes interleaved samples.
+  void Process(const float* samples, int frames);
+
+  float sample_peak() const { return peak_; }
+  const QVector<double>& blocks() const { return blocks_; }
+
+  // Returns the loudness in LUFS, or false if it was all too quiet to have
+  // one.
+  bool IntegratedLoudness(double* lufs) const;
+  static bool IntegratedLoudness(const QVector<double>& blocks, double* lufs);
+
+  // The gain that brings audio of this loudness to kReferenceLoudness.
+  static double Gain(double lufs) { return kReferenceLoudness - lufs; }
+
+ private:
+  struct Biquad {
+    double b0, b1, b2, a1, a2;
+  };
+
+  static Biquad HighShelf(int sample_rate);
+  static Biquad HighPass(int sample_rate);
+
+  // Runs one sample through a filter, with its state in z.
+  static double Filter(const Biquad& f, double x, double* z);
+
+  int channels_;
+  double weight_;
+  Biquad shelf_;
+  Biquad high_pass_;
+  // Two values per filter per channel.
+  QVector<double> state_;
+
+  int step_frames_;
+  int step_position_;
+  double step_sum_;
+  // The sums of the last four 100ms steps.
+  double steps_[4];
+  int steps_seen_;
+
+  float peak_;
+  QVector<double> blocks_;
+};
+
+#endif  // LIBRARY_LOUDNESSMETER_H_
@@ -0,0 +1,421 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "replaygainscanner.h"
+
+#include <gst/app/gstappsink.h>
+#include <gst/audio/audio.h>
+#include <gst/gst.h>
+
+#include <QCoreApplication>
+#include <QMap>
+#include <QMutexLocker>
+#include <QSqlQuery>
+#include <QThread>
+#include <cstring>
+#include <functional>
+
+#include "core/database.h"
+#include "core/logging.h"
+#include "core/scopedtransaction.h"
+#include "core/signalchecker.h"
+#include "core/taskmanager.h"
+#include "loudnessmeter.h"
+
+const int ReplayGainScanner::kPollMsec = 200;
+
+namespace {
+
+struct Decoder {
+  Decoder() : convert(nullptr), channels(0) {}
+
+  GstElement* convert;
+  int channels;
+  std::unique_ptr<LoudnessMeter> meter;
+};
+
+GstElement* CreateElement(const char* factory_name, GstElement* bin) {
+  GstElement* ret = gst_element_factory_make(factory_name, factory_name);
+  if (!ret) {
+    qLog(Warning) << "Couldn't create the gstreamer element" << factory_name;
+    return nullptr;
+  }
+
+  gst_bin_add(GST_BIN(bin), ret);
+  return ret;
+}
+
+void NewPadCallback(GstElement*, GstPad* pad, gpointer data) {
+  Decoder* decoder = reinterpret_cast<Decoder*>(data);
+  GstPad* const audiopad = gst_element_get_static_pad(decoder->convert, "sink");
+
+  if (!GST_PAD_IS_LINKED(audiopad)) {
+    gst_pad_link(pad, audiopad);
+  }
+  gst_object_unref(audiopad);
+}
+
+GstFlowReturn NewSampleCallback(GstAppSink* app_sink, gpointer data) {
+  Decoder* decoder = reinterpret_cast<Decoder*>(data);
+
+  GstSample* sample = gst_app_sink_pull_sample(app_sink);
+  if (!sample) return GST_FLOW_ERROR;
+
+  if (!decoder->meter) {
+    GstAudioInfo info;
+    if (!gst_audio_info_from_caps(&info, gst_sample_get_caps(sample))) {
+      gst_sample_unref(sample);
+      return GST_FLOW_ERROR;
+    }
+    decoder->channels = GST_AUDIO_INFO_CHANNELS(&info);
+    decoder->meter.reset(
+        new LoudnessMeter(GST_AUDIO_INFO_RATE(&info), decoder->channels));
+  }
+
+  GstBuffer* buffer = gst_sample_get_buffer(sample);
+  GstMapInfo map;
+  if (buffer && gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+    decoder->meter->Process(reinterpret_cast<const float*>(map.data),
+                            map.size / (sizeof(float) * decoder->channels));
+    gst_buffer_unmap(buffer, &map);
+  }
+  gst_sample_unref(sample);
+
+  return GST_FLOW_OK;
+}
+
+}  // namespace
+
+ReplayGainScanner::ReplayGainScanner(Database* db, TaskManager* task_manager,
+                                     QObject* parent)
+    : QObject(parent),
+      db_(db),
+      task_manager_(task_manager),
+      find_queue_(WorkScheduler::Priority_Idle, 1),
+      album_queue_(WorkScheduler::Priority_Idle),
+      analysing_(false),
+      abort_(0),
+      task_id_(-1),
+      albums_left_(0) {
+  connect(task_manager_, SIGNAL(TasksChanged()), SLOT(TasksChanged()));
+}
+
+ReplayGainScanner::~ReplayGainScanner() {
+  abort_ = 1;
+  find_queue_.WaitForDone();
+  album_queue_.WaitForDone();
+
+  if (albums_left_) task_manager_->SetTaskFinished(task_id_);
+}
+
+void ReplayGainScanner::AnalyseLibraryAsync() {
+  if (analysing_) return;
+  analysing_ = true;
+
+  find_queue_.Run<void>(std::bind(&ReplayGainScanner::AnalyseLibrary, this));
+}
+
+void ReplayGainScanner::AnalyseLibraryFinished() { analysing_ = false; }
+
+void ReplayGainScanner::AnalyseLibrary() {
+  const QList<SongList> albums = AlbumsToAnalyse();
+  if (albums.isEmpty()) {
+    QMetaObject::invokeMethod(this, "AnalyseLibraryFinished",
+                              Qt::QueuedConnection);
+    return;
+  }
+
+  int song_count = 0;
+  for (const SongList& album : albums) {
+    song_count += album.count();
+  }
+
+  const int task_id = task_manager_->StartTask(tr("Analysing loudness"));
+  task_manager_->SetTaskPausable(task_id);
+  task_manager_->SetTaskProgress(task_id, 0, song_count);
+
+  {
+    QMutexLocker l(&albums_mutex_);
+    task_id_ = task_id;
+    albums_left_ = albums.count();
+  }
+
+  for (const SongList& album : albums) {
+    QueueAlbum(AlbumPtr(new Album(album)), task_id);
+  }
+}
+
+void ReplayGainScanner::QueueAlbum(AlbumPtr album, int task_id) {
+  album_queue_.Run<void>(
+      std::bind(&ReplayGainScanner::AnalyseAlbum, this, album, task_id));
+}
+
+bool ReplayGainScanner::ParkIfPaused(AlbumPtr album, int task_id) {
+  // TasksChanged takes the same lock before it looks at the task, so the
+  // album can't be parked just after the task was resumed.
+  QMutexLocker l(&albums_mutex_);
+  if (!task_manager_->IsTaskPaused(task_id)) return false;
+
+  paused_albums_ << album;
+  return true;
+}
+
+void ReplayGainScanner::TasksChanged() {
+  QList<AlbumPtr> albums;
+  int task_id = -1;
+  {
+    QMutexLocker l(&albums_mutex_);
+    if (paused_albums_.isEmpty() || task_manager_->IsTaskPaused(task_id_)) {
+      return;
+    }
+    albums = paused_albums_;
+    paused_albums_.clear();
+    task_id = task_id_;
+  }
+
+  for (AlbumPtr album : albums) {
+    QueueAlbum(album, task_id);
+  }
+}
+
+void ReplayGainScanner::AlbumFinished(int task_id) {
+  {
+    QMutexLocker l(&albums_mutex_);
+    if (--albums_left_ > 0) return;
+  }
+
+  task_manager_->SetTaskFinished(task_id);
+  QMetaObject::invokeMethod(this, "AnalyseLibraryFinished",
+                            Qt::QueuedConnection);
+}
+
+QList<SongList> ReplayGainScanner::AlbumsToAnalyse() {
+  QMap<QString, SongList> albums;
+  QSet<QString> incomplete_albums;
+  QList<SongList> ret;
+
+  QSet<int> failed;
+  {
+    QMutexLocker l(&failed_mutex_);
+    failed = failed_;
+  }
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  // CUE sheet tracks share a file, and would need to be decoded in pieces.
+  QSqlQuery q(db);
+  q.prepare(
+      "SELECT ROWID, filename, mtime, album, effective_albumartist,"
+      "  effective_compilation, rg_track_peak IS NULL"
+      " FROM songs"
+      " WHERE unavailable = 0 AND cue_path = '' AND filename LIKE 'file:%'");
+  q.exec();
+  if (db_->CheckErrors(q)) return ret;
+
+  while (q.next()) {
+    Song song;
+    song.set_id(q.value(0).toInt());
+    song.set_url(QUrl::fromEncoded(q.value(1).toByteArray()));
+    song.set_mtime(q.value(2).toInt());
+    song.set_album(q.value(3).toString());
+
+    if (failed.contains(song.id())) continue;
+    const bool needs_analysis = q.value(6).toBool();
+
+    if (song.album().isEmpty()) {
+      // A song on its own only gets a track gain.
+      if (needs_analysis) ret << (SongList() << song);
+      continue;
+    }
+
+    // Tracks by different artists on a compilation are still one album.
+    const QString key =
+        song.album() + '\n' +
+        (q.value(5).toBool() ? QString() : q.value(4).toString());
+    albums[key] << song;
+    if (needs_analysis) incomplete_albums << key;
+  }
+
+  for (auto it = albums.constBegin(); it != albums.constEnd(); ++it) {
+    if (incomplete_albums.contains(it.key())) ret << it.value();
+  }
+  return ret;
+}
+
+void ReplayGainScanner::AnalyseAlbum(AlbumPtr album, int task_id) {
+  while (album->next_ < album->songs_.count()) {
+    if (abort_ || ParkIfPaused(album, task_id)) return;
+
+    Song song = album->songs_[album->next_];
+    bool paused = false;
+    std::unique_ptr<LoudnessMeter> meter =
+        Measure(song.url().toLocalFile(), task_id, &paused);
+    if (abort_) return;
+    // A song that was interrupted is measured again from the start.
+    if (paused) continue;
+
+    album->next_++;
+    task_manager_->IncreaseTaskProgress(task_id, 1);
+
+    if (!meter) {
+      QMutexLocker l(&failed_mutex_);
+      failed_ << song.id();
+      continue;
+    }
+
+    // Silence doesn't need turning up or down.
+    double lufs = LoudnessMeter::kReferenceLoudness;
+    meter->IntegratedLoudness(&lufs);
+    song.set_replaygain_track(LoudnessMeter::Gain(lufs), meter->sample_peak());
+
+    album->blocks_ += meter->blocks();
+    album->peak_ = qMax(album->peak_, meter->sample_peak());
+    album->measured_ << song;
+  }
+
+  double album_lufs = LoudnessMeter::kReferenceLoudness;
+  const bool has_album = !album->songs_.first().album().isEmpty();
+  if (has_album) {
+    LoudnessMeter::IntegratedLoudness(album->blocks_, &album_lufs);
+  }
+
+  for (Song& song : album->measured_) {
+    if (has_album) {
+      song.set_replaygain_album(LoudnessMeter::Gain(album_lufs), album->peak_);
+    } else {
+      song.set_replaygain_album(0.0f, -1.0f);
+    }
+  }
+
+  StoreGains(album->measured_);
+  AlbumFinished(task_id);
+}
+
+void ReplayGainScanner::StoreGains(const SongList& songs) {
+  if (songs.isEmpty()) return;
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+  ScopedTransaction t(&db);
+
+  // If the file changed while it was being measured, it'll need measuring
+  // again.
+  QSqlQuery q(db);
+  q.prepare(
+      "UPDATE songs SET rg_track_gain = :track_gain,"
+      "  rg_track_peak = :track_peak, rg_album_gain = :album_gain,"
+      "  rg_album_peak = :album_peak"
+      " WHERE ROWID = :id AND mtime = :mtime");
+  for (const Song& song : songs) {
+    const bool has_album_gain = song.replaygain_album_peak() >= 0;
+    q.bindValue(":track_gain", song.replaygain_track_gain());
+    q.bindValue(":track_peak", song.replaygain_track_peak());
+    q.bindValue(":album_gain", has_album_gain
+                                   ? QVariant(song.replaygain_album_gain())
+                                   : QVariant());
+    q.bindValue(":album_peak", has_album_gain
+                                   ? QVariant(song.replaygain_album_peak())
+                                   : QVariant());
+    q.bindValue(":id", song.id());
+    q.bindValue(":mtime", song.mtime());
+    q.exec();
+    if (db_->CheckErrors(q)) return;
+  }
+
+  t.Commit();
+}
+
+std::unique_ptr<LoudnessMeter> ReplayGainScanner::Measure(
+    const QString& filename, int task_id, bool* paused) {
+  Q_ASSERT(QThread::currentThread() != qApp->thread());
+
+  Decoder decoder;
+
+  GstElement* pipeline = gst_pipeline_new("pipeline");
+  GstElement* src = CreateElement("filesrc", pipeline);
+  GstElement* decode = CreateElement("decodebin", pipeline);
+  GstElement* convert = CreateElement("audioconvert", pipeline);
+  GstElement* sink = CreateElement("appsink", pipeline);
+
+  if (!src || !decode || !convert || !sink) {
+    gst_object_unref(pipeline);
+    return nullptr;
+  }
+
+  decoder.convert = convert;
+  gst_element_link(src, decode);
+
+  // Anything with more than two channels is downmixed to stereo, which the
+  // meter weights the same as BS.1770 would the front channels.
+  GstCaps* caps = gst_caps_new_simple(
+      "audio/x-raw", "format", G_TYPE_STRING, GST_AUDIO_NE(F32), "layout",
+      G_TYPE_STRING, "interleaved", "channels", GST_TYPE_INT_RANGE, 1, 2,
+      nullptr);
+  gst_element_link_filtered(convert, sink, caps);
+  gst_caps_unref(caps);
+
+  GstAppSinkCallbacks callbacks;
+  memset(&callbacks, 0, sizeof(callbacks));
+  callbacks.new_sample = NewSampleCallback;
+  gst_app_sink_set_callbacks(reinterpret_cast<GstAppSink*>(sink), &callbacks,
+                             &decoder, nullptr);
+  g_object_set(G_OBJECT(sink), "sync", FALSE, nullptr);
+  g_object_set(src, "location", filename.toUtf8().constData(), nullptr);
+  CHECKED_GCONNECT(decode, "pad-added", &NewPadCallback, &decoder);
+
+  GstBus* bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline));
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+
+  bool finished = false;
+  forever {
+    GstMessage* msg = gst_bus_timed_pop_filtered(
+        bus, kPollMsec * GST_MSECOND,
+        static_cast<GstMessageType>(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+
+    if (msg) {
+      if (msg->type == GST_MESSAGE_ERROR) {
+        GError* error = nullptr;
+        gchar* debugs = nullptr;
+        gst_message_parse_error(msg, &error, &debugs);
+        qLog(Debug) << "Error measuring" << filename << ":"
+                    << QString::fromLocal8Bit(error->message);
+        g_error_free(error);
+        g_free(debugs);
+      } else {
+        finished = true;
+      }
+      gst_message_unref(msg);
+      break;
+    }
+
+    if (abort_) break;
+    if (task_manager_->IsTaskPaused(task_id)) {
+      // Give the worker back rather than holding on to it until the task is
+      // resumed.
+      *paused = true;
+      break;
+    }
+  }
+
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(bus);
+  gst_object_unref(pipeline);
+
+  if (!finished) return nullptr;
+  return std::move(decoder.meter);
+}
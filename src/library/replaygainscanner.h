@@ -0,0 +1,112 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef LIBRARY_REPLAYGAINSCANNER_H_
+#define LIBRARY_REPLAYGAINSCANNER_H_
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QVector>
+#include <memory>
+
+#include "core/song.h"
+#include "core/workscheduler.h"
+
+class Database;
+class LoudnessMeter;
+class TaskManager;
+
+// Measures the loudness of library songs that don't have ReplayGain values
+// yet, and stores track and album gains and peaks in the songs table.  The
+// engine uses these for files that don't have ReplayGain tags of their own,
+// so the files themselves are never changed.
+//
+// Each album is measured by one idle job on the WorkScheduler.  The album gain
+// comes from gating all the album's tracks together, so if any track of an
+// album needs measuring the whole album is measured again.
+class ReplayGainScanner : public QObject {
+  Q_OBJECT
+
+ public:
+  ReplayGainScanner(Database* db, TaskManager* task_manager,
+                    QObject* parent = nullptr);
+  ~ReplayGainScanner();
+
+  // How often a decoding job checks whether it should stop or pause.
+  static const int kPollMsec;
+
+ public slots:
+  void AnalyseLibraryAsync();
+
+ private slots:
+  void AnalyseLibraryFinished();
+  void TasksChanged();
+
+ private:
+  // An album that's being measured.  When the task is paused its job stops
+  // after the current song, and the album waits in paused_albums_ until the
+  // task is resumed, so it doesn't keep a worker.
+  struct Album {
+    explicit Album(const SongList& songs)
+        : songs_(songs), next_(0), peak_(0.0f) {}
+
+    SongList songs_;
+    int next_;
+    SongList measured_;
+    QVector<double> blocks_;
+    float peak_;
+  };
+  typedef std::shared_ptr<Album> AlbumPtr;
+
+  void AnalyseLibrary();
+  void AnalyseAlbum(AlbumPtr album, int task_id);
+  void QueueAlbum(AlbumPtr album, int task_id);
+  // Keeps the album for later and returns true if the task is paused.
+  bool ParkIfPaused(AlbumPtr album, int task_id);
+  void AlbumFinished(int task_id);
+  QList<SongList> AlbumsToAnalyse();
+  void StoreGains(const SongList& songs);
+
+  // Decodes the whole file and measures it.  Returns nullptr if the file
+  // couldn't be decoded, or if we're stopping or pausing - paused is set in
+  // the last case.
+  std::unique_ptr<LoudnessMeter> Measure(const QString& filename, int task_id,
+                                         bool* paused);
+
+  Database* db_;
+  TaskManager* task_manager_;
+
+  WorkQueue find_queue_;
+  WorkQueue album_queue_;
+  bool analysing_;
+  QAtomicInt abort_;
+
+  // Protects the albums of the task that's running.
+  QMutex albums_mutex_;
+  int task_id_;
+  int albums_left_;
+  QList<AlbumPtr> paused_albums_;
+
+  // Songs that couldn't be decoded aren't tried again until Clementine is
+  // restarted.
+  QMutex failed_mutex_;
+  QSet<int> failed_;
+};
+
+#endif  // LIBRARY_REPLAYGAINSCANNER_H_
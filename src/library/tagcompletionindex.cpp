@@ -0,0 +1,179 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tagcompletionindex.h"
+
+#include <QMutexLocker>
+#include <algorithm>
+
+#include "core/logging.h"
+#include "librarybackend.h"
+
+namespace {
+
+bool CaseInsensitiveLessThan(const QString& a, const QString& b) {
+  return QString::compare(a, b, Qt::CaseInsensitive) < 0;
+}
+
+}  // namespace
+
+TagCompletionIndex::TagCompletionIndex(LibraryBackend* backend)
+    : QObject(backend), backend_(backend) {
+  connect(backend, SIGNAL(SongsDiscovered(SongList)),
+          SLOT(SongsDiscovered(SongList)));
+  connect(backend, SIGNAL(SongsDeleted(SongList)),
+          SLOT(SongsDeleted(SongList)));
+  connect(backend, SIGNAL(DatabaseReset()), SLOT(Reset()));
+}
+
+QStringList TagCompletionIndex::Values(const QString& column) {
+  int generation = 0;
+  {
+    QMutexLocker l(&mutex_);
+    const Vocabulary& vocabulary = vocabularies_[column];
+    if (vocabulary.valid_) return vocabulary.values_;
+    generation = vocabulary.generation_;
+  }
+
+  // Don't hold the lock while querying the database - the backend might be
+  // trying to tell us about new songs at the same time.
+  const QHash<QString, int> counts = Load(column);
+  QStringList values = counts.keys();
+  std::sort(values.begin(), values.end(), CaseInsensitiveLessThan);
+
+  QMutexLocker l(&mutex_);
+  Vocabulary& vocabulary = vocabularies_[column];
+  if (vocabulary.generation_ == generation) {
+    vocabulary.values_ = values;
+    vocabulary.counts_ = counts;
+    vocabulary.valid_ = true;
+  }
+  return values;
+}
+
+QHash<QString, int> TagCompletionIndex::Load(const QString& column) {
+  return backend_->CountAll(column);
+}
+
+void TagCompletionIndex::SongsDiscovered(const SongList& songs) {
+  QMutexLocker l(&mutex_);
+  for (auto it = vocabularies_.begin(); it != vocabularies_.end(); ++it) {
+    Vocabulary& vocabulary = it.value();
+    if (!vocabulary.valid_) {
+      // It might be being loaded right now, by a query that ran before these
+      // songs were added.
+      vocabulary.generation_++;
+      continue;
+    }
+
+    for (const Song& song : songs) {
+      if (!IsCounted(song)) continue;
+
+      const QString value = ValueOf(song, it.key());
+      if (vocabulary.counts_[value]++ == 0) {
+        Insert(value, &vocabulary.values_);
+      }
+    }
+  }
+}
+
+void TagCompletionIndex::SongsDeleted(const SongList& songs) {
+  // Songs that come back after being unavailable are announced through here
+  // too, with nothing to say they're back, so count those again from scratch.
+  for (const Song& song : songs) {
+    if (song.is_unavailable()) {
+      Reset();
+      return;
+    }
+  }
+
+  // Changed songs come through here with their old values, and then through
+  // SongsDiscovered with their new ones.
+  QMutexLocker l(&mutex_);
+  for (auto it = vocabularies_.begin(); it != vocabularies_.end(); ++it) {
+    Vocabulary& vocabulary = it.value();
+    if (!vocabulary.valid_) {
+      vocabulary.generation_++;
+      continue;
+    }
+
+    for (const Song& song : songs) {
+      if (!IsCounted(song)) continue;
+
+      const QString value = ValueOf(song, it.key());
+      auto count = vocabulary.counts_.find(value);
+      if (count == vocabulary.counts_.end()) continue;
+
+      if (--count.value() <= 0) {
+        vocabulary.counts_.erase(count);
+        Remove(value, &vocabulary.values_);
+      }
+    }
+  }
+}
+
+void TagCompletionIndex::Reset() {
+  QMutexLocker l(&mutex_);
+  for (Vocabulary& vocabulary : vocabularies_) {
+    vocabulary.valid_ = false;
+    vocabulary.values_.clear();
+    vocabulary.counts_.clear();
+    vocabulary.generation_++;
+  }
+}
+
+bool TagCompletionIndex::IsCounted(const Song& song) {
+  return !song.is_compilation() && !song.is_unavailable();
+}
+
+void TagCompletionIndex::Insert(const QString& value, QStringList* values) {
+  auto it = std::lower_bound(values->begin(), values->end(), value,
+                             CaseInsensitiveLessThan);
+
+  // Values that only differ in case are all kept, like SELECT DISTINCT does.
+  for (auto i = it; i != values->end() &&
+                    QString::compare(*i, value, Qt::CaseInsensitive) == 0;
+       ++i) {
+    if (*i == value) return;
+  }
+  values->insert(it, value);
+}
+
+void TagCompletionIndex::Remove(const QString& value, QStringList* values) {
+  auto it = std::lower_bound(values->begin(), values->end(), value,
+                             CaseInsensitiveLessThan);
+  for (; it != values->end() &&
+         QString::compare(*it, value, Qt::CaseInsensitive) == 0;
+       ++it) {
+    if (*it == value) {
+      values->erase(it);
+      return;
+    }
+  }
+}
+
+QString TagCompletionIndex::ValueOf(const Song& song, const QString& column) {
+  if (column == "artist") return song.artist();
+  if (column == "album") return song.album();
+  if (column == "albumartist") return song.albumartist();
+  if (column == "composer") return song.composer();
+  if (column == "performer") return song.performer();
+  if (column == "grouping") return song.grouping();
+  if (column == "genre") return song.genre();
+
+  qLog(Warning) << "Unknown column" << column;
+  return QString();
+}
@@ -0,0 +1,82 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIBRARY_TAGCOMPLETIONINDEX_H_
+#define LIBRARY_TAGCOMPLETIONINDEX_H_
+
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+
+#include "core/song.h"
+
+class LibraryBackend;
+
+// Keeps the distinct values of the library's tag columns in memory, so every
+// tag editor that wants to complete an artist or an album doesn't have to
+// scan the whole songs table.  Each column is loaded the first time it's
+// asked for, along with how many songs have each value.  After that the counts
+// follow the songs that are discovered, changed and deleted, and a value is
+// dropped when no songs have it any more.  Values() is thread-safe, and is
+// meant to be called from a background thread.
+class TagCompletionIndex : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit TagCompletionIndex(LibraryBackend* backend);
+
+  // Returns the distinct values of a column, sorted case-insensitively - the
+  // order QCompleter::CaseInsensitivelySortedModel expects.  This might have
+  // to query the database.
+  QStringList Values(const QString& column);
+
+ protected:
+  // Returns how many songs have each value of a column.  Called without the
+  // lock held.
+  virtual QHash<QString, int> Load(const QString& column);
+
+ private slots:
+  void SongsDiscovered(const SongList& songs);
+  void SongsDeleted(const SongList& songs);
+  void Reset();
+
+ private:
+  struct Vocabulary {
+    Vocabulary() : valid_(false), generation_(0) {}
+
+    bool valid_;
+    // Incremented whenever the column changes before it's loaded, so a load
+    // that raced with the change knows its result is already out of date.
+    int generation_;
+    QStringList values_;
+    QHash<QString, int> counts_;
+  };
+
+  static QString ValueOf(const Song& song, const QString& column);
+  // Whether GetAll would return the song's values.
+  static bool IsCounted(const Song& song);
+  static void Insert(const QString& value, QStringList* values);
+  static void Remove(const QString& value, QStringList* values);
+
+  LibraryBackend* backend_;
+
+  QMutex mutex_;
+  QMap<QString, Vocabulary> vocabularies_;
+};
+
+#endif  // LIBRARY_TAGCOMPLETIONINDEX_H_
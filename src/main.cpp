@@ -60,6 +60,7 @@
 #include "core/networkproxyfactory.h"
 #include "core/potranslator.h"
 #include "core/song.h"
+#include "core/startuptrace.h"
 #include "core/ubuntuunityhack.h"
 #include "core/utilities.h"
 #include "engines/enginebase.h"
@@ -251,6 +252,8 @@ void ScanGIOModulePath() {
 #endif  // HAVE_GIO
 
 int main(int argc, char* argv[]) {
+  StartupTrace::Start();
+
   if (CrashReporting::SendCrashReport(argc, argv)) {
     return 0;
   }
@@ -299,6 +302,7 @@ int main(int argc, char* argv[]) {
     // full QApplication so it works without an X server
     if (!options.Parse()) return 1;
     logging::SetLevels(options.log_levels());
+    StartupTrace::SetEnabled(options.startup_trace());
 
     if (a.isRunning()) {
       if (options.is_empty()) {
@@ -436,6 +440,7 @@ int main(int argc, char* argv[]) {
   Application app;
   QObject::connect(&a, SIGNAL(aboutToQuit()), &app, SLOT(SaveSettings_()));
   app.set_language_name(language);
+  StartupTrace::Mark("Application created");
 
   // Network proxy
   QNetworkProxyFactory::setApplicationProxyFactory(
@@ -459,6 +464,7 @@ int main(int argc, char* argv[]) {
 
   // Window
   MainWindow w(&app, tray_icon.get(), &osd, options);
+  StartupTrace::Mark("Main window created");
 #ifdef Q_OS_DARWIN
   mac::EnableFullScreen(w);
 #endif  // Q_OS_DARWIN
@@ -17,6 +17,7 @@
 
 #include "moodbarbuilder.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include "core/arraysize.h"
@@ -29,6 +30,26 @@ static const int sBarkBands[] = {
 
 static const int sBarkBandCount = arraysize(sBarkBands);
 
+// Sums a run of values into four separate totals, so each addition doesn't
+// have to wait for the one before it.  This is plain scalar code: most bark
+// bands are only a few bins wide, which is too short for SIMD to pay off.
+double Sum(const double* values, int count) {
+  double sums[4] = {0, 0, 0, 0};
+
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    sums[0] += values[i];
+    sums[1] += values[i + 1];
+    sums[2] += values[i + 2];
+    sums[3] += values[i + 3];
+  }
+  for (; i < count; ++i) {
+    sums[0] += values[i];
+  }
+
+  return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+}
+
 }  // namespace
 
 MoodbarBuilder::MoodbarBuilder() : bands_(0), rate_hz_(0) {}
@@ -41,61 +62,59 @@ void MoodbarBuilder::Init(int bands, int rate_hz) {
   bands_ = bands;
   rate_hz_ = rate_hz;
 
-  barkband_table_.clear();
-  barkband_table_.reserve(bands + 1);
+  // Bins move up to the next bark band once their frequency reaches it, so
+  // each band is a contiguous run of bins.  Bands beyond the highest
+  // frequency are left empty.
+  barkband_start_.fill(bands + 1, sBarkBandCount + 1);
+  barkband_start_[0] = 0;
 
   int barkband = 0;
   for (int i = 0; i < bands + 1; ++i) {
     if (barkband < sBarkBandCount - 1 &&
         BandFrequency(i) >= sBarkBands[barkband]) {
       barkband++;
+      barkband_start_[barkband] = i;
     }
-
-    barkband_table_.append(barkband);
   }
 }
 
 void MoodbarBuilder::AddFrame(const double* magnitudes, int size) {
-  if (size > barkband_table_.length()) {
+  if (barkband_start_.isEmpty() || size > barkband_start_.last()) {
     return;
   }
 
-  // Calculate total magnitudes for different bark bands.
-  double bands[sBarkBandCount];
+  // Calculate total magnitudes for different bark bands, and divide them into
+  // thirds to compute their total amplitudes.
+  double rgb[] = {0, 0, 0};
   for (int i = 0; i < sBarkBandCount; ++i) {
-    bands[i] = 0.0;
-  }
+    const int start = qMin(barkband_start_[i], size);
+    const int end = qMin(barkband_start_[i + 1], size);
+    const double band = Sum(magnitudes + start, end - start);
 
-  for (int i = 0; i < size; ++i) {
-    bands[barkband_table_[i]] += magnitudes[i];
+    rgb[(i * 3) / sBarkBandCount] += band * band;
   }
 
-  // Now divide the bark bands into thirds and compute their total amplitudes.
-  double rgb[] = {0, 0, 0};
-  for (int i = 0; i < sBarkBandCount; ++i) {
-    rgb[(i * 3) / sBarkBandCount] += bands[i] * bands[i];
+  for (int i = 0; i < 3; ++i) {
+    frames_[i].append(sqrt(rgb[i]));
   }
-
-  frames_.append(Rgb(sqrt(rgb[0]), sqrt(rgb[1]), sqrt(rgb[2])));
 }
 
-void MoodbarBuilder::Normalize(QList<Rgb>* vals, double Rgb::*member) {
-  double mini = vals->at(0).*member;
-  double maxi = vals->at(0).*member;
-  for (int i = 1; i < vals->count(); i++) {
-    const double value = vals->at(i).*member;
-    if (value > maxi) {
-      maxi = value;
-    } else if (value < mini) {
-      mini = value;
-    }
+void MoodbarBuilder::Normalize(QVector<double>* vals) {
+  const int count = vals->count();
+  double* values = vals->data();
+
+  double mini = values[0];
+  double maxi = values[0];
+  for (int i = 1; i < count; i++) {
+    mini = std::min(mini, values[i]);
+    maxi = std::max(maxi, values[i]);
   }
 
   double avg = 0;
-  for (const Rgb& rgb : *vals) {
-    const double value = rgb.*member;
+  for (int i = 0; i < count; i++) {
+    const double value = values[i];
     if (value != mini && value != maxi) {
-      avg += value / vals->count();
+      avg += value / count;
     }
   }
 
@@ -103,8 +122,8 @@ void MoodbarBuilder::Normalize(QList<Rgb>* vals, double Rgb::*member) {
   double tb = 0;
   double avgu = 0;
   double avgb = 0;
-  for (const Rgb& rgb : *vals) {
-    const double value = rgb.*member;
+  for (int i = 0; i < count; i++) {
+    const double value = values[i];
     if (value != mini && value != maxi) {
       if (value > avg) {
         avgu += value;
@@ -122,8 +141,8 @@ void MoodbarBuilder::Normalize(QList<Rgb>* vals, double Rgb::*member) {
   tb = 0;
   double avguu = 0;
   double avgbb = 0;
-  for (const Rgb& rgb : *vals) {
-    const double value = rgb.*member;
+  for (int i = 0; i < count; i++) {
+    const double value = values[i];
     if (value != mini && value != maxi) {
       if (value > avgu) {
         avguu += value;
@@ -144,10 +163,10 @@ void MoodbarBuilder::Normalize(QList<Rgb>* vals, double Rgb::*member) {
     delta = 1;
   }
 
-  for (auto it = vals->begin(); it != vals->end(); ++it) {
-    double* value = &((*it).*member);
-    *value =
-        std::isfinite(*value) ? qBound(0.0, (*value - mini) / delta, 1.0) : 0;
+  for (int i = 0; i < count; i++) {
+    const double value = values[i];
+    values[i] =
+        std::isfinite(value) ? qBound(0.0, (value - mini) / delta, 1.0) : 0;
   }
 }
 
@@ -155,32 +174,26 @@ QByteArray MoodbarBuilder::Finish(int width) {
   QByteArray ret;
   ret.resize(width * 3);
   char* data = ret.data();
-  if (frames_.count() == 0) return ret;
 
-  Normalize(&frames_, &Rgb::r);
-  Normalize(&frames_, &Rgb::g);
-  Normalize(&frames_, &Rgb::b);
+  const int frames = frames_[0].count();
+  if (frames == 0) return ret;
+
+  for (QVector<double>& channel : frames_) {
+    Normalize(&channel);
+  }
 
   for (int i = 0; i < width; ++i) {
-    Rgb rgb;
-    int start = i * frames_.count() / width;
-    int end = (i + 1) * frames_.count() / width;
+    int start = i * frames / width;
+    int end = (i + 1) * frames / width;
     if (start == end) {
       end = start + 1;
     }
 
-    for (int j = start; j < end; j++) {
-      const Rgb& frame = frames_[j];
-      rgb.r += frame.r * 255;
-      rgb.g += frame.g * 255;
-      rgb.b += frame.b * 255;
-    }
-
     const int n = end - start;
-
-    *(data++) = rgb.r / n;
-    *(data++) = rgb.g / n;
-    *(data++) = rgb.b / n;
+    for (const QVector<double>& channel : frames_) {
+      const double total = Sum(channel.constData() + start, n) * 255;
+      *(data++) = static_cast<unsigned char>(total / n);
+    }
   }
   return ret;
 }
@@ -18,9 +18,15 @@
 #ifndef MOODBARBUILDER_H
 #define MOODBARBUILDER_H
 
-#include <QColor>
-#include <QList>
-
+#include <QByteArray>
+#include <QVector>
+
+// Turns the spectrum of each 100ms of a song into the colours of its moodbar.
+// Each bark band's magnitude is the sum of a contiguous range of the
+// spectrum's bins, and each colour is made from a contiguous range of bark
+// bands, so both are worked out once in Init and AddFrame only sums runs of
+// doubles.  The colours are kept in one array per channel for the same
+// reason.
 class MoodbarBuilder {
  public:
   MoodbarBuilder();
@@ -30,21 +36,16 @@ class MoodbarBuilder {
   QByteArray Finish(int width);
 
  private:
-  struct Rgb {
-    Rgb() : r(0), g(0), b(0) {}
-    Rgb(double r_, double g_, double b_) : r(r_), g(g_), b(b_) {}
-
-    double r, g, b;
-  };
-
   int BandFrequency(int band) const;
-  static void Normalize(QList<Rgb>* vals, double Rgb::*member);
+  static void Normalize(QVector<double>* vals);
 
-  QList<uint> barkband_table_;
+  // The first spectrum bin of each bark band, and one past the last bin.
+  QVector<int> barkband_start_;
   int bands_;
   int rate_hz_;
 
-  QList<Rgb> frames_;
+  // The red, green and blue value of every frame.
+  QVector<double> frames_[3];
 };
 
 #endif  // MOODBARBUILDER_H
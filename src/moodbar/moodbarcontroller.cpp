@@ -36,7 +36,9 @@ void MoodbarController::CurrentSongChanged(const Song& song) {
   QByteArray data;
   MoodbarPipeline* pipeline = nullptr;
   const MoodbarLoader::Result result =
-      app_->moodbar_loader()->Load(song.url(), &data, &pipeline);
+      app_->moodbar_loader()->Load(song.url(),
+                                   song.is_library_song() ? song.id() : -1,
+                                   song.mtime(), &data, &pipeline);
 
   switch (result) {
     case MoodbarLoader::CannotLoad:
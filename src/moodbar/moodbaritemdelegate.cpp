@@ -21,17 +21,19 @@
 #include <QPainter>
 #include <QSettings>
 #include <QSortFilterProxyModel>
-#include <QtConcurrentRun>
+#include <functional>
 
 #include "core/application.h"
 #include "core/closure.h"
+#include "core/workscheduler.h"
 #include "moodbarloader.h"
 #include "moodbarpipeline.h"
 #include "moodbarrenderer.h"
 #include "playlist/playlist.h"
 #include "playlist/playlistview.h"
 
-MoodbarItemDelegate::Data::Data() : state_(State_None) {}
+MoodbarItemDelegate::Data::Data()
+    : song_id_(-1), mtime_(0), state_(State_None) {}
 
 MoodbarItemDelegate::MoodbarItemDelegate(Application* app, PlaylistView* view,
                                          QObject* parent)
@@ -80,6 +82,10 @@ QPixmap MoodbarItemDelegate::PixmapForIndex(const QModelIndex& index,
   Data* data = data_[url];
   if (!data) {
     data = new Data;
+    data->song_id_ = index.data(Playlist::Role_LibrarySongId).toInt();
+    data->mtime_ = index.sibling(index.row(), Playlist::Column_DateModified)
+                       .data()
+                       .toUInt();
     data_.insert(url, data);
   }
 
@@ -117,7 +123,8 @@ void MoodbarItemDelegate::StartLoadingData(const QUrl& url, Data* data) {
   // Load a mood file for this song and generate some colors from it
   QByteArray bytes;
   MoodbarPipeline* pipeline = nullptr;
-  switch (app_->moodbar_loader()->Load(url, &bytes, &pipeline)) {
+  switch (app_->moodbar_loader()->Load(url, data->song_id_, data->mtime_,
+                                       &bytes, &pipeline)) {
     case MoodbarLoader::CannotLoad:
       data->state_ = Data::State_CannotLoad;
       break;
@@ -182,8 +189,10 @@ void MoodbarItemDelegate::StartLoadingColors(const QUrl& url,
                                              Data* data) {
   data->state_ = Data::State_LoadingColors;
 
-  QFuture<ColorVector> future = QtConcurrent::run(
-      MoodbarRenderer::Colors, bytes, style_, qApp->palette());
+  // The rows are on screen, so this goes ahead of other background work.
+  QFuture<ColorVector> future = WorkScheduler::Instance()->Run<ColorVector>(
+      WorkScheduler::Priority_Interactive,
+      std::bind(&MoodbarRenderer::Colors, bytes, style_, qApp->palette()));
   NewClosure(future, this, SLOT(ColorsLoaded(QUrl, QFuture<ColorVector>)), url,
              future);
 }
@@ -208,8 +217,10 @@ void MoodbarItemDelegate::ColorsLoaded(const QUrl& url,
 void MoodbarItemDelegate::StartLoadingImage(const QUrl& url, Data* data) {
   data->state_ = Data::State_LoadingImage;
 
-  QFuture<QImage> future = QtConcurrent::run(
-      MoodbarRenderer::RenderToImage, data->colors_, data->desired_size_);
+  QFuture<QImage> future = WorkScheduler::Instance()->Run<QImage>(
+      WorkScheduler::Priority_Interactive,
+      std::bind(&MoodbarRenderer::RenderToImage, data->colors_,
+                data->desired_size_));
   NewClosure(future, this, SLOT(ImageLoaded(QUrl, QFuture<QImage>)), url,
              future);
 }
@@ -63,6 +63,10 @@ class MoodbarItemDelegate : public QItemDelegate {
 
     QSet<QPersistentModelIndex> indexes_;
 
+    // Where to find the moodbar in the MoodbarStore, if it's a library song.
+    int song_id_;
+    uint mtime_;
+
     State state_;
     ColorVector colors_;
     QSize desired_size_;
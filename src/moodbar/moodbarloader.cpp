@@ -20,17 +20,24 @@
 #include <QCoreApplication>
 #include <QDir>
 #include <QFileInfo>
+#include <QMutexLocker>
 #include <QNetworkDiskCache>
+#include <QSqlQuery>
 #include <QThread>
 #include <QTimer>
 #include <QUrl>
+#include <functional>
 #include <memory>
 
 #include "core/application.h"
 #include "core/closure.h"
+#include "core/database.h"
 #include "core/logging.h"
+#include "core/taskmanager.h"
 #include "core/utilities.h"
+#include "core/workscheduler.h"
 #include "moodbarpipeline.h"
+#include "moodbarstore.h"
 
 #ifdef Q_OS_WIN32
 #include <windows.h>
@@ -38,9 +45,16 @@
 
 MoodbarLoader::MoodbarLoader(Application* app, QObject* parent)
     : QObject(parent),
+      app_(app),
       cache_(new QNetworkDiskCache(this)),
-      thread_(new QThread(this)),
+      store_(new MoodbarStore(
+          Utilities::GetConfigPath(Utilities::Path_CacheRoot) + "/moodbars")),
       kMaxActiveRequests(qMax(1, QThread::idealThreadCount() / 2)),
+      generate_all_task_id_(-1),
+      generate_all_threads_(kMaxActiveRequests),
+      generate_all_paused_(false),
+      generate_all_done_(0),
+      generate_all_total_(0),
       save_alongside_originals_(false),
       disable_moodbar_calculation_(false) {
   cache_->setCacheDirectory(
@@ -49,12 +63,14 @@ MoodbarLoader::MoodbarLoader(Application* app, QObject* parent)
                               1024);  // 60MB - enough for 20,000 moodbars
 
   connect(app, SIGNAL(SettingsChanged()), SLOT(ReloadSettings()));
+  connect(app->task_manager(), SIGNAL(TasksChanged()), SLOT(TasksChanged()));
   ReloadSettings();
 }
 
 MoodbarLoader::~MoodbarLoader() {
-  thread_->quit();
-  thread_->wait(1000);
+  for (const QUrl& url : active_requests_) {
+    requests_[url]->Cancel();
+  }
 }
 
 void MoodbarLoader::ReloadSettings() {
@@ -64,6 +80,11 @@ void MoodbarLoader::ReloadSettings() {
       s.value("save_alongside_originals", false).toBool();
 
   disable_moodbar_calculation_ = !s.value("calculate", true).toBool();
+
+  generate_all_threads_ = s.value("generate_threads", 0).toInt();
+  if (generate_all_threads_ <= 0) {
+    generate_all_threads_ = kMaxActiveRequests;
+  }
   MaybeTakeNextRequest();
 }
 
@@ -80,7 +101,17 @@ QStringList MoodbarLoader::MoodFilenames(const QString& song_filename) {
                        << dir_path + "/" + mood_filename;
 }
 
-MoodbarLoader::Result MoodbarLoader::Load(const QUrl& url, QByteArray* data,
+bool MoodbarLoader::HasMoodFile(const QString& song_filename) {
+  for (const QString& possible_mood_file : MoodFilenames(song_filename)) {
+    if (QFile::exists(possible_mood_file)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+MoodbarLoader::Result MoodbarLoader::Load(const QUrl& url, int song_id,
+                                          uint mtime, QByteArray* data,
                                           MoodbarPipeline** async_pipeline) {
   if (url.scheme() != "file") {
     return CannotLoad;
@@ -92,6 +123,13 @@ MoodbarLoader::Result MoodbarLoader::Load(const QUrl& url, QByteArray* data,
     return WillLoadAsync;
   }
 
+  // Library songs' moodbars are in the store - this is the common case when
+  // painting a playlist, so look there before touching the disk, and don't
+  // log anything.
+  if (song_id != -1 && store_->Get(song_id, mtime, url, data)) {
+    return Loaded;
+  }
+
   // Check if a mood file exists for this file already
   const QString filename(url.toLocalFile());
 
@@ -114,53 +152,103 @@ MoodbarLoader::Result MoodbarLoader::Load(const QUrl& url, QByteArray* data,
     }
   }
 
-  if (!thread_->isRunning()) thread_->start(QThread::IdlePriority);
-
   // There was no existing file, analyze the audio file and create one.
+  MoodbarPipeline* pipeline = CreateRequest(url, StoreKey(song_id, mtime));
+  queued_requests_ << url;
+
+  MaybeTakeNextRequest();
+
+  *async_pipeline = pipeline;
+  return WillLoadAsync;
+}
+
+MoodbarPipeline* MoodbarLoader::CreateRequest(const QUrl& url,
+                                              const StoreKey& key) {
   MoodbarPipeline* pipeline = new MoodbarPipeline(url);
-  pipeline->moveToThread(thread_);
   NewClosure(pipeline, SIGNAL(Finished(bool)), this,
              SLOT(RequestFinished(MoodbarPipeline*, QUrl)), pipeline, url);
 
   requests_[url] = pipeline;
-  queued_requests_ << url;
+  request_keys_[url] = key;
+  return pipeline;
+}
 
-  MaybeTakeNextRequest();
+void MoodbarLoader::StartRequest(const QUrl& url) {
+  active_requests_ << url;
 
-  *async_pipeline = pipeline;
-  return WillLoadAsync;
+  qLog(Info) << "Creating moodbar data for" << url.toLocalFile();
+
+  // Moodbars that somebody is waiting for go before the rest of the library.
+  const WorkScheduler::Priority priority =
+      generate_all_active_.contains(url) ? WorkScheduler::Priority_Idle
+                                         : WorkScheduler::Priority_Normal;
+  WorkScheduler::Instance()->Run<void>(
+      priority, std::bind(&MoodbarPipeline::Run, requests_[url]));
 }
 
 void MoodbarLoader::MaybeTakeNextRequest() {
   Q_ASSERT(QThread::currentThread() == qApp->thread());
 
-  if (active_requests_.count() >= kMaxActiveRequests ||
-      queued_requests_.isEmpty() || disable_moodbar_calculation_) {
-    return;
+  // Moodbars that somebody is waiting for go first.
+  while (active_requests_.count() < kMaxActiveRequests &&
+         !queued_requests_.isEmpty() && !disable_moodbar_calculation_) {
+    StartRequest(queued_requests_.takeFirst());
   }
 
-  const QUrl url = queued_requests_.takeFirst();
-  active_requests_ << url;
+  // The rest of the library gets whatever is left of its own thread budget.
+  while (active_requests_.count() < generate_all_threads_ &&
+         TakeNextBulkRequest()) {
+  }
 
-  qLog(Info) << "Creating moodbar data for" << url.toLocalFile();
-  QMetaObject::invokeMethod(requests_[url], "Start", Qt::QueuedConnection);
+  UpdateGenerateAllTask();
+}
+
+bool MoodbarLoader::TakeNextBulkRequest() {
+  if (generate_all_task_id_ == -1 || generate_all_paused_) {
+    return false;
+  }
+
+  while (!generate_all_queue_.isEmpty()) {
+    const Song song = generate_all_queue_.takeFirst();
+    const QUrl url = song.url();
+
+    // It might have been wanted for a playlist since the queue was made.
+    if (requests_.contains(url) ||
+        store_->Contains(song.id(), song.mtime(), url)) {
+      generate_all_done_++;
+      continue;
+    }
+
+    CreateRequest(url, StoreKey(song.id(), song.mtime()));
+    generate_all_active_ << url;
+    StartRequest(url);
+    return true;
+  }
+
+  return false;
 }
 
 void MoodbarLoader::RequestFinished(MoodbarPipeline* request, const QUrl& url) {
   Q_ASSERT(QThread::currentThread() == qApp->thread());
 
+  const StoreKey key = request_keys_.take(url);
+
   if (request->success()) {
     qLog(Info) << "Moodbar data generated successfully for"
                << url.toLocalFile();
 
-    // Save the data in the cache
-    QNetworkCacheMetaData metadata;
-    metadata.setUrl(url);
-
-    QIODevice* cache_file = cache_->prepare(metadata);
-    if (cache_file) {
-      cache_file->write(request->data());
-      cache_->insert(cache_file);
+    if (key.song_id_ != -1) {
+      store_->Put(key.song_id_, key.mtime_, url, request->data());
+    } else {
+      // Save the data in the cache
+      QNetworkCacheMetaData metadata;
+      metadata.setUrl(url);
+
+      QIODevice* cache_file = cache_->prepare(metadata);
+      if (cache_file) {
+        cache_file->write(request->data());
+        cache_->insert(cache_file);
+      }
     }
 
     // Save the data alongside the original as well if we're configured to.
@@ -187,8 +275,103 @@ void MoodbarLoader::RequestFinished(MoodbarPipeline* request, const QUrl& url) {
   // Remove the request from the active list and delete it
   requests_.remove(url);
   active_requests_.remove(url);
+  if (generate_all_active_.remove(url)) {
+    generate_all_done_++;
+  }
 
   QTimer::singleShot(1000, request, SLOT(deleteLater()));
 
   MaybeTakeNextRequest();
 }
+
+void MoodbarLoader::GenerateAllAsync() {
+  if (generate_all_task_id_ != -1) return;
+
+  TaskManager* task_manager = app_->task_manager();
+  generate_all_task_id_ = task_manager->StartTask(tr("Generating moodbars"));
+  task_manager->SetTaskPausable(generate_all_task_id_);
+
+  generate_all_paused_ = false;
+  generate_all_done_ = 0;
+  // The songs aren't known yet.
+  generate_all_total_ = -1;
+
+  QFuture<SongList> future = WorkScheduler::Instance()->Run<SongList>(
+      WorkScheduler::Priority_Idle,
+      std::bind(&MoodbarLoader::SongsWithoutMoodbars, this));
+  NewClosure(future, this, SLOT(GenerateAllSongsLoaded(QFuture<SongList>)),
+             future);
+}
+
+SongList MoodbarLoader::SongsWithoutMoodbars() {
+  SongList songs;
+  {
+    Database* db = app_->database();
+    QMutexLocker l(db->Mutex());
+    QSqlDatabase sql(db->Connect());
+
+    // Songs in cue sheets share their file's moodbar, so there's no need to
+    // make it more than once.
+    QSqlQuery q(sql);
+    q.prepare(
+        "SELECT ROWID, filename, mtime FROM songs"
+        " WHERE unavailable = 0 AND cue_path = '' AND"
+        "  filename LIKE 'file:%'");
+    q.exec();
+    if (db->CheckErrors(q)) return SongList();
+
+    while (q.next()) {
+      Song song;
+      song.set_id(q.value(0).toInt());
+      song.set_url(QUrl::fromEncoded(q.value(1).toByteArray()));
+      song.set_mtime(q.value(2).toInt());
+      songs << song;
+    }
+  }
+
+  SongList ret;
+  for (const Song& song : songs) {
+    if (!store_->Contains(song.id(), song.mtime(), song.url()) &&
+        !HasMoodFile(song.url().toLocalFile())) {
+      ret << song;
+    }
+  }
+  return ret;
+}
+
+void MoodbarLoader::GenerateAllSongsLoaded(QFuture<SongList> future) {
+  generate_all_queue_ = future.result();
+  generate_all_total_ = generate_all_queue_.count();
+
+  qLog(Info) << "Generating moodbars for" << generate_all_total_ << "songs";
+  MaybeTakeNextRequest();
+}
+
+void MoodbarLoader::UpdateGenerateAllTask() {
+  if (generate_all_task_id_ == -1 || generate_all_total_ == -1) return;
+
+  TaskManager* task_manager = app_->task_manager();
+  if (generate_all_queue_.isEmpty() && generate_all_active_.isEmpty()) {
+    const int task_id = generate_all_task_id_;
+    generate_all_task_id_ = -1;
+    task_manager->SetTaskFinished(task_id);
+    return;
+  }
+
+  task_manager->SetTaskProgress(generate_all_task_id_, generate_all_done_,
+                                generate_all_total_);
+}
+
+void MoodbarLoader::TasksChanged() {
+  if (generate_all_task_id_ == -1) return;
+
+  // Pausing lets the songs being worked on finish, but doesn't start any more.
+  const bool paused =
+      app_->task_manager()->IsTaskPaused(generate_all_task_id_);
+  if (paused == generate_all_paused_) return;
+
+  generate_all_paused_ = paused;
+  if (!paused) {
+    MaybeTakeNextRequest();
+  }
+}
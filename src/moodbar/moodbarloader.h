@@ -18,15 +18,20 @@
 #ifndef MOODBARLOADER_H
 #define MOODBARLOADER_H
 
+#include <QFuture>
 #include <QMap>
 #include <QObject>
 #include <QSet>
+#include <memory>
+
+#include "core/song.h"
 
 class QNetworkDiskCache;
 class QUrl;
 
 class Application;
 class MoodbarPipeline;
+class MoodbarStore;
 
 class MoodbarLoader : public QObject {
   Q_OBJECT
@@ -48,28 +53,67 @@ class MoodbarLoader : public QObject {
     WillLoadAsync
   };
 
-  Result Load(const QUrl& url, QByteArray* data,
+  // Library songs should pass their ID and mtime, so their moodbars are kept
+  // in the MoodbarStore.  Pass -1 as the ID for other songs.
+  Result Load(const QUrl& url, int song_id, uint mtime, QByteArray* data,
               MoodbarPipeline** async_pipeline);
 
+ public slots:
+  // Creates moodbars for all the songs in the library that don't have one
+  // yet.  This is a pausable task that uses at most the number of threads in
+  // the "generate_threads" setting, and gives way to moodbars that are
+  // wanted right now.
+  void GenerateAllAsync();
+
  private slots:
   void ReloadSettings();
+  void TasksChanged();
 
   void RequestFinished(MoodbarPipeline* request, const QUrl& filename);
   void MaybeTakeNextRequest();
+  void GenerateAllSongsLoaded(QFuture<SongList> future);
 
  private:
+  struct StoreKey {
+    StoreKey() : song_id_(-1), mtime_(0) {}
+    StoreKey(int song_id, uint mtime) : song_id_(song_id), mtime_(mtime) {}
+
+    int song_id_;
+    uint mtime_;
+  };
+
   static QStringList MoodFilenames(const QString& song_filename);
+  static bool HasMoodFile(const QString& song_filename);
+
+  MoodbarPipeline* CreateRequest(const QUrl& url, const StoreKey& key);
+  void StartRequest(const QUrl& url);
+  bool TakeNextBulkRequest();
+  void UpdateGenerateAllTask();
+
+  SongList SongsWithoutMoodbars();
 
  private:
+  Application* app_;
   QNetworkDiskCache* cache_;
-  QThread* thread_;
+  std::unique_ptr<MoodbarStore> store_;
 
   const int kMaxActiveRequests;
 
   QMap<QUrl, MoodbarPipeline*> requests_;
+  QMap<QUrl, StoreKey> request_keys_;
   QList<QUrl> queued_requests_;
   QSet<QUrl> active_requests_;
 
+  // The "generate all moodbars" task.  Songs are only turned into requests
+  // when there's a thread free for them.
+  int generate_all_task_id_;
+  int generate_all_threads_;
+  bool generate_all_paused_;
+  SongList generate_all_queue_;
+  QSet<QUrl> generate_all_active_;
+  int generate_all_done_;
+  int generate_all_total_;
+
   bool save_alongside_originals_;
   bool disable_moodbar_calculation_;
 };
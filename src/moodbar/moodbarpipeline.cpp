@@ -18,6 +18,7 @@
 #include "moodbarpipeline.h"
 
 #include <QCoreApplication>
+#include <QMutexLocker>
 #include <QThread>
 #include <QUrl>
 
@@ -37,7 +38,8 @@ MoodbarPipeline::MoodbarPipeline(const QUrl& local_filename)
       pipeline_(nullptr),
       convert_element_(nullptr),
       success_(false),
-      running_(false) {}
+      running_(false),
+      cancelled_(false) {}
 
 MoodbarPipeline::~MoodbarPipeline() { Cleanup(); }
 
@@ -68,11 +70,48 @@ GstElement* MoodbarPipeline::CreateElement(const QString& factory_name) {
   return ret;
 }
 
-void MoodbarPipeline::Start() {
+void MoodbarPipeline::Run() {
   Q_ASSERT(QThread::currentThread() != qApp->thread());
 
-  Utilities::SetThreadIOPriority(Utilities::IOPRIO_CLASS_IDLE);
+  // Errors can reach the bus callback while the pipeline is starting, so
+  // mutex_ isn't held here.
+  bool cancelled = false;
+  {
+    QMutexLocker l(&mutex_);
+    cancelled = cancelled_;
+  }
+  if (!cancelled) Start();
+
+  {
+    QMutexLocker l(&mutex_);
+    // The bus callback stops it when the file has been decoded.
+    while (running_ && !cancelled_) {
+      stopped_.wait(&mutex_);
+    }
+    running_ = false;
+    cancelled = cancelled_;
+  }
+
+  // This waits for the streaming threads to stop, so the builder is safe to
+  // use afterwards.
+  Cleanup();
+
+  if (builder_ != nullptr) {
+    if (!cancelled) data_ = builder_->Finish(1000);
+    builder_.reset();
+  }
+  if (cancelled) success_ = false;
+
+  emit Finished(success_);
+}
+
+void MoodbarPipeline::Cancel() {
+  QMutexLocker l(&mutex_);
+  cancelled_ = true;
+  stopped_.wakeAll();
+}
 
+void MoodbarPipeline::Start() {
   if (pipeline_) {
     return;
   }
@@ -86,7 +125,6 @@ void MoodbarPipeline::Start() {
 
   if (!decodebin || !convert_element_ || !spectrum || !fakesink) {
     pipeline_ = nullptr;
-    emit Finished(false);
     return;
   }
 
@@ -95,7 +133,6 @@ void MoodbarPipeline::Start() {
       !gst_element_link(spectrum, fakesink)) {
     qLog(Error) << "Failed to link elements";
     pipeline_ = nullptr;
-    emit Finished(false);
     return;
   }
 
@@ -118,7 +155,10 @@ void MoodbarPipeline::Start() {
   gst_object_unref(bus);
 
   // Start playing
-  running_ = true;
+  {
+    QMutexLocker l(&mutex_);
+    running_ = true;
+  }
   gst_element_set_state(pipeline_, GST_STATE_PLAYING);
 }
 
@@ -187,22 +227,19 @@ GstBusSyncReply MoodbarPipeline::BusCallbackSync(GstBus*, GstMessage* msg,
 }
 
 void MoodbarPipeline::Stop(bool success) {
+  QMutexLocker l(&mutex_);
+  if (!running_) return;
+
   success_ = success;
   running_ = false;
-  if (builder_ != nullptr) {
-    data_ = builder_->Finish(1000);
-    builder_.reset();
-  }
-
-  emit Finished(success);
+  stopped_.wakeAll();
 }
 
 void MoodbarPipeline::Cleanup() {
-  Q_ASSERT(QThread::currentThread() == thread());
-  Q_ASSERT(QThread::currentThread() != qApp->thread());
-
   running_ = false;
   if (pipeline_) {
+    Q_ASSERT(QThread::currentThread() != qApp->thread());
+
     GstBus* bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline_));
     gst_bus_set_sync_handler(bus, nullptr, nullptr, nullptr);
     gst_object_unref(bus);
@@ -21,13 +21,16 @@
 #include <gst/app/gstappsink.h>
 #include <gst/gst.h>
 
+#include <QMutex>
 #include <QObject>
 #include <QUrl>
+#include <QWaitCondition>
 #include <memory>
 
 class MoodbarBuilder;
 
-// Creates moodbar data for a single local music file.
+// Creates moodbar data for a single local music file.  Run() blocks until
+// it's done, so it's meant to be run as a background job.
 class MoodbarPipeline : public QObject {
   Q_OBJECT
 
@@ -40,13 +43,18 @@ class MoodbarPipeline : public QObject {
   bool success() const { return success_; }
   const QByteArray& data() const { return data_; }
 
- public slots:
-  void Start();
+  // Decodes the file and returns when it's finished, after emitting
+  // Finished.  Call it from a background thread.
+  void Run();
+
+  // Makes Run return as soon as possible, without any data.  Thread safe.
+  void Cancel();
 
  signals:
   void Finished(bool success);
 
  private:
+  void Start();
   GstElement* CreateElement(const QString& factory_name);
 
   void ReportError(GstMessage* message);
@@ -69,8 +77,13 @@ class MoodbarPipeline : public QObject {
 
   std::unique_ptr<MoodbarBuilder> builder_;
 
+  // Protects running_ and cancelled_ while Run is waiting.
+  QMutex mutex_;
+  QWaitCondition stopped_;
+
   bool success_;
   bool running_;
+  bool cancelled_;
   QByteArray data_;
 };
 
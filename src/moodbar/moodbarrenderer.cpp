@@ -64,18 +64,23 @@ ColorVector MoodbarRenderer::Colors(const QByteArray& data, MoodbarStyle style,
 
   memset(hue_distribution, 0, sizeof(hue_distribution));
 
-  ColorVector colors;
+  // Convert each sample to HSV just once - QColor would otherwise convert it
+  // again for each of hue(), saturation() and value().
+  QVector<int> hues(samples);
+  QVector<int> saturations(samples);
+  QVector<int> values(samples);
 
   // Read the colors, keeping track of some histograms
   for (int i = 0; i < samples; ++i) {
-    QColor color;
-    color.setRed(int(*data_p++));
-    color.setGreen(int(*data_p++));
-    color.setBlue(int(*data_p++));
+    const int r = *data_p++;
+    const int g = *data_p++;
+    const int b = *data_p++;
 
-    colors << color;
+    int hue;
+    QColor::fromRgb(r, g, b).getHsv(&hue, &saturations[i], &values[i]);
+    hue = qMax(0, hue);
+    hues[i] = hue;
 
-    const int hue = qMax(0, color.hue());
     if (hue_distribution[hue]++ == properties.threshold_) {
       total++;
     }
@@ -97,13 +102,12 @@ ColorVector MoodbarRenderer::Colors(const QByteArray& data, MoodbarStyle style,
 
   // Now huedist is a hue mapper: huedist[h] is the new hue value
   // for a bar with hue h
-  for (ColorVector::iterator it = colors.begin(); it != colors.end(); ++it) {
-    const int hue = qMax(0, it->hue());
-
-    *it = QColor::fromHsv(
-        qBound(0, hue_distribution[hue], 359),
-        qBound(0, it->saturation() * properties.sat_ / 100, 255),
-        qBound(0, it->value() * properties.val_ / 100, 255));
+  ColorVector colors(samples);
+  for (int i = 0; i < samples; ++i) {
+    colors[i] = QColor::fromHsv(
+        qBound(0, hue_distribution[hues[i]], 359),
+        qBound(0, saturations[i] * properties.sat_ / 100, 255),
+        qBound(0, values[i] * properties.val_ / 100, 255));
   }
 
   return colors;
@@ -0,0 +1,274 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "moodbarstore.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QUrl>
+#include <QtEndian>
+
+#include "core/logging.h"
+
+const char MoodbarStore::kMagic[] = "CLMOOD01";
+const int MoodbarStore::kHeaderSize = 8;
+const int MoodbarStore::kRecordHeaderSize = 16;
+
+MoodbarStore::MoodbarStore(const QString& filename)
+    : file_(filename), map_(nullptr), map_size_(0), superseded_bytes_(0) {
+  if (!Open()) {
+    qLog(Warning) << "Couldn't open the moodbar store" << filename;
+    Unmap();
+    file_.close();
+    entries_.clear();
+  }
+}
+
+MoodbarStore::~MoodbarStore() { Unmap(); }
+
+quint32 MoodbarStore::UrlHash(const QUrl& url) {
+  const QByteArray hash =
+      QCryptographicHash::hash(url.toEncoded(), QCryptographicHash::Md5);
+  return qFromLittleEndian<quint32>(
+      reinterpret_cast<const uchar*>(hash.constData()));
+}
+
+bool MoodbarStore::Open() {
+  QDir().mkpath(QFileInfo(file_.fileName()).path());
+  if (!file_.open(QIODevice::ReadWrite)) {
+    return false;
+  }
+
+  if (file_.size() < kHeaderSize || file_.read(kHeaderSize) != kMagic) {
+    if (file_.size() != 0) {
+      qLog(Warning) << "Discarding unrecognised moodbar store"
+                    << file_.fileName();
+    }
+    if (!file_.resize(0) || !file_.seek(0) ||
+        file_.write(kMagic, kHeaderSize) != kHeaderSize || !file_.flush()) {
+      return false;
+    }
+    return true;
+  }
+
+  if (!ReadIndex()) {
+    return false;
+  }
+
+  // Get rid of replaced records once they make up most of the file.
+  if (superseded_bytes_ > file_.size() / 2) {
+    Compact();
+  }
+  return file_.isOpen();
+}
+
+bool MoodbarStore::ReadIndex() {
+  const qint64 size = file_.size();
+  if (!EnsureMapped(size)) {
+    return false;
+  }
+
+  qint64 offset = kHeaderSize;
+  while (offset + kRecordHeaderSize <= size) {
+    const uchar* header = map_ + offset;
+    const int song_id = qFromLittleEndian<qint32>(header);
+
+    Entry entry;
+    entry.mtime_ = qFromLittleEndian<quint32>(header + 4);
+    entry.url_hash_ = qFromLittleEndian<quint32>(header + 8);
+    entry.length_ = qFromLittleEndian<quint32>(header + 12);
+    entry.offset_ = offset + kRecordHeaderSize;
+
+    if (entry.offset_ + entry.length_ > size) {
+      break;
+    }
+
+    auto it = entries_.find(song_id);
+    if (it == entries_.end()) {
+      entries_.insert(song_id, entry);
+    } else {
+      superseded_bytes_ += kRecordHeaderSize + it->length_;
+      *it = entry;
+    }
+
+    offset = entry.offset_ + entry.length_;
+  }
+
+  if (offset != size) {
+    // We must have been killed in the middle of writing the last record.
+    qLog(Warning) << "Truncating incomplete record at" << offset << "in"
+                  << file_.fileName();
+    Unmap();
+    if (!file_.resize(offset)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void MoodbarStore::Compact() {
+  const QString filename = file_.fileName();
+
+  // The compacted store is written next to the old one and renamed over it,
+  // so the old one is still there if we're killed in the middle.
+  QSaveFile new_file(filename);
+  if (!EnsureMapped(file_.size()) || !new_file.open(QIODevice::WriteOnly)) {
+    return;
+  }
+
+  QHash<int, Entry> new_entries;
+  bool ok = new_file.write(kMagic, kHeaderSize) == kHeaderSize;
+
+  for (auto it = entries_.constBegin(); ok && it != entries_.constEnd(); ++it) {
+    const qint64 header_offset = it->offset_ - kRecordHeaderSize;
+    const qint64 length = kRecordHeaderSize + it->length_;
+
+    Entry entry = *it;
+    entry.offset_ = new_file.pos() + kRecordHeaderSize;
+    new_entries.insert(it.key(), entry);
+
+    ok = new_file.write(reinterpret_cast<const char*>(map_ + header_offset),
+                        length) == length;
+  }
+
+  if (!ok) {
+    qLog(Warning) << "Couldn't compact the moodbar store" << filename;
+    return;
+  }
+
+  Unmap();
+  file_.close();
+  ok = new_file.commit();
+  if (!file_.open(QIODevice::ReadWrite)) {
+    entries_.clear();
+    return;
+  }
+
+  if (!ok) {
+    qLog(Warning) << "Couldn't replace the moodbar store" << filename
+                  << new_file.errorString();
+    return;
+  }
+
+  qLog(Info) << "Compacted the moodbar store, dropping" << superseded_bytes_
+             << "bytes";
+
+  entries_ = new_entries;
+  superseded_bytes_ = 0;
+}
+
+bool MoodbarStore::EnsureMapped(qint64 end) {
+  if (map_ && end <= map_size_) {
+    return true;
+  }
+
+  // The file has grown since it was mapped.
+  Unmap();
+  const qint64 size = file_.size();
+  if (size < end || size == 0) {
+    return false;
+  }
+
+  map_ = file_.map(0, size);
+  if (!map_) {
+    qLog(Warning) << "Couldn't map" << file_.fileName() << file_.errorString();
+    return false;
+  }
+  map_size_ = size;
+  return true;
+}
+
+void MoodbarStore::Unmap() {
+  if (map_) {
+    file_.unmap(map_);
+    map_ = nullptr;
+  }
+  map_size_ = 0;
+}
+
+const MoodbarStore::Entry* MoodbarStore::Find(int song_id, uint mtime,
+                                              const QUrl& url) const {
+  auto it = entries_.constFind(song_id);
+  if (it == entries_.constEnd() || it->mtime_ != mtime ||
+      it->url_hash_ != UrlHash(url)) {
+    return nullptr;
+  }
+  return &it.value();
+}
+
+bool MoodbarStore::Get(int song_id, uint mtime, const QUrl& url,
+                       QByteArray* data) {
+  QMutexLocker l(&mutex_);
+
+  const Entry* entry = Find(song_id, mtime, url);
+  if (!entry || !EnsureMapped(entry->offset_ + entry->length_)) {
+    return false;
+  }
+
+  *data = QByteArray(reinterpret_cast<const char*>(map_ + entry->offset_),
+                     entry->length_);
+  return true;
+}
+
+bool MoodbarStore::Contains(int song_id, uint mtime, const QUrl& url) {
+  QMutexLocker l(&mutex_);
+  return Find(song_id, mtime, url) != nullptr;
+}
+
+void MoodbarStore::Put(int song_id, uint mtime, const QUrl& url,
+                       const QByteArray& data) {
+  QMutexLocker l(&mutex_);
+  if (!file_.isOpen()) {
+    return;
+  }
+
+  Entry entry;
+  entry.mtime_ = mtime;
+  entry.url_hash_ = UrlHash(url);
+  entry.length_ = data.size();
+
+  QByteArray record(kRecordHeaderSize, '\0');
+  uchar* header = reinterpret_cast<uchar*>(record.data());
+  qToLittleEndian<qint32>(song_id, header);
+  qToLittleEndian<quint32>(entry.mtime_, header + 4);
+  qToLittleEndian<quint32>(entry.url_hash_, header + 8);
+  qToLittleEndian<quint32>(entry.length_, header + 12);
+  record.append(data);
+
+  const qint64 offset = file_.size();
+  if (!file_.seek(offset) || file_.write(record) != record.size() ||
+      !file_.flush()) {
+    qLog(Warning) << "Couldn't write to the moodbar store" << file_.fileName()
+                  << file_.errorString();
+    // Don't leave half a record behind for the next one to be appended to.
+    file_.resize(offset);
+    return;
+  }
+  entry.offset_ = offset + kRecordHeaderSize;
+
+  auto it = entries_.find(song_id);
+  if (it == entries_.end()) {
+    entries_.insert(song_id, entry);
+  } else {
+    superseded_bytes_ += kRecordHeaderSize + it->length_;
+    *it = entry;
+  }
+}
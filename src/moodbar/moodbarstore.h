@@ -0,0 +1,90 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef MOODBAR_MOODBARSTORE_H_
+#define MOODBAR_MOODBARSTORE_H_
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+class QUrl;
+
+// Keeps the moodbars of library songs in a single append-only file that's
+// mapped into memory, so looking one up doesn't have to open a file of its
+// own.  Moodbars are keyed by the song's ID in the library and its mtime - a
+// song that changed on disk has to get a new one.  A hash of the song's URL
+// is stored as well, so songs on devices that happen to share an ID with a
+// library song aren't given its moodbar.
+//
+// Each record in the file is a little-endian header of song ID, mtime, URL
+// hash and data length, followed by the data.  A newer record for the same
+// song replaces the older one, which is only dropped when the file is next
+// opened and is mostly made up of records like that.
+//
+// All methods are thread-safe.
+class MoodbarStore {
+ public:
+  explicit MoodbarStore(const QString& filename);
+  ~MoodbarStore();
+
+  static const char kMagic[];
+  static const int kHeaderSize;
+  static const int kRecordHeaderSize;
+
+  bool is_open() const { return file_.isOpen(); }
+
+  // Copies the song's moodbar to data and returns true if there is one for
+  // this version of the song.
+  bool Get(int song_id, uint mtime, const QUrl& url, QByteArray* data);
+  bool Contains(int song_id, uint mtime, const QUrl& url);
+
+  // Appends the moodbar to the end of the file.
+  void Put(int song_id, uint mtime, const QUrl& url, const QByteArray& data);
+
+ private:
+  struct Entry {
+    uint mtime_;
+    quint32 url_hash_;
+    qint64 offset_;
+    quint32 length_;
+  };
+
+  static quint32 UrlHash(const QUrl& url);
+
+  bool Open();
+  bool ReadIndex();
+  void Compact();
+  bool EnsureMapped(qint64 end);
+  void Unmap();
+
+  const Entry* Find(int song_id, uint mtime, const QUrl& url) const;
+
+  QMutex mutex_;
+  QFile file_;
+
+  uchar* map_;
+  qint64 map_size_;
+
+  QHash<int, Entry> entries_;
+  // The bytes taken up by records that have since been replaced.
+  qint64 superseded_bytes_;
+};
+
+#endif  // MOODBAR_MOODBARSTORE_H_
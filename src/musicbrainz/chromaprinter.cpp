@@ -155,24 +155,23 @@ QString Chromaprinter::CreateFingerprint() {
 
 #if CHROMAPRINT_VERSION_MAJOR >= 1 && CHROMAPRINT_VERSION_MINOR >= 4
   u_int32_t* fprint = nullptr;
-  char* encoded = nullptr;
 #else
   void* fprint = nullptr;
-  void* encoded = nullptr;
 #endif
 
   int ret = chromaprint_get_raw_fingerprint(chromaprint, &fprint, &size);
 
-  QByteArray fingerprint;
+  QString fingerprint;
   if (ret == 1) {
-    int encoded_size = 0;
-    chromaprint_encode_fingerprint(fprint, size, CHROMAPRINT_ALGORITHM_DEFAULT,
-                                   &encoded, &encoded_size, 1);
-
-    fingerprint.append(reinterpret_cast<char*>(encoded), encoded_size);
+    const u_int32_t* values = reinterpret_cast<const u_int32_t*>(fprint);
+    QVector<quint32> raw;
+    raw.reserve(size);
+    for (int i = 0; i < size; ++i) {
+      raw << values[i];
+    }
+    fingerprint = EncodeFingerprint(raw);
 
     chromaprint_dealloc(fprint);
-    chromaprint_dealloc(encoded);
   }
   chromaprint_free(chromaprint);
   int codegen_time = time.elapsed();
@@ -221,3 +220,50 @@ GstFlowReturn Chromaprinter::NewBufferCallback(GstAppSink* app_sink,
 
   return GST_FLOW_OK;
 }
+
+QString Chromaprinter::EncodeFingerprint(const QVector<quint32>& raw) {
+  int encoded_size = 0;
+
+#if CHROMAPRINT_VERSION_MAJOR >= 1 && CHROMAPRINT_VERSION_MINOR >= 4
+  const u_int32_t* fprint = reinterpret_cast<const u_int32_t*>(raw.constData());
+  char* encoded = nullptr;
+#else
+  const void* fprint = raw.constData();
+  void* encoded = nullptr;
+#endif
+
+  QString ret;
+  if (chromaprint_encode_fingerprint(fprint, raw.count(),
+                                     CHROMAPRINT_ALGORITHM_DEFAULT, &encoded,
+                                     &encoded_size, 1) == 1) {
+    ret = QString::fromLatin1(reinterpret_cast<char*>(encoded), encoded_size);
+    chromaprint_dealloc(encoded);
+  }
+  return ret;
+}
+
+QVector<quint32> Chromaprinter::DecodeFingerprint(const QString& fingerprint) {
+  QByteArray encoded = fingerprint.toLatin1();
+  int size = 0;
+  int algorithm = 0;
+
+#if CHROMAPRINT_VERSION_MAJOR >= 1 && CHROMAPRINT_VERSION_MINOR >= 4
+  u_int32_t* fprint = nullptr;
+  const char* data = encoded.constData();
+#else
+  void* fprint = nullptr;
+  void* data = encoded.data();
+#endif
+
+  QVector<quint32> ret;
+  if (chromaprint_decode_fingerprint(data, encoded.size(), &fprint, &size,
+                                     &algorithm, 1) == 1) {
+    const u_int32_t* values = reinterpret_cast<const u_int32_t*>(fprint);
+    ret.reserve(size);
+    for (int i = 0; i < size; ++i) {
+      ret << values[i];
+    }
+    chromaprint_dealloc(fprint);
+  }
+  return ret;
+}
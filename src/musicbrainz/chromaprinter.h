@@ -23,6 +23,7 @@
 
 #include <QBuffer>
 #include <QString>
+#include <QVector>
 
 class Chromaprinter {
   // Creates a Chromaprint fingerprint from a song.
@@ -41,6 +42,15 @@ class Chromaprinter {
   // could be created.
   QString CreateFingerprint();
 
+  // Encodes Chromaprint's raw sub-fingerprints the same way CreateFingerprint
+  // does.  Returns an empty string if they couldn't be encoded.
+  static QString EncodeFingerprint(const QVector<quint32>& raw);
+
+  // Decodes a fingerprint made by CreateFingerprint back into Chromaprint's
+  // raw sub-fingerprints, so it can be compared with other fingerprints.
+  // Returns an empty vector if the fingerprint couldn't be decoded.
+  static QVector<quint32> DecodeFingerprint(const QString& fingerprint);
+
  private:
   GstElement* CreateElement(const QString& factory_name,
                             GstElement* bin = nullptr);
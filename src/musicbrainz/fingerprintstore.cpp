@@ -0,0 +1,347 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "fingerprintstore.h"
+
+#include <QFuture>
+#include <QMutexLocker>
+#include <QSet>
+#include <QSqlQuery>
+#include <QtAlgorithms>
+#include <functional>
+
+#include "chromaprinter.h"
+#include "core/closure.h"
+#include "core/database.h"
+#include "core/logging.h"
+#include "core/scopedtransaction.h"
+#include "core/taskmanager.h"
+
+const int FingerprintStore::kHashItems = 120;
+const quint32 FingerprintStore::kHashSampling = 4;
+const int FingerprintStore::kMinSharedHashes = 3;
+const int FingerprintStore::kMaxSongsPerHash = 50;
+const int FingerprintStore::kMaxOffset = 8;
+const int FingerprintStore::kMinOverlap = 60;
+const double FingerprintStore::kMaxBitErrorRate = 0.1;
+
+FingerprintStore::FingerprintStore(Database* db, TaskManager* task_manager,
+                                   QObject* parent)
+    : QObject(parent),
+      db_(db),
+      task_manager_(task_manager),
+      // Fingerprinting decodes a lot of audio - one file at a time is plenty
+      // for a background job.
+      work_queue_(WorkScheduler::Priority_Idle, 1),
+      updating_(false),
+      abort_(0) {}
+
+FingerprintStore::~FingerprintStore() {
+  abort_ = 1;
+  work_queue_.WaitForDone();
+}
+
+bool FingerprintStore::IsStorable(const Song& song) {
+  // CUE sheet tracks share a file, and Chromaprinter only ever looks at the
+  // start of it.
+  return song.is_library_song() && !song.has_cue() &&
+         song.url().scheme() == "file";
+}
+
+QString FingerprintStore::Fingerprint(const Song& song) {
+  QString fingerprint = StoredFingerprint(song);
+  if (!fingerprint.isEmpty()) return fingerprint;
+
+  fingerprint = Chromaprinter(song.url().toLocalFile()).CreateFingerprint();
+  if (!fingerprint.isEmpty()) StoreFingerprint(song, fingerprint);
+
+  return fingerprint;
+}
+
+QString FingerprintStore::StoredFingerprint(const Song& song) {
+  if (!IsStorable(song)) return QString();
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  // Check the filename too, so a song from a device's library can't pick up
+  // the fingerprint of a library song with the same ID.
+  QSqlQuery q(db);
+  q.prepare(
+      "SELECT f.fingerprint FROM fingerprints AS f"
+      " INNER JOIN songs AS s ON s.ROWID = f.song_id"
+      " WHERE f.song_id = :id AND f.mtime = :mtime AND s.filename = :filename");
+  q.bindValue(":id", song.id());
+  q.bindValue(":mtime", song.mtime());
+  q.bindValue(":filename", song.url().toEncoded());
+  q.exec();
+  if (db_->CheckErrors(q) || !q.next()) return QString();
+
+  return q.value(0).toString();
+}
+
+void FingerprintStore::StoreFingerprint(const Song& song,
+                                        const QString& fingerprint) {
+  if (!IsStorable(song)) return;
+
+  const QList<quint32> hashes =
+      Hashes(Chromaprinter::DecodeFingerprint(fingerprint));
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+  ScopedTransaction t(&db);
+
+  QSqlQuery insert(db);
+  insert.prepare(
+      "INSERT OR REPLACE INTO fingerprints (song_id, mtime, fingerprint)"
+      " SELECT ROWID, :mtime, :fingerprint FROM songs"
+      " WHERE ROWID = :id AND filename = :filename");
+  insert.bindValue(":mtime", song.mtime());
+  insert.bindValue(":fingerprint", fingerprint);
+  insert.bindValue(":id", song.id());
+  insert.bindValue(":filename", song.url().toEncoded());
+  insert.exec();
+  if (db_->CheckErrors(insert) || insert.numRowsAffected() <= 0) return;
+
+  QSqlQuery remove_hashes(db);
+  remove_hashes.prepare("DELETE FROM fingerprint_hashes WHERE song_id = :id");
+  remove_hashes.bindValue(":id", song.id());
+  remove_hashes.exec();
+  if (db_->CheckErrors(remove_hashes)) return;
+
+  QSqlQuery insert_hash(db);
+  insert_hash.prepare(
+      "INSERT INTO fingerprint_hashes (hash, song_id) VALUES (:hash, :id)");
+  for (quint32 hash : hashes) {
+    insert_hash.bindValue(":hash", qint64(hash));
+    insert_hash.bindValue(":id", song.id());
+    insert_hash.exec();
+    if (db_->CheckErrors(insert_hash)) return;
+  }
+
+  t.Commit();
+}
+
+QList<quint32> FingerprintStore::Hashes(const QVector<quint32>& raw) {
+  // Choosing values by their content rather than their position means the
+  // same values get picked even if one file is offset from the other.
+  QSet<quint32> ret;
+  for (int i = 0; i < raw.count() && i < kHashItems; ++i) {
+    if (raw[i] % kHashSampling == 0) ret << raw[i];
+  }
+  return ret.toList();
+}
+
+double FingerprintStore::Similarity(const QVector<quint32>& a,
+                                    const QVector<quint32>& b) {
+  double best = 0.0;
+
+  for (int offset = -kMaxOffset; offset <= kMaxOffset; ++offset) {
+    int errors = 0;
+    int count = 0;
+    for (int i = qMax(0, -offset); i < a.count() && i + offset < b.count();
+         ++i) {
+      errors += qPopulationCount(a[i] ^ b[i + offset]);
+      count++;
+    }
+
+    if (count < kMinOverlap) continue;
+    best = qMax(best, 1.0 - double(errors) / (count * 32));
+  }
+
+  return best;
+}
+
+void FingerprintStore::UpdateDuplicatesAsync() {
+  if (updating_) return;
+  updating_ = true;
+
+  QFuture<void> future = work_queue_.Run<void>(
+      std::bind(&FingerprintStore::UpdateDuplicates, this));
+  NewClosure(future, this, SLOT(UpdateDuplicatesFinished()));
+}
+
+void FingerprintStore::UpdateDuplicatesFinished() {
+  updating_ = false;
+  emit DuplicatesUpdated();
+}
+
+void FingerprintStore::UpdateDuplicates() {
+  RemoveDeletedSongs();
+
+  const SongList songs = SongsWithoutFingerprints();
+  if (!songs.isEmpty()) {
+    const int task_id = task_manager_->StartTask(tr("Fingerprinting songs"));
+    TaskManager::ScopedTask task(task_id, task_manager_);
+
+    int done = 0;
+    for (const Song& song : songs) {
+      if (abort_) return;
+
+      const QString fingerprint =
+          Chromaprinter(song.url().toLocalFile()).CreateFingerprint();
+      if (!fingerprint.isEmpty()) StoreFingerprint(song, fingerprint);
+
+      task_manager_->SetTaskProgress(task_id, ++done, songs.count());
+    }
+  }
+
+  if (abort_) return;
+  FindDuplicates();
+}
+
+void FingerprintStore::RemoveDeletedSongs() {
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+  ScopedTransaction t(&db);
+
+  for (const QString& table : QStringList() << "fingerprints"
+                                            << "fingerprint_hashes"
+                                            << "audio_duplicates") {
+    QSqlQuery q(db);
+    q.prepare(QString("DELETE FROM %1 WHERE song_id NOT IN"
+                      " (SELECT ROWID FROM songs WHERE unavailable = 0)")
+                  .arg(table));
+    q.exec();
+    if (db_->CheckErrors(q)) return;
+  }
+
+  t.Commit();
+}
+
+SongList FingerprintStore::SongsWithoutFingerprints() {
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  QSqlQuery q(db);
+  q.prepare(
+      "SELECT s.ROWID, s.filename, s.mtime FROM songs AS s"
+      " LEFT JOIN fingerprints AS f ON f.song_id = s.ROWID"
+      " WHERE s.unavailable = 0 AND s.cue_path = '' AND"
+      "  s.filename LIKE 'file:%' AND"
+      "  (f.song_id IS NULL OR f.mtime != s.mtime)");
+  q.exec();
+  if (db_->CheckErrors(q)) return SongList();
+
+  SongList ret;
+  while (q.next()) {
+    Song song;
+    song.set_id(q.value(0).toInt());
+    song.set_url(QUrl::fromEncoded(q.value(1).toByteArray()));
+    song.set_mtime(q.value(2).toInt());
+    ret << song;
+  }
+  return ret;
+}
+
+QVector<quint32> FingerprintStore::LoadRawFingerprint(int song_id) {
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  QSqlQuery q(db);
+  q.prepare("SELECT fingerprint FROM fingerprints WHERE song_id = :id");
+  q.bindValue(":id", song_id);
+  q.exec();
+  if (db_->CheckErrors(q) || !q.next()) return QVector<quint32>();
+
+  return Chromaprinter::DecodeFingerprint(q.value(0).toString());
+}
+
+QList<int> FingerprintStore::FingerprintedSongs() {
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  QSqlQuery q(db);
+  q.prepare("SELECT song_id FROM fingerprints ORDER BY song_id");
+  q.exec();
+  if (db_->CheckErrors(q)) return QList<int>();
+
+  QList<int> ret;
+  while (q.next()) {
+    ret << q.value(0).toInt();
+  }
+  return ret;
+}
+
+QList<int> FingerprintStore::DuplicateCandidates(int song_id) {
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  // Both sides of the join are looked up through an index, so this only ever
+  // reads the rows of the song's own values.
+  QSqlQuery q(db);
+  q.prepare(
+      "SELECT other.song_id FROM fingerprint_hashes AS mine"
+      " INNER JOIN fingerprint_hashes AS other ON other.hash = mine.hash"
+      " WHERE mine.song_id = :id AND other.song_id > :id AND"
+      "  (SELECT COUNT(*) FROM fingerprint_hashes AS h"
+      "   WHERE h.hash = mine.hash) <= :max_songs"
+      " GROUP BY other.song_id HAVING COUNT(*) >= :min_shared");
+  q.bindValue(":id", song_id);
+  q.bindValue(":max_songs", kMaxSongsPerHash);
+  q.bindValue(":min_shared", kMinSharedHashes);
+  q.exec();
+  if (db_->CheckErrors(q)) return QList<int>();
+
+  QList<int> ret;
+  while (q.next()) {
+    ret << q.value(0).toInt();
+  }
+  return ret;
+}
+
+void FingerprintStore::FindDuplicates() {
+  // Each song is compared with the songs after it, so every pair is only
+  // compared once, and the database is only locked for one song at a time.
+  QSet<int> duplicates;
+  int pairs = 0;
+  for (int song_id : FingerprintedSongs()) {
+    if (abort_) return;
+
+    const QList<int> candidates = DuplicateCandidates(song_id);
+    if (candidates.isEmpty()) continue;
+    pairs += candidates.count();
+
+    const QVector<quint32> fingerprint = LoadRawFingerprint(song_id);
+    for (int candidate : candidates) {
+      if (Similarity(fingerprint, LoadRawFingerprint(candidate)) >=
+          1.0 - kMaxBitErrorRate) {
+        duplicates << song_id << candidate;
+      }
+    }
+  }
+
+  qLog(Debug) << "Compared" << pairs << "possible duplicate pairs";
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+  ScopedTransaction t(&db);
+
+  QSqlQuery clear(db);
+  clear.prepare("DELETE FROM audio_duplicates");
+  clear.exec();
+  if (db_->CheckErrors(clear)) return;
+
+  QSqlQuery insert(db);
+  insert.prepare("INSERT INTO audio_duplicates (song_id) VALUES (:id)");
+  for (int id : duplicates) {
+    insert.bindValue(":id", id);
+    insert.exec();
+    if (db_->CheckErrors(insert)) return;
+  }
+
+  t.Commit();
+}
@@ -0,0 +1,116 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MUSICBRAINZ_FINGERPRINTSTORE_H_
+#define MUSICBRAINZ_FINGERPRINTSTORE_H_
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QVector>
+
+#include "core/song.h"
+#include "core/workscheduler.h"
+#include "gtest/gtest_prod.h"
+
+class Database;
+class TaskManager;
+
+// Keeps the Chromaprint fingerprints of library songs in the database, so they
+// only have to be made once per version of a file.  Also uses them to find
+// songs in the library that sound the same, whatever their tags say.
+//
+// Besides each song's fingerprint, a handful of its raw sub-fingerprint values
+// are stored in an indexed table.  Each song's values are looked up in that
+// index to find the songs that share enough of them, and only those pairs get
+// their whole fingerprints compared.
+class FingerprintStore : public QObject {
+  Q_OBJECT
+
+ public:
+  FingerprintStore(Database* db, TaskManager* task_manager,
+                   QObject* parent = nullptr);
+  ~FingerprintStore();
+
+  // How many raw values from the start of a fingerprint are considered for
+  // the index, and 1 in how many of them (by value) are kept.
+  static const int kHashItems;
+  static const quint32 kHashSampling;
+
+  // Pairs of songs need to share this many indexed values to be compared.
+  static const int kMinSharedHashes;
+  // Values shared by more songs than this (silence, mostly) are ignored.
+  static const int kMaxSongsPerHash;
+
+  // Fingerprints are compared at every offset up to this many raw values, to
+  // allow for files that start slightly earlier or later.  At least
+  // kMinOverlap values have to line up.
+  static const int kMaxOffset;
+  static const int kMinOverlap;
+
+  // The proportion of bits that can differ between two songs that sound the
+  // same.
+  static const double kMaxBitErrorRate;
+
+  // Returns a fingerprint for the song.  Library songs are looked up in the
+  // store first, and stored after being fingerprinted.  This method is
+  // blocking, so you want to call it in another thread.
+  QString Fingerprint(const Song& song);
+
+  // Returns how similar two raw fingerprints are, from 0 (nothing in common)
+  // to 1 (identical).
+  static double Similarity(const QVector<quint32>& a,
+                           const QVector<quint32>& b);
+
+ public slots:
+  // Fingerprints all the library songs that don't have a current fingerprint
+  // yet, in the background at idle priority, and then works out which songs
+  // sound the same.  Emits DuplicatesUpdated when it's done.
+  void UpdateDuplicatesAsync();
+
+ signals:
+  void DuplicatesUpdated();
+
+ private slots:
+  void UpdateDuplicatesFinished();
+
+ private:
+  static bool IsStorable(const Song& song);
+  static QList<quint32> Hashes(const QVector<quint32>& raw);
+
+  QString StoredFingerprint(const Song& song);
+  void StoreFingerprint(const Song& song, const QString& fingerprint);
+
+  void UpdateDuplicates();
+  void RemoveDeletedSongs();
+  SongList SongsWithoutFingerprints();
+  QVector<quint32> LoadRawFingerprint(int song_id);
+  QList<int> FingerprintedSongs();
+  // Returns the songs with a higher ID that share enough indexed values with
+  // this one to be compared with it.
+  QList<int> DuplicateCandidates(int song_id);
+  void FindDuplicates();
+
+  FRIEND_TEST(FingerprintStoreTest, FindsDuplicates);
+
+  Database* db_;
+  TaskManager* task_manager_;
+
+  WorkQueue work_queue_;
+  bool updating_;
+  QAtomicInt abort_;
+};
+
+#endif  // MUSICBRAINZ_FINGERPRINTSTORE_H_
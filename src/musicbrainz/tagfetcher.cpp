@@ -23,12 +23,30 @@
 #include <QtConcurrentMap>
 
 #include "acoustidclient.h"
-#include "chromaprinter.h"
 #include "core/timeconstants.h"
+#include "fingerprintstore.h"
 #include "musicbrainzclient.h"
 
-TagFetcher::TagFetcher(QObject* parent)
+namespace {
+
+// Gets songs' fingerprints through the store, so library songs that have been
+// fingerprinted before don't need decoding again.
+struct GetFingerprint {
+  typedef QString result_type;
+
+  explicit GetFingerprint(FingerprintStore* store) : store_(store) {}
+  QString operator()(const Song& song) const {
+    return store_->Fingerprint(song);
+  }
+
+  FingerprintStore* store_;
+};
+
+}  // namespace
+
+TagFetcher::TagFetcher(FingerprintStore* fingerprint_store, QObject* parent)
     : QObject(parent),
+      fingerprint_store_(fingerprint_store),
       fingerprint_watcher_(nullptr),
       acoustid_client_(new AcoustidClient(this)),
       musicbrainz_client_(new MusicBrainzClient(this)) {
@@ -39,16 +57,13 @@ TagFetcher::TagFetcher(QObject* parent)
           SLOT(TagsFetched(int, MusicBrainzClient::ResultList)));
 }
 
-QString TagFetcher::GetFingerprint(const Song& song) {
-  return Chromaprinter(song.url().toLocalFile()).CreateFingerprint();
-}
-
 void TagFetcher::StartFetch(const SongList& songs) {
   Cancel();
 
   songs_ = songs;
 
-  QFuture<QString> future = QtConcurrent::mapped(songs_, GetFingerprint);
+  QFuture<QString> future =
+      QtConcurrent::mapped(songs_, GetFingerprint(fingerprint_store_));
   fingerprint_watcher_ = new QFutureWatcher<QString>(this);
   connect(fingerprint_watcher_, SIGNAL(resultReadyAt(int)),
           SLOT(FingerprintFound(int)));
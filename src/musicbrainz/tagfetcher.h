@@ -25,6 +25,7 @@
 #include "musicbrainzclient.h"
 
 class AcoustidClient;
+class FingerprintStore;
 
 class TagFetcher : public QObject {
   Q_OBJECT
@@ -33,7 +34,7 @@ class TagFetcher : public QObject {
   // MusicBrainzClient.
 
  public:
-  TagFetcher(QObject* parent = nullptr);
+  TagFetcher(FingerprintStore* fingerprint_store, QObject* parent = nullptr);
 
   void StartFetch(const SongList& songs);
 
@@ -51,8 +52,7 @@ class TagFetcher : public QObject {
   void TagsFetched(int index, const MusicBrainzClient::ResultList& result);
 
  private:
-  static QString GetFingerprint(const Song& song);
-
+  FingerprintStore* fingerprint_store_;
   QFutureWatcher<QString>* fingerprint_watcher_;
   AcoustidClient* acoustid_client_;
   MusicBrainzClient* musicbrainz_client_;
@@ -27,7 +27,6 @@
 #include <QMutableListIterator>
 #include <QSortFilterProxyModel>
 #include <QUndoStack>
-#include <QtConcurrentRun>
 #include <QtDebug>
 #include <algorithm>
 #include <functional>
@@ -44,6 +43,8 @@
 #include "core/player.h"
 #include "core/tagreaderclient.h"
 #include "core/timeconstants.h"
+#include "core/tracing.h"
+#include "core/workscheduler.h"
 #include "internet/core/internetmimedata.h"
 #include "internet/core/internetmodel.h"
 #include "internet/core/internetplaylistitem.h"
@@ -60,6 +61,7 @@
 #include "playlistbackend.h"
 #include "playlistfilter.h"
 #include "playlistitemmimedata.h"
+#include "playlistsorter.h"
 #include "playlistundocommands.h"
 #include "playlistview.h"
 #include "queue.h"
@@ -102,17 +104,6 @@ const int Playlist::kUndoItemLimit = 500;
 const qint64 Playlist::kMinScrobblePointNsecs = 31ll * kNsecPerSec;
 const qint64 Playlist::kMaxScrobblePointNsecs = 240ll * kNsecPerSec;
 
-namespace {
-QString removePrefix(const QString& a, const QStringList& prefixes) {
-  for (const QString& prefix : prefixes) {
-    if (a.startsWith(prefix)) {
-      return a.mid(prefix.size());
-    }
-  }
-  return a;
-}
-}  // namespace
-
 Playlist::Playlist(PlaylistBackend* backend, TaskManager* task_manager,
                    LibraryBackend* library, int id, const QString& special_type,
                    bool favorite, QObject* parent)
@@ -134,17 +125,20 @@ Playlist::Playlist(PlaylistBackend* backend, TaskManager* task_manager,
       playlist_sequence_(nullptr),
       ignore_sorting_(false),
       undo_stack_(new QUndoStack(this)),
+      row_cache_(ColumnCount, &Playlist::BuildRowCache),
       special_type_(special_type),
       cancel_restore_(false) {
   undo_stack_->setUndoLimit(kUndoStackSize);
 
+  // This has to be connected before anything else (like the filter) sees the
+  // signal, so they never read stale data from the cache.
+  connect(this, SIGNAL(dataChanged(QModelIndex, QModelIndex)),
+          SLOT(InvalidateRowCache(QModelIndex, QModelIndex)));
   connect(this, SIGNAL(rowsInserted(const QModelIndex&, int, int)),
           SIGNAL(PlaylistChanged()));
   connect(this, SIGNAL(rowsRemoved(const QModelIndex&, int, int)),
           SIGNAL(PlaylistChanged()));
 
-  Restore();
-
   proxy_->setSourceModel(this);
   queue_->setSourceModel(this);
 
@@ -275,6 +269,47 @@ bool Playlist::set_column_value(Song& song, Playlist::Column column,
   return true;
 }
 
+void Playlist::BuildRowCache(const PlaylistItemPtr& item,
+                             QVector<QVariant>* values) {
+  const Song song = item->Metadata();
+  QVector<QVariant>& v = *values;
+
+  // Don't forget to change PlaylistSorter when adding new columns
+  v[Column_Title] = song.PrettyTitle();
+  v[Column_Artist] = song.artist();
+  v[Column_Album] = song.album();
+  v[Column_Length] = song.length_nanosec();
+  v[Column_Track] = song.track();
+  v[Column_Disc] = song.disc();
+  v[Column_Year] = song.year();
+  v[Column_OriginalYear] = song.effective_originalyear();
+  v[Column_Genre] = song.genre();
+  v[Column_AlbumArtist] = song.playlist_albumartist();
+  v[Column_Composer] = song.composer();
+  v[Column_Performer] = song.performer();
+  v[Column_Grouping] = song.grouping();
+
+  v[Column_Rating] = song.rating();
+  v[Column_PlayCount] = song.playcount();
+  v[Column_SkipCount] = song.skipcount();
+  v[Column_LastPlayed] = song.lastplayed();
+  v[Column_Score] = song.score();
+
+  v[Column_BPM] = song.bpm();
+  v[Column_Bitrate] = song.bitrate();
+  v[Column_Samplerate] = song.samplerate();
+  v[Column_Filename] = song.url();
+  v[Column_BaseFilename] = song.basefilename();
+  v[Column_Filesize] = song.filesize();
+  v[Column_Filetype] = song.filetype();
+  v[Column_DateModified] = song.mtime();
+  v[Column_DateCreated] = song.ctime();
+
+  v[Column_Comment] = song.comment().simplified();
+
+  v[Column_Source] = item->Url();
+}
+
 QVariant Playlist::data(const QModelIndex& index, int role) const {
   switch (role) {
     case Role_IsCurrent:
@@ -295,81 +330,24 @@ QVariant Playlist::data(const QModelIndex& index, int role) const {
              items_[index.row()]->IsLocalLibraryItem() &&
              items_[index.row()]->Metadata().id() != -1;
 
+    case Role_FilterText:
+      return row_cache_.FilterText(items_[index.row()], index.column());
+
+    case Role_LibrarySongId:
+      return items_[index.row()]->IsLocalLibraryItem()
+                 ? items_[index.row()]->Metadata().id()
+                 : -1;
+
     case Qt::EditRole:
     case Qt::ToolTipRole:
-    case Qt::DisplayRole: {
-      PlaylistItemPtr item = items_[index.row()];
-      Song song = item->Metadata();
-
-      // Don't forget to change Playlist::CompareItems when adding new columns
-      switch (index.column()) {
-        case Column_Title:
-          return song.PrettyTitle();
-        case Column_Artist:
-          return song.artist();
-        case Column_Album:
-          return song.album();
-        case Column_Length:
-          return song.length_nanosec();
-        case Column_Track:
-          return song.track();
-        case Column_Disc:
-          return song.disc();
-        case Column_Year:
-          return song.year();
-        case Column_OriginalYear:
-          return song.effective_originalyear();
-        case Column_Genre:
-          return song.genre();
-        case Column_AlbumArtist:
-          return song.playlist_albumartist();
-        case Column_Composer:
-          return song.composer();
-        case Column_Performer:
-          return song.performer();
-        case Column_Grouping:
-          return song.grouping();
-
-        case Column_Rating:
-          return song.rating();
-        case Column_PlayCount:
-          return song.playcount();
-        case Column_SkipCount:
-          return song.skipcount();
-        case Column_LastPlayed:
-          return song.lastplayed();
-        case Column_Score:
-          return song.score();
-
-        case Column_BPM:
-          return song.bpm();
-        case Column_Bitrate:
-          return song.bitrate();
-        case Column_Samplerate:
-          return song.samplerate();
-        case Column_Filename:
-          return song.url();
-        case Column_BaseFilename:
-          return song.basefilename();
-        case Column_Filesize:
-          return song.filesize();
-        case Column_Filetype:
-          return song.filetype();
-        case Column_DateModified:
-          return song.mtime();
-        case Column_DateCreated:
-          return song.ctime();
-
-        case Column_Comment:
-          if (role == Qt::DisplayRole) return song.comment().simplified();
-          return song.comment();
-
-        case Column_Source:
-          return item->Url();
+      if (index.column() == Column_Comment) {
+        // The cache only has the simplified comment that's displayed.
+        return items_[index.row()]->Metadata().comment();
       }
+      return row_cache_.Value(items_[index.row()], index.column());
 
-      return QVariant();
-    }
+    case Qt::DisplayRole:
+      return row_cache_.Value(items_[index.row()], index.column());
 
     case Qt::TextAlignmentRole:
       return QVariant(column_alignments_.value(
@@ -415,6 +393,15 @@ QVariant Playlist::data(const QModelIndex& index, int role) const {
   }
 }
 
+void Playlist::InvalidateRowCache(const QModelIndex& top_left,
+                                  const QModelIndex& bottom_right) {
+  for (int row = top_left.row(); row <= bottom_right.row(); ++row) {
+    if (row >= 0 && row < items_.count()) {
+      row_cache_.Invalidate(items_[row].get());
+    }
+  }
+}
+
 void Playlist::MoodbarUpdated(const QModelIndex& index) {
   emit dataChanged(index.sibling(index.row(), Column_Mood),
                    index.sibling(index.row(), Column_Mood));
@@ -617,6 +604,42 @@ int Playlist::next_row(bool ignore_repeat_track) const {
   return virtual_items_[next_virtual_index];
 }
 
+QList<int> Playlist::upcoming_rows(int count) const {
+  QList<int> ret;
+
+  // Any queued items take priority
+  for (int i = 0; i < queue_->rowCount() && ret.count() < count; ++i) {
+    ret << queue_->mapToSource(queue_->index(i, 0)).row();
+  }
+
+  const PlaylistSequence::RepeatMode repeat_mode =
+      playlist_sequence_->repeat_mode();
+  const bool repeats = repeat_mode == PlaylistSequence::Repeat_Album ||
+                       repeat_mode == PlaylistSequence::Repeat_Playlist ||
+                       repeat_mode == PlaylistSequence::Repeat_OneByOne;
+
+  int virtual_index = current_virtual_index_;
+  bool wrapped = false;
+  while (ret.count() < count) {
+    virtual_index = NextVirtualIndex(virtual_index, true);
+    if (virtual_index >= virtual_items_.count()) {
+      // We've gone off the end of the playlist - only go round again if it's
+      // going to repeat.
+      if (!repeats || wrapped) break;
+      wrapped = true;
+      virtual_index = NextVirtualIndex(-1, true);
+      if (virtual_index >= virtual_items_.count()) break;
+    }
+
+    const int row = virtual_items_[virtual_index];
+    if (row != current_row() && !ret.contains(row)) {
+      ret << row;
+    }
+  }
+
+  return ret;
+}
+
 int Playlist::previous_row(bool ignore_repeat_track) const {
   int prev_virtual_index =
       PreviousVirtualIndex(current_virtual_index_, ignore_repeat_track);
@@ -1018,6 +1041,7 @@ void Playlist::MoveItemsWithoutUndo(int start, const QList<int>& dest_rows) {
 void Playlist::InsertItems(const PlaylistItemList& itemsIn, int pos,
                            bool play_now, bool enqueue, bool enqueue_next) {
   if (itemsIn.isEmpty()) return;
+  TRACE_SPAN("playlist", "Playlist::InsertItems");
 
   PlaylistItemList items = itemsIn;
 
@@ -1223,6 +1247,7 @@ void Playlist::UpdateItems(const SongList& songs) {
         } else {
           new_item = PlaylistItemPtr(new SongPlaylistItem(song));
         }
+        row_cache_.Invalidate(item.get());
         items_[i] = new_item;
         emit dataChanged(index(i, 0), index(i, ColumnCount - 1));
         // Also update undo actions
@@ -1280,102 +1305,6 @@ QMimeData* Playlist::mimeData(const QModelIndexList& indexes) const {
   return data;
 }
 
-bool Playlist::CompareItems(int column, Qt::SortOrder order,
-                            shared_ptr<PlaylistItem> _a,
-                            shared_ptr<PlaylistItem> _b,
-                            const QStringList& prefixes) {
-  shared_ptr<PlaylistItem> a = order == Qt::AscendingOrder ? _a : _b;
-  shared_ptr<PlaylistItem> b = order == Qt::AscendingOrder ? _b : _a;
-
-#define cmp(field) return a->Metadata().field() < b->Metadata().field()
-#define strcmp(field)                                                 \
-  return QString::localeAwareCompare(                                 \
-             removePrefix(a->Metadata().field().toLower(), prefixes), \
-             removePrefix(b->Metadata().field().toLower(), prefixes)) < 0;
-
-  switch (column) {
-    case Column_Title:
-      strcmp(title);
-    case Column_Artist:
-      strcmp(artist);
-    case Column_Album:
-      strcmp(album);
-    case Column_Length:
-      cmp(length_nanosec);
-    case Column_Track:
-      cmp(track);
-    case Column_Disc:
-      cmp(disc);
-    case Column_Year:
-      cmp(year);
-    case Column_OriginalYear:
-      cmp(originalyear);
-    case Column_Genre:
-      strcmp(genre);
-    case Column_AlbumArtist:
-      strcmp(playlist_albumartist);
-    case Column_Composer:
-      strcmp(composer);
-    case Column_Performer:
-      strcmp(performer);
-    case Column_Grouping:
-      strcmp(grouping);
-
-    case Column_Rating:
-      cmp(rating);
-    case Column_PlayCount:
-      cmp(playcount);
-    case Column_SkipCount:
-      cmp(skipcount);
-    case Column_LastPlayed:
-      cmp(lastplayed);
-    case Column_Score:
-      cmp(score);
-
-    case Column_BPM:
-      cmp(bpm);
-    case Column_Bitrate:
-      cmp(bitrate);
-    case Column_Samplerate:
-      cmp(samplerate);
-    case Column_Filename:
-      return (QString::localeAwareCompare(a->Url().path().toLower(),
-                                          b->Url().path().toLower()) < 0);
-    case Column_BaseFilename:
-      cmp(basefilename);
-    case Column_Filesize:
-      cmp(filesize);
-    case Column_Filetype:
-      cmp(filetype);
-    case Column_DateModified:
-      cmp(mtime);
-    case Column_DateCreated:
-      cmp(ctime);
-
-    case Column_Comment:
-      strcmp(comment);
-    case Column_Source:
-      cmp(url);
-  }
-
-#undef cmp
-#undef strcmp
-
-  return false;
-}
-
-bool Playlist::ComparePathDepths(Qt::SortOrder order,
-                                 shared_ptr<PlaylistItem> _a,
-                                 shared_ptr<PlaylistItem> _b) {
-  shared_ptr<PlaylistItem> a = order == Qt::AscendingOrder ? _a : _b;
-  shared_ptr<PlaylistItem> b = order == Qt::AscendingOrder ? _b : _a;
-
-  int a_dir_level = a->Url().path().count('/');
-  int b_dir_level = b->Url().path().count('/');
-
-  return a_dir_level < b_dir_level;
-}
-
 QString Playlist::column_name(Column column) {
   switch (column) {
     case Column_Title:
@@ -1466,9 +1395,9 @@ void Playlist::sort(int column, Qt::SortOrder order) {
   if (ignore_sorting_) return;
 
   PlaylistItemList new_items(items_);
-  PlaylistItemList::iterator begin = new_items.begin();
+  int begin = 0;
   if (dynamic_playlist_ && current_item_index_.isValid())
-    begin += current_item_index_.row() + 1;
+    begin = current_item_index_.row() + 1;
 
   QSettings s;
   s.beginGroup(Playlist::kSettingsGroup);
@@ -1485,30 +1414,7 @@ void Playlist::sort(int column, Qt::SortOrder order) {
   }
   s.endGroup();
 
-  if (column == Column_Album) {
-    // When sorting by album, also take into account discs and tracks.
-    std::stable_sort(begin, new_items.end(),
-                     std::bind(&Playlist::CompareItems, Column_Track, order, _1,
-                               _2, prefixes));
-    std::stable_sort(begin, new_items.end(),
-                     std::bind(&Playlist::CompareItems, Column_Disc, order, _1,
-                               _2, prefixes));
-    std::stable_sort(begin, new_items.end(),
-                     std::bind(&Playlist::CompareItems, Column_Album, order, _1,
-                               _2, prefixes));
-  } else if (column == Column_Filename) {
-    // When sorting by full paths we also expect a hierarchical order. This
-    // returns a breath-first ordering of paths.
-    std::stable_sort(begin, new_items.end(),
-                     std::bind(&Playlist::CompareItems, Column_Filename, order,
-                               _1, _2, prefixes));
-    std::stable_sort(begin, new_items.end(),
-                     std::bind(&Playlist::ComparePathDepths, order, _1, _2));
-  } else {
-    std::stable_sort(
-        begin, new_items.end(),
-        std::bind(&Playlist::CompareItems, column, order, _1, _2, prefixes));
-  }
+  PlaylistSorter(column, order, prefixes).Sort(&new_items, begin);
 
   undo_stack_->push(
       new PlaylistUndoCommands::SortItems(this, column, order, new_items));
@@ -1562,22 +1468,30 @@ void Playlist::Save() const {
                               dynamic_playlist_);
 }
 
+void Playlist::DeferRestore() { is_loading_ = true; }
+
 void Playlist::Restore() {
   if (!backend_) return;
 
-  items_.clear();
-  virtual_items_.clear();
-  library_items_by_id_.clear();
-
+  is_loading_ = true;
   cancel_restore_ = false;
   QFuture<QList<PlaylistItemPtr>> future =
-      QtConcurrent::run(backend_, &PlaylistBackend::GetPlaylistItems, id_);
+      WorkScheduler::Instance()->Run<QList<PlaylistItemPtr>>(
+          WorkScheduler::Priority_Interactive,
+          std::bind(&PlaylistBackend::GetPlaylistItems, backend_, id_));
   NewClosure(future, this, SLOT(ItemsLoaded(QFuture<PlaylistItemList>)),
              future);
 }
 
 void Playlist::ItemsLoaded(QFuture<PlaylistItemList> future) {
-  if (cancel_restore_) return;
+  if (cancel_restore_) {
+    // The playlist was cleared before its items arrived.  Anything waiting
+    // for it to be restored still has to be told.
+    is_loading_ = false;
+    Save();
+    emit RestoreFinished();
+    return;
+  }
 
   PlaylistItemList items = future.result();
 
@@ -1592,10 +1506,15 @@ void Playlist::ItemsLoaded(QFuture<PlaylistItemList> future) {
     }
   }
 
-  is_loading_ = true;
+  // Anything that was added before the playlist was restored hasn't been
+  // saved yet.
+  const bool changed_while_loading = !items_.isEmpty();
+
   InsertItems(items, 0);
   is_loading_ = false;
 
+  if (changed_while_loading) Save();
+
   PlaylistBackend::Playlist p = backend_->GetPlaylist(id_);
 
   // the newly loaded list of items might be shorter than it was before so
@@ -1631,7 +1550,9 @@ void Playlist::ItemsLoaded(QFuture<PlaylistItemList> future) {
 
   // should we gray out deleted songs asynchronously on startup?
   if (s.value("greyoutdeleted", false).toBool()) {
-    QtConcurrent::run(this, &Playlist::InvalidateDeletedSongs);
+    WorkScheduler::Instance()->Run<void>(
+        WorkScheduler::Priority_Idle,
+        std::bind(&Playlist::InvalidateDeletedSongs, this));
   }
 }
 
@@ -1716,6 +1637,7 @@ PlaylistItemList Playlist::RemoveItemsWithoutUndo(int row, int count) {
   PlaylistItemList ret;
   for (int i = 0; i < count; ++i) {
     PlaylistItemPtr item(items_.takeAt(row));
+    row_cache_.Invalidate(item.get());
     ret << item;
 
     if (item->IsLocalLibraryItem()) {
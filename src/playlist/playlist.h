@@ -24,6 +24,7 @@
 #include "core/song.h"
 #include "core/tagreaderclient.h"
 #include "playlistitem.h"
+#include "playlistrowcache.h"
 #include "playlistsequence.h"
 #include "smartplaylists/generator_fwd.h"
 
@@ -125,6 +126,10 @@ class Playlist : public QAbstractListModel {
     Role_StopAfter,
     Role_QueuePosition,
     Role_CanSetRating,
+    // The DisplayRole text in lower case, for matching against filters.
+    Role_FilterText,
+    // The song's ID in the library, or -1 if it isn't a library song.
+    Role_LibrarySongId,
   };
 
   enum LastFMStatus {
@@ -167,9 +172,6 @@ class Playlist : public QAbstractListModel {
   static const qint64 kMinScrobblePointNsecs;
   static const qint64 kMaxScrobblePointNsecs;
 
-  static bool CompareItems(int column, Qt::SortOrder order, PlaylistItemPtr a,
-                           PlaylistItemPtr b, const QStringList& prefixes = {});
-
   static QString column_name(Column column);
   static QString abbreviated_column_name(Column column);
 
@@ -179,7 +181,12 @@ class Playlist : public QAbstractListModel {
 
   // Persistence
   void Save() const;
+  // Loads the playlist's items from the database, and emits RestoreFinished
+  // when they've arrived.  It isn't saved until then.
   void Restore();
+  // Stops the playlist being saved until Restore() has been called and has
+  // finished, for a playlist whose items are loaded later.
+  void DeferRestore();
 
   // Accessors
   QSortFilterProxyModel* proxy() const;
@@ -195,6 +202,10 @@ class Playlist : public QAbstractListModel {
   int last_played_row() const;
   int next_row(bool ignore_repeat_track = false) const;
   int previous_row(bool ignore_repeat_track = false) const;
+  // Returns up to count rows that will be played after the current one, in
+  // order: queued items first, then the rest of the playlist in the current
+  // shuffle order.
+  QList<int> upcoming_rows(int count) const;
 
   const QModelIndex current_index() const;
 
@@ -323,9 +334,6 @@ class Playlist : public QAbstractListModel {
   bool removeRows(int row, int count,
                   const QModelIndex& parent = QModelIndex());
 
-  static bool ComparePathDepths(Qt::SortOrder, PlaylistItemPtr,
-                                PlaylistItemPtr);
-
  public slots:
   void set_current_row(int index, bool is_stopping = false);
   void Paused();
@@ -391,6 +399,10 @@ class Playlist : public QAbstractListModel {
 
   void InsertDynamicItems(int count);
 
+  // Fills in a row of the display data cache.
+  static void BuildRowCache(const PlaylistItemPtr& item,
+                            QVector<QVariant>* values);
+
   // Modify the playlist without changing the undo stack.  These are used by
   // our friends in PlaylistUndoCommands
   void InsertItemsWithoutUndo(const PlaylistItemList& items, int pos,
@@ -407,6 +419,8 @@ class Playlist : public QAbstractListModel {
   bool removeRows(QList<int>& rows);
 
  private slots:
+  void InvalidateRowCache(const QModelIndex& top_left,
+                          const QModelIndex& bottom_right);
   void TracksAboutToBeDequeued(const QModelIndex&, int begin, int end);
   void TracksDequeued();
   void TracksEnqueued(const QModelIndex&, int begin, int end);
@@ -418,6 +432,7 @@ class Playlist : public QAbstractListModel {
   void SongInsertVetoListenerDestroyed();
 
  private:
+  // True while the items are being restored, so they aren't saved over.
   bool is_loading_;
   PlaylistFilter* proxy_;
   Queue* queue_;
@@ -459,6 +474,10 @@ class Playlist : public QAbstractListModel {
 
   QUndoStack* undo_stack_;
 
+  // Display data for recently used rows - data() is called a lot by the view
+  // and the filter.
+  mutable PlaylistRowCache row_cache_;
+
   smart_playlists::GeneratorPtr dynamic_playlist_;
   ColumnAlignmentMap column_alignments_;
 
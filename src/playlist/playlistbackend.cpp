@@ -46,6 +46,9 @@ const int PlaylistBackend::kSongTableJoins = 4;
 PlaylistBackend::PlaylistBackend(Application* app, QObject* parent)
     : QObject(parent), app_(app), db_(app_->database()) {}
 
+PlaylistBackend::PlaylistBackend(Database* db, QObject* parent)
+    : QObject(parent), app_(nullptr), db_(db) {}
+
 PlaylistBackend::PlaylistList PlaylistBackend::GetAllPlaylists() {
   return GetPlaylists(GetPlaylists_All);
 }
@@ -228,7 +231,7 @@ PlaylistItemPtr PlaylistBackend::RestoreCueData(
     PlaylistItemPtr item, std::shared_ptr<NewSongFromQueryState> state) {
   // we need library to run a CueParser; also, this method applies only to
   // file-type PlaylistItems
-  if (item->type() != "File") {
+  if (!app_ || item->type() != "File") {
     return item;
   }
   CueParser cue_parser(app_->library_backend());
@@ -34,6 +34,9 @@ class PlaylistBackend : public QObject {
 
  public:
   Q_INVOKABLE PlaylistBackend(Application* app, QObject* parent = nullptr);
+  // Used by benchmarks, which have a database but no Application.  Songs
+  // from cue sheets can't be restored by a backend made this way.
+  PlaylistBackend(Database* db, QObject* parent = nullptr);
 
   struct Playlist {
     Playlist() : id(-1), favorite(false), last_played(0) {}
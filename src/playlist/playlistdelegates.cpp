@@ -29,12 +29,14 @@
 #include <QTextDocument>
 #include <QToolTip>
 #include <QWhatsThis>
-#include <QtConcurrentRun>
+#include <functional>
 
 #include "core/logging.h"
 #include "core/player.h"
 #include "core/utilities.h"
+#include "core/workscheduler.h"
 #include "library/librarybackend.h"
+#include "library/tagcompletionindex.h"
 #include "queue.h"
 #include "ui/iconloader.h"
 #include "widgets/trackslider.h"
@@ -366,7 +368,7 @@ TagCompletionModel::TagCompletionModel(LibraryBackend* backend,
     : QStringListModel() {
   QString col = database_column(column);
   if (!col.isEmpty()) {
-    setStringList(backend->GetAll(col));
+    setStringList(backend->tag_completion_index()->Values(col));
   }
 }
 
@@ -401,7 +403,9 @@ TagCompleter::TagCompleter(LibraryBackend* backend, Playlist::Column column,
                            QLineEdit* editor)
     : QCompleter(editor), editor_(editor) {
   QFuture<TagCompletionModel*> future =
-      QtConcurrent::run(&InitCompletionModel, backend, column);
+      WorkScheduler::Instance()->Run<TagCompletionModel*>(
+          WorkScheduler::Priority_Interactive,
+          std::bind(&InitCompletionModel, backend, column));
   NewClosure(future, this, SLOT(ModelReady(QFuture<TagCompletionModel*>)),
              future);
 }
@@ -412,6 +416,9 @@ void TagCompleter::ModelReady(QFuture<TagCompletionModel*> future) {
   TagCompletionModel* model = future.result();
   setModel(model);
   setCaseSensitivity(Qt::CaseInsensitive);
+  // The index keeps the values sorted, which lets QCompleter binary search
+  // for the prefix instead of scanning the whole list.
+  setModelSorting(QCompleter::CaseInsensitivelySortedModel);
   editor_->setCompleter(this);
 }
 
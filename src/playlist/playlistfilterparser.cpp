@@ -193,7 +193,8 @@ class FilterTerm : public FilterTree {
                       const QAbstractItemModel* const model) const {
     for (int i : columns_) {
       QModelIndex idx(model->index(row, i, parent));
-      if (cmp_->Matches(idx.data().toString().toLower())) return true;
+      if (cmp_->Matches(idx.data(Playlist::Role_FilterText).toString()))
+        return true;
     }
     return false;
   }
@@ -214,7 +215,7 @@ class FilterColumnTerm : public FilterTree {
   virtual bool accept(int row, const QModelIndex& parent,
                       const QAbstractItemModel* const model) const {
     QModelIndex idx(model->index(row, col, parent));
-    return cmp_->Matches(idx.data().toString().toLower());
+    return cmp_->Matches(idx.data(Playlist::Role_FilterText).toString());
   }
   virtual FilterType type() { return Column; }
 
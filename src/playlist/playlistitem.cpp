@@ -18,11 +18,12 @@
 #include "playlistitem.h"
 
 #include <QSqlQuery>
-#include <QtConcurrentRun>
 #include <QtDebug>
+#include <functional>
 
 #include "core/logging.h"
 #include "core/song.h"
+#include "core/workscheduler.h"
 #include "internet/core/internetplaylistitem.h"
 #include "internet/jamendo/jamendoplaylistitem.h"
 #include "internet/jamendo/jamendoservice.h"
@@ -80,7 +81,9 @@ void PlaylistItem::ClearTemporaryMetadata() { temp_metadata_ = Song(); }
 static void ReloadPlaylistItem(PlaylistItemPtr item) { item->Reload(); }
 
 QFuture<void> PlaylistItem::BackgroundReload() {
-  return QtConcurrent::run(ReloadPlaylistItem, shared_from_this());
+  return WorkScheduler::Instance()->Run<void>(
+      WorkScheduler::Priority_Normal,
+      std::bind(&ReloadPlaylistItem, shared_from_this()));
 }
 
 void PlaylistItem::SetBackgroundColor(short priority, const QColor& color) {
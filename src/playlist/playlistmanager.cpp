@@ -21,14 +21,16 @@
 #include <QFileInfo>
 #include <QFuture>
 #include <QMessageBox>
-#include <QtConcurrentRun>
 #include <QtDebug>
+#include <functional>
 
 #include "core/application.h"
 #include "core/logging.h"
 #include "core/player.h"
 #include "core/songloader.h"
+#include "core/startuptrace.h"
 #include "core/utilities.h"
+#include "core/workscheduler.h"
 #include "library/librarybackend.h"
 #include "library/libraryplaylistitem.h"
 #include "playlistbackend.h"
@@ -82,12 +84,20 @@ void PlaylistManager::Init(LibraryBackend* library_backend,
   connect(parser_, SIGNAL(Error(QString)), this, SIGNAL(Error(QString)));
   for (const PlaylistBackend::Playlist& p :
        playlist_backend->GetAllOpenPlaylists()) {
-    AddPlaylist(p.id, p.name, p.special_type, p.ui_path, p.favorite);
+    AddPlaylist(p.id, p.name, p.special_type, p.ui_path, p.favorite, false);
+    pending_restores_ << p.id;
   }
 
   // If no playlist exists then make a new one
   if (playlists_.isEmpty()) New(tr("Playlist"));
 
+  if (pending_restores_.removeAll(active_)) {
+    NewClosure(active(), SIGNAL(RestoreFinished()),
+               []() { StartupTrace::Mark("Active playlist restored"); });
+    active()->Restore();
+  }
+  app_->RunAfterStartup(this, "RestoreNextPlaylist");
+
   emit PlaylistManagerInitialized();
 }
 
@@ -108,7 +118,8 @@ QItemSelection PlaylistManager::selection(int id) const {
 
 Playlist* PlaylistManager::AddPlaylist(int id, const QString& name,
                                        const QString& special_type,
-                                       const QString& ui_path, bool favorite) {
+                                       const QString& ui_path, bool favorite,
+                                       bool restore) {
   Playlist* ret = new Playlist(playlist_backend_, app_->task_manager(),
                                library_backend_, id, special_type, favorite);
   ret->set_sequence(sequence_);
@@ -127,6 +138,12 @@ Playlist* PlaylistManager::AddPlaylist(int id, const QString& name,
           SIGNAL(ColumnAlignmentChanged(ColumnAlignmentMap)), ret,
           SLOT(SetColumnAlignment(ColumnAlignmentMap)));
 
+  if (restore) {
+    ret->Restore();
+  } else {
+    ret->DeferRestore();
+  }
+
   playlists_[id] = Data(ret, name);
 
   emit PlaylistAdded(id, name, favorite);
@@ -187,8 +204,9 @@ void PlaylistManager::Save(int id, const QString& filename,
     // Playlist is not in the playlist manager: probably save action was
     // triggered
     // from the left side bar and the playlist isn't loaded.
-    QFuture<QList<Song>> future = QtConcurrent::run(
-        playlist_backend_, &PlaylistBackend::GetPlaylistSongs, id);
+    QFuture<QList<Song>> future = WorkScheduler::Instance()->Run<SongList>(
+        WorkScheduler::Priority_Normal,
+        std::bind(&PlaylistBackend::GetPlaylistSongs, playlist_backend_, id));
     NewClosure(future, this,
                SLOT(ItemsLoadedForSavePlaylist(QFuture<SongList>, QString,
                                                Playlist::Path)),
@@ -344,8 +362,32 @@ void PlaylistManager::OneOfPlaylistsChanged() {
   emit PlaylistChanged(qobject_cast<Playlist*>(sender()));
 }
 
+void PlaylistManager::RestoreNextPlaylist() {
+  while (!pending_restores_.isEmpty()) {
+    const int id = pending_restores_.takeFirst();
+    // It might have been closed before we got to it.
+    if (!playlists_.contains(id)) continue;
+
+    Playlist* playlist = playlists_[id].p;
+    connect(playlist, SIGNAL(RestoreFinished()), SLOT(RestoreNextPlaylist()),
+            Qt::QueuedConnection);
+    playlist->Restore();
+    return;
+  }
+
+  StartupTrace::Mark("All playlists restored");
+}
+
+void PlaylistManager::RestoreIfPending(int id) {
+  // Don't make the user wait for the playlists before it.
+  if (pending_restores_.removeAll(id)) {
+    playlists_[id].p->Restore();
+  }
+}
+
 void PlaylistManager::SetCurrentPlaylist(int id) {
   Q_ASSERT(playlists_.contains(id));
+  RestoreIfPending(id);
   current_ = id;
   emit CurrentChanged(current());
   UpdateSummaryText();
@@ -353,6 +395,7 @@ void PlaylistManager::SetCurrentPlaylist(int id) {
 
 void PlaylistManager::SetActivePlaylist(int id) {
   Q_ASSERT(playlists_.contains(id));
+  RestoreIfPending(id);
 
   // Kinda a hack: unset the current item from the old active playlist before
   // setting the new one
@@ -239,6 +239,7 @@ class PlaylistManager : public PlaylistManagerInterface {
   void SetActiveStopped();
 
   void OneOfPlaylistsChanged();
+  void RestoreNextPlaylist();
   void UpdateSummaryText();
   void SongsDiscovered(const SongList& songs);
   void ItemsLoadedForSavePlaylist(QFuture<SongList> future,
@@ -248,7 +249,8 @@ class PlaylistManager : public PlaylistManagerInterface {
  private:
   Playlist* AddPlaylist(int id, const QString& name,
                         const QString& special_type, const QString& ui_path,
-                        bool favorite);
+                        bool favorite, bool restore = true);
+  void RestoreIfPending(int id);
 
  private:
   struct Data {
@@ -271,6 +273,10 @@ class PlaylistManager : public PlaylistManagerInterface {
 
   int current_;
   int active_;
+
+  // Playlists that haven't been restored yet.  Only the active playlist is
+  // restored during startup, the rest are restored one at a time afterwards.
+  QList<int> pending_restores_;
 };
 
 #endif  // PLAYLISTMANAGER_H
@@ -0,0 +1,62 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "playlistrowcache.h"
+
+// Enough for the filter to go through a large playlist a few columns at a time
+// without rebuilding every row, while keeping memory use reasonable.
+const int PlaylistRowCache::kDefaultMaxRows = 20000;
+
+PlaylistRowCache::PlaylistRowCache(int column_count, BuildFunction build,
+                                   int max_rows)
+    : column_count_(column_count), build_(build), rows_(max_rows) {}
+
+PlaylistRowCache::Row* PlaylistRowCache::GetRow(const PlaylistItemPtr& item) {
+  Row* row = rows_.object(item.get());
+  if (row) return row;
+
+  row = new Row;
+  row->item_ = item;
+  row->values_.resize(column_count_);
+  row->filter_text_.resize(column_count_);
+  row->has_filter_text_.fill(false, column_count_);
+  build_(item, &row->values_);
+
+  rows_.insert(item.get(), row);
+  return row;
+}
+
+QVariant PlaylistRowCache::Value(const PlaylistItemPtr& item, int column) {
+  if (column < 0 || column >= column_count_) return QVariant();
+  return GetRow(item)->values_[column];
+}
+
+QString PlaylistRowCache::FilterText(const PlaylistItemPtr& item, int column) {
+  if (column < 0 || column >= column_count_) return QString();
+
+  Row* row = GetRow(item);
+  if (!row->has_filter_text_[column]) {
+    row->filter_text_[column] = row->values_[column].toString().toLower();
+    row->has_filter_text_[column] = true;
+  }
+  return row->filter_text_[column];
+}
+
+void PlaylistRowCache::Invalidate(const PlaylistItem* item) {
+  rows_.remove(item);
+}
+
+void PlaylistRowCache::Clear() { rows_.clear(); }
@@ -0,0 +1,74 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLAYLIST_PLAYLISTROWCACHE_H_
+#define PLAYLIST_PLAYLISTROWCACHE_H_
+
+#include <QCache>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+#include "playlistitem.h"
+
+// Caches the display data of a playlist's rows, so the view, the filter and
+// the sort don't have to copy a Song out of the PlaylistItem for every cell
+// they look at.  Rows are built lazily the first time any of their columns is
+// requested, and the least recently used rows are dropped once the cache is
+// full.  The cache isn't thread-safe - it's only used from the GUI thread.
+class PlaylistRowCache {
+ public:
+  // Fills in the value of every column for the given item.
+  typedef void (*BuildFunction)(const PlaylistItemPtr& item,
+                                QVector<QVariant>* values);
+
+  static const int kDefaultMaxRows;
+
+  PlaylistRowCache(int column_count, BuildFunction build,
+                   int max_rows = kDefaultMaxRows);
+
+  // Returns the display value of a column.
+  QVariant Value(const PlaylistItemPtr& item, int column);
+
+  // Returns the value of a column as a lower-cased string, as used by the
+  // playlist filter.
+  QString FilterText(const PlaylistItemPtr& item, int column);
+
+  // Forgets about an item, because its metadata has changed or it has been
+  // removed from the playlist.
+  void Invalidate(const PlaylistItem* item);
+  void Clear();
+
+ private:
+  struct Row {
+    // Holding a reference stops the item being deleted (and its address
+    // being reused by a different item) while it's still in the cache.
+    PlaylistItemPtr item_;
+    QVector<QVariant> values_;
+
+    // Filled in the first time the filter looks at each column.
+    QVector<QString> filter_text_;
+    QVector<bool> has_filter_text_;
+  };
+
+  Row* GetRow(const PlaylistItemPtr& item);
+
+  const int column_count_;
+  BuildFunction build_;
+  QCache<const PlaylistItem*, Row> rows_;
+};
+
+#endif  // PLAYLIST_PLAYLISTROWCACHE_H_
@@ -0,0 +1,328 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "playlistsorter.h"
+
+#include <QFuture>
+#include <QList>
+#include <algorithm>
+#include <functional>
+
+#include "core/workscheduler.h"
+#include "playlist.h"
+
+const int PlaylistSorter::kParallelThreshold = 20000;
+
+namespace {
+
+void WaitForAll(const QList<QFuture<void>>& futures) {
+  for (const QFuture<void>& future : futures) {
+    WorkScheduler::Instance()->WaitForFinished(future);
+  }
+}
+
+QFuture<void> RunInteractive(std::function<void()> function) {
+  return WorkScheduler::Instance()->Run<void>(
+      WorkScheduler::Priority_Interactive, function);
+}
+
+// Stable sorts chunks of the vector on the work scheduler, then merges
+// neighbouring chunks in parallel until there's only one left.  Merging the
+// left chunk into the right keeps equal elements in their original order.
+template <typename T, typename Compare>
+void ParallelStableSort(std::vector<T>* v, Compare compare, int chunks) {
+  typedef typename std::vector<T>::iterator Iterator;
+
+  std::vector<int> bounds;
+  for (int i = 0; i <= chunks; ++i) {
+    bounds.push_back(qint64(v->size()) * i / chunks);
+  }
+
+  QList<QFuture<void>> futures;
+  for (int i = 0; i < chunks; ++i) {
+    const Iterator first = v->begin() + bounds[i];
+    const Iterator last = v->begin() + bounds[i + 1];
+    futures << RunInteractive(
+        [first, last, compare]() { std::stable_sort(first, last, compare); });
+  }
+  WaitForAll(futures);
+
+  while (bounds.size() > 2) {
+    futures.clear();
+    std::vector<int> merged_bounds;
+
+    size_t i = 0;
+    for (; i + 2 < bounds.size(); i += 2) {
+      const Iterator first = v->begin() + bounds[i];
+      const Iterator middle = v->begin() + bounds[i + 1];
+      const Iterator last = v->begin() + bounds[i + 2];
+      futures << RunInteractive([first, middle, last, compare]() {
+        std::inplace_merge(first, middle, last, compare);
+      });
+      merged_bounds.push_back(bounds[i]);
+    }
+    for (; i < bounds.size(); ++i) {
+      merged_bounds.push_back(bounds[i]);
+    }
+
+    WaitForAll(futures);
+    bounds = merged_bounds;
+  }
+}
+
+}  // namespace
+
+class PlaylistSorter::KeyCompare {
+ public:
+  KeyCompare(Qt::SortOrder order, TextType text_type,
+             const std::vector<QCollatorSortKey>* collated,
+             const QStringList* plain)
+      : order_(order),
+        text_type_(text_type),
+        collated_(collated),
+        plain_(plain) {}
+
+  bool operator()(const Key& a, const Key& b) const {
+    return order_ == Qt::AscendingOrder ? Less(a, b) : Less(b, a);
+  }
+
+ private:
+  bool Less(const Key& a, const Key& b) const {
+    if (a.number_[0] != b.number_[0]) return a.number_[0] < b.number_[0];
+
+    int text = 0;
+    switch (text_type_) {
+      case Text_Collated:
+        text = (*collated_)[a.index_].compare((*collated_)[b.index_]);
+        break;
+      case Text_Plain:
+        text = (*plain_)[a.index_].compare((*plain_)[b.index_]);
+        break;
+      case Text_None:
+        break;
+    }
+    if (text != 0) return text < 0;
+
+    if (a.number_[1] != b.number_[1]) return a.number_[1] < b.number_[1];
+    return a.number_[2] < b.number_[2];
+  }
+
+  Qt::SortOrder order_;
+  TextType text_type_;
+  const std::vector<QCollatorSortKey>* collated_;
+  const QStringList* plain_;
+};
+
+PlaylistSorter::PlaylistSorter(int column, Qt::SortOrder order,
+                               const QStringList& prefixes)
+    : column_(column), order_(order), prefixes_(prefixes) {
+  switch (column) {
+    case Playlist::Column_Title:
+    case Playlist::Column_Artist:
+    case Playlist::Column_Album:
+    case Playlist::Column_Genre:
+    case Playlist::Column_AlbumArtist:
+    case Playlist::Column_Composer:
+    case Playlist::Column_Performer:
+    case Playlist::Column_Grouping:
+    case Playlist::Column_Comment:
+    case Playlist::Column_Filename:
+      text_type_ = Text_Collated;
+      break;
+
+    case Playlist::Column_BaseFilename:
+    case Playlist::Column_Source:
+      text_type_ = Text_Plain;
+      break;
+
+    default:
+      text_type_ = Text_None;
+      break;
+  }
+}
+
+QString PlaylistSorter::RemovePrefix(const QString& text) const {
+  for (const QString& prefix : prefixes_) {
+    if (text.startsWith(prefix)) {
+      return text.mid(prefix.size());
+    }
+  }
+  return text;
+}
+
+void PlaylistSorter::ExtractKey(const PlaylistItemPtr& item, Key* key,
+                                QString* text) const {
+  const Song song = item->Metadata();
+  double* n = key->number_;
+  n[0] = n[1] = n[2] = 0;
+
+  switch (column_) {
+    case Playlist::Column_Title:
+      *text = RemovePrefix(song.title().toLower());
+      break;
+    case Playlist::Column_Artist:
+      *text = RemovePrefix(song.artist().toLower());
+      break;
+    case Playlist::Column_Album:
+      // When sorting by album, also take into account discs and tracks.
+      *text = RemovePrefix(song.album().toLower());
+      n[1] = song.disc();
+      n[2] = song.track();
+      break;
+    case Playlist::Column_Length:
+      n[0] = song.length_nanosec();
+      break;
+    case Playlist::Column_Track:
+      n[0] = song.track();
+      break;
+    case Playlist::Column_Disc:
+      n[0] = song.disc();
+      break;
+    case Playlist::Column_Year:
+      n[0] = song.year();
+      break;
+    case Playlist::Column_OriginalYear:
+      n[0] = song.originalyear();
+      break;
+    case Playlist::Column_Genre:
+      *text = RemovePrefix(song.genre().toLower());
+      break;
+    case Playlist::Column_AlbumArtist:
+      *text = RemovePrefix(song.playlist_albumartist().toLower());
+      break;
+    case Playlist::Column_Composer:
+      *text = RemovePrefix(song.composer().toLower());
+      break;
+    case Playlist::Column_Performer:
+      *text = RemovePrefix(song.performer().toLower());
+      break;
+    case Playlist::Column_Grouping:
+      *text = RemovePrefix(song.grouping().toLower());
+      break;
+
+    case Playlist::Column_Rating:
+      n[0] = song.rating();
+      break;
+    case Playlist::Column_PlayCount:
+      n[0] = song.playcount();
+      break;
+    case Playlist::Column_SkipCount:
+      n[0] = song.skipcount();
+      break;
+    case Playlist::Column_LastPlayed:
+      n[0] = song.lastplayed();
+      break;
+    case Playlist::Column_Score:
+      n[0] = song.score();
+      break;
+
+    case Playlist::Column_BPM:
+      n[0] = song.bpm();
+      break;
+    case Playlist::Column_Bitrate:
+      n[0] = song.bitrate();
+      break;
+    case Playlist::Column_Samplerate:
+      n[0] = song.samplerate();
+      break;
+    case Playlist::Column_Filename: {
+      // When sorting by full paths we also expect a hierarchical order. This
+      // gives a breadth-first ordering of paths.
+      const QString path = item->Url().path();
+      n[0] = path.count('/');
+      *text = path.toLower();
+      break;
+    }
+    case Playlist::Column_BaseFilename:
+      *text = song.basefilename();
+      break;
+    case Playlist::Column_Filesize:
+      n[0] = song.filesize();
+      break;
+    case Playlist::Column_Filetype:
+      n[0] = song.filetype();
+      break;
+    case Playlist::Column_DateModified:
+      n[0] = song.mtime();
+      break;
+    case Playlist::Column_DateCreated:
+      n[0] = song.ctime();
+      break;
+
+    case Playlist::Column_Comment:
+      *text = RemovePrefix(song.comment().toLower());
+      break;
+    case Playlist::Column_Source:
+      *text = song.url().toString();
+      break;
+  }
+}
+
+std::vector<int> PlaylistSorter::SortedIndices(
+    const PlaylistItemList& items) const {
+  const int count = items.count();
+
+  std::vector<Key> keys(count);
+  std::vector<QCollatorSortKey> collated;
+  QStringList plain;
+  QCollator collator;
+
+  if (text_type_ == Text_Collated) collated.reserve(count);
+  if (text_type_ == Text_Plain) plain.reserve(count);
+
+  QString text;
+  for (int i = 0; i < count; ++i) {
+    text.clear();
+    keys[i].index_ = i;
+    ExtractKey(items[i], &keys[i], &text);
+
+    switch (text_type_) {
+      case Text_Collated:
+        collated.push_back(collator.sortKey(text));
+        break;
+      case Text_Plain:
+        plain << text;
+        break;
+      case Text_None:
+        break;
+    }
+  }
+
+  const KeyCompare compare(order_, text_type_, &collated, &plain);
+  const int threads =
+      WorkScheduler::Instance()->limit(WorkScheduler::Priority_Interactive);
+  if (count < kParallelThreshold || threads < 2) {
+    std::stable_sort(keys.begin(), keys.end(), compare);
+  } else {
+    ParallelStableSort(&keys, compare, threads);
+  }
+
+  std::vector<int> ret;
+  ret.reserve(count);
+  for (const Key& key : keys) {
+    ret.push_back(key.index_);
+  }
+  return ret;
+}
+
+void PlaylistSorter::Sort(PlaylistItemList* items, int begin) const {
+  const PlaylistItemList unsorted = items->mid(begin);
+  const std::vector<int> order = SortedIndices(unsorted);
+
+  for (size_t i = 0; i < order.size(); ++i) {
+    (*items)[begin + i] = unsorted[order[i]];
+  }
+}
@@ -0,0 +1,71 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLAYLIST_PLAYLISTSORTER_H_
+#define PLAYLIST_PLAYLISTSORTER_H_
+
+#include <QCollator>
+#include <QStringList>
+
+#include <vector>
+
+#include "playlistitem.h"
+
+// Sorts playlist items by one of the playlist's columns.  A key is extracted
+// from each item's metadata once before sorting, so comparisons only look at
+// the compact keys and never copy a Song.  Large playlists are sorted in
+// parallel chunks which are then merged.  The sort is always stable.
+class PlaylistSorter {
+ public:
+  // Playlists smaller than this are sorted on the calling thread.
+  static const int kParallelThreshold;
+
+  // prefixes are removed from the start of the text before comparing it, if
+  // present.  Each one should include its trailing space.
+  PlaylistSorter(int column, Qt::SortOrder order,
+                 const QStringList& prefixes = QStringList());
+
+  // Returns the order that items should be in, as a list of indices into
+  // items.
+  std::vector<int> SortedIndices(const PlaylistItemList& items) const;
+
+  // Sorts the items from begin onwards, leaving the ones before it alone.
+  void Sort(PlaylistItemList* items, int begin = 0) const;
+
+ private:
+  // Keys are compared by number_[0], then the item's text, then number_[1]
+  // and number_[2].  This covers both the album sort (album, disc, track) and
+  // the filename sort (path depth, path).  The text is kept in a separate
+  // array, at the same index as the item.
+  struct Key {
+    int index_;
+    double number_[3];
+  };
+
+  enum TextType { Text_None, Text_Collated, Text_Plain };
+
+  class KeyCompare;
+
+  void ExtractKey(const PlaylistItemPtr& item, Key* key, QString* text) const;
+  QString RemovePrefix(const QString& text) const;
+
+  int column_;
+  Qt::SortOrder order_;
+  QStringList prefixes_;
+  TextType text_type_;
+};
+
+#endif  // PLAYLIST_PLAYLISTSORTER_H_
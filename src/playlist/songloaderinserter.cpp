@@ -17,11 +17,12 @@
 
 #include "songloaderinserter.h"
 
-#include <QtConcurrentRun>
+#include <functional>
 
 #include "core/logging.h"
 #include "core/songloader.h"
 #include "core/taskmanager.h"
+#include "core/workscheduler.h"
 #include "playlist.h"
 
 SongLoaderInserter::SongLoaderInserter(TaskManager* task_manager,
@@ -72,7 +73,9 @@ void SongLoaderInserter::Load(Playlist* destination, int row, bool play_now,
     InsertSongs();
     deleteLater();
   } else {
-    QtConcurrent::run(this, &SongLoaderInserter::AsyncLoad);
+    WorkScheduler::Instance()->Run<void>(
+        WorkScheduler::Priority_Normal,
+        std::bind(&SongLoaderInserter::AsyncLoad, this));
   }
 }
 
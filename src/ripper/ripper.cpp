@@ -20,12 +20,13 @@
 #include <QFile>
 #include <QMutexLocker>
 #include <QUrl>
-#include <QtConcurrentRun>
+#include <functional>
 
 #include "core/closure.h"
 #include "core/logging.h"
 #include "core/tagreaderclient.h"
 #include "core/utilities.h"
+#include "core/workscheduler.h"
 #include "devices/cddadevice.h"
 #include "transcoder/transcoder.h"
 
@@ -91,7 +92,8 @@ void Ripper::Start() {
   }
 
   qLog(Debug) << "Ripping" << AddedTracks() << "tracks.";
-  QtConcurrent::run(this, &Ripper::Rip);
+  WorkScheduler::Instance()->Run<void>(WorkScheduler::Priority_Normal,
+                                       std::bind(&Ripper::Rip, this));
 }
 
 void Ripper::Cancel() {
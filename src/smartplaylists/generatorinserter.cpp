@@ -17,10 +17,11 @@
 
 #include "smartplaylists/generatorinserter.h"
 
-#include <QtConcurrentRun>
+#include <functional>
 
 #include "core/closure.h"
 #include "core/taskmanager.h"
+#include "core/workscheduler.h"
 #include "playlist/playlist.h"
 #include "smartplaylists/generator.h"
 
@@ -57,7 +58,9 @@ void GeneratorInserter::Load(Playlist* destination, int row, bool play_now,
   connect(generator.get(), SIGNAL(Error(QString)), SIGNAL(Error(QString)));
 
   QFuture<PlaylistItemList> future =
-      QtConcurrent::run(Generate, generator, dynamic_count);
+      WorkScheduler::Instance()->Run<PlaylistItemList>(
+          WorkScheduler::Priority_Normal,
+          std::bind(&Generate, generator, dynamic_count));
   NewClosure(future, this, SLOT(Finished(QFuture<PlaylistItemList>)), future);
 }
 
@@ -17,9 +17,10 @@
 
 #include "searchpreview.h"
 
-#include <QtConcurrentRun>
+#include <functional>
 #include <memory>
 
+#include "core/workscheduler.h"
 #include "playlist/playlist.h"
 #include "querygenerator.h"
 #include "ui_searchpreview.h"
@@ -90,7 +91,10 @@ void SearchPreview::RunSearch(const Search& search) {
 
   ui_->busy_container->show();
   ui_->count_label->hide();
-  QFuture<PlaylistItemList> future = QtConcurrent::run(DoRunSearch, generator_);
+  QFuture<PlaylistItemList> future =
+      WorkScheduler::Instance()->Run<PlaylistItemList>(
+          WorkScheduler::Priority_Interactive,
+          std::bind(&DoRunSearch, generator_));
   NewClosure(future, this, SLOT(SearchFinished(QFuture<PlaylistItemList>)),
              future);
 }
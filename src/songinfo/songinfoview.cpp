@@ -19,11 +19,12 @@
 
 #include <QFuture>
 #include <QSettings>
-#include <QtConcurrentRun>
 #include <algorithm>
+#include <functional>
 
 #include "config.h"
 #include "core/closure.h"
+#include "core/workscheduler.h"
 #include "songinfo/songinfoprovider.h"
 #include "songinfo/taglyricsinfoprovider.h"
 #include "songinfo/ultimatelyricsprovider.h"
@@ -38,9 +39,10 @@ const char* SongInfoView::kSettingsGroup = "SongInfo";
 SongInfoView::SongInfoView(QWidget* parent)
     : SongInfoBase(parent), ultimate_reader_(new UltimateLyricsReader(this)) {
   // Parse the ultimate lyrics xml file in the background
-  QFuture<ProviderList> future =
-      QtConcurrent::run(ultimate_reader_.get(), &UltimateLyricsReader::Parse,
-                        QString(":lyrics/ultimate_providers.xml"));
+  QFuture<ProviderList> future = WorkScheduler::Instance()->Run<ProviderList>(
+      WorkScheduler::Priority_Normal,
+      std::bind(&UltimateLyricsReader::Parse, ultimate_reader_.get(),
+                QString(":lyrics/ultimate_providers.xml")));
   NewClosure(future, this, SLOT(UltimateLyricsParsed(QFuture<ProviderList>)),
              future);
 
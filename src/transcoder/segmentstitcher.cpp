@@ -0,0 +1,439 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "segmentstitcher.h"
+
+#include <QFile>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "core/logging.h"
+
+const int SegmentStitcher::kFlacBlockAlignment = 36864;
+
+namespace {
+
+const char kFlacMagic[] = "fLaC";
+const int kFlacMagicLength = 4;
+const int kFlacStreamInfoLength = 34;
+
+enum FlacBlockType { FlacBlock_StreamInfo = 0, FlacBlock_SeekTable = 3 };
+
+// A metadata block of the first segment, including its 4 byte header.
+struct FlacMetadataBlock {
+  int type_;
+  qint64 offset_;
+  qint64 length_;
+};
+
+struct CrcTables {
+  CrcTables() {
+    for (int i = 0; i < 256; ++i) {
+      quint8 crc8 = i;
+      quint16 crc16 = i << 8;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc8 = (crc8 & 0x80) ? (crc8 << 1) ^ 0x07 : crc8 << 1;
+        crc16 = (crc16 & 0x8000) ? (crc16 << 1) ^ 0x8005 : crc16 << 1;
+      }
+      crc8_[i] = crc8;
+      crc16_[i] = crc16;
+    }
+  }
+
+  quint8 crc8_[256];
+  quint16 crc16_[256];
+};
+
+const CrcTables& Tables() {
+  static const CrcTables sTables;
+  return sTables;
+}
+
+inline quint16 UpdateCrc16(const CrcTables& tables, quint16 crc, uchar byte) {
+  return (crc << 8) ^ tables.crc16_[(crc >> 8) ^ byte];
+}
+
+quint32 ReadBigEndian(const uchar* data, int bytes) {
+  quint32 ret = 0;
+  for (int i = 0; i < bytes; ++i) {
+    ret = (ret << 8) | data[i];
+  }
+  return ret;
+}
+
+void AppendBigEndian(quint64 value, int bytes, QByteArray* out) {
+  for (int i = bytes - 1; i >= 0; --i) {
+    out->append(char((value >> (i * 8)) & 0xFF));
+  }
+}
+
+}  // namespace
+
+SegmentStitcher::Method SegmentStitcher::MethodForFileType(
+    Song::FileType type) {
+  switch (type) {
+    case Song::Type_Flac:
+      return Method_Flac;
+
+    default:
+      return Method_None;
+  }
+}
+
+bool SegmentStitcher::Stitch(Method method, const QStringList& segments,
+                             const QString& output) {
+  switch (method) {
+    case Method_Flac:
+      return JoinFlac(segments, output);
+    case Method_None:
+      break;
+  }
+  return false;
+}
+
+bool SegmentStitcher::JoinFlac(const QStringList& segments,
+                               const QString& output) {
+  std::vector<std::unique_ptr<QFile>> files;
+  QList<const uchar*> data;
+  QList<FlacMetadataBlock> metadata;
+  QList<FlacFrame> frames;
+  const uchar* stream_info = nullptr;
+
+  for (int i = 0; i < segments.count(); ++i) {
+    files.emplace_back(new QFile(segments[i]));
+    QFile* file = files.back().get();
+    const qint64 size = file->size();
+
+    const uchar* map = nullptr;
+    if (file->open(QIODevice::ReadOnly)) {
+      map = file->map(0, size);
+    }
+    if (!map || size < kFlacMagicLength ||
+        memcmp(map, kFlacMagic, kFlacMagicLength) != 0) {
+      qLog(Warning) << "Not a FLAC file" << segments[i];
+      return false;
+    }
+    data << map;
+
+    // Walk over the metadata to the first frame.
+    qint64 offset = kFlacMagicLength;
+    bool last = false;
+    while (!last) {
+      if (offset + 4 > size) return false;
+
+      FlacMetadataBlock block;
+      block.type_ = map[offset] & 0x7F;
+      block.offset_ = offset;
+      block.length_ = 4 + ReadBigEndian(map + offset + 1, 3);
+      last = map[offset] & 0x80;
+
+      if (offset + block.length_ > size) return false;
+
+      if (block.type_ == FlacBlock_StreamInfo) {
+        if (block.length_ != 4 + kFlacStreamInfoLength) return false;
+
+        // Every segment has to have the same sample rate, channels and bits
+        // per sample.
+        const uchar* info = map + offset + 4;
+        if (!stream_info) {
+          stream_info = info;
+        } else if (memcmp(info + 10, stream_info + 10, 3) != 0 ||
+                   (info[13] & 0xF0) != (stream_info[13] & 0xF0)) {
+          qLog(Warning) << "The format of" << segments[i]
+                        << "is different from the first segment";
+          return false;
+        }
+      }
+
+      if (i == 0) metadata << block;
+      offset += block.length_;
+    }
+
+    if (!stream_info || !ReadFlacFrames(map, size, offset, i, &frames)) {
+      qLog(Warning) << "Couldn't read the frames in" << segments[i];
+      return false;
+    }
+  }
+
+  if (frames.isEmpty()) return false;
+
+  // A fixed block size stream has to have the same block size in every frame
+  // but the last.
+  bool variable = false;
+  for (int i = 0; i < frames.count(); ++i) {
+    if (frames[i].variable_block_size_ ||
+        (i != frames.count() - 1 &&
+         frames[i].block_size_ != frames[0].block_size_)) {
+      variable = true;
+      break;
+    }
+  }
+
+  // Work out what goes in the STREAMINFO block.  Frames are numbered by
+  // their index in fixed block size streams and by their first sample in
+  // variable block size ones.
+  int min_block_size = frames[0].block_size_;
+  int max_block_size = frames[0].block_size_;
+  qint64 min_frame_size = -1;
+  qint64 max_frame_size = 0;
+  quint64 samples = 0;
+  for (int i = 0; i < frames.count(); ++i) {
+    const FlacFrame& frame = frames[i];
+    const quint64 number = variable ? samples : i;
+    const qint64 length =
+        frame.length_ - frame.number_length_ + Utf8Length(number);
+
+    if (i != frames.count() - 1 || frames.count() == 1) {
+      min_block_size = qMin(min_block_size, frame.block_size_);
+      max_block_size = qMax(max_block_size, frame.block_size_);
+    }
+    min_frame_size =
+        min_frame_size == -1 ? length : qMin(min_frame_size, length);
+    max_frame_size = qMax(max_frame_size, length);
+    samples += frame.block_size_;
+  }
+
+  QFile out(output);
+  if (!out.open(QIODevice::WriteOnly)) {
+    qLog(Warning) << "Couldn't open" << output << out.errorString();
+    return false;
+  }
+
+  // The seek table points into the first segment only, so it's dropped.
+  QList<FlacMetadataBlock> blocks;
+  for (const FlacMetadataBlock& block : metadata) {
+    if (block.type_ != FlacBlock_StreamInfo &&
+        block.type_ != FlacBlock_SeekTable) {
+      blocks << block;
+    }
+  }
+
+  QByteArray header(kFlacMagic, kFlacMagicLength);
+  header.append(char(FlacBlock_StreamInfo | (blocks.isEmpty() ? 0x80 : 0)));
+  AppendBigEndian(kFlacStreamInfoLength, 3, &header);
+  AppendBigEndian(min_block_size, 2, &header);
+  AppendBigEndian(max_block_size, 2, &header);
+  AppendBigEndian(min_frame_size, 3, &header);
+  AppendBigEndian(max_frame_size, 3, &header);
+  header.append(reinterpret_cast<const char*>(stream_info + 10), 3);
+  header.append(char((stream_info[13] & 0xF0) | ((samples >> 32) & 0x0F)));
+  AppendBigEndian(samples & 0xFFFFFFFF, 4, &header);
+  header.append(QByteArray(16, '\0'));
+
+  for (int i = 0; i < blocks.count(); ++i) {
+    const uchar* block = data[0] + blocks[i].offset_;
+    const bool last = i == blocks.count() - 1;
+    header.append(char(blocks[i].type_ | (last ? 0x80 : 0)));
+    header.append(reinterpret_cast<const char*>(block + 1),
+                  blocks[i].length_ - 1);
+  }
+
+  if (out.write(header) != header.size()) return false;
+
+  samples = 0;
+  for (int i = 0; i < frames.count(); ++i) {
+    const FlacFrame& frame = frames[i];
+    const uchar* in = data[frame.segment_] + frame.offset_;
+
+    // The header, with the new number and blocking strategy.
+    QByteArray bytes(reinterpret_cast<const char*>(in), frame.number_offset_);
+    bytes[1] = char(0xF8 | (variable ? 1 : 0));
+    WriteUtf8(variable ? samples : i, &bytes);
+
+    const int rest_offset = frame.number_offset_ + frame.number_length_;
+    bytes.append(reinterpret_cast<const char*>(in + rest_offset),
+                 frame.header_length_ - 1 - rest_offset);
+    bytes.append(char(Crc8(reinterpret_cast<const uchar*>(bytes.constData()),
+                           bytes.size())));
+
+    // The subframes are copied as they are, and the footer is worked out
+    // again.
+    bytes.append(reinterpret_cast<const char*>(in + frame.header_length_),
+                 frame.length_ - frame.header_length_ - 2);
+
+    AppendBigEndian(
+        Crc16(0, reinterpret_cast<const uchar*>(bytes.constData()),
+              bytes.size()),
+        2, &bytes);
+
+    if (out.write(bytes) != bytes.size()) {
+      qLog(Warning) << "Couldn't write to" << output << out.errorString();
+      return false;
+    }
+    samples += frame.block_size_;
+  }
+
+  return true;
+}
+
+bool SegmentStitcher::ReadFlacFrames(const uchar* data, qint64 size,
+                                     qint64 offset, int segment,
+                                     QList<FlacFrame>* frames) {
+  const CrcTables& tables = Tables();
+
+  while (offset < size) {
+    FlacFrame frame;
+    if (!ParseFlacFrameHeader(data + offset, size - offset, &frame)) {
+      return false;
+    }
+    frame.segment_ = segment;
+    frame.offset_ = offset;
+
+    // Frames aren't prefixed with their length.  A frame ends where the
+    // CRC-16 over all of it, footer included, comes to 0 and another frame
+    // (or the end of the file) follows.
+    const qint64 min_end = offset + frame.header_length_ + 2;
+    quint16 crc = 0;
+    qint64 end = -1;
+    for (qint64 i = offset; i < size; ++i) {
+      crc = UpdateCrc16(tables, crc, data[i]);
+
+      const qint64 next = i + 1;
+      if (crc != 0 || next < min_end) continue;
+
+      FlacFrame next_frame;
+      if (next == size ||
+          ParseFlacFrameHeader(data + next, size - next, &next_frame)) {
+        end = next;
+        break;
+      }
+    }
+
+    if (end == -1) return false;
+
+    frame.length_ = end - offset;
+    frames->append(frame);
+    offset = end;
+  }
+
+  return true;
+}
+
+bool SegmentStitcher::ParseFlacFrameHeader(const uchar* data, qint64 size,
+                                           FlacFrame* frame) {
+  // Sync code, blocking strategy, block size and sample rate, channels and
+  // sample size, and at least one byte of the frame or sample number.
+  if (size < 6 || data[0] != 0xFF || (data[1] & 0xFE) != 0xF8) return false;
+
+  const int block_size_code = data[2] >> 4;
+  const int sample_rate_code = data[2] & 0x0F;
+  const int channels_code = data[3] >> 4;
+  const int sample_size_code = (data[3] >> 1) & 0x07;
+  if (block_size_code == 0 || sample_rate_code == 15 || channels_code > 10 ||
+      sample_size_code == 3 || (data[3] & 0x01)) {
+    return false;
+  }
+
+  // The frame or sample number is coded like UTF-8, up to 36 bits.
+  int length = 0;
+  const uchar first = data[4];
+  if ((first & 0x80) == 0x00) {
+    length = 1;
+  } else if ((first & 0xE0) == 0xC0) {
+    length = 2;
+  } else if ((first & 0xF0) == 0xE0) {
+    length = 3;
+  } else if ((first & 0xF8) == 0xF0) {
+    length = 4;
+  } else if ((first & 0xFC) == 0xF8) {
+    length = 5;
+  } else if ((first & 0xFE) == 0xFC) {
+    length = 6;
+  } else if (first == 0xFE) {
+    length = 7;
+  } else {
+    return false;
+  }
+
+  int pos = 4;
+  if (pos + length > size) return false;
+  for (int i = 1; i < length; ++i) {
+    if ((data[pos + i] & 0xC0) != 0x80) return false;
+  }
+  frame->variable_block_size_ = data[1] & 0x01;
+  frame->number_offset_ = pos;
+  frame->number_length_ = length;
+  pos += length;
+
+  const int extra_block_size_bytes =
+      block_size_code == 6 ? 1 : block_size_code == 7 ? 2 : 0;
+  const int extra_sample_rate_bytes =
+      sample_rate_code == 12 ? 1 : sample_rate_code >= 13 ? 2 : 0;
+  if (pos + extra_block_size_bytes + extra_sample_rate_bytes + 1 > size) {
+    return false;
+  }
+
+  if (block_size_code == 1) {
+    frame->block_size_ = 192;
+  } else if (block_size_code <= 5) {
+    frame->block_size_ = 576 << (block_size_code - 2);
+  } else if (block_size_code <= 7) {
+    frame->block_size_ =
+        ReadBigEndian(data + pos, extra_block_size_bytes) + 1;
+  } else {
+    frame->block_size_ = 256 << (block_size_code - 8);
+  }
+  pos += extra_block_size_bytes + extra_sample_rate_bytes;
+
+  if (Crc8(data, pos) != data[pos]) return false;
+  frame->header_length_ = pos + 1;
+  return true;
+}
+
+int SegmentStitcher::Utf8Length(quint64 value) {
+  if (value < 0x80) return 1;
+  if (value < 0x800) return 2;
+  if (value < 0x10000) return 3;
+  if (value < 0x200000) return 4;
+  if (value < 0x4000000) return 5;
+  if (value < 0x80000000) return 6;
+  return 7;
+}
+
+void SegmentStitcher::WriteUtf8(quint64 value, QByteArray* out) {
+  const int length = Utf8Length(value);
+  if (length == 1) {
+    out->append(char(value));
+    return;
+  }
+
+  // The first byte has a 1 bit for each byte in the sequence, then the top
+  // bits of the value.  The rest carry 6 bits each.
+  const int shift = 6 * (length - 1);
+  out->append(char(((0xFF00 >> length) & 0xFF) | (value >> shift)));
+  for (int bits = shift - 6; bits >= 0; bits -= 6) {
+    out->append(char(0x80 | ((value >> bits) & 0x3F)));
+  }
+}
+
+quint8 SegmentStitcher::Crc8(const uchar* data, int length) {
+  const CrcTables& tables = Tables();
+  quint8 crc = 0;
+  for (int i = 0; i < length; ++i) {
+    crc = tables.crc8_[crc ^ data[i]];
+  }
+  return crc;
+}
+
+quint16 SegmentStitcher::Crc16(quint16 crc, const uchar* data,
+                               qint64 length) {
+  const CrcTables& tables = Tables();
+  for (qint64 i = 0; i < length; ++i) {
+    crc = UpdateCrc16(tables, crc, data[i]);
+  }
+  return crc;
+}
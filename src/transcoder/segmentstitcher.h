@@ -0,0 +1,80 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRANSCODER_SEGMENTSTITCHER_H_
+#define TRANSCODER_SEGMENTSTITCHER_H_
+
+#include <QList>
+#include <QStringList>
+
+#include "core/song.h"
+
+class QFile;
+
+// Joins the files made by encoding consecutive parts of one input back into a
+// single file, without decoding them again.
+//
+// FLAC frames don't depend on each other, so the segments' frames are copied
+// after the first segment's metadata with their frame numbers rewritten.  If
+// the segments didn't end on a block boundary, the stream is written with a
+// variable block size instead.  The MD5 of the whole stream isn't known, so
+// it's left empty, as the format allows.
+class SegmentStitcher {
+ public:
+  enum Method { Method_None, Method_Flac };
+
+  static Method MethodForFileType(Song::FileType type);
+
+  // Writes the joined segments to output, and returns false if they couldn't
+  // be joined.  This can take a while, so call it in another thread.
+  static bool Stitch(Method method, const QStringList& segments,
+                     const QString& output);
+
+  // Segments that start on a multiple of this many samples end on a block
+  // boundary with any of the block sizes FLAC encoders normally use.
+  static const int kFlacBlockAlignment;
+
+ private:
+  struct FlacFrame {
+    int segment_;
+    qint64 offset_;
+    qint64 length_;
+    int header_length_;
+
+    // Where the frame or sample number starts in the header, and how long it
+    // is.
+    int number_offset_;
+    int number_length_;
+
+    int block_size_;
+    bool variable_block_size_;
+  };
+
+  static bool JoinFlac(const QStringList& segments, const QString& output);
+
+  static bool ReadFlacFrames(const uchar* data, qint64 size, qint64 offset,
+                             int segment, QList<FlacFrame>* frames);
+  static bool ParseFlacFrameHeader(const uchar* data, qint64 size,
+                                   FlacFrame* frame);
+
+  static int Utf8Length(quint64 value);
+  static void WriteUtf8(quint64 value, QByteArray* out);
+
+  static quint8 Crc8(const uchar* data, int length);
+  static quint16 Crc16(quint16 crc, const uchar* data, qint64 length);
+};
+
+#endif  // TRANSCODER_SEGMENTSTITCHER_H_
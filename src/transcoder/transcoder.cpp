@@ -17,18 +17,25 @@
 
 #include "transcoder.h"
 
+#include <gst/audio/audio.h>
+#include <gst/pbutils/pbutils.h>
+
 #include <QCoreApplication>
 #include <QDir>
 #include <QFile>
+#include <QSet>
 #include <QSettings>
-#include <QThread>
 #include <QtDebug>
 #include <algorithm>
+#include <functional>
 #include <memory>
 
+#include "core/closure.h"
 #include "core/logging.h"
 #include "core/signalchecker.h"
+#include "core/timeconstants.h"
 #include "core/utilities.h"
+#include "core/workscheduler.h"
 
 using std::shared_ptr;
 
@@ -38,6 +45,13 @@ static QString UrlToLocalFileIfPossible(QUrl url) {
 }
 
 int Transcoder::JobFinishedEvent::sEventType = -1;
+int Transcoder::SegmentSeekEvent::sEventType = -1;
+
+const qint64 Transcoder::kDefaultMinSegmentLength = 5 * 60 * kNsecPerSec;
+
+// Parts of files are decoded from this long before the start of their segment
+// until this long after the end, and then cut to the exact sample.
+static const GstClockTime kSegmentSeekMargin = GST_SECOND;
 
 TranscoderPreset::TranscoderPreset(Song::FileType type, const QString& name,
                                    const QString& extension,
@@ -204,8 +218,11 @@ QString Transcoder::GetEncoderFactoryForMimeType(const QString& mime_type) {
 Transcoder::JobFinishedEvent::JobFinishedEvent(JobState* state, bool success)
     : QEvent(QEvent::Type(sEventType)), state_(state), success_(success) {}
 
+Transcoder::SegmentSeekEvent::SegmentSeekEvent(JobState* state)
+    : QEvent(QEvent::Type(sEventType)), state_(state) {}
+
 void Transcoder::JobState::PostFinished(bool success) {
-  if (success) {
+  if (success && !job_.split) {
     emit parent_->LogLine(tr("Successfully written %1")
                               .arg(QDir::toNativeSeparators(job_.output)));
   }
@@ -214,17 +231,39 @@ void Transcoder::JobState::PostFinished(bool success) {
                               new Transcoder::JobFinishedEvent(this, success));
 }
 
+void Transcoder::JobState::PostSeek() {
+  if (segment_state_.testAndSetOrdered(Segment_WaitingForSeek,
+                                       Segment_Seeking)) {
+    QCoreApplication::postEvent(parent_,
+                                new Transcoder::SegmentSeekEvent(this));
+  }
+}
+
 QString Transcoder::JobState::GetDisplayName() {
+  if (job_.split) {
+    return QString("%1 => %2 (%3)")
+        .arg(job_.input.fileName(),
+             QFileInfo(job_.split->job.output).fileName(),
+             Utilities::PrettyTimeNanosec(job_.segment_start));
+  }
   return job_.input.fileName() + " => " + QFileInfo(job_.output).fileName();
 }
 
 Transcoder::Transcoder(QObject* parent, const QString& settings_postfix)
     : QObject(parent),
-      max_threads_(QThread::idealThreadCount()),
+      // The pipelines run in GStreamer's own threads, but they take as many
+      // cores as normal background jobs can.
+      max_threads_(
+          WorkScheduler::Instance()->limit(WorkScheduler::Priority_Normal)),
+      min_segment_length_(kDefaultMinSegmentLength),
+      next_discover_id_(0),
+      next_stitch_id_(0),
       settings_postfix_(settings_postfix),
       model_(new GstPipelineModel(this)) {
   if (JobFinishedEvent::sEventType == -1)
     JobFinishedEvent::sEventType = QEvent::registerEventType();
+  if (SegmentSeekEvent::sEventType == -1)
+    SegmentSeekEvent::sEventType = QEvent::registerEventType();
 
   // Initialise some settings for the lamemp3enc element.
   QSettings s;
@@ -373,7 +412,8 @@ void Transcoder::Start() {
 Transcoder::StartJobStatus Transcoder::MaybeStartNextJob() {
   if (current_jobs_.count() >= max_threads()) return AllThreadsBusy;
   if (queued_jobs_.isEmpty()) {
-    if (current_jobs_.isEmpty()) {
+    if (current_jobs_.isEmpty() && discovering_jobs_.isEmpty() &&
+        stitching_jobs_.isEmpty()) {
       emit AllJobsComplete();
     }
 
@@ -381,14 +421,139 @@ Transcoder::StartJobStatus Transcoder::MaybeStartNextJob() {
   }
 
   Job job = queued_jobs_.takeFirst();
+  if (MaybeDiscoverJob(job)) {
+    // It's queued again when the discoverer has finished with it.
+    return MaybeStartNextJob();
+  }
+
   if (StartJob(job)) {
     return StartedSuccessfully;
   }
 
-  emit JobComplete(job.input, job.output, false);
+  if (job.split) {
+    SegmentFinished(job, false);
+  } else {
+    emit JobComplete(job.input, job.output, false);
+  }
   return FailedToStart;
 }
 
+bool Transcoder::MaybeDiscoverJob(const Job& job) {
+  if (job.split || job.discovered || max_threads() < 2 ||
+      min_segment_length_ <= 0 || !job.input.isLocalFile() ||
+      SegmentStitcher::MethodForFileType(job.preset.type_) ==
+          SegmentStitcher::Method_None) {
+    return false;
+  }
+
+  // The discoverer can take seconds to give up on a file, so it doesn't run
+  // in this thread.
+  const int id = next_discover_id_++;
+  discovering_jobs_[id] = job;
+
+  QFuture<AudioInfo> future = WorkScheduler::Instance()->Run<AudioInfo>(
+      WorkScheduler::Priority_Normal,
+      std::bind(&Transcoder::DiscoverAudio, job.input));
+  NewClosure(future, this, SLOT(DiscoverFinished(QFuture<AudioInfo>, int)),
+             future, id);
+  return true;
+}
+
+void Transcoder::DiscoverFinished(QFuture<AudioInfo> future, int id) {
+  // The job was cancelled.
+  if (!discovering_jobs_.contains(id)) return;
+
+  Job job = discovering_jobs_.take(id);
+  job.discovered = true;
+  if (!MaybeSplitJob(job, future.result())) {
+    queued_jobs_.prepend(job);
+  }
+
+  forever {
+    StartJobStatus status = MaybeStartNextJob();
+    if (status == AllThreadsBusy || status == NoMoreJobs) break;
+  }
+}
+
+bool Transcoder::MaybeSplitJob(const Job& job, const AudioInfo& info) {
+  const GstClockTime duration = info.duration;
+  const int sample_rate = info.sample_rate;
+  if (sample_rate <= 0) return false;
+
+  const int count = qMin<qint64>(max_threads(), duration / min_segment_length_);
+  if (count < 2) return false;
+
+  // Every part but the last is a whole number of FLAC blocks long, so FLAC
+  // parts can be joined without changing the block size.
+  const quint64 total_samples =
+      gst_util_uint64_scale(duration, sample_rate, GST_SECOND);
+  const quint64 alignment = SegmentStitcher::kFlacBlockAlignment;
+  const quint64 segment_samples =
+      ((total_samples + count - 1) / count + alignment - 1) / alignment *
+      alignment;
+
+  std::shared_ptr<SplitJob> split(new SplitJob);
+  split->job = job;
+  split->method = SegmentStitcher::MethodForFileType(job.preset.type_);
+  split->finished = 0;
+  split->success = true;
+
+  QList<Job> segments;
+  for (quint64 start = 0; start < total_samples; start += segment_samples) {
+    const quint64 stop = start + segment_samples;
+
+    Job segment = job;
+    segment.output = Utilities::GetTemporaryFileName();
+    segment.split = split;
+    segment.segment_start =
+        gst_util_uint64_scale_round(start, GST_SECOND, sample_rate);
+    if (stop < total_samples) {
+      segment.segment_stop =
+          gst_util_uint64_scale_round(stop, GST_SECOND, sample_rate);
+    }
+
+    segments << segment;
+    split->segments << segment.output;
+  }
+
+  emit LogLine(tr("Transcoding %1 in %2 parts")
+                   .arg(UrlToLocalFileIfPossible(job.input))
+                   .arg(segments.count()));
+
+  queued_jobs_ = segments + queued_jobs_;
+  return true;
+}
+
+Transcoder::AudioInfo Transcoder::DiscoverAudio(const QUrl& url) {
+  AudioInfo ret;
+
+  GError* error = nullptr;
+  GstDiscoverer* discoverer = gst_discoverer_new(5 * GST_SECOND, &error);
+  if (!discoverer) {
+    g_error_free(error);
+    return ret;
+  }
+
+  GstDiscovererInfo* info = gst_discoverer_discover_uri(
+      discoverer, url.toString().toUtf8().constData(), &error);
+
+  if (info && gst_discoverer_info_get_result(info) == GST_DISCOVERER_OK) {
+    GList* streams = gst_discoverer_info_get_audio_streams(info);
+    const GstClockTime duration = gst_discoverer_info_get_duration(info);
+    if (streams && GST_CLOCK_TIME_IS_VALID(duration)) {
+      ret.duration = duration;
+      ret.sample_rate = gst_discoverer_audio_info_get_sample_rate(
+          GST_DISCOVERER_AUDIO_INFO(streams->data));
+    }
+    gst_discoverer_stream_info_list_free(streams);
+  }
+
+  if (info) gst_discoverer_info_unref(info);
+  if (error) g_error_free(error);
+  g_object_unref(discoverer);
+  return ret;
+}
+
 void Transcoder::NewPadCallback(GstElement*, GstPad* pad, gpointer data) {
   JobState* state = reinterpret_cast<JobState*>(data);
   GstPad* const audiopad =
@@ -416,12 +581,105 @@ GstBusSyncReply Transcoder::BusCallbackSync(GstBus*, GstMessage* msg,
       state->PostFinished(false);
       break;
 
+    case GST_MESSAGE_ASYNC_DONE:
+      // Parts of files can be seeked to their segment once they've prerolled.
+      if (state->job_.split &&
+          GST_MESSAGE_SRC(msg) == GST_OBJECT(state->Pipeline())) {
+        state->PostSeek();
+      }
+      break;
+
     default:
       break;
   }
   return GST_BUS_PASS;
 }
 
+GstPadProbeReturn Transcoder::SegmentProbeCallback(GstPad* pad,
+                                                   GstPadProbeInfo* info,
+                                                   gpointer data) {
+  JobState* state = reinterpret_cast<JobState*>(data);
+  const Job& job = state->job_;
+
+  if (info->type & GST_PAD_PROBE_TYPE_EVENT_FLUSH) {
+    // The seek to the segment has finished when its flush gets here.
+    if (GST_EVENT_TYPE(GST_PAD_PROBE_INFO_EVENT(info)) ==
+        GST_EVENT_FLUSH_STOP) {
+      state->segment_state_.testAndSetOrdered(JobState::Segment_Seeking,
+                                              JobState::Segment_Encoding);
+    }
+    return GST_PAD_PROBE_OK;
+  }
+
+  switch (state->segment_state_.load()) {
+    case JobState::Segment_Encoding:
+      break;
+
+    case JobState::Segment_Ending:
+      state->segment_state_ = JobState::Segment_Done;
+      gst_pad_send_event(pad, gst_event_new_eos());
+      return GST_PAD_PROBE_DROP;
+
+    default:
+      return GST_PAD_PROBE_DROP;
+  }
+
+  GstAudioInfo audio_info;
+  GstCaps* caps = gst_pad_get_current_caps(pad);
+  const bool have_info = caps && gst_audio_info_from_caps(&audio_info, caps);
+  if (caps) gst_caps_unref(caps);
+  if (!have_info) return GST_PAD_PROBE_OK;
+
+  // Work out which samples are in this buffer, and which of them are in the
+  // segment.
+  const int rate = GST_AUDIO_INFO_RATE(&audio_info);
+  const int bpf = GST_AUDIO_INFO_BPF(&audio_info);
+  const quint64 start =
+      gst_util_uint64_scale_round(job.segment_start, rate, GST_SECOND);
+  const quint64 stop =
+      GST_CLOCK_TIME_IS_VALID(job.segment_stop)
+          ? gst_util_uint64_scale_round(job.segment_stop, rate, GST_SECOND)
+          : G_MAXUINT64;
+
+  GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+  const quint64 first =
+      GST_BUFFER_PTS_IS_VALID(buffer)
+          ? gst_util_uint64_scale_round(GST_BUFFER_PTS(buffer), rate,
+                                        GST_SECOND)
+          : state->next_sample_;
+  const quint64 count = gst_buffer_get_size(buffer) / bpf;
+  state->next_sample_ = first + count;
+
+  if (first + count <= start) return GST_PAD_PROBE_DROP;
+  if (first >= stop) {
+    state->segment_state_ = JobState::Segment_Done;
+    gst_pad_send_event(pad, gst_event_new_eos());
+    return GST_PAD_PROBE_DROP;
+  }
+
+  const quint64 clip_start = qMax(first, start);
+  const quint64 clip_stop = qMin(first + count, stop);
+  if (clip_stop == stop) {
+    state->segment_state_ = JobState::Segment_Ending;
+  }
+
+  if (clip_start != first || clip_stop != first + count) {
+    GstBuffer* clipped =
+        gst_buffer_copy_region(buffer, GST_BUFFER_COPY_ALL,
+                               (clip_start - first) * bpf,
+                               (clip_stop - clip_start) * bpf);
+    GST_BUFFER_PTS(clipped) =
+        gst_util_uint64_scale_round(clip_start, GST_SECOND, rate);
+    GST_BUFFER_DURATION(clipped) =
+        gst_util_uint64_scale_round(clip_stop - clip_start, GST_SECOND, rate);
+
+    gst_buffer_unref(buffer);
+    GST_PAD_PROBE_INFO_DATA(info) = clipped;
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
 void Transcoder::JobState::ReportError(GstMessage* msg) {
   GError* error;
   gchar* debugs;
@@ -496,6 +754,19 @@ bool Transcoder::StartJob(const Job& job) {
   QFileInfo output_file_path(job.output);
   output_file_path.dir().mkpath(".");
 
+  if (job.split) {
+    // The encoder only gets to see the samples in the segment.  The sink
+    // won't get anything until the pipeline's been seeked, so it mustn't
+    // wait for data before it can pause.
+    GstPad* pad = gst_element_get_static_pad(codec, "sink");
+    gst_pad_add_probe(pad,
+                      GstPadProbeType(GST_PAD_PROBE_TYPE_BUFFER |
+                                      GST_PAD_PROBE_TYPE_EVENT_FLUSH),
+                      SegmentProbeCallback, state.get(), nullptr);
+    gst_object_unref(pad);
+    g_object_set(sink, "async", FALSE, nullptr);
+  }
+
   // Set callbacks
   state->convert_element_ = convert;
 
@@ -504,8 +775,14 @@ bool Transcoder::StartJob(const Job& job) {
       gst_pipeline_get_bus(GST_PIPELINE(state->Pipeline())), BusCallbackSync,
       state.get(), nullptr);
 
-  // Start the pipeline
-  gst_element_set_state(state->Pipeline(), GST_STATE_PLAYING);
+  // Start the pipeline.  Parts of files are paused first, and started again
+  // by SeekSegment.
+  if (!job.split) {
+    gst_element_set_state(state->Pipeline(), GST_STATE_PLAYING);
+  } else if (gst_element_set_state(state->Pipeline(), GST_STATE_PAUSED) ==
+             GST_STATE_CHANGE_SUCCESS) {
+    state->PostSeek();
+  }
 
   // GStreamer now transcodes in another thread, so we can return now and do
   // something else.  Keep the JobState object around.  It'll post an event
@@ -532,8 +809,7 @@ bool Transcoder::event(QEvent* e) {
       return true;
     }
 
-    QUrl input = (*it)->job_.input;
-    QString output = (*it)->job_.output;
+    const Job job = (*it)->job_;
 
     // Remove event handlers from the gstreamer pipeline so they don't get
     // called after the pipeline is shutting down
@@ -545,8 +821,13 @@ bool Transcoder::event(QEvent* e) {
     model_->RemovePipeline((*it)->id());
     current_jobs_.erase(it);
 
-    // Emit the finished signal
-    emit JobComplete(input, output, finished_event->success_);
+    // Emit the finished signal, or join the parts of the file if they're all
+    // done.
+    if (job.split) {
+      SegmentFinished(job, finished_event->success_);
+    } else {
+      emit JobComplete(job.input, job.output, finished_event->success_);
+    }
 
     // Start some more jobs
     MaybeStartNextJob();
@@ -554,12 +835,132 @@ bool Transcoder::event(QEvent* e) {
     return true;
   }
 
+  if (e->type() == SegmentSeekEvent::sEventType) {
+    JobState* state = static_cast<SegmentSeekEvent*>(e)->state_;
+    for (const auto& job_state : current_jobs_) {
+      if (job_state.get() == state) {
+        SeekSegment(state);
+        break;
+      }
+    }
+    return true;
+  }
+
   return QObject::event(e);
 }
 
+void Transcoder::SeekSegment(JobState* state) {
+  const Job& job = state->job_;
+
+  const GstClockTime start = job.segment_start > kSegmentSeekMargin
+                                 ? job.segment_start - kSegmentSeekMargin
+                                 : 0;
+  const bool has_stop = GST_CLOCK_TIME_IS_VALID(job.segment_stop);
+
+  if (!gst_element_seek(
+          state->Pipeline(), 1.0, GST_FORMAT_TIME,
+          GstSeekFlags(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE),
+          GST_SEEK_TYPE_SET, start,
+          has_stop ? GST_SEEK_TYPE_SET : GST_SEEK_TYPE_NONE,
+          has_stop ? job.segment_stop + kSegmentSeekMargin
+                   : GST_CLOCK_TIME_NONE)) {
+    emit LogLine(tr("Error processing %1: %2")
+                     .arg(UrlToLocalFileIfPossible(job.input),
+                          tr("Couldn't seek to %1")
+                              .arg(Utilities::PrettyTimeNanosec(
+                                  job.segment_start))));
+    state->PostFinished(false);
+    return;
+  }
+
+  gst_element_set_state(state->Pipeline(), GST_STATE_PLAYING);
+}
+
+void Transcoder::SegmentFinished(const Job& job, bool success) {
+  std::shared_ptr<SplitJob> split = job.split;
+  split->finished++;
+
+  if (!success && split->success) {
+    // There's no point transcoding the rest of the file.
+    split->success = false;
+    for (auto it = queued_jobs_.begin(); it != queued_jobs_.end();) {
+      if (it->split == split) {
+        it = queued_jobs_.erase(it);
+        split->finished++;
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  if (split->finished < split->segments.count()) return;
+
+  if (!split->success) {
+    for (const QString& segment : split->segments) {
+      QFile::remove(segment);
+    }
+    emit JobComplete(split->job.input, split->job.output, false);
+    return;
+  }
+
+  // Joining the parts means copying the whole file again, so it's done as a
+  // background job.
+  QFileInfo(split->job.output).dir().mkpath(".");
+
+  const int id = next_stitch_id_++;
+  stitching_jobs_[id] = split;
+
+  QFuture<bool> future = WorkScheduler::Instance()->Run<bool>(
+      WorkScheduler::Priority_Normal,
+      std::bind(&SegmentStitcher::Stitch, split->method, split->segments,
+                split->job.output));
+  NewClosure(future, this, SLOT(StitchFinished(QFuture<bool>, int)), future,
+             id);
+}
+
+void Transcoder::StitchFinished(QFuture<bool> future, int id) {
+  std::shared_ptr<SplitJob> split = stitching_jobs_.take(id);
+  if (!split) return;
+
+  for (const QString& segment : split->segments) {
+    QFile::remove(segment);
+  }
+
+  const Job& job = split->job;
+  const bool success = future.result();
+  if (success) {
+    emit LogLine(tr("Successfully written %1")
+                     .arg(QDir::toNativeSeparators(job.output)));
+  } else {
+    QFile::remove(job.output);
+    emit LogLine(tr("Error processing %1: %2")
+                     .arg(UrlToLocalFileIfPossible(job.input),
+                          tr("Couldn't join the parts of the file")));
+  }
+
+  emit JobComplete(job.input, job.output, success);
+  MaybeStartNextJob();
+}
+
 void Transcoder::Cancel() {
+  // Parts of files that have already been written are thrown away.  Parts
+  // that are being joined together are left to finish.
+  QSet<SplitJob*> split_jobs;
+  for (const Job& job : queued_jobs_) {
+    if (job.split) split_jobs << job.split.get();
+  }
+  for (const auto& state : current_jobs_) {
+    if (state->job_.split) split_jobs << state->job_.split.get();
+  }
+  for (SplitJob* split : split_jobs) {
+    for (const QString& segment : split->segments) {
+      QFile::remove(segment);
+    }
+  }
+
   // Remove all pending jobs
   queued_jobs_.clear();
+  discovering_jobs_.clear();
 
   // Stop the running ones
   JobStateList::iterator it = current_jobs_.begin();
@@ -597,6 +998,7 @@ void Transcoder::DumpGraph(int id) {
 
 QMap<QUrl, float> Transcoder::GetProgress() const {
   QMap<QUrl, float> ret;
+  QSet<SplitJob*> split_jobs;
 
   for (const auto& state : current_jobs_) {
     if (!state->Pipeline()) continue;
@@ -607,7 +1009,27 @@ QMap<QUrl, float> Transcoder::GetProgress() const {
     gst_element_query_position(state->Pipeline(), GST_FORMAT_TIME, &position);
     gst_element_query_duration(state->Pipeline(), GST_FORMAT_TIME, &duration);
 
-    ret[state->job_.input] = float(position) / duration;
+    const Job& job = state->job_;
+    if (!job.split) {
+      ret[job.input] = float(position) / duration;
+      continue;
+    }
+
+    // Each part of a file counts for its share of the file.
+    const gint64 start = job.segment_start;
+    const gint64 stop = GST_CLOCK_TIME_IS_VALID(job.segment_stop)
+                            ? gint64(job.segment_stop)
+                            : duration;
+    if (stop > start) {
+      ret[job.input] += float(qBound(start, position, stop) - start) /
+                        (stop - start) / job.split->segments.count();
+    }
+    split_jobs << job.split.get();
+  }
+
+  for (SplitJob* split : split_jobs) {
+    ret[split->job.input] +=
+        float(split->finished) / split->segments.count();
   }
 
   return ret;
@@ -20,7 +20,10 @@
 
 #include <gst/gst.h>
 
+#include <QAtomicInt>
 #include <QEvent>
+#include <QFuture>
+#include <QMap>
 #include <QMetaType>
 #include <QObject>
 #include <QStringList>
@@ -29,6 +32,7 @@
 
 #include "core/song.h"
 #include "engines/gstpipelinebase.h"
+#include "transcoder/segmentstitcher.h"
 
 struct SuitableElement;
 
@@ -71,13 +75,24 @@ class Transcoder : public QObject {
   int max_threads() const { return max_threads_; }
   void set_max_threads(int count) { max_threads_ = count; }
 
+  // Files at least twice this long (in nanoseconds) are split into up to
+  // max_threads() parts which are transcoded at the same time, if they're
+  // being transcoded to FLAC.  0 turns this off.
+  static const qint64 kDefaultMinSegmentLength;
+  qint64 min_segment_length() const { return min_segment_length_; }
+  void set_min_segment_length(qint64 nanosec) {
+    min_segment_length_ = nanosec;
+  }
+
   void AddJob(const QUrl& input, const TranscoderPreset& preset,
               const QString& output = QString(),
               bool overwrite_existing = false);
   void AddTemporaryJob(const QUrl& input, const TranscoderPreset& preset);
 
   QMap<QUrl, float> GetProgress() const;
-  int QueuedJobsCount() const { return queued_jobs_.count(); }
+  int QueuedJobsCount() const {
+    return queued_jobs_.count() + discovering_jobs_.count();
+  }
 
   GstPipelineModel* model() { return model_; }
 
@@ -95,24 +110,81 @@ class Transcoder : public QObject {
   bool event(QEvent* e);
 
  private:
+  // The length and sample rate of a file, or zeros if the discoverer couldn't
+  // find any audio in it.
+  struct AudioInfo {
+    AudioInfo() : duration(0), sample_rate(0) {}
+
+    GstClockTime duration;
+    int sample_rate;
+  };
+
+ private slots:
+  void DiscoverFinished(QFuture<AudioInfo> future, int id);
+  void StitchFinished(QFuture<bool> future, int id);
+
+ private:
+  struct SplitJob;
+
   // The description of a file to transcode - lives in the main thread.
   struct Job {
+    Job()
+        : discovered(false),
+          segment_start(0),
+          segment_stop(GST_CLOCK_TIME_NONE) {}
+
     QUrl input;
     QString output;
     TranscoderPreset preset;
+
+    // Set once the discoverer has looked at the input to see if it's long
+    // enough to split.
+    bool discovered;
+
+    // Set if this job only transcodes part of the input, from segment_start
+    // up to segment_stop.
+    std::shared_ptr<SplitJob> split;
+    GstClockTime segment_start;
+    GstClockTime segment_stop;
+  };
+
+  // A file that's being transcoded in parts.  The parts are written to
+  // temporary files, and joined into the real output when they've all
+  // finished.
+  struct SplitJob {
+    Job job;
+    SegmentStitcher::Method method;
+    QStringList segments;
+    int finished;
+    bool success;
   };
 
   // State held by a job and shared across gstreamer callbacks - lives in the
   // job's thread.
   class JobState : public GstPipelineBase {
    public:
+    // Where the pipeline of a job that transcodes part of a file is up to.
+    // It's prerolled first, then seeked to a little before the start of its
+    // segment.  The encoder doesn't see any audio until the seek has
+    // finished, and then only sees the samples that are in the segment.
+    enum SegmentState {
+      Segment_WaitingForSeek,
+      Segment_Seeking,
+      Segment_Encoding,
+      Segment_Ending,
+      Segment_Done,
+    };
+
     JobState(const Job& job, Transcoder* parent)
         : GstPipelineBase("transcode"),
           job_(job),
           parent_(parent),
-          convert_element_(nullptr) {}
+          convert_element_(nullptr),
+          segment_state_(Segment_WaitingForSeek),
+          next_sample_(0) {}
 
     void PostFinished(bool success);
+    void PostSeek();
     void ReportError(GstMessage* msg);
 
     GstElement* Pipeline() { return pipeline_; }
@@ -121,6 +193,9 @@ class Transcoder : public QObject {
     Job job_;
     Transcoder* parent_;
     GstElement* convert_element_;
+
+    QAtomicInt segment_state_;
+    quint64 next_sample_;
   };
 
   // Event passed from a GStreamer callback to the Transcoder when a job
@@ -134,6 +209,16 @@ class Transcoder : public QObject {
     bool success_;
   };
 
+  // Event passed from a GStreamer callback to the Transcoder when a job that
+  // transcodes part of a file is ready to be seeked to its segment.
+  struct SegmentSeekEvent : public QEvent {
+    explicit SegmentSeekEvent(JobState* state);
+
+    static int sEventType;
+
+    JobState* state_;
+  };
+
   enum StartJobStatus {
     StartedSuccessfully,
     FailedToStart,
@@ -144,6 +229,12 @@ class Transcoder : public QObject {
   StartJobStatus MaybeStartNextJob();
   bool StartJob(const Job& job);
 
+  bool MaybeDiscoverJob(const Job& job);
+  bool MaybeSplitJob(const Job& job, const AudioInfo& info);
+  void SeekSegment(JobState* state);
+  void SegmentFinished(const Job& job, bool success);
+  static AudioInfo DiscoverAudio(const QUrl& url);
+
   GstElement* CreateElement(const QString& factory_name,
                             GstElement* bin = nullptr,
                             const QString& name = QString());
@@ -158,13 +249,25 @@ class Transcoder : public QObject {
   static void NewPadCallback(GstElement*, GstPad* pad, gpointer data);
   static GstBusSyncReply BusCallbackSync(GstBus*, GstMessage* msg,
                                          gpointer data);
+  static GstPadProbeReturn SegmentProbeCallback(GstPad* pad,
+                                                GstPadProbeInfo* info,
+                                                gpointer data);
 
  private:
   typedef QList<std::shared_ptr<JobState>> JobStateList;
 
   int max_threads_;
+  qint64 min_segment_length_;
   QList<Job> queued_jobs_;
   JobStateList current_jobs_;
+
+  // Jobs waiting for the discoverer before they're queued again, by ID.
+  QMap<int, Job> discovering_jobs_;
+  int next_discover_id_;
+
+  // Split jobs whose parts are being joined, by ID.
+  QMap<int, std::shared_ptr<SplitJob>> stitching_jobs_;
+  int next_stitch_id_;
   QString settings_postfix_;
   GstPipelineModel* model_;
 };
@@ -156,6 +156,8 @@ void AppearanceSettingsPage::Load() {
   ui_->moodbar_calculate->setChecked(!s.value("calculate", true).toBool());
   ui_->moodbar_save->setChecked(
       s.value("save_alongside_originals", false).toBool());
+  ui_->moodbar_generate_threads->setValue(
+      s.value("generate_threads", 0).toInt());
   s.endGroup();
 
   InitMoodbarPreviews();
@@ -203,6 +205,7 @@ void AppearanceSettingsPage::Save() {
   s.setValue("show", ui_->moodbar_show->isChecked());
   s.setValue("style", ui_->moodbar_style->currentIndex());
   s.setValue("save_alongside_originals", ui_->moodbar_save->isChecked());
+  s.setValue("generate_threads", ui_->moodbar_generate_threads->value());
   s.endGroup();
 }
 
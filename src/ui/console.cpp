@@ -1,6 +1,9 @@
 #include "console.h"
 
+#include <QDir>
+#include <QFileDialog>
 #include <QFont>
+#include <QMessageBox>
 #include <QScrollBar>
 #include <QSqlDatabase>
 #include <QSqlQuery>
@@ -9,12 +12,25 @@
 #include "core/application.h"
 #include "core/database.h"
 #include "core/logging.h"
+#include "core/queryprofiler.h"
+#include "core/tracing.h"
 
 Console::Console(Application* app, QWidget* parent)
     : QDialog(parent), app_(app) {
   ui_.setupUi(this);
   connect(ui_.database_run, SIGNAL(clicked()), SLOT(RunQuery()));
+  connect(ui_.profile_enabled, SIGNAL(toggled(bool)),
+          SLOT(ProfileEnabledChanged(bool)));
+  connect(ui_.profile_slow_msec, SIGNAL(valueChanged(int)),
+          SLOT(SlowQueryMsecChanged(int)));
+  connect(ui_.profile_refresh, SIGNAL(clicked()), SLOT(RefreshProfile()));
+  connect(ui_.profile_reset, SIGNAL(clicked()), SLOT(ResetProfile()));
   connect(ui_.qt_dump_button, SIGNAL(clicked()), SLOT(Dump()));
+  connect(ui_.tracing_start, SIGNAL(clicked()), SLOT(StartTracing()));
+  connect(ui_.tracing_stop, SIGNAL(clicked()), SLOT(StopTracing()));
+
+  ui_.tracing_start->setEnabled(!tracing::IsEnabled());
+  ui_.tracing_stop->setEnabled(tracing::IsEnabled());
 
   QFont font("Monospace");
   font.setStyleHint(QFont::TypeWriter);
@@ -22,6 +38,11 @@ Console::Console(Application* app, QWidget* parent)
   ui_.database_output->setFont(font);
   ui_.database_query->setFont(font);
 
+  QueryProfiler* profiler = app_->database()->query_profiler();
+  ui_.profile_enabled->setChecked(profiler->is_enabled());
+  ui_.profile_slow_msec->setValue(profiler->slow_query_msec());
+  RefreshProfile();
+
   QList<QObject*> objs = GetTopLevelObjects();
   for (QObject* obj : objs)
     ui_.qt_dump_box->addItem(obj->objectName() + " object tree",
@@ -53,6 +74,40 @@ void Console::RunQuery() {
       ui_.database_output->verticalScrollBar()->maximum());
 }
 
+void Console::ProfileEnabledChanged(bool enabled) {
+  app_->database()->query_profiler()->SetEnabled(enabled);
+}
+
+void Console::SlowQueryMsecChanged(int msec) {
+  app_->database()->query_profiler()->SetSlowQueryMsec(msec);
+}
+
+void Console::RefreshProfile() {
+  ui_.profile_results->clear();
+  ui_.profile_results->setSortingEnabled(false);
+
+  for (const QueryProfiler::Stats& stats :
+       app_->database()->query_profiler()->Results()) {
+    QTreeWidgetItem* item = new QTreeWidgetItem(ui_.profile_results);
+    item->setText(0, stats.sql_);
+    item->setData(1, Qt::DisplayRole, stats.count_);
+    item->setData(2, Qt::DisplayRole, stats.total_nsec_ / 1000000.0);
+    item->setData(3, Qt::DisplayRole, stats.p99_nsec_ / 1000000.0);
+    item->setData(4, Qt::DisplayRole, stats.rows_);
+    item->setToolTip(0, stats.plan_.isEmpty()
+                            ? stats.sql_
+                            : stats.sql_ + "\n\n" + stats.plan_);
+  }
+
+  ui_.profile_results->setSortingEnabled(true);
+  ui_.profile_results->sortByColumn(2, Qt::DescendingOrder);
+}
+
+void Console::ResetProfile() {
+  app_->database()->query_profiler()->Reset();
+  RefreshProfile();
+}
+
 void Console::Dump() {
   QString item = ui_.qt_dump_box->currentData().toString();
   QObject* obj = FindTopLevelObject(item);
@@ -63,6 +118,26 @@ void Console::Dump() {
   obj->dumpObjectTree();
 }
 
+void Console::StartTracing() {
+  tracing::Start();
+  ui_.tracing_start->setEnabled(false);
+  ui_.tracing_stop->setEnabled(true);
+}
+
+void Console::StopTracing() {
+  QString filename = QFileDialog::getSaveFileName(
+      this, tr("Save trace"), QDir::homePath() + "/clementine-trace.json",
+      tr("Trace files (*.json)"));
+  if (filename.isEmpty()) return;
+
+  if (!tracing::StopAndSave(filename)) {
+    QMessageBox::warning(this, tr("Save trace"),
+                         tr("Couldn't write to %1").arg(filename));
+  }
+  ui_.tracing_start->setEnabled(true);
+  ui_.tracing_stop->setEnabled(false);
+}
+
 QList<QObject*> Console::GetTopLevelObjects() {
   QList<QObject*> objs;
   objs << app_;
@@ -17,8 +17,16 @@ class Console : public QDialog {
  private slots:
   // Database
   void RunQuery();
+  // Queries
+  void ProfileEnabledChanged(bool enabled);
+  void SlowQueryMsecChanged(int msec);
+  void RefreshProfile();
+  void ResetProfile();
   // Qt
   void Dump();
+  // Tracing
+  void StartTracing();
+  void StopTracing();
 
  private:
   QList<QObject*> GetTopLevelObjects();
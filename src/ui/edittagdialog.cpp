@@ -25,14 +25,15 @@
 #include <QMessageBox>
 #include <QPushButton>
 #include <QShortcut>
-#include <QtConcurrentRun>
 #include <QtDebug>
+#include <functional>
 #include <limits>
 
 #include "core/application.h"
 #include "core/logging.h"
 #include "core/tagreaderclient.h"
 #include "core/utilities.h"
+#include "core/workscheduler.h"
 #include "covers/albumcoverloader.h"
 #include "covers/coverproviders.h"
 #include "library/library.h"
@@ -56,7 +57,7 @@ EditTagDialog::EditTagDialog(Application* app, QWidget* parent)
       album_cover_choice_controller_(new AlbumCoverChoiceController(this)),
       loading_(false),
       ignore_edits_(false),
-      tag_fetcher_(new TagFetcher(this)),
+      tag_fetcher_(new TagFetcher(app->library()->fingerprint_store(), this)),
       cover_art_id_(0),
       cover_art_is_set_(false),
       results_dialog_(new TrackSelectionDialog(this)) {
@@ -256,8 +257,9 @@ void EditTagDialog::SetSongs(const SongList& s, const PlaylistItemList& items) {
   ui_->song_list->clear();
 
   // Reload tags in the background
-  QFuture<QList<Data>> future =
-      QtConcurrent::run(this, &EditTagDialog::LoadData, s);
+  QFuture<QList<Data>> future = WorkScheduler::Instance()->Run<QList<Data>>(
+      WorkScheduler::Priority_Interactive,
+      std::bind(&EditTagDialog::LoadData, this, s));
   NewClosure(future, this,
              SLOT(SetSongsFinished(QFuture<QList<EditTagDialog::Data>>)),
              future);
@@ -715,8 +717,9 @@ void EditTagDialog::accept() {
   if (!SetLoading(tr("Saving tracks") + "...")) return;
 
   // Save tags in the background
-  QFuture<void> future =
-      QtConcurrent::run(this, &EditTagDialog::SaveData, data_);
+  QFuture<void> future = WorkScheduler::Instance()->Run<void>(
+      WorkScheduler::Priority_Normal,
+      std::bind(&EditTagDialog::SaveData, this, data_));
   NewClosure(future, this, SLOT(AcceptFinished()));
 }
 
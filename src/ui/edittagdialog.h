@@ -138,7 +138,7 @@ class EditTagDialog : public QDialog {
   bool SetLoading(const QString& message);
   void SetSongListVisibility(bool visible);
 
-  // Called by QtConcurrentRun
+  // Run on the WorkScheduler
   QList<Data> LoadData(const SongList& songs) const;
   void SaveData(const QList<Data>& data);
 
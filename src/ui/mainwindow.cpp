@@ -55,6 +55,7 @@
 #include "core/songloader.h"
 #include "core/stylesheetloader.h"
 #include "core/taskmanager.h"
+#include "core/trackprefetcher.h"
 #include "core/timeconstants.h"
 #include "core/utilities.h"
 #include "devices/devicemanager.h"
@@ -78,6 +79,8 @@
 #include "library/librarydirectorymodel.h"
 #include "library/libraryfilterwidget.h"
 #include "library/libraryviewcontainer.h"
+#include "library/replaygainscanner.h"
+#include "musicbrainz/fingerprintstore.h"
 #include "musicbrainz/tagfetcher.h"
 #include "networkremote/networkremote.h"
 #include "playlist/playlist.h"
@@ -142,6 +145,7 @@
 
 #ifdef HAVE_MOODBAR
 #include "moodbar/moodbarcontroller.h"
+#include "moodbar/moodbarloader.h"
 #include "moodbar/moodbarproxystyle.h"
 #endif
 
@@ -484,6 +488,14 @@ MainWindow::MainWindow(Application* app, SystemTrayIcon* tray_icon, OSD* osd,
           SLOT(IncrementalScan()));
   connect(ui_->action_full_library_scan, SIGNAL(triggered()), app_->library(),
           SLOT(FullScan()));
+  connect(ui_->action_analyse_loudness, SIGNAL(triggered()),
+          app_->library()->replaygain_scanner(), SLOT(AnalyseLibraryAsync()));
+#ifdef HAVE_MOODBAR
+  connect(ui_->action_generate_moodbars, SIGNAL(triggered()),
+          app_->moodbar_loader(), SLOT(GenerateAllAsync()));
+#else
+  ui_->action_generate_moodbars->setVisible(false);
+#endif
   connect(ui_->action_queue_manager, SIGNAL(triggered()),
           SLOT(ShowQueueManager()));
   connect(ui_->action_add_files_to_transcoder, SIGNAL(triggered()),
@@ -668,10 +680,13 @@ MainWindow::MainWindow(Application* app, SystemTrayIcon* tray_icon, OSD* osd,
       library_view_group->addAction(tr("Show only duplicates"));
   library_show_untagged_ =
       library_view_group->addAction(tr("Show only untagged"));
+  library_show_audio_duplicates_ =
+      library_view_group->addAction(tr("Show only songs that sound the same"));
 
   library_show_all_->setCheckable(true);
   library_show_duplicates_->setCheckable(true);
   library_show_untagged_->setCheckable(true);
+  library_show_audio_duplicates_->setCheckable(true);
   library_show_all_->setChecked(true);
 
   connect(library_view_group, SIGNAL(triggered(QAction*)),
@@ -691,6 +706,7 @@ MainWindow::MainWindow(Application* app, SystemTrayIcon* tray_icon, OSD* osd,
   library_view_->filter()->AddMenuAction(library_show_all_);
   library_view_->filter()->AddMenuAction(library_show_duplicates_);
   library_view_->filter()->AddMenuAction(library_show_untagged_);
+  library_view_->filter()->AddMenuAction(library_show_audio_duplicates_);
   library_view_->filter()->AddMenuAction(separator);
   library_view_->filter()->AddMenuAction(library_config_action);
 
@@ -963,6 +979,7 @@ MainWindow::MainWindow(Application* app, SystemTrayIcon* tray_icon, OSD* osd,
   app_->playlist_manager()->Init(app_->library_backend(),
                                  app_->playlist_backend(),
                                  ui_->playlist_sequence, ui_->playlist);
+  app_->track_prefetcher()->Init();
 
   // This connection must be done after the playlists have been initialized.
   connect(this, SIGNAL(StopAfterToggled(bool)), osd_,
@@ -2710,6 +2727,12 @@ void MainWindow::ChangeLibraryQueryMode(QAction* action) {
     library_view_->filter()->SetQueryMode(QueryOptions::QueryMode_Duplicates);
   } else if (action == library_show_untagged_) {
     library_view_->filter()->SetQueryMode(QueryOptions::QueryMode_Untagged);
+  } else if (action == library_show_audio_duplicates_) {
+    library_view_->filter()->SetQueryMode(
+        QueryOptions::QueryMode_AudioDuplicates);
+    // Songs that haven't been fingerprinted yet will show up when this
+    // finishes.
+    app_->library()->fingerprint_store()->UpdateDuplicatesAsync();
   } else {
     library_view_->filter()->SetQueryMode(QueryOptions::QueryMode_All);
   }
@@ -363,6 +363,7 @@ class MainWindow : public QMainWindow, public PlatformInterface {
   QAction* library_show_all_;
   QAction* library_show_duplicates_;
   QAction* library_show_untagged_;
+  QAction* library_show_audio_duplicates_;
 
   QMenu* playlist_menu_;
   QAction* playlist_play_pause_;
@@ -24,15 +24,16 @@
 #include <QPushButton>
 #include <QResizeEvent>
 #include <QSettings>
-#include <QtConcurrentRun>
 #include <QtDebug>
 #include <algorithm>
+#include <functional>
 #include <memory>
 
 #include "core/musicstorage.h"
 #include "core/organise.h"
 #include "core/tagreaderclient.h"
 #include "core/utilities.h"
+#include "core/workscheduler.h"
 #include "iconloader.h"
 #include "library/librarybackend.h"
 #include "organiseerrordialog.h"
@@ -120,8 +121,9 @@ bool OrganiseDialog::SetUrls(const QList<QUrl>& urls) {
 }
 
 bool OrganiseDialog::SetFilenames(const QStringList& filenames) {
-  songs_future_ =
-      QtConcurrent::run(this, &OrganiseDialog::LoadSongsBlocking, filenames);
+  songs_future_ = WorkScheduler::Instance()->Run<SongList>(
+      WorkScheduler::Priority_Interactive,
+      std::bind(&OrganiseDialog::LoadSongsBlocking, this, filenames));
   NewClosure(songs_future_, [=]() { SetSongs(songs_future_.result()); });
 
   SetLoadingSongs(true);
@@ -269,6 +271,8 @@ QSize OrganiseDialog::sizeHint() const { return QSize(650, 0); }
 void OrganiseDialog::Reset() {
   ui_->naming_group->Reset();
   ui_->eject_after->setChecked(false);
+  ui_->copy_workers->setValue(Organise::kDefaultCopyWorkers);
+  ui_->verify_copies->setChecked(false);
 }
 
 void OrganiseDialog::showEvent(QShowEvent*) {
@@ -277,6 +281,9 @@ void OrganiseDialog::showEvent(QShowEvent*) {
   QSettings s;
   s.beginGroup(kSettingsGroup);
   ui_->eject_after->setChecked(s.value("eject_after", false).toBool());
+  ui_->copy_workers->setValue(
+      s.value("copy_workers", Organise::kDefaultCopyWorkers).toInt());
+  ui_->verify_copies->setChecked(s.value("verify_copies", false).toBool());
 
   QString destination = s.value("destination").toString();
   int index = ui_->destination->findText(destination);
@@ -290,6 +297,8 @@ void OrganiseDialog::accept() {
   s.beginGroup(kSettingsGroup);
   s.setValue("destination", ui_->destination->currentText());
   s.setValue("eject_after", ui_->eject_after->isChecked());
+  s.setValue("copy_workers", ui_->copy_workers->value());
+  s.setValue("verify_copies", ui_->verify_copies->isChecked());
   ui_->naming_group->StoreSettings();
 
   const QModelIndex destination =
@@ -312,6 +321,8 @@ void OrganiseDialog::accept() {
                    ui_->naming_group->overwrite_existing(),
                    ui_->naming_group->mark_as_listened(), new_songs_info_,
                    ui_->eject_after->isChecked());
+  organise->set_copy_workers(ui_->copy_workers->value());
+  organise->set_verify_copies(ui_->verify_copies->isChecked());
   connect(organise, SIGNAL(Finished(QStringList)),
           SLOT(OrganiseFinished(QStringList)));
   connect(organise, SIGNAL(FileCopied(int)), this, SIGNAL(FileCopied(int)));
@@ -17,6 +17,9 @@
 
 #include "playbacksettingspage.h"
 
+#include "core/application.h"
+#include "core/trackprefetcher.h"
+#include "core/utilities.h"
 #include "engines/gstengine.h"
 #include "iconloader.h"
 #include "playlist/playlist.h"
@@ -127,6 +130,23 @@ void PlaybackSettingsPage::Load() {
           .toString()));
   ui_->buffer_min_fill->setValue(s.value("bufferminfill", 33).toInt());
   s.endGroup();
+
+  s.beginGroup(TrackPrefetcher::kSettingsGroup);
+  ui_->prefetch_group->setChecked(s.value("enabled", true).toBool());
+  ui_->prefetch_lookahead->setValue(
+      s.value("lookahead", TrackPrefetcher::kDefaultLookahead).toInt());
+  ui_->prefetch_budget->setValue(
+      s.value("budget_mb", TrackPrefetcher::kDefaultBudgetMb).toInt());
+  s.endGroup();
+
+  const TrackPrefetcher::Stats& stats =
+      dialog()->app()->track_prefetcher()->stats();
+  ui_->prefetch_stats->setText(
+      tr("%1 of the %2 local tracks played since Clementine started were "
+         "read ahead (%3 read)")
+          .arg(stats.hits_)
+          .arg(stats.hits_ + stats.misses_)
+          .arg(Utilities::PrettySize(stats.bytes_read_)));
 }
 
 void PlaybackSettingsPage::Save() {
@@ -167,6 +187,12 @@ void PlaybackSettingsPage::Save() {
                  .toString());
   s.setValue("bufferminfill", ui_->buffer_min_fill->value());
   s.endGroup();
+
+  s.beginGroup(TrackPrefetcher::kSettingsGroup);
+  s.setValue("enabled", ui_->prefetch_group->isChecked());
+  s.setValue("lookahead", ui_->prefetch_lookahead->value());
+  s.setValue("budget_mb", ui_->prefetch_budget->value());
+  s.endGroup();
 }
 
 void PlaybackSettingsPage::RgPreampChanged(int value) {
@@ -22,10 +22,11 @@
 #include <QShortcut>
 #include <QTreeWidget>
 #include <QUrl>
-#include <QtConcurrentRun>
 #include <QtDebug>
+#include <functional>
 
 #include "core/tagreaderclient.h"
+#include "core/workscheduler.h"
 #include "ui/iconloader.h"
 #include "ui_trackselectiondialog.h"
 
@@ -255,8 +256,9 @@ void TrackSelectionDialog::accept() {
     SetLoading(tr("Saving tracks") + "...");
 
     // Save tags in the background
-    QFuture<void> future =
-        QtConcurrent::run(this, &TrackSelectionDialog::SaveData, data_);
+    QFuture<void> future = WorkScheduler::Instance()->Run<void>(
+        WorkScheduler::Priority_Normal,
+        std::bind(&TrackSelectionDialog::SaveData, this, data_));
     NewClosure(future, this, SLOT(AcceptFinished()));
     return;
   }
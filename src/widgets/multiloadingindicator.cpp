@@ -17,8 +17,12 @@
 
 #include "multiloadingindicator.h"
 
+#include <QContextMenuEvent>
 #include <QHBoxLayout>
+#include <QHelpEvent>
+#include <QMenu>
 #include <QPainter>
+#include <QToolTip>
 
 #include "core/taskmanager.h"
 #include "widgets/busyindicator.h"
@@ -28,7 +32,9 @@ const int MultiLoadingIndicator::kHorizontalPadding = 6;
 const int MultiLoadingIndicator::kSpacing = 6;
 
 MultiLoadingIndicator::MultiLoadingIndicator(QWidget* parent)
-    : QWidget(parent), spinner_(new BusyIndicator(this)) {
+    : QWidget(parent),
+      task_manager_(nullptr),
+      spinner_(new BusyIndicator(this)) {
   spinner_->move(kHorizontalPadding, kVerticalPadding);
   setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Fixed);
 }
@@ -59,6 +65,9 @@ void MultiLoadingIndicator::UpdateText() {
       int percentage = float(task.progress) / task.progress_max * 100;
       task_text += QString(" %1%").arg(percentage);
     }
+    if (task.paused) {
+      task_text += " " + tr("(paused)");
+    }
 
     strings << task_text;
   }
@@ -74,6 +83,63 @@ void MultiLoadingIndicator::UpdateText() {
   updateGeometry();
 }
 
+QString MultiLoadingIndicator::JobsToolTip() const {
+  const WorkScheduler::Stats stats = task_manager_->GetWorkStats();
+  const QString class_names[WorkScheduler::kPriorityCount] = {
+      tr("Interactive"), tr("Normal"), tr("Idle")};
+
+  QStringList jobs;
+  for (int i = 0; i < WorkScheduler::kPriorityCount; ++i) {
+    if (stats.running_[i] == 0 && stats.queued_[i] == 0) continue;
+    jobs << tr("%1: %2 running, %3 waiting")
+                .arg(class_names[i])
+                .arg(stats.running_[i])
+                .arg(stats.queued_[i]);
+  }
+  if (jobs.isEmpty()) return QString();
+  return tr("Background jobs") + "\n" + jobs.join("\n");
+}
+
+bool MultiLoadingIndicator::event(QEvent* e) {
+  // The job counts change too often to keep a tooltip up to date, so they're
+  // read when it's shown.
+  if (e->type() == QEvent::ToolTip && task_manager_) {
+    const QString text = JobsToolTip();
+    if (text.isEmpty()) {
+      QToolTip::hideText();
+      e->ignore();
+    } else {
+      QToolTip::showText(static_cast<QHelpEvent*>(e)->globalPos(), text, this);
+    }
+    return true;
+  }
+  return QWidget::event(e);
+}
+
+void MultiLoadingIndicator::contextMenuEvent(QContextMenuEvent* e) {
+  QMenu menu;
+  for (const TaskManager::Task& task : task_manager_->GetTasks()) {
+    if (!task.pausable) continue;
+
+    QString name(task.name);
+    name[0] = name[0].toLower();
+
+    const int id = task.id;
+    const bool paused = task.paused;
+    QAction* action = menu.addAction(paused ? tr("Resume %1").arg(name)
+                                            : tr("Pause %1").arg(name));
+    connect(action, &QAction::triggered, [this, id, paused]() {
+      task_manager_->SetTaskPaused(id, !paused);
+    });
+  }
+
+  if (menu.isEmpty()) {
+    QWidget::contextMenuEvent(e);
+    return;
+  }
+  menu.exec(e->globalPos());
+}
+
 void MultiLoadingIndicator::paintEvent(QPaintEvent*) {
   QPainter p(this);
 
@@ -41,12 +41,16 @@ class MultiLoadingIndicator : public QWidget {
   void TaskCountChange(int tasks);
 
  protected:
+  bool event(QEvent* e);
   void paintEvent(QPaintEvent*);
+  void contextMenuEvent(QContextMenuEvent* e);
 
  private slots:
   void UpdateText();
 
  private:
+  QString JobsToolTip() const;
+
   TaskManager* task_manager_;
 
   BusyIndicator* spinner_;
@@ -0,0 +1,132 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QSqlQuery>
+
+#include "core/database.h"
+#include "library/library.h"
+#include "library/librarybackend.h"
+#include "musicbrainz/chromaprinter.h"
+#include "musicbrainz/fingerprintstore.h"
+#include "test_utils.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+QVector<quint32> MakeFingerprint(int size, quint32 seed) {
+  QVector<quint32> ret;
+  quint32 value = seed;
+  for (int i = 0; i < size; ++i) {
+    // A simple LCG is random enough for this.
+    value = value * 1664525u + 1013904223u;
+    ret << value;
+  }
+  return ret;
+}
+
+TEST(FingerprintStoreTest, IdenticalFingerprints) {
+  const QVector<quint32> a = MakeFingerprint(200, 1);
+  EXPECT_DOUBLE_EQ(1.0, FingerprintStore::Similarity(a, a));
+}
+
+TEST(FingerprintStoreTest, UnrelatedFingerprints) {
+  const QVector<quint32> a = MakeFingerprint(200, 1);
+  const QVector<quint32> b = MakeFingerprint(200, 2);
+  EXPECT_LT(FingerprintStore::Similarity(a, b),
+            1.0 - FingerprintStore::kMaxBitErrorRate);
+}
+
+TEST(FingerprintStoreTest, FewBitsDifferent) {
+  const QVector<quint32> a = MakeFingerprint(200, 1);
+  QVector<quint32> b = a;
+  for (quint32& value : b) {
+    value ^= 0x1;  // 1 bit in 32
+  }
+  EXPECT_DOUBLE_EQ(1.0 - 1.0 / 32, FingerprintStore::Similarity(a, b));
+}
+
+TEST(FingerprintStoreTest, Offset) {
+  const QVector<quint32> a = MakeFingerprint(200, 1);
+  const QVector<quint32> b = a.mid(FingerprintStore::kMaxOffset);
+  EXPECT_DOUBLE_EQ(1.0, FingerprintStore::Similarity(a, b));
+  EXPECT_DOUBLE_EQ(1.0, FingerprintStore::Similarity(b, a));
+}
+
+TEST(FingerprintStoreTest, TooShort) {
+  const QVector<quint32> a =
+      MakeFingerprint(FingerprintStore::kMinOverlap - 1, 1);
+  EXPECT_DOUBLE_EQ(0.0, FingerprintStore::Similarity(a, a));
+}
+
+}  // namespace
+
+// Outside the anonymous namespace, so FingerprintStore can befriend it.
+TEST(FingerprintStoreTest, FindsDuplicates) {
+  MemoryDatabase database(nullptr);
+  LibraryBackend backend;
+  backend.Init(&database, Library::kSongsTable, Library::kDirsTable,
+               Library::kSubdirsTable, Library::kFtsTable);
+  backend.AddDirectory("/tmp");
+
+  SongList songs;
+  for (const QString& title : QStringList() << "a"
+                                            << "b"
+                                            << "c") {
+    Song song;
+    song.Init(title, "Artist", "Album", 123);
+    song.set_directory_id(1);
+    song.set_url(QUrl::fromLocalFile("/tmp/" + title + ".mp3"));
+    song.set_mtime(1);
+    song.set_ctime(1);
+    song.set_filesize(1);
+    songs << song;
+  }
+  backend.AddOrUpdateSongs(songs);
+
+  // b is a with a few values changed, so most of their indexed values are the
+  // same.  c has nothing in common with either.
+  const QVector<quint32> a = MakeFingerprint(200, 1);
+  QVector<quint32> b = a;
+  for (int i = 0; i < b.count(); i += 10) {
+    b[i] ^= 0x80000000;
+  }
+  const QVector<quint32> c = MakeFingerprint(200, 2);
+
+  FingerprintStore store(&database, nullptr);
+  store.StoreFingerprint(backend.GetSongByUrl(songs[0].url()),
+                         Chromaprinter::EncodeFingerprint(a));
+  store.StoreFingerprint(backend.GetSongByUrl(songs[1].url()),
+                         Chromaprinter::EncodeFingerprint(b));
+  store.StoreFingerprint(backend.GetSongByUrl(songs[2].url()),
+                         Chromaprinter::EncodeFingerprint(c));
+  ASSERT_EQ(3, store.FingerprintedSongs().count());
+
+  store.FindDuplicates();
+
+  QSqlDatabase db(database.Connect());
+  QSqlQuery q(db);
+  ASSERT_TRUE(q.exec("SELECT s.title FROM audio_duplicates AS d"
+                     " INNER JOIN songs AS s ON s.ROWID = d.song_id"
+                     " ORDER BY s.title"));
+  QStringList titles;
+  while (q.next()) {
+    titles << q.value(0).toString();
+  }
+  EXPECT_EQ(QStringList() << "a"
+                          << "b",
+            titles);
+}
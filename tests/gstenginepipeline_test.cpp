@@ -0,0 +1,175 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <gst/gst.h>
+
+#include <QEventLoop>
+#include <QList>
+#include <QThread>
+#include <QTimer>
+#include <QUrl>
+#include <memory>
+
+#include "core/taskmanager.h"
+#include "engines/gstengine.h"
+#include "engines/gstenginepipeline.h"
+#include "test_utils.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+class TestGstEnginePipeline : public GstEnginePipeline {
+ public:
+  explicit TestGstEnginePipeline(GstEngine* engine)
+      : GstEnginePipeline(engine) {}
+
+  // Counts the elements anywhere in the pipeline that have the flag.
+  int CountElements(GstElementFlags flag) {
+    int count = 0;
+    GstIterator* it = gst_bin_iterate_recurse(GST_BIN(pipeline_));
+    GValue item = G_VALUE_INIT;
+    while (gst_iterator_next(it, &item) == GST_ITERATOR_OK) {
+      GstElement* element = GST_ELEMENT(g_value_get_object(&item));
+      if (GST_OBJECT_FLAG_IS_SET(element, flag)) ++count;
+      g_value_reset(&item);
+    }
+    g_value_unset(&item);
+    gst_iterator_free(it);
+    return count;
+  }
+
+  // Waits for the pipeline to get to a state, and returns whether it did.
+  bool WaitForState(GstState state) {
+    SetState(state);
+    for (int i = 0; i < 200 && this->state() != state; ++i) {
+      QThread::msleep(50);
+    }
+    return this->state() == state;
+  }
+};
+
+class GstEnginePipelineTest : public ::testing::Test {
+ protected:
+  static void SetUpTestCase() {
+    sTaskManager = new TaskManager;
+    sGstEngine = new GstEngine(sTaskManager);
+    ASSERT_TRUE(sGstEngine->Init());
+    sGstEngine->EnsureInitialised();
+  }
+
+  static void TearDownTestCase() {
+    delete sGstEngine;
+    sGstEngine = nullptr;
+    delete sTaskManager;
+    sTaskManager = nullptr;
+  }
+
+  void SetUp() override {
+    pipeline_.reset(new TestGstEnginePipeline(sGstEngine));
+    pipeline_->set_output_device("fakesink", QVariant());
+  }
+
+  void TearDown() override { pipeline_.reset(); }
+
+  // Plays until the pipeline says a track has ended, and returns whether it
+  // said there was another one, or an empty list if it didn't end.
+  QList<bool> PlayUntilTrackEnded() {
+    QList<bool> ended;
+    QEventLoop loop;
+    QObject::connect(pipeline_.get(), &GstEnginePipeline::EndOfStreamReached,
+                     &loop,
+                     [&](int, bool has_next_track) {
+                       ended << has_next_track;
+                       loop.quit();
+                     },
+                     Qt::QueuedConnection);
+    QTimer::singleShot(10000, &loop, SLOT(quit()));
+
+    pipeline_->SetState(GST_STATE_PLAYING);
+    loop.exec(QEventLoop::ExcludeUserInputEvents);
+    return ended;
+  }
+
+  static TaskManager* sTaskManager;
+  static GstEngine* sGstEngine;
+
+  std::unique_ptr<TestGstEnginePipeline> pipeline_;
+};
+
+TaskManager* GstEnginePipelineTest::sTaskManager = nullptr;
+GstEngine* GstEnginePipelineTest::sGstEngine = nullptr;
+
+TEST_F(GstEnginePipelineTest, GaplessTrackEnded) {
+  TemporaryResource first(":/testdata/beep.wav");
+  TemporaryResource second(":/testdata/beep.wav");
+  const QUrl first_url = QUrl::fromLocalFile(first.fileName());
+  const QUrl second_url = QUrl::fromLocalFile(second.fileName());
+
+  ASSERT_TRUE(pipeline_->InitFromReq(MediaPlaybackRequest(first_url), 0));
+  pipeline_->SetNextReq(MediaPlaybackRequest(second_url), 0, 0);
+
+  // The second track starts in the same pipeline, and the end of the first is
+  // signalled when it's heard rather than by the end of the stream.
+  QList<bool> ended = PlayUntilTrackEnded();
+  ASSERT_EQ(1, ended.count());
+  EXPECT_TRUE(ended[0]);
+  EXPECT_EQ(second_url, pipeline_->url());
+}
+
+TEST_F(GstEnginePipelineTest, PrerollOnlyDecodes) {
+  TemporaryResource first(":/testdata/beep.wav");
+  TemporaryResource second(":/testdata/beep.wav");
+  TemporaryResource third(":/testdata/beep.wav");
+  const QUrl second_url = QUrl::fromLocalFile(second.fileName());
+  const QUrl third_url = QUrl::fromLocalFile(third.fileName());
+
+  ASSERT_TRUE(pipeline_->InitFromReq(
+      MediaPlaybackRequest(QUrl::fromLocalFile(first.fileName())), 0));
+  ASSERT_TRUE(pipeline_->WaitForState(GST_STATE_PAUSED));
+
+  // Only the audio sink and the analyzer's sink.
+  const int sinks = pipeline_->CountElements(GST_ELEMENT_FLAG_SINK);
+  EXPECT_EQ(2, sinks);
+
+  pipeline_->Preroll(QList<MediaPlaybackRequest>()
+                     << MediaPlaybackRequest(second_url)
+                     << MediaPlaybackRequest(third_url));
+  EXPECT_TRUE(pipeline_->is_prerolled(second_url));
+  EXPECT_TRUE(pipeline_->is_prerolled(third_url));
+  EXPECT_EQ(sinks, pipeline_->CountElements(GST_ELEMENT_FLAG_SINK));
+
+  // Switching to one of them plays it through the same sink.
+  ASSERT_TRUE(pipeline_->SwitchTo(MediaPlaybackRequest(second_url), 0));
+  EXPECT_FALSE(pipeline_->is_prerolled(second_url));
+  EXPECT_TRUE(pipeline_->is_prerolled(third_url));
+  EXPECT_EQ(second_url, pipeline_->url());
+
+  QList<bool> ended = PlayUntilTrackEnded();
+  ASSERT_EQ(1, ended.count());
+  EXPECT_FALSE(ended[0]);
+  EXPECT_EQ(sinks, pipeline_->CountElements(GST_ELEMENT_FLAG_SINK));
+  // The switch forgot the first track's length, and the second's was found
+  // when it started.
+  EXPECT_GT(pipeline_->length(), 0);
+
+  // Tracks that aren't wanted any more are dropped.
+  pipeline_->Preroll(QList<MediaPlaybackRequest>());
+  EXPECT_FALSE(pipeline_->is_prerolled(third_url));
+}
+
+}  // namespace
@@ -0,0 +1,142 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gst/app/gstappsink.h>
+#include <gst/gst.h>
+
+#include <cmath>
+
+#include "core/timeconstants.h"
+#include "engines/gstfader.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+// The amplitude of the square wave going into the fader.
+const float kAmplitude = 0.5;
+
+class GstFaderTest : public ::testing::Test {
+ protected:
+  static void SetUpTestCase() { gst_init(nullptr, nullptr); }
+
+  void SetUp() {
+    pipeline_ = gst_parse_launch(
+        "audiotestsrc wave=square volume=0.5 samplesperbuffer=441 ! "
+        "audio/x-raw,format=F32LE,rate=44100,channels=1 ! "
+        "volume name=fader ! appsink name=sink sync=false max-buffers=4",
+        nullptr);
+    ASSERT_TRUE(pipeline_);
+    volume_ = gst_bin_get_by_name(GST_BIN(pipeline_), "fader");
+    sink_ = gst_bin_get_by_name(GST_BIN(pipeline_), "sink");
+    fader_ = new GstFader(volume_);
+  }
+
+  void TearDown() {
+    gst_element_set_state(pipeline_, GST_STATE_NULL);
+    delete fader_;
+    gst_object_unref(volume_);
+    gst_object_unref(sink_);
+    gst_object_unref(pipeline_);
+  }
+
+  void Play() {
+    gst_element_set_state(pipeline_, GST_STATE_PLAYING);
+    gst_element_get_state(pipeline_, nullptr, nullptr, 10 * GST_SECOND);
+  }
+
+  void Seek(qint64 nanosec) {
+    gst_element_seek_simple(
+        pipeline_, GST_FORMAT_TIME,
+        GstSeekFlags(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE), nanosec);
+    gst_element_get_state(pipeline_, nullptr, nullptr, 10 * GST_SECOND);
+  }
+
+  // Pulls buffers until one starts between from and to, and returns the
+  // loudest sample in it, or -1 if there wasn't one.
+  float PeakBetween(qint64 from, qint64 to) {
+    for (int i = 0; i < 1000; ++i) {
+      GstSample* sample =
+          gst_app_sink_try_pull_sample(GST_APP_SINK(sink_), 10 * GST_SECOND);
+      if (!sample) return -1;
+
+      GstBuffer* buffer = gst_sample_get_buffer(sample);
+      const qint64 timestamp = GST_BUFFER_TIMESTAMP(buffer);
+      float peak = -1;
+      if (timestamp >= from && timestamp < to) {
+        GstMapInfo map;
+        if (gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+          const float* data = reinterpret_cast<const float*>(map.data);
+          peak = 0;
+          for (gsize j = 0; j < map.size / sizeof(float); ++j) {
+            peak = qMax(peak, std::fabs(data[j]));
+          }
+          gst_buffer_unmap(buffer, &map);
+        }
+      }
+      gst_sample_unref(sample);
+
+      if (peak >= 0) return peak;
+    }
+    return -1;
+  }
+
+  GstElement* pipeline_;
+  GstElement* volume_;
+  GstElement* sink_;
+  GstFader* fader_;
+};
+
+TEST_F(GstFaderTest, FadeIn) {
+  fader_->Start(kNsecPerSec, QTimeLine::Forward, QTimeLine::LinearCurve,
+                false);
+  Play();
+
+  EXPECT_NEAR(0.0, PeakBetween(0, 20 * kNsecPerMsec), 0.02);
+  EXPECT_NEAR(kAmplitude / 2, PeakBetween(490 * kNsecPerMsec, kNsecPerSec),
+              0.02);
+  EXPECT_NEAR(kAmplitude, PeakBetween(1500 * kNsecPerMsec, 2 * kNsecPerSec),
+              0.001);
+}
+
+TEST_F(GstFaderTest, FinishedFadeInStaysAfterSeekingBack) {
+  fader_->Start(kNsecPerSec, QTimeLine::Forward, QTimeLine::LinearCurve,
+                false);
+  Play();
+  ASSERT_LT(0, PeakBetween(1500 * kNsecPerMsec, 2 * kNsecPerSec));
+
+  // Going back to the start of the fade, like the next track in a gapless
+  // transition does, mustn't play it again.
+  Seek(0);
+  EXPECT_NEAR(kAmplitude, PeakBetween(0, 20 * kNsecPerMsec), 0.001);
+
+  Seek(250 * kNsecPerMsec);
+  EXPECT_NEAR(kAmplitude,
+              PeakBetween(250 * kNsecPerMsec, 500 * kNsecPerMsec), 0.001);
+}
+
+TEST_F(GstFaderTest, FinishedFadeOutStaysAfterSeekingBack) {
+  fader_->Start(kNsecPerSec, QTimeLine::Backward, QTimeLine::LinearCurve,
+                false);
+  Play();
+  ASSERT_NEAR(0.0, PeakBetween(1500 * kNsecPerMsec, 2 * kNsecPerSec), 0.001);
+
+  Seek(250 * kNsecPerMsec);
+  EXPECT_NEAR(0.0, PeakBetween(250 * kNsecPerMsec, 500 * kNsecPerMsec),
+              0.001);
+}
+
+}  // namespace
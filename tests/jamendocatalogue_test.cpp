@@ -0,0 +1,174 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QMap>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QStringList>
+#include <memory>
+
+#include "core/database.h"
+#include "core/song.h"
+#include "internet/jamendo/jamendocatalogue.h"
+#include "internet/jamendo/jamendoservice.h"
+#include "test_utils.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+class JamendoCatalogueTest : public ::testing::Test {
+ protected:
+  void SetUp() { database_.reset(new MemoryDatabase(nullptr)); }
+
+  Song MakeSong(const QString& title) {
+    Song ret;
+    ret.Init(title, "artist", "album", 123);
+    ret.set_url(QUrl("http://example.com/" + title + ".mp3"));
+    return ret;
+  }
+
+  void Apply(const QMap<int, QString>& titles) {
+    SongList songs;
+    for (const QString& title : titles) songs << MakeSong(title);
+
+    JamendoCatalogue catalogue(database_.get());
+    catalogue.Begin();
+    catalogue.Stage(songs, titles.keys());
+    catalogue.Apply();
+  }
+
+  // Returns the title of each song by its track ID.
+  QMap<int, QString> Titles() {
+    QSqlDatabase db(database_->Connect());
+    QSqlQuery q(db);
+    q.exec(QString("SELECT t.%1, s.title FROM %2 AS s"
+                   " JOIN %3 AS t ON t.songs_row_id = s.ROWID")
+               .arg(JamendoService::kTrackIdsColumn,
+                    JamendoService::kSongsTable,
+                    JamendoService::kTrackIdsTable));
+    QMap<int, QString> ret;
+    while (q.next()) ret[q.value(0).toInt()] = q.value(1).toString();
+    return ret;
+  }
+
+  QStringList Match(const QString& query) {
+    QSqlDatabase db(database_->Connect());
+    QSqlQuery q(db);
+    q.prepare(QString("SELECT s.title FROM %1 AS s"
+                      " WHERE s.ROWID IN (SELECT ROWID FROM %2"
+                      "  WHERE %2 MATCH :query)"
+                      " ORDER BY s.title")
+                  .arg(JamendoService::kSongsTable, JamendoService::kFtsTable));
+    q.bindValue(":query", query);
+    q.exec();
+    QStringList ret;
+    while (q.next()) ret << q.value(0).toString();
+    return ret;
+  }
+
+  qint64 RowId(int track_id) {
+    QSqlDatabase db(database_->Connect());
+    QSqlQuery q(db);
+    q.prepare(QString("SELECT songs_row_id FROM %1 WHERE %2 = :track_id")
+                  .arg(JamendoService::kTrackIdsTable,
+                       JamendoService::kTrackIdsColumn));
+    q.bindValue(":track_id", track_id);
+    q.exec();
+    return q.next() ? q.value(0).toLongLong() : -1;
+  }
+
+  // The FTS5 index of an external content table is only right if rows were
+  // deleted from it while the songs table still had their old values.
+  bool FtsIntegrityCheck() {
+    QSqlDatabase db(database_->Connect());
+    QSqlQuery q(db);
+    return q.exec(QString("INSERT INTO %1 (songs_fts, rank)"
+                          " VALUES ('integrity-check', 1)")
+                      .arg(JamendoService::kFtsTable));
+  }
+
+  std::unique_ptr<Database> database_;
+};
+
+TEST_F(JamendoCatalogueTest, AddsSongs) {
+  QMap<int, QString> titles;
+  titles[1] = "one";
+  titles[2] = "two";
+  titles[3] = "three";
+  Apply(titles);
+
+  EXPECT_EQ(titles, Titles());
+  EXPECT_EQ(QStringList() << "two", Match("two"));
+  EXPECT_TRUE(FtsIntegrityCheck());
+}
+
+TEST_F(JamendoCatalogueTest, AppliesDifferences) {
+  QMap<int, QString> titles;
+  titles[1] = "one";
+  titles[2] = "two";
+  titles[3] = "three";
+  Apply(titles);
+
+  const qint64 two_row_id = RowId(2);
+  const qint64 three_row_id = RowId(3);
+  const qint64 last_row_id = qMax(RowId(1), qMax(two_row_id, three_row_id));
+
+  titles.remove(1);
+  titles[2] = "deux";
+  titles[4] = "four";
+  Apply(titles);
+
+  EXPECT_EQ(titles, Titles());
+
+  // Changed and unchanged songs keep their rows, and new ones go after the
+  // last row there was before.
+  EXPECT_EQ(two_row_id, RowId(2));
+  EXPECT_EQ(three_row_id, RowId(3));
+  EXPECT_GT(RowId(4), last_row_id);
+
+  EXPECT_TRUE(Match("one").isEmpty());
+  EXPECT_TRUE(Match("two").isEmpty());
+  EXPECT_EQ(QStringList() << "deux", Match("deux"));
+  EXPECT_EQ(QStringList() << "three", Match("three"));
+  EXPECT_EQ(QStringList() << "four", Match("four"));
+  EXPECT_EQ(QStringList() << "deux"
+                          << "four"
+                          << "three",
+            Match("artist"));
+  EXPECT_TRUE(FtsIntegrityCheck());
+}
+
+TEST_F(JamendoCatalogueTest, CancelKeepsSongs) {
+  QMap<int, QString> titles;
+  titles[1] = "one";
+  Apply(titles);
+
+  JamendoCatalogue catalogue(database_.get());
+  catalogue.Begin();
+  catalogue.Stage(SongList() << MakeSong("two"), QList<int>() << 2);
+  catalogue.Cancel();
+
+  // Nothing that was staged is left over for the next update.
+  titles[3] = "three";
+  Apply(titles);
+
+  EXPECT_EQ(titles, Titles());
+  EXPECT_TRUE(Match("two").isEmpty());
+  EXPECT_TRUE(FtsIntegrityCheck());
+}
+
+}  // namespace
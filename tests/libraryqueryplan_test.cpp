@@ -0,0 +1,213 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QList>
+#include <QRegExp>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QStringList>
+#include <QVariant>
+#include <memory>
+
+#include "core/database.h"
+#include "core/song.h"
+#include "library/library.h"
+#include "library/libraryitem.h"
+#include "library/librarymodel.h"
+#include "library/libraryquery.h"
+#include "test_utils.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+const QList<LibraryModel::GroupBy> kGroupBys = {
+    LibraryModel::GroupBy_Artist,       LibraryModel::GroupBy_Album,
+    LibraryModel::GroupBy_YearAlbum,    LibraryModel::GroupBy_Year,
+    LibraryModel::GroupBy_Composer,     LibraryModel::GroupBy_Genre,
+    LibraryModel::GroupBy_AlbumArtist,  LibraryModel::GroupBy_FileType,
+    LibraryModel::GroupBy_Performer,    LibraryModel::GroupBy_Grouping,
+    LibraryModel::GroupBy_Bitrate,      LibraryModel::GroupBy_Disc,
+    LibraryModel::GroupBy_OriginalYearAlbum,
+    LibraryModel::GroupBy_OriginalYear,
+};
+
+bool IsArtistGroupBy(LibraryModel::GroupBy group_by) {
+  return group_by == LibraryModel::GroupBy_Artist ||
+         group_by == LibraryModel::GroupBy_AlbumArtist;
+}
+
+class LibraryQueryPlanTest : public ::testing::Test {
+ protected:
+  void SetUp() { database_.reset(new MemoryDatabase(nullptr)); }
+
+  // Every way of grouping the library with three different levels.
+  static QList<LibraryModel::Grouping> Groupings() {
+    QList<LibraryModel::Grouping> ret;
+    for (LibraryModel::GroupBy first : kGroupBys) {
+      for (LibraryModel::GroupBy second : kGroupBys) {
+        if (second == first) continue;
+        for (LibraryModel::GroupBy third : kGroupBys) {
+          if (third == first || third == second) continue;
+          ret << LibraryModel::Grouping(first, second, third);
+        }
+      }
+    }
+    return ret;
+  }
+
+  // Adds a node under parent like the ones LibraryModel makes for a song.  If
+  // various_artists is set and the node is an artist, it's made the parent's
+  // Various artists node instead.
+  static LibraryItem* AddContainer(const LibraryModel::Grouping& grouping,
+                                   LibraryItem* parent, int level,
+                                   bool various_artists) {
+    Song song;
+    song.Init("title", "artist", "album", 123);
+    song.set_year(2000);
+
+    LibraryItem* ret = new LibraryItem(LibraryItem::Type_Container, parent);
+    ret->container_level = level;
+    ret->key = "key";
+    ret->metadata = song;
+    if (various_artists && IsArtistGroupBy(grouping[level])) {
+      parent->compilation_artist_node_ = ret;
+    }
+    return ret;
+  }
+
+  // Returns the queries LibraryModel makes to fill in the whole tree for a
+  // grouping, from the top level down to the songs.
+  static QList<LibraryQuery> Queries(const LibraryModel::Grouping& grouping,
+                                     const QueryOptions& options,
+                                     bool various_artists) {
+    LibraryItem root(LibraryItem::Type_Root);
+    LibraryItem* parent = &root;
+
+    QList<LibraryQuery> ret;
+    for (int level = 0; level <= 3; ++level) {
+      LibraryQuery q(options);
+      LibraryQuery va_query(options);
+      const LibraryModel::GroupBy child_type =
+          LibraryModel::BuildQuery(grouping, parent, &q, &va_query);
+      ret << q;
+      if (IsArtistGroupBy(child_type)) ret << va_query;
+
+      if (level < 3) {
+        parent = AddContainer(grouping, parent, level, various_artists);
+      }
+    }
+    return ret;
+  }
+
+  // Runs the query and returns the details of its query plan.
+  QStringList Plan(LibraryQuery* query) {
+    QSqlDatabase db(database_->Connect());
+    const QSqlQuery& result =
+        query->Exec(db, Library::kSongsTable, Library::kFtsTable);
+    const QString sql = result.lastQuery();
+    EXPECT_FALSE(result.lastError().isValid()) << sql.toStdString();
+
+    QSqlQuery q(db);
+    q.prepare("EXPLAIN QUERY PLAN " + sql);
+    for (int i = 0; i < sql.count('?'); ++i) q.addBindValue(0);
+    EXPECT_TRUE(q.exec()) << sql.toStdString();
+
+    QStringList ret;
+    while (q.next()) ret << q.value(q.record().count() - 1).toString();
+    return ret;
+  }
+
+  // Returns the lines of the query plan that read the whole songs table.
+  static QStringList TableScans(const QStringList& plan) {
+    QStringList ret;
+    for (const QString& detail : plan) {
+      if (detail.contains(QRegExp("^SCAN (TABLE )?songs\\b")) &&
+          !detail.contains("INDEX")) {
+        ret << detail;
+      }
+    }
+    return ret;
+  }
+
+  // Returns the lines of the query plan that go through every available song,
+  // either with a table scan or with one of the indexes that start with the
+  // unavailable column.
+  static QStringList AvailableSongScans(const QStringList& plan) {
+    QStringList ret = TableScans(plan);
+    for (const QString& detail : plan) {
+      if (detail.contains(QRegExp("^SEARCH (TABLE )?songs\\b")) &&
+          detail.endsWith("(unavailable=?)")) {
+        ret << detail;
+      }
+    }
+    return ret;
+  }
+
+  std::unique_ptr<Database> database_;
+};
+
+TEST_F(LibraryQueryPlanTest, TopLevelUsesCoveringIndex) {
+  for (LibraryModel::GroupBy group_by : kGroupBys) {
+    LibraryItem root(LibraryItem::Type_Root);
+    LibraryQuery q;
+    LibraryQuery va_query;
+    LibraryModel::BuildQuery(LibraryModel::Grouping(group_by), &root, &q,
+                             &va_query);
+
+    QStringList plan = Plan(&q);
+    ASSERT_FALSE(plan.isEmpty());
+    EXPECT_TRUE(plan[0].contains("COVERING INDEX")) << group_by;
+
+    if (IsArtistGroupBy(group_by)) {
+      plan = Plan(&va_query);
+      ASSERT_FALSE(plan.isEmpty());
+      EXPECT_TRUE(plan[0].contains("COVERING INDEX"))
+          << group_by << " (Various artists)";
+    }
+  }
+}
+
+TEST_F(LibraryQueryPlanTest, NoTableScans) {
+  for (const LibraryModel::Grouping& grouping : Groupings()) {
+    for (bool various_artists : {false, true}) {
+      for (LibraryQuery q : Queries(grouping, QueryOptions(),
+                                    various_artists)) {
+        EXPECT_EQ(QStringList(), TableScans(Plan(&q)))
+            << grouping.first << " > " << grouping.second << " > "
+            << grouping.third << (various_artists ? " (Various artists)" : "");
+      }
+    }
+  }
+}
+
+TEST_F(LibraryQueryPlanTest, FilteredQueriesStartFromMatches) {
+  QueryOptions options;
+  options.set_filter("foo");
+
+  for (const LibraryModel::Grouping& grouping : Groupings()) {
+    for (bool various_artists : {false, true}) {
+      for (LibraryQuery q : Queries(grouping, options, various_artists)) {
+        EXPECT_EQ(QStringList(), AvailableSongScans(Plan(&q)))
+            << grouping.first << " > " << grouping.second << " > "
+            << grouping.third << (various_artists ? " (Various artists)" : "");
+      }
+    }
+  }
+}
+
+}  // namespace
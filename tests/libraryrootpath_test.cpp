@@ -0,0 +1,111 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <memory>
+
+#include "core/database.h"
+#include "core/song.h"
+#include "library/library.h"
+#include "library/librarybackend.h"
+#include "test_utils.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+// Device libraries store their paths relative to wherever the device is
+// mounted.
+class LibraryRootPathTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    ASSERT_TRUE(mount_point_.isValid());
+    root_ = QFileInfo(mount_point_.path()).canonicalFilePath();
+
+    database_.reset(new MemoryDatabase(nullptr));
+    backend_ = MakeBackend(root_);
+    backend_->AddDirectory(root_);
+  }
+
+  std::unique_ptr<LibraryBackend> MakeBackend(const QString& root) {
+    std::unique_ptr<LibraryBackend> ret(new LibraryBackend);
+    ret->Init(database_.get(), Library::kSongsTable, Library::kDirsTable,
+              Library::kSubdirsTable, Library::kFtsTable);
+    ret->SetRootPath(root);
+    return ret;
+  }
+
+  Song MakeSong(const QString& path) {
+    Song ret;
+    ret.Init("Title", "Artist", "Album", 123);
+    ret.set_directory_id(1);
+    ret.set_url(QUrl::fromLocalFile(root_ + "/" + path));
+    ret.set_mtime(1);
+    ret.set_ctime(1);
+    ret.set_filesize(1);
+    return ret;
+  }
+
+  QTemporaryDir mount_point_;
+  QString root_;
+  std::unique_ptr<Database> database_;
+  std::unique_ptr<LibraryBackend> backend_;
+};
+
+TEST_F(LibraryRootPathTest, PathWithColon) {
+  // The first part of the path looks like a URL scheme.
+  Song song = MakeSong("a:b/c.mp3");
+  backend_->AddOrUpdateSongs(SongList() << song);
+
+  EXPECT_EQ(song.url(), backend_->GetSongById(1).url());
+  EXPECT_TRUE(backend_->GetSongByUrl(song.url()).is_valid());
+}
+
+TEST_F(LibraryRootPathTest, Remounted) {
+  backend_->AddOrUpdateSongs(SongList() << MakeSong("artist/song.mp3"));
+
+  Subdirectory subdir;
+  subdir.directory_id = 1;
+  subdir.path = root_ + "/artist";
+  subdir.mtime = 1;
+  backend_->AddOrUpdateSubdirs(SubdirectoryList() << subdir);
+
+  // The device comes back somewhere else.
+  QTemporaryDir new_mount_point;
+  ASSERT_TRUE(new_mount_point.isValid());
+  const QString new_root =
+      QFileInfo(new_mount_point.path()).canonicalFilePath();
+  backend_ = MakeBackend(new_root);
+
+  const QUrl url = QUrl::fromLocalFile(new_root + "/artist/song.mp3");
+  EXPECT_EQ(url, backend_->GetSongById(1).url());
+  EXPECT_TRUE(backend_->GetSongByUrl(url).is_valid());
+  EXPECT_FALSE(
+      backend_->GetSongByUrl(QUrl::fromLocalFile(root_ + "/artist/song.mp3"))
+          .is_valid());
+
+  const DirectoryList dirs = backend_->GetAllDirectories();
+  ASSERT_EQ(1, dirs.count());
+  EXPECT_EQ(new_root, dirs[0].path);
+
+  const SubdirectoryList subdirs = backend_->SubdirsInDirectory(1);
+  ASSERT_EQ(1, subdirs.count());
+  EXPECT_EQ(new_root + "/artist", subdirs[0].path);
+}
+
+}  // namespace
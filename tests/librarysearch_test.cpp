@@ -0,0 +1,172 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QSqlQuery>
+#include <QStringList>
+#include <memory>
+
+#include "core/database.h"
+#include "core/song.h"
+#include "library/library.h"
+#include "library/librarybackend.h"
+#include "library/libraryquery.h"
+#include "test_utils.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+class LibrarySearchTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    database_.reset(new MemoryDatabase(nullptr));
+    backend_.reset(new LibraryBackend);
+    backend_->Init(database_.get(), Library::kSongsTable, Library::kDirsTable,
+                   Library::kSubdirsTable, Library::kFtsTable);
+    backend_->AddDirectory("/tmp");
+  }
+
+  Song MakeSong(const QString& title, const QString& artist,
+                const QString& album) {
+    Song ret;
+    ret.Init(title, artist, album, 123);
+    ret.set_directory_id(1);
+    ret.set_url(QUrl::fromLocalFile("/tmp/" + title + ".mp3"));
+    ret.set_mtime(1);
+    ret.set_ctime(1);
+    ret.set_filesize(1);
+    return ret;
+  }
+
+  // Returns the titles of the songs matching the filter, in the order global
+  // search would get them.
+  QStringList Search(const QString& filter) {
+    QueryOptions options;
+    options.set_filter(filter);
+
+    LibraryQuery query(options);
+    query.SetColumnSpec("title");
+    query.SetOrderByRank(true);
+
+    QStringList ret;
+    if (!backend_->ExecQuery(&query)) return ret;
+    while (query.Next()) {
+      ret << query.Value(0).toString();
+    }
+    return ret;
+  }
+
+  // The FTS5 index of an external content table is only right if rows were
+  // deleted from it while the songs table still had the values it indexed.
+  bool FtsIntegrityCheck() {
+    QSqlDatabase db(database_->Connect());
+    QSqlQuery q(db);
+    return q.exec(QString("INSERT INTO %1 (%1, rank)"
+                          " VALUES ('integrity-check', 1)")
+                      .arg(Library::kFtsTable));
+  }
+
+  std::unique_ptr<Database> database_;
+  std::unique_ptr<LibraryBackend> backend_;
+};
+
+TEST_F(LibrarySearchTest, Prefixes) {
+  backend_->AddOrUpdateSongs(SongList()
+                             << MakeSong("Yesterday", "The Beatles", "Help!")
+                             << MakeSong("Heroes", "David Bowie", "Heroes"));
+
+  EXPECT_EQ(QStringList() << "Yesterday", Search("y"));
+  EXPECT_EQ(QStringList() << "Yesterday", Search("bea"));
+  EXPECT_EQ(QStringList() << "Yesterday", Search("beatles"));
+  EXPECT_EQ(QStringList() << "Heroes", Search("artist:bow"));
+  EXPECT_EQ(QStringList(), Search("album:bow"));
+}
+
+TEST_F(LibrarySearchTest, IgnoresCaseAndDiacritics) {
+  backend_->AddOrUpdateSongs(SongList()
+                             << MakeSong("Hyperballad", "Björk", "Post"));
+
+  EXPECT_EQ(QStringList() << "Hyperballad", Search("bjork"));
+  EXPECT_EQ(QStringList() << "Hyperballad", Search("BJÖRK"));
+}
+
+TEST_F(LibrarySearchTest, Punctuation) {
+  backend_->AddOrUpdateSongs(SongList()
+                             << MakeSong("Help!", "The Beatles", "Help!"));
+
+  EXPECT_EQ(QStringList() << "Help!", Search("help!"));
+  EXPECT_EQ(QStringList() << "Help!", Search("\"help"));
+  EXPECT_EQ(QStringList() << "Help!", Search("(the) -beatles"));
+  EXPECT_EQ(QStringList(), Search("rolling OR beatles"));
+  EXPECT_EQ(QStringList(), Search("!?"));
+  EXPECT_EQ(QStringList(), Search("artist:!?"));
+}
+
+TEST_F(LibrarySearchTest, RanksTitlesFirst) {
+  backend_->AddOrUpdateSongs(SongList()
+                             << MakeSong("Other", "Someone", "Heroes")
+                             << MakeSong("Heroes", "David Bowie", "Other"));
+
+  EXPECT_EQ(QStringList() << "Heroes"
+                          << "Other",
+            Search("heroes"));
+}
+
+TEST_F(LibrarySearchTest, UpdatedSongs) {
+  backend_->AddOrUpdateSongs(SongList()
+                             << MakeSong("Yesterday", "The Beatles", "Help!"));
+
+  Song song = MakeSong("Yesterday", "Bowie", "Help!");
+  song.set_id(1);
+  backend_->AddOrUpdateSongs(SongList() << song);
+
+  EXPECT_EQ(QStringList(), Search("beatles"));
+  EXPECT_EQ(QStringList() << "Yesterday", Search("bowie"));
+
+  backend_->DeleteSongs(SongList() << song);
+  EXPECT_EQ(QStringList(), Search("bowie"));
+}
+
+TEST_F(LibrarySearchTest, UnknownYear) {
+  // The songs table stores a year of 0 as -1.
+  Song song = MakeSong("Yesterday", "The Beatles", "Help!");
+  song.set_year(0);
+  backend_->AddOrUpdateSongs(SongList() << song);
+  EXPECT_TRUE(FtsIntegrityCheck());
+
+  song.set_id(1);
+  song.set_artist("Bowie");
+  backend_->AddOrUpdateSongs(SongList() << song);
+  EXPECT_TRUE(FtsIntegrityCheck());
+  EXPECT_EQ(QStringList() << "Yesterday", Search("bowie"));
+
+  backend_->DeleteSongs(SongList() << song);
+  EXPECT_TRUE(FtsIntegrityCheck());
+  EXPECT_EQ(QStringList(), Search("yesterday"));
+}
+
+TEST_F(LibrarySearchTest, DeleteAll) {
+  backend_->AddOrUpdateSongs(SongList()
+                             << MakeSong("Yesterday", "The Beatles", "Help!")
+                             << MakeSong("Heroes", "David Bowie", "Heroes"));
+
+  backend_->DeleteAll();
+  EXPECT_TRUE(FtsIntegrityCheck());
+  EXPECT_EQ(QStringList(), Search("heroes"));
+}
+
+}  // namespace
@@ -0,0 +1,106 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cmath>
+
+#include "library/loudnessmeter.h"
+#include "test_utils.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+// Adds a sine wave at the same level on every channel.
+void AddSine(LoudnessMeter* meter, int sample_rate, int channels,
+             double level_db, double seconds) {
+  const double amplitude = std::pow(10.0, level_db / 20.0);
+  const int frames = sample_rate * seconds;
+
+  QVector<float> samples(frames * channels);
+  for (int i = 0; i < frames; ++i) {
+    const float value = amplitude * std::sin(2 * M_PI * 1000 * i / sample_rate);
+    for (int c = 0; c < channels; ++c) {
+      samples[i * channels + c] = value;
+    }
+  }
+  meter->Process(samples.constData(), frames);
+}
+
+// The test signals from EBU Tech 3341.
+TEST(LoudnessMeterTest, Sine) {
+  for (int sample_rate : {44100, 48000}) {
+    LoudnessMeter meter(sample_rate, 2);
+    AddSine(&meter, sample_rate, 2, -23.0, 20);
+
+    double lufs = 0;
+    ASSERT_TRUE(meter.IntegratedLoudness(&lufs));
+    EXPECT_NEAR(-23.0, lufs, 0.1);
+    EXPECT_NEAR(std::pow(10.0, -23.0 / 20.0), meter.sample_peak(), 0.001);
+  }
+}
+
+TEST(LoudnessMeterTest, QuietPartsAreGated) {
+  LoudnessMeter meter(48000, 2);
+  AddSine(&meter, 48000, 2, -36.0, 10);
+  AddSine(&meter, 48000, 2, -23.0, 60);
+  AddSine(&meter, 48000, 2, -36.0, 10);
+
+  double lufs = 0;
+  ASSERT_TRUE(meter.IntegratedLoudness(&lufs));
+  EXPECT_NEAR(-23.0, lufs, 0.1);
+}
+
+TEST(LoudnessMeterTest, MonoIsPlayedOnBothChannels) {
+  LoudnessMeter meter(48000, 1);
+  AddSine(&meter, 48000, 1, -23.0, 20);
+
+  double lufs = 0;
+  ASSERT_TRUE(meter.IntegratedLoudness(&lufs));
+  EXPECT_NEAR(-23.0, lufs, 0.1);
+}
+
+TEST(LoudnessMeterTest, Silence) {
+  LoudnessMeter meter(48000, 2);
+  AddSine(&meter, 48000, 2, -100.0, 5);
+
+  double lufs = 0;
+  EXPECT_FALSE(meter.IntegratedLoudness(&lufs));
+}
+
+TEST(LoudnessMeterTest, AlbumGatesBlocksTogether) {
+  LoudnessMeter quiet(48000, 2);
+  AddSine(&quiet, 48000, 2, -36.0, 10);
+  LoudnessMeter loud(48000, 2);
+  AddSine(&loud, 48000, 2, -23.0, 60);
+
+  // On its own the quiet track is loud enough to count, but next to the
+  // loud one it's gated out.
+  double lufs = 0;
+  ASSERT_TRUE(quiet.IntegratedLoudness(&lufs));
+  EXPECT_NEAR(-36.0, lufs, 0.1);
+
+  ASSERT_TRUE(LoudnessMeter::IntegratedLoudness(quiet.blocks() + loud.blocks(),
+                                                &lufs));
+  EXPECT_NEAR(-23.0, lufs, 0.1);
+}
+
+TEST(LoudnessMeterTest, Gain) {
+  EXPECT_DOUBLE_EQ(5.0, LoudnessMeter::Gain(-23.0));
+  EXPECT_DOUBLE_EQ(-4.0, LoudnessMeter::Gain(-14.0));
+}
+
+}  // namespace
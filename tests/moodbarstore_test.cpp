@@ -0,0 +1,139 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QUrl>
+
+#include "moodbar/moodbarstore.h"
+#include "test_utils.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+class MoodbarStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    ASSERT_TRUE(dir_.isValid());
+    filename_ = dir_.path() + "/moodbars";
+  }
+
+  QTemporaryDir dir_;
+  QString filename_;
+};
+
+const QUrl kUrl(QUrl::fromLocalFile("/music/song.mp3"));
+
+TEST_F(MoodbarStoreTest, StoresMoodbars) {
+  {
+    MoodbarStore store(filename_);
+    ASSERT_TRUE(store.is_open());
+    store.Put(1, 100, kUrl, "one");
+    store.Put(2, 200, kUrl, "two");
+
+    QByteArray data;
+    ASSERT_TRUE(store.Get(1, 100, kUrl, &data));
+    EXPECT_EQ(QByteArray("one"), data);
+  }
+
+  MoodbarStore store(filename_);
+  QByteArray data;
+  ASSERT_TRUE(store.Get(2, 200, kUrl, &data));
+  EXPECT_EQ(QByteArray("two"), data);
+  EXPECT_FALSE(store.Contains(3, 200, kUrl));
+}
+
+TEST_F(MoodbarStoreTest, ChecksMtimeAndUrl) {
+  MoodbarStore store(filename_);
+  store.Put(1, 100, kUrl, "one");
+
+  EXPECT_TRUE(store.Contains(1, 100, kUrl));
+  EXPECT_FALSE(store.Contains(1, 101, kUrl));
+  EXPECT_FALSE(
+      store.Contains(1, 100, QUrl::fromLocalFile("/media/ipod/song.mp3")));
+}
+
+TEST_F(MoodbarStoreTest, NewerRecordsReplaceOlderOnes) {
+  {
+    MoodbarStore store(filename_);
+    store.Put(1, 100, kUrl, "old");
+    store.Put(1, 101, kUrl, "new");
+  }
+
+  MoodbarStore store(filename_);
+  QByteArray data;
+  EXPECT_FALSE(store.Contains(1, 100, kUrl));
+  ASSERT_TRUE(store.Get(1, 101, kUrl, &data));
+  EXPECT_EQ(QByteArray("new"), data);
+}
+
+TEST_F(MoodbarStoreTest, DropsIncompleteRecords) {
+  {
+    MoodbarStore store(filename_);
+    store.Put(1, 100, kUrl, "one");
+    store.Put(2, 200, kUrl, "two");
+  }
+
+  QFile file(filename_);
+  const qint64 size = file.size();
+  ASSERT_TRUE(file.resize(size - 1));
+
+  {
+    MoodbarStore store(filename_);
+    EXPECT_TRUE(store.Contains(1, 100, kUrl));
+    EXPECT_FALSE(store.Contains(2, 200, kUrl));
+    store.Put(3, 300, kUrl, "three");
+  }
+
+  MoodbarStore store(filename_);
+  QByteArray data;
+  ASSERT_TRUE(store.Get(3, 300, kUrl, &data));
+  EXPECT_EQ(QByteArray("three"), data);
+}
+
+TEST_F(MoodbarStoreTest, CompactsReplacedRecords) {
+  const QByteArray moodbar(1000, 'x');
+  {
+    MoodbarStore store(filename_);
+    for (uint mtime = 0; mtime < 10; ++mtime) {
+      store.Put(1, mtime, kUrl, moodbar);
+    }
+  }
+  EXPECT_GT(QFile(filename_).size(), 10 * moodbar.size());
+
+  MoodbarStore store(filename_);
+  EXPECT_EQ(MoodbarStore::kHeaderSize + MoodbarStore::kRecordHeaderSize +
+                moodbar.size(),
+            QFile(filename_).size());
+
+  // The compacted store replaced the old one without leaving anything behind.
+  EXPECT_EQ(QStringList() << "moodbars",
+            QDir(dir_.path()).entryList(QDir::Files | QDir::Hidden));
+
+  QByteArray data;
+  ASSERT_TRUE(store.Get(1, 9, kUrl, &data));
+  EXPECT_EQ(moodbar, data);
+
+  store.Put(2, 100, kUrl, "two");
+  ASSERT_TRUE(store.Get(2, 100, kUrl, &data));
+  EXPECT_EQ(QByteArray("two"), data);
+}
+
+}  // namespace
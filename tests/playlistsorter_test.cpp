@@ -0,0 +1,118 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "playlist/playlist.h"
+#include "playlist/playlistsorter.h"
+#include "playlist/songplaylistitem.h"
+#include "test_utils.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+class PlaylistSorterTest : public ::testing::Test {
+ protected:
+  PlaylistItemPtr Item(const QString& title, const QString& artist,
+                       const QString& album = QString(), int disc = -1,
+                       int track = -1) {
+    Song song;
+    song.Init(title, artist, album, 123);
+    song.set_disc(disc);
+    song.set_track(track);
+    return PlaylistItemPtr(new SongPlaylistItem(song));
+  }
+
+  static QStringList Titles(const PlaylistItemList& items) {
+    QStringList ret;
+    for (PlaylistItemPtr item : items) {
+      ret << item->Metadata().title();
+    }
+    return ret;
+  }
+};
+
+TEST_F(PlaylistSorterTest, SortsTextIgnoringCase) {
+  PlaylistItemList items;
+  items << Item("1", "beta") << Item("2", "Gamma") << Item("3", "alpha");
+
+  PlaylistSorter(Playlist::Column_Artist, Qt::AscendingOrder).Sort(&items);
+  EXPECT_EQ(QStringList() << "3" << "1" << "2", Titles(items));
+
+  PlaylistSorter(Playlist::Column_Artist, Qt::DescendingOrder).Sort(&items);
+  EXPECT_EQ(QStringList() << "2" << "1" << "3", Titles(items));
+}
+
+TEST_F(PlaylistSorterTest, Stable) {
+  PlaylistItemList items;
+  items << Item("1", "b") << Item("2", "a") << Item("3", "b") << Item("4", "a");
+
+  PlaylistSorter(Playlist::Column_Artist, Qt::AscendingOrder).Sort(&items);
+  EXPECT_EQ(QStringList() << "2" << "4" << "1" << "3", Titles(items));
+
+  PlaylistSorter(Playlist::Column_Artist, Qt::DescendingOrder).Sort(&items);
+  EXPECT_EQ(QStringList() << "1" << "3" << "2" << "4", Titles(items));
+}
+
+TEST_F(PlaylistSorterTest, AlbumUsesDiscAndTrack) {
+  PlaylistItemList items;
+  items << Item("1", "", "B", 1, 1) << Item("2", "", "A", 2, 1)
+        << Item("3", "", "A", 1, 2) << Item("4", "", "A", 1, 1);
+
+  PlaylistSorter(Playlist::Column_Album, Qt::AscendingOrder).Sort(&items);
+  EXPECT_EQ(QStringList() << "4" << "3" << "2" << "1", Titles(items));
+}
+
+TEST_F(PlaylistSorterTest, IgnoresPrefixes) {
+  PlaylistItemList items;
+  items << Item("1", "The Zombies") << Item("2", "Queen")
+        << Item("3", "The Beatles");
+
+  PlaylistSorter(Playlist::Column_Artist, Qt::AscendingOrder,
+                 QStringList() << "the ")
+      .Sort(&items);
+  EXPECT_EQ(QStringList() << "3" << "2" << "1", Titles(items));
+}
+
+TEST_F(PlaylistSorterTest, LeavesItemsBeforeBegin) {
+  PlaylistItemList items;
+  items << Item("1", "c") << Item("2", "b") << Item("3", "a");
+
+  PlaylistSorter(Playlist::Column_Artist, Qt::AscendingOrder).Sort(&items, 1);
+  EXPECT_EQ(QStringList() << "1" << "3" << "2", Titles(items));
+}
+
+TEST_F(PlaylistSorterTest, LargePlaylistIsSortedStably) {
+  const int count = PlaylistSorter::kParallelThreshold * 2 + 7;
+
+  PlaylistItemList items;
+  for (int i = 0; i < count; ++i) {
+    items << Item(QString::number(i), QString(), QString(), -1, i % 13);
+  }
+
+  PlaylistSorter(Playlist::Column_Track, Qt::AscendingOrder).Sort(&items);
+
+  ASSERT_EQ(count, items.count());
+  for (int i = 1; i < count; ++i) {
+    const Song& a = items[i - 1]->Metadata();
+    const Song& b = items[i]->Metadata();
+    ASSERT_LE(a.track(), b.track());
+    if (a.track() == b.track()) {
+      ASSERT_LT(a.title().toInt(), b.title().toInt());
+    }
+  }
+}
+
+}  // namespace
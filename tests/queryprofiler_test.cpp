@@ -0,0 +1,127 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QString>
+#include <sqlite3.h>
+
+#include "core/queryprofiler.h"
+#include "test_utils.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+class QueryProfilerTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    ASSERT_EQ(SQLITE_OK, sqlite3_open(":memory:", &db_));
+    profiler_.Install(db_);
+    Exec("CREATE TABLE foo (a INTEGER, b TEXT)");
+    Exec("INSERT INTO foo VALUES (1, 'one'), (2, 'two'), (3, 'three')");
+  }
+
+  void TearDown() { sqlite3_close(db_); }
+
+  void Exec(const char* sql) {
+    char* errmsg = nullptr;
+    ASSERT_EQ(SQLITE_OK, sqlite3_exec(db_, sql, nullptr, nullptr, &errmsg))
+        << errmsg;
+  }
+
+  QueryProfiler::Stats Find(const QString& sql) {
+    for (const QueryProfiler::Stats& stats : profiler_.Results()) {
+      if (stats.sql_ == sql) return stats;
+    }
+    return QueryProfiler::Stats();
+  }
+
+  sqlite3* db_ = nullptr;
+  QueryProfiler profiler_;
+};
+
+TEST_F(QueryProfilerTest, DisabledByDefault) {
+  Exec("SELECT * FROM foo");
+  EXPECT_TRUE(profiler_.Results().isEmpty());
+}
+
+TEST_F(QueryProfilerTest, CountsStatements) {
+  profiler_.SetEnabled(true);
+  Exec("SELECT * FROM foo");
+  Exec("SELECT * FROM foo");
+  Exec("SELECT * FROM foo WHERE a = 2");
+
+  const QueryProfiler::Stats all = Find("SELECT * FROM foo");
+  EXPECT_EQ(2, all.count_);
+  EXPECT_LE(all.p99_nsec_, all.total_nsec_);
+#if SQLITE_VERSION_NUMBER >= 3014000
+  EXPECT_EQ(6, all.rows_);
+  EXPECT_EQ(1, Find("SELECT * FROM foo WHERE a = 2").rows_);
+#endif
+
+  profiler_.Reset();
+  EXPECT_TRUE(profiler_.Results().isEmpty());
+}
+
+#if SQLITE_VERSION_NUMBER >= 3014000
+TEST_F(QueryProfilerTest, ForgetsRowsOfUnfinishedStatements) {
+  profiler_.SetEnabled(true);
+
+  // Leave a statement half way through while profiling is turned off.
+  sqlite3_stmt* stmt = nullptr;
+  ASSERT_EQ(SQLITE_OK, sqlite3_prepare_v2(db_, "SELECT * FROM foo", -1, &stmt,
+                                          nullptr));
+  ASSERT_EQ(SQLITE_ROW, sqlite3_step(stmt));
+  profiler_.SetEnabled(false);
+  sqlite3_finalize(stmt);
+
+  profiler_.SetEnabled(true);
+  profiler_.Reset();
+  Exec("SELECT * FROM foo");
+  EXPECT_EQ(3, Find("SELECT * FROM foo").rows_);
+}
+#endif
+
+TEST_F(QueryProfilerTest, ExplainsSlowQueries) {
+  profiler_.SetEnabled(true);
+  profiler_.SetSlowQueryMsec(0);
+  Exec("SELECT * FROM foo WHERE a = 2");
+
+  // The plan is only worked out after sqlite has returned.
+  QueryProfiler::Stats stats = Find("SELECT * FROM foo WHERE a = 2");
+  EXPECT_EQ(1, stats.count_);
+  EXPECT_TRUE(stats.plan_.isEmpty());
+
+  profiler_.ExplainPending(db_);
+  EXPECT_FALSE(profiler_.has_pending());
+
+  stats = Find("SELECT * FROM foo WHERE a = 2");
+#if SQLITE_VERSION_NUMBER >= 3014000
+  EXPECT_TRUE(stats.plan_.contains("foo")) << stats.plan_.toStdString();
+#endif
+  // The EXPLAIN isn't profiled itself.
+  EXPECT_EQ(1, profiler_.Results().count());
+}
+
+TEST_F(QueryProfilerTest, KeepsLimitedNumberOfStatements) {
+  profiler_.SetEnabled(true);
+  for (int i = 0; i < QueryProfiler::kMaxStatements + 10; ++i) {
+    Exec(QString("SELECT * FROM foo WHERE a = %1").arg(i).toUtf8().constData());
+  }
+
+  EXPECT_EQ(QueryProfiler::kMaxStatements, profiler_.Results().count());
+}
+
+}  // namespace
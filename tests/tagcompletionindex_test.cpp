@@ -0,0 +1,208 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QStringList>
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+#include "core/database.h"
+#include "core/song.h"
+#include "library/library.h"
+#include "library/librarybackend.h"
+#include "library/tagcompletionindex.h"
+#include "test_utils.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+// Counts how often each column is loaded, and lets a test change the library
+// while a load is in progress.
+class TestTagCompletionIndex : public TagCompletionIndex {
+ public:
+  explicit TestTagCompletionIndex(LibraryBackend* backend)
+      : TagCompletionIndex(backend), load_count_(0) {}
+
+  int load_count_;
+  std::function<void()> after_load_;
+
+ protected:
+  QHash<QString, int> Load(const QString& column) override {
+    QHash<QString, int> ret = TagCompletionIndex::Load(column);
+    load_count_++;
+    if (after_load_) {
+      std::function<void()> after_load = after_load_;
+      after_load_ = nullptr;
+      after_load();
+    }
+    return ret;
+  }
+};
+
+class TagCompletionIndexTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    database_.reset(new MemoryDatabase(nullptr));
+    backend_.reset(new LibraryBackend);
+    backend_->Init(database_.get(), Library::kSongsTable, Library::kDirsTable,
+                   Library::kSubdirsTable, Library::kFtsTable);
+    backend_->AddDirectory("/tmp");
+
+    // Owned by the backend.
+    index_ = new TestTagCompletionIndex(backend_.get());
+  }
+
+  Song MakeSong(const QString& title, const QString& artist) {
+    Song ret;
+    ret.Init(title, artist, "Album", 123);
+    ret.set_directory_id(1);
+    ret.set_url(QUrl::fromLocalFile("/tmp/" + title + ".mp3"));
+    ret.set_mtime(1);
+    ret.set_ctime(1);
+    ret.set_filesize(1);
+    return ret;
+  }
+
+  Song GetSong(const QString& title) {
+    return backend_->GetSongByUrl(
+        QUrl::fromLocalFile("/tmp/" + title + ".mp3"));
+  }
+
+  std::unique_ptr<Database> database_;
+  std::unique_ptr<LibraryBackend> backend_;
+  TestTagCompletionIndex* index_;
+};
+
+TEST_F(TagCompletionIndexTest, SortedCaseInsensitively) {
+  backend_->AddOrUpdateSongs(SongList() << MakeSong("1", "beta")
+                                        << MakeSong("2", "Alpha")
+                                        << MakeSong("3", "Beta")
+                                        << MakeSong("4", "gamma")
+                                        << MakeSong("5", "Beta"));
+
+  // Values that only differ in case are both kept, but duplicates aren't.
+  const QStringList values = index_->Values("artist");
+  ASSERT_EQ(4, values.count());
+  EXPECT_EQ("Alpha", values[0]);
+  EXPECT_EQ(0, QString::compare("beta", values[1], Qt::CaseInsensitive));
+  EXPECT_EQ(0, QString::compare("beta", values[2], Qt::CaseInsensitive));
+  EXPECT_NE(values[1], values[2]);
+  EXPECT_EQ("gamma", values[3]);
+}
+
+TEST_F(TagCompletionIndexTest, PrefixesAreContiguous) {
+  backend_->AddOrUpdateSongs(SongList() << MakeSong("1", "The Beatles")
+                                        << MakeSong("2", "Blur")
+                                        << MakeSong("3", "the band")
+                                        << MakeSong("4", "Tom Waits")
+                                        << MakeSong("5", "THE CURE"));
+
+  // This is how QCompleter looks for completions in a sorted model.
+  const QStringList values = index_->Values("artist");
+  auto less = [](const QString& a, const QString& b) {
+    return QString::compare(a, b, Qt::CaseInsensitive) < 0;
+  };
+  auto it = std::lower_bound(values.begin(), values.end(), QString("the "),
+                             less);
+
+  QStringList matches;
+  for (; it != values.end() && it->startsWith("the ", Qt::CaseInsensitive);
+       ++it) {
+    matches << *it;
+  }
+  EXPECT_EQ(QStringList() << "the band"
+                          << "The Beatles"
+                          << "THE CURE",
+            matches);
+}
+
+TEST_F(TagCompletionIndexTest, DiscoveredSongsAreInserted) {
+  backend_->AddOrUpdateSongs(SongList() << MakeSong("1", "Alpha")
+                                        << MakeSong("2", "gamma"));
+  ASSERT_EQ(QStringList() << "Alpha"
+                          << "gamma",
+            index_->Values("artist"));
+
+  backend_->AddOrUpdateSongs(SongList() << MakeSong("3", "Beta")
+                                        << MakeSong("4", "ALPHA")
+                                        << MakeSong("5", "delta"));
+  const QStringList values = index_->Values("artist");
+  ASSERT_EQ(5, values.count());
+  EXPECT_TRUE(values.mid(0, 2).contains("Alpha"));
+  EXPECT_TRUE(values.mid(0, 2).contains("ALPHA"));
+  EXPECT_EQ(QStringList() << "Beta"
+                          << "delta"
+                          << "gamma",
+            values.mid(2));
+  EXPECT_EQ(1, index_->load_count_);
+}
+
+TEST_F(TagCompletionIndexTest, UpdatedSongsSwapValues) {
+  backend_->AddOrUpdateSongs(SongList() << MakeSong("1", "Alpha")
+                                        << MakeSong("2", "Beta"));
+  ASSERT_EQ(QStringList() << "Alpha"
+                          << "Beta",
+            index_->Values("artist"));
+
+  Song song = GetSong("1");
+  ASSERT_TRUE(song.is_valid());
+  song.set_artist("Gamma");
+  backend_->AddOrUpdateSongs(SongList() << song);
+
+  EXPECT_EQ(QStringList() << "Beta"
+                          << "Gamma",
+            index_->Values("artist"));
+  EXPECT_EQ(1, index_->load_count_);
+}
+
+TEST_F(TagCompletionIndexTest, DeletedValuesAreCounted) {
+  backend_->AddOrUpdateSongs(SongList() << MakeSong("1", "Alpha")
+                                        << MakeSong("2", "Alpha")
+                                        << MakeSong("3", "Beta"));
+  ASSERT_EQ(QStringList() << "Alpha"
+                          << "Beta",
+            index_->Values("artist"));
+
+  // Another song still has this artist.
+  backend_->DeleteSongs(SongList() << GetSong("1"));
+  EXPECT_EQ(QStringList() << "Alpha"
+                          << "Beta",
+            index_->Values("artist"));
+
+  backend_->DeleteSongs(SongList() << GetSong("2"));
+  EXPECT_EQ(QStringList() << "Beta", index_->Values("artist"));
+  EXPECT_EQ(1, index_->load_count_);
+}
+
+TEST_F(TagCompletionIndexTest, ChangesDuringLoad) {
+  backend_->AddOrUpdateSongs(SongList() << MakeSong("1", "Alpha"));
+
+  // The song is added after the load's query ran, so the loaded values are
+  // already out of date and mustn't be kept.
+  index_->after_load_ = [this]() {
+    backend_->AddOrUpdateSongs(SongList() << MakeSong("2", "Beta"));
+  };
+  EXPECT_EQ(QStringList() << "Alpha", index_->Values("artist"));
+
+  EXPECT_EQ(QStringList() << "Alpha"
+                          << "Beta",
+            index_->Values("artist"));
+  EXPECT_EQ(2, index_->load_count_);
+}
+
+}  // namespace
@@ -0,0 +1,187 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gst/app/gstappsink.h>
+#include <gst/gst.h>
+
+#include <QDataStream>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include "core/timeconstants.h"
+#include "test_utils.h"
+#include "transcoder/transcoder.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+const int kSampleRate = 44100;
+const int kChannels = 2;
+
+class TranscoderTest : public ::testing::Test {
+ protected:
+  static void SetUpTestCase() { gst_init(nullptr, nullptr); }
+
+  void SetUp() {
+    ASSERT_TRUE(dir_.isValid());
+    input_ = dir_.path() + "/input.wav";
+  }
+
+  static bool HaveFlacEncoder() {
+    return !Transcoder::GetEncoderFactoryForMimeType(
+                Transcoder::MimeType(Transcoder::Codec_Flac))
+                .isEmpty();
+  }
+
+  // Writes a 16 bit stereo WAV file full of noise, so no two FLAC blocks are
+  // the same.
+  void WriteInput(int seconds) {
+    pcm_.clear();
+    QDataStream samples(&pcm_, QIODevice::WriteOnly);
+    samples.setByteOrder(QDataStream::LittleEndian);
+
+    quint32 seed = 1;
+    for (int i = 0; i < kSampleRate * seconds * kChannels; ++i) {
+      seed = seed * 1103515245 + 12345;
+      samples << qint16(seed >> 16);
+    }
+
+    QFile file(input_);
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    QDataStream s(&file);
+    s.setByteOrder(QDataStream::LittleEndian);
+    s.writeRawData("RIFF", 4);
+    s << quint32(36 + pcm_.size());
+    s.writeRawData("WAVEfmt ", 8);
+    s << quint32(16) << quint16(1) << quint16(kChannels)
+      << quint32(kSampleRate) << quint32(kSampleRate * kChannels * 2)
+      << quint16(kChannels * 2) << quint16(16);
+    s.writeRawData("data", 4);
+    s << quint32(pcm_.size());
+    s.writeRawData(pcm_.constData(), pcm_.size());
+  }
+
+  // Transcodes the input to FLAC, and returns whether it worked.
+  bool Transcode(const QString& output, int threads,
+                 qint64 min_segment_length, QStringList* log = nullptr) {
+    Transcoder transcoder;
+    transcoder.set_max_threads(threads);
+    transcoder.set_min_segment_length(min_segment_length);
+    transcoder.AddJob(QUrl::fromLocalFile(input_),
+                      Transcoder::PresetForFileType(Song::Type_Flac), output,
+                      true);
+
+    QSignalSpy complete(&transcoder,
+                        SIGNAL(JobComplete(QUrl, QString, bool)));
+    QSignalSpy all_complete(&transcoder, SIGNAL(AllJobsComplete()));
+    QSignalSpy log_lines(&transcoder, SIGNAL(LogLine(QString)));
+
+    transcoder.Start();
+    if (all_complete.isEmpty() && !all_complete.wait(60000)) return false;
+
+    if (log) {
+      for (const QList<QVariant>& line : log_lines) {
+        *log << line[0].toString();
+      }
+    }
+    return complete.count() == 1 && complete[0][2].toBool();
+  }
+
+  // Decodes a file to interleaved 16 bit samples.
+  static QByteArray Decode(const QString& filename) {
+    GstElement* pipeline = gst_parse_launch(
+        "filesrc name=src ! decodebin ! audioconvert ! "
+        "audio/x-raw,format=S16LE ! appsink name=sink sync=false",
+        nullptr);
+    GstElement* src = gst_bin_get_by_name(GST_BIN(pipeline), "src");
+    GstElement* sink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+    g_object_set(src, "location", filename.toUtf8().constData(), nullptr);
+
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+
+    QByteArray ret;
+    while (GstSample* sample = gst_app_sink_try_pull_sample(
+               GST_APP_SINK(sink), 10 * GST_SECOND)) {
+      GstMapInfo map;
+      GstBuffer* buffer = gst_sample_get_buffer(sample);
+      if (gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+        ret.append(reinterpret_cast<const char*>(map.data), map.size);
+        gst_buffer_unmap(buffer, &map);
+      }
+      gst_sample_unref(sample);
+    }
+
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(src);
+    gst_object_unref(sink);
+    gst_object_unref(pipeline);
+    return ret;
+  }
+
+  QTemporaryDir dir_;
+  QString input_;
+  QByteArray pcm_;
+};
+
+TEST_F(TranscoderTest, SplitFlacIsSampleExact) {
+  if (!HaveFlacEncoder()) return;
+  WriteInput(20);
+
+  const QString single = dir_.path() + "/single.flac";
+  const QString split = dir_.path() + "/split.flac";
+  QStringList log;
+  ASSERT_TRUE(Transcode(single, 1, 0));
+  ASSERT_TRUE(Transcode(split, 4, 4 * kNsecPerSec, &log));
+  EXPECT_EQ(1, log.filter("in 4 parts").count());
+
+  const QByteArray expected = Decode(single);
+  EXPECT_EQ(pcm_.size(), expected.size());
+  EXPECT_TRUE(expected == pcm_);
+
+  const QByteArray actual = Decode(split);
+  EXPECT_EQ(expected.size(), actual.size());
+  EXPECT_TRUE(actual == expected);
+}
+
+TEST_F(TranscoderTest, SplitFlacWithShortLastPart) {
+  if (!HaveFlacEncoder()) return;
+  WriteInput(13);
+
+  // 13 seconds in 3 parts is 2 parts of 221184 samples and one of 130932.
+  const QString split = dir_.path() + "/split.flac";
+  QStringList log;
+  ASSERT_TRUE(Transcode(split, 3, 4 * kNsecPerSec, &log));
+  EXPECT_EQ(1, log.filter("in 3 parts").count());
+
+  const QByteArray actual = Decode(split);
+  EXPECT_EQ(pcm_.size(), actual.size());
+  EXPECT_TRUE(actual == pcm_);
+}
+
+TEST_F(TranscoderTest, ShortFilesAreNotSplit) {
+  if (!HaveFlacEncoder()) return;
+  WriteInput(7);
+
+  const QString output = dir_.path() + "/output.flac";
+  QStringList log;
+  ASSERT_TRUE(Transcode(output, 4, 4 * kNsecPerSec, &log));
+  EXPECT_TRUE(log.filter("parts").isEmpty());
+  EXPECT_TRUE(Decode(output) == pcm_);
+}
+
+}  // namespace
@@ -0,0 +1,244 @@
+/* This file is part of Clementine.
+
+   Clementine is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Clementine is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Clementine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QAtomicInt>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSemaphore>
+#include <QStringList>
+#include <QThread>
+
+#include "core/workscheduler.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+int Add(int a, int b) { return a + b; }
+
+// Counts how many jobs are running at once, and how many have run.
+class ConcurrencyCounter {
+ public:
+  ConcurrencyCounter() : running_(0), max_running_(0), count_(0) {}
+
+  void Start() {
+    QMutexLocker l(&mutex_);
+    max_running_ = qMax(max_running_, ++running_);
+    count_++;
+  }
+
+  void Finish() {
+    QMutexLocker l(&mutex_);
+    running_--;
+  }
+
+  void Run() {
+    Start();
+    QThread::msleep(20);
+    Finish();
+  }
+
+  int max_running() {
+    QMutexLocker l(&mutex_);
+    return max_running_;
+  }
+
+  int count() {
+    QMutexLocker l(&mutex_);
+    return count_;
+  }
+
+ private:
+  QMutex mutex_;
+  int running_;
+  int max_running_;
+  int count_;
+};
+
+TEST(WorkSchedulerTest, RunReturnsResult) {
+  WorkScheduler scheduler(2);
+  QFuture<int> future = scheduler.Run<int, int, int>(
+      WorkScheduler::Priority_Normal, &Add, 1300, 37);
+  scheduler.WaitForFinished(future);
+  EXPECT_EQ(1337, future.result());
+}
+
+TEST(WorkSchedulerTest, DefaultLimitsLeaveRoomForInteractiveJobs) {
+  WorkScheduler scheduler(4);
+  EXPECT_EQ(4, scheduler.limit(WorkScheduler::Priority_Interactive));
+  EXPECT_EQ(3, scheduler.limit(WorkScheduler::Priority_Normal));
+  EXPECT_EQ(2, scheduler.limit(WorkScheduler::Priority_Idle));
+}
+
+TEST(WorkSchedulerTest, HigherClassesGoFirst) {
+  WorkScheduler scheduler(1);
+
+  // Keep the only worker busy while the other jobs are queued.
+  QSemaphore started;
+  QSemaphore release;
+  scheduler.Run<void>(WorkScheduler::Priority_Interactive, [&]() {
+    started.release();
+    release.acquire();
+  });
+  started.acquire();
+
+  QMutex mutex;
+  QStringList order;
+  auto record = [&](const QString& name) {
+    return [&mutex, &order, name]() {
+      QMutexLocker l(&mutex);
+      order << name;
+    };
+  };
+
+  QList<QFuture<void>> futures;
+  futures << scheduler.Run<void>(WorkScheduler::Priority_Idle, record("idle"));
+  futures << scheduler.Run<void>(WorkScheduler::Priority_Normal,
+                                 record("normal"));
+  futures << scheduler.Run<void>(WorkScheduler::Priority_Interactive,
+                                 record("interactive"));
+
+  release.release();
+  for (const QFuture<void>& future : futures) {
+    scheduler.WaitForFinished(future);
+  }
+
+  EXPECT_EQ(QStringList() << "interactive"
+                          << "normal"
+                          << "idle",
+            order);
+}
+
+TEST(WorkSchedulerTest, LimitsIncludeLowerClasses) {
+  WorkScheduler scheduler(4);
+  scheduler.set_limit(WorkScheduler::Priority_Normal, 2);
+  scheduler.set_limit(WorkScheduler::Priority_Idle, 1);
+
+  ConcurrencyCounter idle;
+  ConcurrencyCounter normal;
+  ConcurrencyCounter all;
+  QList<QFuture<void>> futures;
+  for (int i = 0; i < 8; ++i) {
+    futures << scheduler.Run<void>(WorkScheduler::Priority_Idle, [&]() {
+      all.Start();
+      idle.Run();
+      all.Finish();
+    });
+    futures << scheduler.Run<void>(WorkScheduler::Priority_Normal, [&]() {
+      all.Start();
+      normal.Run();
+      all.Finish();
+    });
+  }
+  for (const QFuture<void>& future : futures) {
+    scheduler.WaitForFinished(future);
+  }
+
+  EXPECT_EQ(8, idle.count());
+  EXPECT_EQ(8, normal.count());
+  EXPECT_EQ(1, idle.max_running());
+  // A running idle job takes one of the normal class's two places.
+  EXPECT_EQ(2, all.max_running());
+
+  WorkScheduler::Stats stats = scheduler.GetStats();
+  for (int i = 0; i < WorkScheduler::kPriorityCount; ++i) {
+    EXPECT_EQ(0, stats.queued_[i]);
+  }
+}
+
+TEST(WorkSchedulerTest, WaitingJobsRunOtherJobs) {
+  // With only one place for idle jobs, a job that blocked its worker while
+  // it waited for others would never finish.
+  WorkScheduler scheduler(2);
+  scheduler.set_limit(WorkScheduler::Priority_Idle, 1);
+
+  QAtomicInt done(0);
+  QFuture<void> parent =
+      scheduler.Run<void>(WorkScheduler::Priority_Idle, [&]() {
+        QList<QFuture<void>> children;
+        for (int i = 0; i < 10; ++i) {
+          children << scheduler.Run<void>(
+              WorkScheduler::Priority_Idle,
+              [&done]() { done.fetchAndAddOrdered(1); });
+        }
+        for (const QFuture<void>& child : children) {
+          scheduler.WaitForFinished(child);
+        }
+      });
+  scheduler.WaitForFinished(parent);
+
+  EXPECT_EQ(10, done.load());
+}
+
+TEST(WorkSchedulerTest, WaitingJobsOnlyRunHigherClasses) {
+  WorkScheduler scheduler(1);
+
+  QAtomicInt release(0);
+  QAtomicInt idle_ran_while_waiting(0);
+  QFuture<void> idle;
+  QFuture<void> parent =
+      scheduler.Run<void>(WorkScheduler::Priority_Interactive, [&]() {
+        idle = scheduler.Run<void>(WorkScheduler::Priority_Idle, [&]() {
+          idle_ran_while_waiting.store(release.load() == 0);
+        });
+        scheduler.HelpUntil([&release]() { return release.load() != 0; });
+      });
+
+  QThread::msleep(50);
+  release.store(1);
+  scheduler.WaitForFinished(parent);
+  scheduler.WaitForFinished(idle);
+
+  EXPECT_EQ(0, idle_ran_while_waiting.load());
+}
+
+TEST(WorkSchedulerTest, SerialQueueKeepsOrder) {
+  WorkScheduler scheduler(4);
+  WorkQueue queue(WorkScheduler::Priority_Normal, 1, &scheduler);
+
+  QList<int> order;
+  ConcurrencyCounter counter;
+  for (int i = 0; i < 20; ++i) {
+    queue.Run<void>([&order, &counter, i]() {
+      counter.Run();
+      order << i;
+    });
+  }
+  queue.WaitForDone();
+
+  ASSERT_EQ(20, order.count());
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_EQ(i, order[i]);
+  }
+  EXPECT_EQ(1, counter.max_running());
+  EXPECT_EQ(0, queue.active_count());
+}
+
+TEST(WorkSchedulerTest, QueueLimitsConcurrency) {
+  WorkScheduler scheduler(4);
+  WorkQueue queue(WorkScheduler::Priority_Interactive, 2, &scheduler);
+
+  ConcurrencyCounter counter;
+  for (int i = 0; i < 8; ++i) {
+    queue.Run<void>([&counter]() { counter.Run(); });
+  }
+  queue.WaitForDone();
+
+  EXPECT_EQ(2, counter.max_running());
+}
+
+}  // namespace